@@ -455,6 +455,47 @@ fldty(struct symtab *p)
 {
 }
 
+/*
+ * clz and rbit do leading and trailing zeros; no scalar popcount.
+ */
+int
+mybitop(int op, TWORD t)
+{
+	return op != POPCNT;
+}
+
+/*
+ * Operations on 128-bit vectors of element type t that are done
+ * with NEON instructions.  SCONV is the splat of a scalar.
+ * Less-than is done by swapping operands.
+ */
+int
+vecxop(int op, TWORD t)
+{
+	switch (op) {
+	case SCONV:
+	case PLUS:
+	case MINUS:
+	case UMINUS:
+	case EQ:
+	case GT:
+	case GE:
+		return 1;
+	case MUL: /* no 64-bit lanes */
+		return ISFTY(t) || tsize(t, NULL, NULL) < SZLONG;
+	case DIV:
+		return ISFTY(t);
+	case AND:
+	case OR:
+	case ER:
+	case COMPL:
+	case LS:
+	case RS:
+		return !ISFTY(t);
+	}
+	return 0;
+}
+
 /*
  * Build target-dependent switch tree/table.
  *
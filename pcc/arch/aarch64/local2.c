@@ -48,7 +48,8 @@ char *rnames[] = {
 	"x8", "x9", "x10","x11","x12","x13","x14", 
 	"x15", "x16","x17","x18","x19","x20", "x21",
 	"x22","x23","x24","x25","x26","x27","x28",
-	"x29","x30","sp",
+	"x29","x30","sp", "", "",
+	"v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23",
 };
 
 /*
@@ -587,6 +588,127 @@ argsiz(NODE *p)
 	return 0;
 }
 
+/*
+ * prfm only scales a register index by 1 or 8, else form the address.
+ */
+static void
+prefetch(NODE *p)
+{
+	static char *loc[] = { "l1strm", "l3keep", "l2keep", "l1keep" };
+	NODE *l = p->n_left;
+	int r = l->n_rval;
+
+	if (l->n_op == OREG && R2TEST(r) &&
+	    R2UPK3(r) != 0 && R2UPK3(r) != 3) {
+		printf("\tadd %s,%s,%s,lsl #%d\n", rnames[DECRA(p->n_reg, 1)],
+		    rnames[R2UPK1(r)], rnames[R2UPK2(r)], R2UPK3(r));
+		printf("\tprfm p%s%s,[%s]\n", p->n_rval & PF_WRITE ? "st" : "ld",
+		    loc[p->n_rval & 3], rnames[DECRA(p->n_reg, 1)]);
+		return;
+	}
+	printf("\tprfm p%s%s,", p->n_rval & PF_WRITE ? "st" : "ld",
+	    loc[p->n_rval & 3]);
+	adrput(stdout, l);
+	printf("\n");
+}
+
+/*
+ * Emit NEON instructions for an operation on a 128-bit vector.
+ * The element type is in the vector attribute of the node.
+ */
+static void
+neon(NODE *p)
+{
+	struct attr *ap;
+	NODE *l = getlr(p, 'L'), *r = getlr(p, 'R');
+	char *s, *ar, *d;
+	TWORD t;
+	int fp, us, n;
+
+	if ((ap = attr_find(p->n_ap, ATTR_VECTOR)) == NULL)
+		comperr("neon");
+	t = ap->iarg(1);
+	fp = (t == FLOAT || t == DOUBLE);
+	us = ISUNSIGNED(t);
+	ar = t <= UCHAR ? "16b" : t <= USHORT ? "8h" :
+	    t <= UNSIGNED || t == FLOAT ? "4s" : "2d";
+	d = rnames[DECRA(p->n_reg, 1)];
+
+	switch (p->n_op) {
+	case NAME:
+	case OREG:
+	case UMUL:
+		printf("\tldr q%d,", DECRA(p->n_reg, 1) - V16 + 16);
+		adrput(stdout, l);
+		printf("\n");
+		return;
+
+	case ASSIGN:
+		n = r->n_rval - V16 + 16;
+		if (l->n_op == NAME) {
+			expand(p, 0, "\tadrp A1,AL\n\tadd A1,A1,:lo12:AL\n");
+			printf("\tstr q%d,[%s]\n", n, d);
+		} else {
+			printf("\tstr q%d,", n);
+			adrput(stdout, l);
+			printf("\n");
+		}
+		return;
+
+	case PLUS: s = fp ? "fadd" : "add"; break;
+	case MINUS: s = fp ? "fsub" : "sub"; break;
+	case MUL: s = fp ? "fmul" : "mul"; break;
+	case DIV: s = "fdiv"; break;
+	case EQ: s = fp ? "fcmeq" : "cmeq"; break;
+	case GT: s = fp ? "fcmgt" : us ? "cmhi" : "cmgt"; break;
+	case GE: s = fp ? "fcmge" : us ? "cmhs" : "cmge"; break;
+	case AND: s = "and"; ar = "16b"; break;
+	case OR: s = "orr"; ar = "16b"; break;
+	case ER: s = "eor"; ar = "16b"; break;
+
+	case UMINUS:
+		printf("\t%s %s.%s,%s.%s\n", fp ? "fneg" : "neg",
+		    d, ar, rnames[l->n_rval], ar);
+		return;
+
+	case COMPL:
+		printf("\tnot %s.16b,%s.16b\n", d, rnames[l->n_rval]);
+		return;
+
+	case LS:
+	case RS:
+		if (r->n_op == ICON) {
+			n = (int)getlval(r);
+			if (p->n_op == RS && n == 0)
+				printf("\tmov %s.16b,%s.16b\n",
+				    d, rnames[l->n_rval]);
+			else
+				printf("\t%s %s.%s,%s.%s,#%d\n",
+				    p->n_op == LS ? "shl" : us ? "ushr" : "sshr",
+				    d, ar, rnames[l->n_rval], ar, n);
+			return;
+		}
+		/* shift by a negative count to the right */
+		printf("\tdup %s.%s,%s\n", d, ar, ar[0] == '2' ?
+		    rnames[r->n_rval] : wnames[r->n_rval]);
+		if (p->n_op == RS)
+			printf("\tneg %s.%s,%s.%s\n", d, ar, d, ar);
+		printf("\t%s %s.%s,%s.%s,%s.%s\n", us ? "ushl" : "sshl",
+		    d, ar, rnames[l->n_rval], ar, d, ar);
+		return;
+
+	case SCONV: /* splat */
+		printf("\tdup %s.%s,%s\n", d, ar, gclass(l->n_type) == CLASSB ?
+		    rnames[l->n_rval-R16] : wnames[l->n_rval]);
+		return;
+
+	default:
+		comperr("neon op %d", p->n_op);
+	}
+	printf("\t%s %s.%s,%s.%s,%s.%s\n", s, d, ar,
+	    rnames[l->n_rval], ar, rnames[r->n_rval], ar);
+}
+
 void
 zzzcode(NODE *p, int c)
 {
@@ -630,10 +752,18 @@ zzzcode(NODE *p, int c)
 			    getlval(p) & 0xffffffffffffffff);
 			break;
 
+		case 'P': /* prefetch */
+			prefetch(p);
+			break;
+
 		case 'Q': /* emit struct assign */
 			stasg(p);
 			break;
 
+		case 'V': /* NEON vector instruction */
+			neon(p);
+			break;
+
 		default:
 			comperr("zzzcode %c", c);
 	}
@@ -1031,6 +1161,9 @@ void
 rmove(int s, int d, TWORD t)
 {
         switch (t) {
+		case XTYPE:
+			printf("\tmov %s.16b,%s.16b\n", rnames[d], rnames[s]);
+			break;
 		case DOUBLE:
 		case LDOUBLE:
 			if (features(FEATURE_HARDFLOAT)) {
@@ -1097,6 +1230,8 @@ COLORMAP(int c, int *r)
 		case CLASSC:
 	        	num += r[CLASSC];
    			return num < 8;
+		case CLASSD:
+			return r[CLASSD] < 8;
 	}
 	cerror("colormap 2");
 	return 0; /* XXX gcc */
@@ -1108,6 +1243,8 @@ COLORMAP(int c, int *r)
 int
 gclass(TWORD t)
 {
+	if (t == XTYPE)
+		return CLASSD;
 	if (t == DOUBLE || t == LDOUBLE) {
 		if (features(FEATURE_HARDFLOAT))
 			return CLASSC;
@@ -37,6 +37,7 @@
 #define SZSHORT         16
 #define SZLONGLONG      64
 #define SZPOINT(t)      64
+#define SZXTYPE         128	/* NEON vectors */
 
 /*
  * Alignment constraints
@@ -51,6 +52,7 @@
 #define ALLONGLONG      32
 #define ALSHORT         16
 #define ALPOINT         32
+#define ALXTYPE         128
 #define ALSTRUCT        32
 #define ALSTACK         32
 
@@ -97,7 +99,8 @@ typedef long long OFFSZ;
 #define STOSTARG(p)
 
 #define	szty(t)	(((t) == DOUBLE || (t) == LDOUBLE || \
-	(t) == LONG || (t) == ULONG || (t) == LONGLONG || (t) == ULONGLONG) ? 2 : 1)
+	(t) == LONG || (t) == ULONG || (t) == LONGLONG || (t) == ULONGLONG) ? 2 : \
+	(t) == XTYPE ? 4 : 1)
 
 #define R0	0
 #define R1	1
@@ -137,8 +140,18 @@ typedef long long OFFSZ;
 #define SP	R31
 #define LR	R30
 
-#define NUMCLASS 3
-#define	MAXREGS  34	
+/* NEON registers for vectors, class D */
+#define V16	34
+#define V17	35
+#define V18	36
+#define V19	37
+#define V20	38
+#define V21	39
+#define V22	40
+#define V23	41
+
+#define NUMCLASS 4
+#define	MAXREGS  42
 
 #define RSTATUS \
 	SAREG|TEMPREG, SAREG|TEMPREG, SAREG|TEMPREG, SAREG|TEMPREG,	\
@@ -149,6 +162,8 @@ typedef long long OFFSZ;
         SBREG, SBREG, SBREG, SBREG, SBREG, SBREG,			\
 	SCREG, SCREG, SCREG, SCREG,					\
 	SCREG, SCREG, SCREG, SCREG,					\
+	SDREG|TEMPREG, SDREG|TEMPREG, SDREG|TEMPREG, SDREG|TEMPREG,	\
+	SDREG|TEMPREG, SDREG|TEMPREG, SDREG|TEMPREG, SDREG|TEMPREG,	\
 
 /* no overlapping registers at all */
 #define ROVERLAP \
@@ -156,13 +171,15 @@ typedef long long OFFSZ;
         { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, \
         { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, \
         { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, \
-        { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 },
+        { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, \
+        { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 },
 
 #define ARGINIT		(16*8)	/* # bits above fp where arguments start */
 #define AUTOINIT	(32*8)	/* # bits above fp where automatics start */
 
 #undef	FIELDOPS		/* no bit-field instructions */
 #define TARGET_ENDIAN TARGET_LE
+#define	MYBITOP		/* clz, rbit */
 
 /* XXX - to die */
 #define FPREG   FP	/* frame pointer */
@@ -171,7 +188,8 @@ typedef long long OFFSZ;
 /* Return a register class based on the type of the node */
 #define PCLASS(p)	(1 << gclass((p)->n_type))
 
-#define GCLASS(x)	(x < 16 ? CLASSA : x < 26 ? CLASSB : CLASSC)
+#define GCLASS(x)	(x < 16 ? CLASSA : x < 26 ? CLASSB : \
+			 x < V16 ? CLASSC : CLASSD)
 #define DECRA(x,y)      (((x) >> (y*6)) & 63)   /* decode encoded regs */
 #define ENCRD(x)        (x)             /* Encode dest reg in n_reg */
 #define ENCRA1(x)       ((x) << 6)      /* A1 */
@@ -36,6 +36,7 @@
 #define	NAREG	NEEDS(NREG(A, 1))
 #define	NBREG	NEEDS(NREG(B, 1))
 #define	NCREG	NEEDS(NREG(C, 1))
+#define	NDREG	NEEDS(NREG(D, 1))
 
 struct optab table[] = {
 /* First entry must be an empty entry */
@@ -1809,6 +1810,38 @@ struct optab table[] = {
 		XSL(B),	RESC1,
 		"	mvn A1,AL" COM "64-bit complement\n", },
 
+{ CLZ,	INAREG,
+	SAREG,	TWORD,
+	SANY,	TANY,
+		NAREG,	RESC1,
+		"	clz A1,AL" COM "count leading zeros\n", },
+
+{ CLZ,	INBREG,
+	SBREG,	TLONGLONG|TULONGLONG,
+	SANY,	TANY,
+		NBREG,	RESC1,
+		"	clz A1,AL" COM "64-bit count leading zeros\n", },
+
+{ CTZ,	INAREG,
+	SAREG,	TWORD,
+	SANY,	TANY,
+		NAREG,	RESC1,
+		"	rbit A1,AL" COM "count trailing zeros\n"
+		"	clz A1,A1\n", },
+
+{ CTZ,	INBREG,
+	SBREG,	TLONGLONG|TULONGLONG,
+	SANY,	TANY,
+		NBREG,	RESC1,
+		"	rbit A1,AL" COM "64-bit count trailing zeros\n"
+		"	clz A1,A1\n", },
+
+{ PREFETCH,	FOREFF,
+	SOREG|SNAME,	TANY,
+	SANY,	TANY,
+		NAREG,	0,
+		"ZP", },
+
 /*
  * Arguments to functions.
  */
@@ -1837,6 +1870,88 @@ struct optab table[] = {
                 0,      0,
 		"	stmfd sp!,{AL,UL}" COM "save function arg to stack (endianness problem here?)\n", },
 
+/*
+ * NEON vectors.
+ */
+{ OPLTYPE,	INDREG,
+	SANY,		TANY,
+	SOREG|SNAME,	TXTYPE,
+		NDREG,	RESC1,
+		"ZV", },
+
+{ UMUL,	INDREG,
+	SANY,	TANY,
+	SOREG,	TXTYPE,
+		NDREG,	RESC1,
+		"ZV", },
+
+{ ASSIGN,	FOREFF|INDREG,
+	SOREG,	TXTYPE,
+	SDREG,	TXTYPE,
+		0,	RDEST,
+		"ZV", },
+
+{ ASSIGN,	FOREFF|INDREG,
+	SNAME,	TXTYPE,
+	SDREG,	TXTYPE,
+		NAREG,	RDEST,
+		"ZV", },
+
+{ ASSIGN,	FOREFF|INDREG,
+	SDREG,	TXTYPE,
+	SDREG,	TXTYPE,
+		0,	RDEST,
+		"	mov AL.16b,AR.16b\n", },
+
+{ OPSIMP,	INDREG,
+	SDREG,	TXTYPE,
+	SDREG,	TXTYPE,
+		XSL(D),	RESC1,
+		"ZV", },
+
+{ OPMUL,	INDREG,
+	SDREG,	TXTYPE,
+	SDREG,	TXTYPE,
+		XSL(D),	RESC1,
+		"ZV", },
+
+{ OPLOG,	INDREG,
+	SDREG,	TXTYPE,
+	SDREG,	TXTYPE,
+		XSL(D),	RESC1,
+		"ZV", },
+
+{ OPSHFT,	INDREG,
+	SDREG,	TXTYPE,
+	SCON,	TANY,
+		XSL(D),	RESC1,
+		"ZV", },
+
+{ OPSHFT,	INDREG,
+	SDREG,	TXTYPE,
+	SAREG,	TWORD,
+		NDREG,	RESC1,
+		"ZV", },
+
+{ UMINUS,	INDREG,
+	SDREG,	TXTYPE,
+	SDREG,	TXTYPE,
+		XSL(D),	RESC1,
+		"ZV", },
+
+{ COMPL,	INDREG,
+	SDREG,	TXTYPE,
+	SDREG,	TXTYPE,
+		XSL(D),	RESC1,
+		"ZV", },
+
+/* splat a scalar */
+{ SCONV,	INDREG,
+	SAREG|SBREG,	TANY,
+	SDREG,		TXTYPE,
+		NDREG,	RESC1,
+		"ZV", },
+
 # define DF(x) FORREW,SANY,TANY,SANY,TANY,NEEDS(NREWRITE),x,""
 
 { UMUL, DF( UMUL ), },
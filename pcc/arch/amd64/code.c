@@ -52,7 +52,7 @@
 static int nsse, ngpr, nrsp, rsaoff;
 static int thissse, thisgpr, thisrsp;
 enum { NO_CLASS, INTEGER, INTMEM, SSE, SSEMEM, X87,
-	STRREG, STRMEM, STRSSE, STRIF, STRFI, STRX87 };
+	STRREG, STRMEM, STRSSE, STRIF, STRFI, STRX87, STRXMM };
 static const int argregsi[] = { RDI, RSI, RDX, RCX, R08, R09 };
 /*
  * The Register Save Area looks something like this.
@@ -86,6 +86,7 @@ static int varneeds;
 static int argtyp(TWORD t, union dimfun *df, struct ssdesc *ap);
 static NODE *movtomem(NODE *p, int off, int reg);
 static NODE *movtoreg(NODE *p, int rno);
+static NODE *xmovreg(NODE *p, int rno, int tomem);
 void varattrib(char *name, struct attr *sap);
 
 /*
@@ -209,6 +210,10 @@ efcode(void)
 		regno(p) = RAX;
 		p = buildtree(UMUL, p, NIL);
 		ecomp(movtoreg(p, 040));
+	} else if (typ == STRXMM) {
+		p = block(REG, NIL, NIL, INCREF(XTYPE), 0, 0);
+		regno(p) = RAX;
+		ecomp(xmovreg(p, XMM0, 0));
 	} else {
 		TWORD t1, t2;
 		int r1, r2;
@@ -322,6 +327,17 @@ bfcode(struct symtab **s, int cnt)
 			nrsp += SZLDOUBLE;
 			break;
 
+		case STRXMM: /* vector in one SSE register */
+			autooff += SZXTYPE;
+			SETOFF(autooff, ALXTYPE);
+			r = block(REG, NIL, NIL, INCREF(XTYPE), 0, 0);
+			regno(r) = FPREG;
+			r = block(PLUS, r, xbcon(-autooff/SZCHAR, NULL, LONG),
+			    INCREF(XTYPE), 0, 0);
+			ecomp(xmovreg(r, XMM0 + nsse++, 1));
+			sp->soffset = -autooff;
+			break;
+
 		case STRFI:
 		case STRIF:
 		case STRSSE:
@@ -409,70 +425,106 @@ ejobcode(int flag)
 #define	P(x) printf(PRTPREF x "\n")
 	/* printout varargs routines if used */
 	if (varneeds & NEED_STRFI) {	/* struct with one float and then int */
-		P(".text\n.align 4");
+		P(".text");
+		P(".align 4");
 		PT("strif");
 		P("__pcc_strif:");
-		P("cmpl $176,4(%%rdi)\njae .Ladd16");
-		P("cmpl $48,(%%rdi)\njae .Ladd16\n");
-		P("movl 4(%%rdi),%%eax\naddq 16(%%rdi),%%rax");
-		P("movq (%%rax),%%rdx\nmovq %%rdx,24(%%rdi)");
-		P("movl (%%rdi),%%eax\naddq 16(%%rdi),%%rax");
-		P("movq 16(%%rax),%%rdx\nmovq %%rdx,32(%%rdi)");
-		P("leaq 24(%%rdi),%%rax\nret");
+		P("cmpl $176,4(%%rdi)");
+		P("jae .Ladd16");
+		P("cmpl $48,(%%rdi)");
+		P("jae .Ladd16");
+		P("movl 4(%%rdi),%%eax");
+		P("addq 16(%%rdi),%%rax");
+		P("movq (%%rax),%%rdx");
+		P("movq %%rdx,24(%%rdi)");
+		P("movl (%%rdi),%%eax");
+		P("addq 16(%%rdi),%%rax");
+		P("movq 16(%%rax),%%rdx");
+		P("movq %%rdx,32(%%rdi)");
+		P("leaq 24(%%rdi),%%rax");
+		P("ret");
 	}
 	if (varneeds & NEED_STRIF) {	/* struct with one int and one float */
-		P(".text\n.align 4");
+		P(".text");
+		P(".align 4");
 		PT("strif");
 		P("__pcc_strif:");
-		P("cmpl $176,4(%%rdi)\njae .Ladd16");
-		P("cmpl $48,(%%rdi)\njae .Ladd16\n");
-		P("movl (%%rdi),%%eax\naddq 16(%%rdi),%%rax");
-		P("movq (%%rax),%%rdx\nmovq %%rdx,24(%%rdi)");
-		P("movl 4(%%rdi),%%eax\naddq 16(%%rdi),%%rax");
-		P("movq 16(%%rax),%%rdx\nmovq %%rdx,32(%%rdi)");
-		P("leaq 24(%%rdi),%%rax\nret");
+		P("cmpl $176,4(%%rdi)");
+		P("jae .Ladd16");
+		P("cmpl $48,(%%rdi)");
+		P("jae .Ladd16");
+		P("movl (%%rdi),%%eax");
+		P("addq 16(%%rdi),%%rax");
+		P("movq (%%rax),%%rdx");
+		P("movq %%rdx,24(%%rdi)");
+		P("movl 4(%%rdi),%%eax");
+		P("addq 16(%%rdi),%%rax");
+		P("movq 16(%%rax),%%rdx");
+		P("movq %%rdx,32(%%rdi)");
+		P("leaq 24(%%rdi),%%rax");
+		P("ret");
 	}
 	if (varneeds & NEED_2FPREF) {	/* struct with two float regs */
-		P(".text\n.align 4");
+		P(".text");
+		P(".align 4");
 		PT("2fpref");
 		P("__pcc_2fpref:");
-		P("cmpl $160,4(%%rdi)\njae .Ladd16");
-		P("movl 4(%%rdi),%%eax\naddq 16(%%rdi),%%rax");
+		P("cmpl $160,4(%%rdi)");
+		P("jae .Ladd16");
+		P("movl 4(%%rdi),%%eax");
+		P("addq 16(%%rdi),%%rax");
 		P("addl $32,4(%%rdi)");
-		P("movq (%%rax),%%rdx\nmovq %%rdx,24(%%rdi)");
-		P("movq 16(%%rax),%%rdx\nmovq %%rdx,32(%%rdi)");
-		P("leaq 24(%%rdi),%%rax\nret");
+		P("movq (%%rax),%%rdx");
+		P("movq %%rdx,24(%%rdi)");
+		P("movq 16(%%rax),%%rdx");
+		P("movq %%rdx,32(%%rdi)");
+		P("leaq 24(%%rdi),%%rax");
+		P("ret");
 	}
 	if (varneeds & NEED_1FPREF) {
-		printf(PRTPREF ".text\n.align 4\n");
+		P(".text");
+		P(".align 4");
 		PT("1fpref");
 		P("__pcc_1fpref:");
-		P("cmpl $176,4(%%rdi)\njae .Ladd8");
-		P("movl 4(%%rdi),%%eax\naddq 16(%%rdi),%%rax");
-		P("addl $16,4(%%rdi)\nret");
+		P("cmpl $176,4(%%rdi)");
+		P("jae .Ladd8");
+		P("movl 4(%%rdi),%%eax");
+		P("addq 16(%%rdi),%%rax");
+		P("addl $16,4(%%rdi)");
+		P("ret");
 	}
 	if (varneeds & NEED_1REGREF) {
-		printf(".text\n.align 4\n");
+		P(".text");
+		P(".align 4");
 		PT("1regref");
 		P("__pcc_1regref:");
-		P("cmpl $48,(%%rdi)\njae .Ladd8");
-		P("movl (%%rdi),%%eax\naddq 16(%%rdi),%%rax");
-		P("addl $8,(%%rdi)\nret");
+		P("cmpl $48,(%%rdi)");
+		P("jae .Ladd8");
+		P("movl (%%rdi),%%eax");
+		P("addq 16(%%rdi),%%rax");
+		P("addl $8,(%%rdi)");
+		P("ret");
 	}
 	if (varneeds & NEED_2REGREF) {
-		printf(".text\n.align 4\n");
+		P(".text");
+		P(".align 4");
 		PT("2regref");
 		P("__pcc_2regref:");
-		P("cmpl $40,(%%rdi)\njae .Ladd16");
-		P("movl (%%rdi),%%eax\naddq 16(%%rdi),%%rax");
-		P("addl $16,(%%rdi)\nret");
+		P("cmpl $40,(%%rdi)");
+		P("jae .Ladd16");
+		P("movl (%%rdi),%%eax");
+		P("addq 16(%%rdi),%%rax");
+		P("addl $16,(%%rdi)");
+		P("ret");
 	}
 	if (varneeds & NEED_MEMREF) {
-		printf(".text\n.align 4\n");
+		P(".text");
+		P(".align 4");
 		PT("memref");
 		P("__pcc_memref:");
 		P("movq 8(%%rdi),%%rax");
-		P("addq %%rsi,8(%%rdi)\nret");
+		P("addq %%rsi,8(%%rdi)");
+		P("ret");
 	}
 
 	if (varneeds & (NEED_1FPREF|NEED_1REGREF)) {
@@ -488,7 +540,7 @@ ejobcode(int flag)
 		P("ret");
 	}
 
-	printf(PRTPREF "\t.ident \"PCC: %s\"\n\t.end\n", VERSSTR);
+	printf(PRTPREF "\t.ident \"PCC: %s\"\n" PRTPREF "\t.end\n", VERSSTR);
 }
 
 /*
@@ -693,6 +745,11 @@ amd64_builtin_va_arg(const struct bitable *bt, NODE *a)
 	case STRFI:
 		r = mkvacall(strfi, a, NEED_STRFI);
 		break;
+
+	case STRXMM: /* only the low half of the regs is saved */
+		uerror("va_arg of vector type not supported");
+		r = bcon(0);
+		break;
 	}
 
 	tfree(a);
@@ -727,6 +784,24 @@ movtoreg(NODE *p, int rno)
 	return clocal(buildtree(ASSIGN, r, p));
 }  
 
+/*
+ * Move the vector pointed to by p into SSE register rno, or the
+ * register to memory if tomem is set.  buildtree() does not know
+ * about XTYPE, so build the nodes directly.
+ */
+static NODE *
+xmovreg(NODE *p, int rno, int tomem)
+{
+	NODE *r, *q;
+
+	r = block(REG, NIL, NIL, XTYPE, 0, 0);
+	regno(r) = rno;
+	q = block(UMUL, p, NIL, XTYPE, 0, 0);
+	if (tomem)
+		return block(ASSIGN, q, r, XTYPE, 0, 0);
+	return block(ASSIGN, r, q, XTYPE, 0, 0);
+}
+
 static NODE *
 movtomem(NODE *p, int off, int reg)
 {
@@ -761,10 +836,12 @@ movtomem(NODE *p, int off, int reg)
  *	STRSSE - the whole struct is saved in SSE registers.
  *	STRIF  - First word of struct is saved in general reg, other SSE.
  *	STRFI  - First word of struct is saved in SSE, next in general reg.
+ *	STRXMM - A 16-byte vector, in one SSE register.
  *
  *	INTEGER, MEMORY, X87, X87UP, X87COMPLEX, SSE, NO_CLASS.
  *
  * - If size > 16 bytes or there are packed fields, use memory.
+ * - Vectors of 8 or 16 bytes are passed in one SSE register.
  * - If any part of an eight-byte should be in a general register,
  *    the eight-byte is stored in a general register
  * - If the eight-byte only contains float or double, use a SSE register
@@ -957,6 +1034,13 @@ argtyp(TWORD t, union dimfun *df, struct ssdesc *ss)
 #endif
 		if (iscplx87(strmemb(ss)) == STRX87) {
 			cl = STRX87;
+#if defined(GCC_COMPAT) && !defined(LANG_CXX)
+		} else if ((sz == SZXTYPE || sz == SZLONG) && vecss(ss)) {
+			if (nsse > 7)
+				cl = STRMEM;
+			else
+				cl = sz == SZXTYPE ? STRXMM : STRSSE;
+#endif
 		} else if (sz > 2*SZLONG) {
 			cl = STRMEM;
 		} else {
@@ -1090,6 +1174,15 @@ argput(NODE *p)
 		}
 		break;
 
+#ifndef LANG_CXX
+	case STRXMM: /* vector in one SSE register */
+		r = XMM0 + nsse++;
+		p = nfree(p);	/* remove STARG */
+		p = block(PCONV, p, NIL, INCREF(XTYPE), 0, 0);
+		p = xmovreg(p, r, 0);
+		break;
+#endif
+
 	case STRX87:
 	case STRMEM: {
 		struct symtab s;
@@ -1128,23 +1221,36 @@ argput(NODE *p)
 	return p;
 }
 
+/*
+ * Evaluate argument p into a temporary first.
+ * buildtree() does not know about XTYPE.
+ */
+static NODE *
+argtemp(NODE *p)
+{
+	NODE *q, *r;
+
+	q = tempnode(0, p->n_type, p->n_df, p->pss);
+	r = ccopy(q);
+	if (p->n_type == XTYPE)
+		return block(COMOP, block(ASSIGN, q, p, XTYPE, 0, 0), r,
+		    XTYPE, 0, 0);
+	return buildtree(COMOP, buildtree(ASSIGN, q, p), r);
+}
+
 /*
  * Sort arglist so that register assignments ends up last.
  */
 static int
 argsort(NODE *p)
 {
-	NODE *q, *r;
+	NODE *q;
 	int rv = 0;
 
 	if (p->n_op != CM) {
 		if (p->n_op == ASSIGN && p->n_left->n_op == REG &&
-		    coptype(p->n_right->n_op) != LTYPE) {
-			q = tempnode(0, p->n_type, p->n_df, p->pss);
-			r = ccopy(q);
-			p->n_right = buildtree(COMOP,
-			    buildtree(ASSIGN, q, p->n_right), r);
-		}
+		    coptype(p->n_right->n_op) != LTYPE)
+			p->n_right = argtemp(p->n_right);
 		return rv;
 	}
 	if (p->n_right->n_op == CM) {
@@ -1158,11 +1264,7 @@ argsort(NODE *p)
 	if (p->n_right->n_op == ASSIGN && p->n_right->n_left->n_op == REG &&
 	    coptype(p->n_right->n_right->n_op) != LTYPE) {
 		/* move before everything to avoid reg trashing */
-		q = tempnode(0, p->n_right->n_type,
-		    p->n_right->n_df, p->n_right->pss);
-		r = ccopy(q);
-		p->n_right->n_right = buildtree(COMOP,
-		    buildtree(ASSIGN, q, p->n_right->n_right), r);
+		p->n_right->n_right = argtemp(p->n_right->n_right);
 	}
 	if (p->n_right->n_op == ASSIGN && p->n_right->n_left->n_op == REG) {
 		if (p->n_left->n_op == CM &&
@@ -1238,6 +1340,29 @@ fldty(struct symtab *p)
 {
 }
 
+/*
+ * All bit counts can be done in registers, popcnt only if asked for.
+ */
+int
+mybitop(int op, TWORD t)
+{
+#ifndef PASS1
+	return op != POPCNT || (msettings & MPOPCNT);
+#else
+	return op != POPCNT;	/* -m is only seen by pass2 */
+#endif
+}
+
+/*
+ * Operations on 128-bit vectors of element type t that are done
+ * with SSE2 instructions.
+ */
+int
+vecxop(int op, TWORD t)
+{
+	return VECOP(op, t);
+}
+
 /*
  * XXX - fix genswitch.
  */
@@ -615,6 +615,7 @@ myp2tree(NODE *p)
 	inval(0, tsize(sp->stype, sp->sdf, sp->sss), p);
 
 	p->n_op = NAME;
+	p->n_qual = sp->squal;
 	slval(p, 0);
 	p->n_sp = sp;
 }
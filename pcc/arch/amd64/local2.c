@@ -29,6 +29,7 @@
 
 # include "pass2.h"
 # include <ctype.h>
+# include <stdlib.h>
 # include <string.h>
 
 static int stkpos;
@@ -36,7 +37,8 @@ static int stkpos;
 void
 deflab(int label)
 {
-	printf(LABFMT ":\n", label);
+	oputlab(stdout, label);
+	fputs(":\n", stdout);
 }
 
 static int regoff[MAXREGS];
@@ -44,6 +46,7 @@ static TWORD ftype;
 char *rbyte[], *rshort[], *rlong[];
 static int needframe;
 int mcmodel = MCSMALL;
+int msettings;
 
 /*
  * Print out the prolog assembler.
@@ -216,7 +219,8 @@ hopcode(int f, int o)
 		comperr("hopcode2: %d", o);
 		str = 0; /* XXX gcc */
 	}
-	printf("%s%c", str, f);
+	fputs(str, stdout);
+	putchar(f);
 }
 
 /*
@@ -306,19 +310,39 @@ fldexpand(NODE *p, int cookie, char **cp)
 	return 0;
 }
 
+/*
+ * Copy a struct from (%rsi) to AL.  Up to STASGMAX bytes are moved
+ * through the xmm register x and %rcx, longer ones with rep movsq.
+ */
 static void
-stasg(NODE *p)
+stasg(NODE *p, NODE *x)
 {
+	static char *rcx[] = { "%cl", "%cx", "%ecx", "%rcx" };
+	static char sfx[] = "bwlq";
 	struct attr *ap = attr_find(p->n_ap, ATTR_P2STRUCT);
+	int i, n, off, sz = ap->iarg(0);
+
 	expand(p, INAREG, "	leaq AL,%rdi\n");
-	if (ap->iarg(0) >= 8)
-		printf("\tmovl $%d,%%ecx\n\trep movsq\n", ap->iarg(0) >> 3);
-	if (ap->iarg(0) & 4)
-		printf("\tmovsl\n");
-	if (ap->iarg(0) & 2)
-		printf("\tmovsw\n");
-	if (ap->iarg(0) & 1)
-		printf("\tmovsb\n");
+	if (sz > STASGMAX) {
+		printf("\tmovl $%d,%%ecx\n\trep movsq\n", sz >> 3);
+		if (sz & 4)
+			printf("\tmovsl\n");
+		if (sz & 2)
+			printf("\tmovsw\n");
+		if (sz & 1)
+			printf("\tmovsb\n");
+		return;
+	}
+	for (off = 0; sz - off >= 16; off += 16) {
+		printf("\tmovdqu %d(%%rsi),%s\n", off, rnames[regno(x)]);
+		printf("\tmovdqu %s,%d(%%rdi)\n", rnames[regno(x)], off);
+	}
+	for (i = 3, n = 8; i >= 0; i--, n >>= 1) {
+		for (; sz - off >= n; off += n) {
+			printf("\tmov%c %d(%%rsi),%s\n", sfx[i], off, rcx[i]);
+			printf("\tmov%c %s,%d(%%rdi)\n", sfx[i], rcx[i], off);
+		}
+	}
 }
 
 #define	E(x)	expand(p, 0, x)
@@ -368,6 +392,99 @@ fdtoul(NODE *p)
 }
 #undef E
 
+static char *pfhint[] = { "nta", "t2", "t1", "t0" };
+
+/*
+ * Emit an SSE2 instruction for an operation on a 128-bit vector.
+ * The element type is in the vector attribute of the node.
+ */
+static void
+vecinsn(NODE *p)
+{
+	struct attr *ap;
+	NODE *l = p->n_left;
+	char buf[64], *s = NULL, *x;
+	TWORD t;
+	int fp, c;
+
+	if ((ap = attr_find(p->n_ap, ATTR_VECTOR)) == NULL)
+		comperr("vecinsn");
+	t = ap->iarg(1);
+	fp = (t == FLOAT || t == DOUBLE);
+	c = t == FLOAT ? 's' : t == DOUBLE ? 'd' :
+	    t <= UCHAR ? 'b' : t <= USHORT ? 'w' : t <= UNSIGNED ? 'd' : 'q';
+
+	switch (p->n_op) {
+	case PLUS: s = fp ? "addp" : "padd"; break;
+	case MINUS: s = fp ? "subp" : "psub"; break;
+	case MUL: s = fp ? "mulp" : "pmull"; break;
+	case DIV: s = "divp"; break;
+	case EQ: s = fp ? "cmpeqp" : "pcmpeq"; break;
+	case NE: s = "cmpneqp"; break;
+	case LT: s = "cmpltp"; break;
+	case LE: s = "cmplep"; break;
+	case GT: s = "pcmpgt"; break;
+	case AND: s = "pand"; c = 0; break;
+	case OR: s = "por"; c = 0; break;
+	case ER: s = "pxor"; c = 0; break;
+
+	case LS:
+	case RS:
+		s = p->n_op == LS ? "psll" : ISUNSIGNED(t) ? "psrl" : "psra";
+		if (p->n_right->n_op == ICON)
+			snprintf(buf, sizeof buf, "\t%s%c AR,AL\n", s, c);
+		else
+			snprintf(buf, sizeof buf,
+			    "\tmovd AR,A1\n\t%s%c A1,AL\n", s, c);
+		expand(p, 0, buf);
+		return;
+
+	case UMINUS:
+		if (fp)
+			snprintf(buf, sizeof buf, "\tpcmpeqd A1,A1\n"
+			    "\tpsll%c $%d,A1\n\txorp%c AL,A1\n",
+			    c == 's' ? 'd' : 'q', c == 's' ? 31 : 63, c);
+		else
+			snprintf(buf, sizeof buf,
+			    "\tpxor A1,A1\n\tpsub%c AL,A1\n", c);
+		expand(p, 0, buf);
+		return;
+
+	case COMPL:
+		expand(p, 0, "\tpcmpeqd A1,A1\n\tpxor AL,A1\n");
+		return;
+
+	case SCONV: /* splat */
+		x = rnames[getlr(p, '1')->n_rval];
+		if (t == FLOAT)
+			printf("\tmovaps %s,%s\n\tshufps $0,%s,%s\n",
+			    rnames[l->n_rval], x, x, x);
+		else if (t == DOUBLE)
+			printf("\tmovapd %s,%s\n\tunpcklpd %s,%s\n",
+			    rnames[l->n_rval], x, x, x);
+		else if (c == 'q')
+			printf("\tmovq %s,%s\n\tpunpcklqdq %s,%s\n",
+			    rnames[l->n_rval], x, x, x);
+		else {
+			printf("\tmovd %s,%s\n", rlong[l->n_rval], x);
+			if (c == 'b')
+				printf("\tpunpcklbw %s,%s\n", x, x);
+			if (c != 'd')
+				printf("\tpunpcklwd %s,%s\n", x, x);
+			printf("\tpshufd $0,%s,%s\n", x, x);
+		}
+		return;
+
+	default:
+		comperr("vecinsn op %d", p->n_op);
+	}
+	if (c)
+		snprintf(buf, sizeof buf, "\t%s%c AR,AL\n", s, c);
+	else
+		snprintf(buf, sizeof buf, "\t%s AR,AL\n", s);
+	expand(p, 0, buf);
+}
+
 void
 zzzcode(NODE *p, int c)
 {
@@ -386,10 +503,29 @@ zzzcode(NODE *p, int c)
 		}
 		break;
 
+	case 'B': /* clz/ctz, as lzcnt/tzcnt if asked for */
+		if (p->n_op == CLZ && (msettings & MLZCNT))
+			expand(p, 0, "\tlzcntZL AL,A1\n");
+		else if (p->n_op == CLZ)
+			expand(p, 0, getlr(p, 'L')->n_type < LONG ?
+			    "\tbsrl AL,A1\n\txorl $31,A1\n" :
+			    "\tbsrq AL,A1\n\txorq $63,A1\n");
+		else
+			expand(p, 0, (msettings & MBMI) ?
+			    "\ttzcntZL AL,A1\n" : "\tbsfZL AL,A1\n");
+		break;
+
 	case 'b': /* float/double to unsigned long cast */
 		fdtoul(p);
 		break;
 
+	case 'p': /* prefetch hint, by locality */
+		if ((p->n_rval & PF_WRITE) && (msettings & MPRFCHW))
+			printf("w");
+		else
+			printf("%s", pfhint[p->n_rval & 3]);
+		break;
+
 	case 'C':  /* remove from stack after subroutine call */
 		pr = p->n_qual;
 		if (p->n_op == UCALL)
@@ -401,6 +537,7 @@ zzzcode(NODE *p, int c)
 #define	STRIF  9
 #define	STRFI  10
 #define	STRX87 11
+#define	STRXMM 12
 		ap = attr_find(p->n_ap, ATTR_P2STRUCT);
 		ap2 = attr_find(p->n_ap, ATTR_AMD64_CMPLRET);
 		if ((p->n_op == STCALL || p->n_op == USTCALL) &&
@@ -410,6 +547,10 @@ zzzcode(NODE *p, int c)
 			printf("\tleaq -%d(%%rbp),%%rax\n", stkpos);
 		}
 		if ((p->n_op == STCALL || p->n_op == USTCALL) &&
+		    ap2->iarg(0) == STRXMM) {
+			printf("\tmovdqu %%xmm0,-%d(%%rbp)\n", stkpos);
+			printf("\tleaq -%d(%%rbp),%%rax\n", stkpos);
+		} else if ((p->n_op == STCALL || p->n_op == USTCALL) &&
 		    ap->iarg(0) <= 16) {
 			/* store reg-passed structs on stack */
 			if (ap2->iarg(0) == STRREG || ap2->iarg(0) == STRIF)
@@ -434,14 +575,14 @@ zzzcode(NODE *p, int c)
 	case 'c': /* xor label */
 		if ((ap = attr_find(p->n_ap, ATTR_AMD64_XORLBL)) == NULL)
 			comperr("missing xor label");
-		printf(LABFMT, ap->iarg(0));
+		oputlab(stdout, ap->iarg(0));
 		break;
 
 	case 'F': /* Structure argument */
 		ap = attr_find(p->n_ap, ATTR_P2STRUCT);
 		printf("	subq $%d,%%rsp\n", ap->iarg(0));
 		printf("	movq %%rsp,%%rsi\n");
-		stasg(p);
+		stasg(p, getlr(p, '1'));
 		break;
 
 	case 'G': /* Floating point compare */
@@ -464,7 +605,7 @@ zzzcode(NODE *p, int c)
 		break;
 
 	case 'N': /* output long reg name */
-		printf("%s", rlong[getlr(p, '1')->n_rval]);
+		fputs(rlong[getlr(p, '1')->n_rval], stdout);
 		break;
 
 	case 'P': /* Put hidden argument in rdi */
@@ -475,7 +616,7 @@ zzzcode(NODE *p, int c)
 		break;
 
         case 'Q': /* emit struct assign */
-		stasg(p);
+		stasg(p, getlr(p, '2'));
 		break;
 
 	case 'R': /* print opname based on right type */
@@ -486,7 +627,7 @@ zzzcode(NODE *p, int c)
 		case INT: case UNSIGNED: s = 'l'; break;
 		default: s = 'q'; break;
 		}
-		printf("%c", s);
+		putchar(s);
 		break;
 
 	case 'U': { /* output branch insn for ucomi */
@@ -508,18 +649,22 @@ zzzcode(NODE *p, int c)
 	case '1': /* special reg name printout (32-bit) */
 		l = getlr(p, '1');
 		rt = c == '8' ? rnames : rlong;
-		printf("%s", rt[l->n_rval]);
+		fputs(rt[l->n_rval], stdout);
 		break;
 
 	case 'g':
 		p = p->n_left;
 		/* FALLTHROUGH */
 	case 'f': /* float or double */
-		printf("%c", p->n_type == FLOAT ? 's' : 'd');
+		putchar(p->n_type == FLOAT ? 's' : 'd');
+		break;
+
+	case 'V': /* SSE2 vector instruction */
+		vecinsn(p);
 		break;
 
 	case 'q': /* int or long */
-		printf("%c", p->n_left->n_type == LONG ? 'q' : ' ');
+		putchar(p->n_left->n_type == LONG ? 'q' : ' ');
 		break;
 
 	default:
@@ -588,7 +733,8 @@ shtemp(NODE *p)
 void
 adrcon(CONSZ val)
 {
-	printf("$" CONFMT, val);
+	putchar('$');
+	oputcon(stdout, val);
 }
 
 void
@@ -599,11 +745,13 @@ conput(FILE *fp, NODE *p)
 	switch (p->n_op) {
 	case ICON:
 		if (p->n_name[0] != '\0') {
-			fprintf(fp, "%s", p->n_name);
-			if (val)
-				fprintf(fp, "+%ld", val);
+			fputs(p->n_name, fp);
+			if (val) {
+				fputc('+', fp);
+				oputd(fp, val);
+			}
 		} else
-			fprintf(fp, "%ld", val);
+			oputd(fp, val);
 		return;
 
 	default:
@@ -630,7 +778,8 @@ upput(NODE *p, int size)
 	size /= SZCHAR;
 	switch (p->n_op) {
 	case REG:
-		printf("%%%s", &rnames[p->n_rval][3]);
+		putchar('%');
+		fputs(&rnames[p->n_rval][3], stdout);
 		break;
 
 	case NAME:
@@ -640,7 +789,8 @@ upput(NODE *p, int size)
 		setlval(p, getlval(p) - size);
 		break;
 	case ICON:
-		printf("$" CONFMT, getlval(p) >> 32);
+		putchar('$');
+		oputcon(stdout, getlval(p) >> 32);
 		break;
 	default:
 		comperr("upput bad op %d size %d", p->n_op, size);
@@ -658,29 +808,41 @@ adrput(FILE *io, NODE *p)
 
 	case NAME:
 		if (p->n_name[0] != '\0') {
-			if (getlval(p) != 0)
-				fprintf(io, CONFMT "+", getlval(p));
-			fprintf(io, "%s(%%rip)", p->n_name);
+			if (getlval(p) != 0) {
+				oputcon(io, getlval(p));
+				fputc('+', io);
+			}
+			fputs(p->n_name, io);
+			fputs("(%rip)", io);
 		} else
-			fprintf(io, CONFMT, getlval(p));
+			oputcon(io, getlval(p));
 		return;
 
 	case OREG:
 		r = p->n_rval;
-		if (p->n_name[0])
-			printf("%s%s", p->n_name, getlval(p) ? "+" : "");
+		if (p->n_name[0]) {
+			fputs(p->n_name, io);
+			if (getlval(p))
+				fputc('+', io);
+		}
 		if (getlval(p))
-			fprintf(io, "%lld", getlval(p));
+			oputd(io, getlval(p));
+		fputc('(', io);
 		if (R2TEST(r)) {
 			int r1 = R2UPK1(r);
 			int r2 = R2UPK2(r);
 			int sh = R2UPK3(r);
 
-			fprintf(io, "(%s,%s,%d)", 
-			    r1 == MAXREGS ? "" : rnames[r1],
-			    r2 == MAXREGS ? "" : rnames[r2], sh);
+			if (r1 != MAXREGS)
+				fputs(rnames[r1], io);
+			fputc(',', io);
+			if (r2 != MAXREGS)
+				fputs(rnames[r2], io);
+			fputc(',', io);
+			oputd(io, sh);
 		} else
-			fprintf(io, "(%s)", rnames[p->n_rval]);
+			fputs(rnames[p->n_rval], io);
+		fputc(')', io);
 		return;
 	case ICON:
 		/* addressable value of the constant */
@@ -706,7 +868,7 @@ adrput(FILE *io, NODE *p)
 			rc = rnames;
 			break;
 		}
-		fprintf(io, "%s", rc[p->n_rval]);
+		fputs(rc[p->n_rval], io);
 		return;
 
 	default:
@@ -737,7 +899,11 @@ cbgen(int o, int lab)
 {
 	if (o < EQ || o > UGT)
 		comperr("bad conditional branch: %s", opst[o]);
-	printf("	%s " LABFMT "\n", ccbranches[o-EQ], lab);
+	putchar('\t');
+	fputs(ccbranches[o-EQ], stdout);
+	putchar(' ');
+	oputlab(stdout, lab);
+	putchar('\n');
 }
 
 /*
@@ -772,17 +938,22 @@ adjustname(char *s)
 static void
 fixcalls(NODE *p, void *arg)
 {
-	int ps;
+	struct attr *ap;
+	int ps, al;
 
 	/* Prepare for struct return by allocating bounce space on stack */
 	switch (p->n_op) {
 	case STCALL:
 	case USTCALL:
-		ps = attr_find(p->n_ap, ATTR_P2STRUCT)->iarg(0);
+		ap = attr_find(p->n_ap, ATTR_P2STRUCT);
+		ps = ap->iarg(0);
 		if (ps < 16)
 			ps = 16;
+		/* the callee may store it with movaps; %rbp is 16-aligned */
+		al = ap->iarg(1) > 16 ? ap->iarg(1) : 16;
 		if (ps+p2autooff > stkpos)
 			stkpos = ps+p2autooff;
+		SETOFF(stkpos, al);
 		break;
 	case XASM:
 		p->n_name = adjustname(p->n_name);
@@ -883,6 +1054,9 @@ rmove(int s, int d, TWORD t)
 	case DOUBLE:
 		printf("	movsd %s,%s\n", rnames[s], rnames[d]);
 		break;
+	case XTYPE:
+		printf("	movdqa %s,%s\n", rnames[s], rnames[d]);
+		break;
 	case LDOUBLE:
 #ifdef notdef
 		/* a=b()*c(); will generate this */
@@ -946,7 +1120,7 @@ gclass(TWORD t)
 {
 	if (t == LDOUBLE)
 		return CLASSC;
-	if (t == FLOAT || t == DOUBLE)
+	if (t == FLOAT || t == DOUBLE || t == XTYPE)
 		return CLASSB;
 	return CLASSA;
 }
@@ -1042,6 +1216,24 @@ mflags(char *str)
 		mcmodel = MCMEDIUM;
 	else if (S("cmodel=large"))
 		mcmodel = MCLARGE;
+	else if (S("popcnt"))
+		msettings |= MPOPCNT;
+	else if (S("lzcnt"))
+		msettings |= MLZCNT;
+	else if (S("abm"))
+		msettings |= MPOPCNT|MLZCNT;
+	else if (S("bmi"))
+		msettings |= MBMI;
+	else if (S("no-popcnt"))
+		msettings &= ~MPOPCNT;
+	else if (S("no-lzcnt"))
+		msettings &= ~MLZCNT;
+	else if (S("no-bmi"))
+		msettings &= ~MBMI;
+	else if (S("prfchw"))
+		msettings |= MPRFCHW;
+	else if (S("no-prfchw"))
+		msettings &= ~MPRFCHW;
 	else
 		comperr("bad -m arg");
 }
@@ -1251,3 +1443,1623 @@ int xasmconstregs(char *s)
 	return -1;
 }
 
+
+/*
+ * Peephole rules, see peep.c.
+ *
+ * The flags are never live into a label in the code from pass2,
+ * nor across jumps, calls and returns; that is what flagsdead()
+ * relies on.
+ */
+
+#define	FL_C	001
+#define	FL_Z	002
+#define	FL_S	004
+#define	FL_O	010
+#define	FL_P	020
+#define	FL_ALL	037
+
+static struct {
+	char *cc;
+	int fl;
+} pcctab[] = {
+	{ "o", FL_O }, { "no", FL_O },
+	{ "b", FL_C }, { "c", FL_C }, { "nae", FL_C },
+	{ "ae", FL_C }, { "nb", FL_C }, { "nc", FL_C },
+	{ "e", FL_Z }, { "z", FL_Z }, { "ne", FL_Z }, { "nz", FL_Z },
+	{ "be", FL_C|FL_Z }, { "na", FL_C|FL_Z },
+	{ "a", FL_C|FL_Z }, { "nbe", FL_C|FL_Z },
+	{ "s", FL_S }, { "ns", FL_S },
+	{ "p", FL_P }, { "pe", FL_P }, { "np", FL_P }, { "po", FL_P },
+	{ "l", FL_S|FL_O }, { "nge", FL_S|FL_O },
+	{ "ge", FL_S|FL_O }, { "nl", FL_S|FL_O },
+	{ "le", FL_Z|FL_S|FL_O }, { "ng", FL_Z|FL_S|FL_O },
+	{ "g", FL_Z|FL_S|FL_O }, { "nle", FL_Z|FL_S|FL_O },
+	{ NULL },
+};
+
+/*
+ * Flags set by arithmetic, and those of them that are the same as
+ * after a cmp $0 of the result.  Shifts set flags only if the count
+ * is a non-zero constant.
+ */
+static struct {
+	char *name;
+	int fl, same, shift;
+} pfltab[] = {
+	{ "cmp", FL_ALL, 0 },
+	{ "test", FL_ALL, 0 },
+	{ "and", FL_ALL, FL_ALL },
+	{ "or", FL_ALL, FL_ALL },
+	{ "xor", FL_ALL, FL_ALL },
+	{ "add", FL_ALL, FL_Z|FL_S|FL_P },
+	{ "sub", FL_ALL, FL_Z|FL_S|FL_P },
+	{ "adc", FL_ALL, 0 },
+	{ "sbb", FL_ALL, 0 },
+	{ "neg", FL_ALL, FL_Z|FL_S|FL_P },
+	{ "inc", FL_ALL & ~FL_C, FL_Z|FL_S|FL_P },
+	{ "dec", FL_ALL & ~FL_C, FL_Z|FL_S|FL_P },
+	{ "sal", FL_ALL, FL_Z|FL_S|FL_P, 1 },
+	{ "shl", FL_ALL, FL_Z|FL_S|FL_P, 1 },
+	{ "sar", FL_ALL, FL_Z|FL_S|FL_P, 1 },
+	{ "shr", FL_ALL, FL_Z|FL_S|FL_P, 1 },
+	{ "imul", FL_ALL, 0 },
+	{ "mul", FL_ALL, 0 },
+	{ "idiv", FL_ALL, 0 },
+	{ "div", FL_ALL, 0 },
+	{ "bsf", FL_ALL, 0 },
+	{ "bsr", FL_ALL, 0 },
+	{ "popcnt", FL_ALL, 0 },
+	{ "lzcnt", FL_ALL, 0 },
+	{ "tzcnt", FL_ALL, 0 },
+	{ "ucomiss", FL_ALL, 0 },
+	{ "ucomisd", FL_ALL, 0 },
+	{ "comiss", FL_ALL, 0 },
+	{ "comisd", FL_ALL, 0 },
+	{ NULL },
+};
+
+static int
+psfx(char *s)
+{
+	return s[0] && s[1] == 0 && strchr("bwlq", s[0]) != NULL;
+}
+
+/*
+ * Find op in pfltab, with or without a size suffix.
+ */
+static int
+pflfind(char *op)
+{
+	size_t l;
+	int i;
+
+	for (i = 0; pfltab[i].name; i++) {
+		l = strlen(pfltab[i].name);
+		if (strncmp(op, pfltab[i].name, l) == 0 &&
+		    (op[l] == 0 || psfx(op + l)))
+			return i;
+	}
+	return -1;
+}
+
+static int
+pccflags(char *cc)
+{
+	int i;
+
+	for (i = 0; pcctab[i].cc; i++)
+		if (strcmp(cc, pcctab[i].cc) == 0)
+			return pcctab[i].fl;
+	return -1;
+}
+
+/*
+ * Flags read by an instruction.
+ */
+static int
+pflread(struct minsn *mi)
+{
+	char *op = mi->op;
+	int fl;
+
+	if (op[0] == 'j' && (fl = pccflags(op+1)) >= 0)
+		return fl;
+	if (strncmp(op, "set", 3) == 0 && (fl = pccflags(op+3)) >= 0)
+		return fl;
+	if (strncmp(op, "cmov", 4) == 0 || strncmp(op, "fcmov", 5) == 0 ||
+	    strncmp(op, "pushf", 5) == 0 || strcmp(op, "lahf") == 0)
+		return FL_ALL;
+	if (strncmp(op, "adc", 3) == 0 || strncmp(op, "sbb", 3) == 0 ||
+	    strncmp(op, "rcl", 3) == 0 || strncmp(op, "rcr", 3) == 0)
+		return FL_C;
+	return 0;
+}
+
+/*
+ * Flags always written by an instruction.
+ */
+static int
+pflwrite(struct minsn *mi)
+{
+	int i;
+
+	if ((i = pflfind(mi->op)) < 0)
+		return 0;
+	if (pfltab[i].shift && mi->nopd == 2 && (mi->opd[0][0] != '$' ||
+	    (atoi(mi->opd[0]+1) & 31) == 0))
+		return 0;
+	return pfltab[i].fl;
+}
+
+/*
+ * Return 1 if the flags in fl are not used after mi.
+ */
+static int
+flagsdead(struct minsn *mi, int fl)
+{
+	while ((mi = minext(mi)) != NULL) {
+		if (mi->type == MI_LABEL)
+			return 1;
+		if (mi->type == MI_RAW || (pflread(mi) & fl))
+			return 0;
+		if (strcmp(mi->op, "jmp") == 0 ||
+		    strncmp(mi->op, "call", 4) == 0 ||
+		    strncmp(mi->op, "ret", 3) == 0)
+			return 1;
+		if ((fl &= ~pflwrite(mi)) == 0)
+			return 1;
+	}
+	return 1;
+}
+
+static int
+isgpr(char *s)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		if (strcmp(s, rnames[i]) == 0 || strcmp(s, rlong[i]) == 0 ||
+		    strcmp(s, rshort[i]) == 0 || strcmp(s, rbyte[i]) == 0)
+			return 1;
+	return 0;
+}
+
+/* n(%rbp), a variable on stack */
+static int
+isframe(char *s)
+{
+	if (*s == '-')
+		s++;
+	if (!isdigit((int)*s))
+		return 0;
+	while (isdigit((int)*s))
+		s++;
+	return strcmp(s, "(%rbp)") == 0;
+}
+
+/* movq %rax,%rax */
+static int
+pmovself(struct minsn *mi, char **v)
+{
+	return psfx(v[2]) && *v[2] != 'l' && isgpr(v[1]);
+}
+
+/* movq %rax,-8(%rbp) ; movq -8(%rbp),%rax, but movl clears the top */
+static int
+pmovback(struct minsn *mi, char **v)
+{
+	if (!psfx(v[3]))
+		return 0;
+	if (isframe(v[1]) && isgpr(v[2]))
+		return 1;
+	return *v[3] != 'l' && isgpr(v[1]) &&
+	    (isgpr(v[2]) || isframe(v[2]));
+}
+
+/* movq %rax,-8(%rbp) ; movq -8(%rbp),%rcx */
+static int
+preload(struct minsn *mi, char **v)
+{
+	return psfx(v[3]) && (isgpr(v[1]) || v[1][0] == '$') &&
+	    isframe(v[2]) && isgpr(v[4]);
+}
+
+/* jmp .L1 ; .L1: */
+static int
+pjnext(struct minsn *mi, char **v)
+{
+	if (strcmp(v[2], "mp") && pccflags(v[2]) < 0)
+		return 0;
+	while ((mi = minext(mi)) != NULL && mi->type == MI_LABEL)
+		if (strcmp(mi->op, v[1]) == 0)
+			return 1;
+	return 0;
+}
+
+/* addq $1,%rax -> incq %rax, one byte shorter */
+static int
+pincdec(struct minsn *mi, char **v)
+{
+	return psfx(v[2]) && flagsdead(mi, FL_C);
+}
+
+/*
+ * subq %rcx,%rax ; cmpq $0,%rax, where the flags the cmp sets
+ * differently are not used.
+ */
+static int
+pcmparith(struct minsn *mi, char **v)
+{
+	size_t l = strlen(v[2]);
+	int i;
+
+	if (!psfx(v[3]) || l < 2 || v[2][l-1] != *v[3] || !isgpr(v[1]))
+		return 0;
+	if ((i = pflfind(v[2])) < 0 || pfltab[i].same == 0 ||
+	    (pflwrite(mi) & pfltab[i].same) == 0)
+		return 0;
+	return flagsdead(minext(mi), FL_ALL & ~pfltab[i].same);
+}
+
+/* cmpq $0,%rax -> testq %rax,%rax, one byte shorter */
+static int
+pcmptest(struct minsn *mi, char **v)
+{
+	return psfx(v[2]) && isgpr(v[1]);
+}
+
+struct peeprule peeptab[] = {
+	{ { "mov@2 @1,@1" }, { NULL }, pmovself },
+	{ { "mov@3 @1,@2", "mov@3 @2,@1" }, { "mov@3 @1,@2" }, pmovback },
+	{ { "mov@3 @1,@2", "mov@3 @2,@4" },
+	    { "mov@3 @1,@2", "mov@3 @1,@4" }, preload },
+	{ { "j@2 @1" }, { NULL }, pjnext },
+	{ { "add@2 $1,@1" }, { "inc@2 @1" }, pincdec },
+	{ { "add@2 $-1,@1" }, { "dec@2 @1" }, pincdec },
+	{ { "sub@2 $1,@1" }, { "dec@2 @1" }, pincdec },
+	{ { "@2 @4,@1", "cmp@3 $0,@1" }, { "@2 @4,@1" }, pcmparith },
+	{ { "@2 @4,@1", "test@3 @1,@1" }, { "@2 @4,@1" }, pcmparith },
+	{ { "@2 @1", "cmp@3 $0,@1" }, { "@2 @1" }, pcmparith },
+	{ { "@2 @1", "test@3 @1,@1" }, { "@2 @1" }, pcmparith },
+	{ { "cmp@2 $0,@1" }, { "test@2 @1,@1" }, pcmptest },
+	{ { NULL } },
+};
+
+#ifdef ELFOBJ
+/*
+ * Instruction encoder for the integrated assembler in elfobj.c.
+ * Only the AT&T syntax that the compiler itself prints is accepted;
+ * anything else makes asinsn() fail and the external assembler is
+ * used for the file.  Encodings are chosen to be the same as gas.
+ */
+
+/* register classes */
+#define	RC_B	1	/* %al ... */
+#define	RC_W	2	/* %ax ... */
+#define	RC_L	3	/* %eax ... */
+#define	RC_Q	4	/* %rax ... */
+#define	RC_X	5	/* %xmm0 ... */
+#define	RC_ST	6	/* %st(i) */
+#define	RC_IP	7	/* %rip */
+#define	RC_SEG	8	/* %fs etc, reg is the prefix byte */
+
+#define	RF_HI	0100	/* %ah ... , no REX allowed */
+#define	RF_REX	0200	/* %sil ... , REX needed */
+
+#define	OP_REG	1
+#define	OP_IMM	2
+#define	OP_MEM	3
+
+#define	BRIP	-2	/* base is %rip */
+
+#define	AF_GOTX	AF_TARG		/* relaxable GOT load */
+#define	AF_REX	(AF_TARG<<1)	/* ... with a REX prefix */
+
+struct asop {
+	int type, star;
+	int reg, cls;
+	int base, index, scale, seg;
+	struct asexp e;
+};
+
+/* instruction classes */
+enum { I_ALU = 1, I_TEST, I_MOV, I_MOVABS, I_MOVX, I_GRP3, I_INC, I_SHIFT,
+	I_IMUL, I_LEA, I_PUSH, I_POP, I_CALL, I_JMP, I_JCC, I_SETCC, I_CMOV,
+	I_RAW, I_PFX, I_RET, I_FSTK, I_FMEM, I_FNSTSW, I_SSE, I_SSEMOV,
+	I_MOVD, I_CVTI, I_CVTX, I_SSEI, I_XCHG, I_BSWAP, I_RM, I_PREF,
+	I_STR };
+
+struct asins {
+	char *name;
+	short cls, sfx;		/* class, takes a b/w/l/q suffix */
+	int op, op2, pfx;	/* opcode, second opcode or /n, prefix */
+	int sz;			/* implied operand size */
+};
+
+static struct asins asinstab[] = {
+	{ "mov", I_MOV, 1 },
+	{ "movabs", I_MOVABS, 1 },
+	{ "add", I_ALU, 1, 0 },
+	{ "or", I_ALU, 1, 1 },
+	{ "adc", I_ALU, 1, 2 },
+	{ "sbb", I_ALU, 1, 3 },
+	{ "and", I_ALU, 1, 4 },
+	{ "sub", I_ALU, 1, 5 },
+	{ "xor", I_ALU, 1, 6 },
+	{ "cmp", I_ALU, 1, 7 },
+	{ "test", I_TEST, 1 },
+	{ "lea", I_LEA, 1 },
+	{ "not", I_GRP3, 1, 2 },
+	{ "neg", I_GRP3, 1, 3 },
+	{ "mul", I_GRP3, 1, 4 },
+	{ "div", I_GRP3, 1, 6 },
+	{ "idiv", I_GRP3, 1, 7 },
+	{ "imul", I_IMUL, 1 },
+	{ "inc", I_INC, 1, 0 },
+	{ "dec", I_INC, 1, 1 },
+	{ "rol", I_SHIFT, 1, 0 },
+	{ "ror", I_SHIFT, 1, 1 },
+	{ "shl", I_SHIFT, 1, 4 },
+	{ "sal", I_SHIFT, 1, 4 },
+	{ "shr", I_SHIFT, 1, 5 },
+	{ "sar", I_SHIFT, 1, 7 },
+	{ "movzbw", I_MOVX, 0, 0x0fb6, 1, 0, 2 },
+	{ "movzbl", I_MOVX, 0, 0x0fb6, 1, 0, 4 },
+	{ "movzbq", I_MOVX, 0, 0x0fb6, 1, 0, 8 },
+	{ "movzwl", I_MOVX, 0, 0x0fb7, 2, 0, 4 },
+	{ "movzwq", I_MOVX, 0, 0x0fb7, 2, 0, 8 },
+	{ "movsbw", I_MOVX, 0, 0x0fbe, 1, 0, 2 },
+	{ "movsbl", I_MOVX, 0, 0x0fbe, 1, 0, 4 },
+	{ "movsbq", I_MOVX, 0, 0x0fbe, 1, 0, 8 },
+	{ "movswl", I_MOVX, 0, 0x0fbf, 2, 0, 4 },
+	{ "movswq", I_MOVX, 0, 0x0fbf, 2, 0, 8 },
+	{ "movslq", I_MOVX, 0, 0x63, 4, 0, 8 },
+	{ "push", I_PUSH, 1 },
+	{ "pop", I_POP, 1 },
+	{ "call", I_CALL, 1 },
+	{ "jmp", I_JMP, 1 },
+	{ "ret", I_RET, 1 },
+	{ "leave", I_RAW, 1, 0xc9 },
+	{ "nop", I_RAW, 0, 0x90 },
+	{ "hlt", I_RAW, 0, 0xf4 },
+	{ "ud2", I_RAW, 0, 0x0f0b },
+	{ "cld", I_RAW, 0, 0xfc },
+	{ "std", I_RAW, 0, 0xfd },
+	{ "sahf", I_RAW, 0, 0x9e },
+	{ "lahf", I_RAW, 0, 0x9f },
+	{ "cbtw", I_RAW, 0, 0x6698 },
+	{ "cwtl", I_RAW, 0, 0x98 },
+	{ "cltq", I_RAW, 0, 0x4898 },
+	{ "cwtd", I_RAW, 0, 0x6699 },
+	{ "cltd", I_RAW, 0, 0x99 },
+	{ "cqto", I_RAW, 0, 0x4899 },
+	{ "mfence", I_RAW, 0, 0x0faef0 },
+	{ "lfence", I_RAW, 0, 0x0faee8 },
+	{ "sfence", I_RAW, 0, 0x0faef8 },
+	{ "pause", I_RAW, 0, 0xf390 },
+	{ "rep", I_PFX, 0, 0xf3 },
+	{ "repe", I_PFX, 0, 0xf3 },
+	{ "repz", I_PFX, 0, 0xf3 },
+	{ "repne", I_PFX, 0, 0xf2 },
+	{ "repnz", I_PFX, 0, 0xf2 },
+	{ "lock", I_PFX, 0, 0xf0 },
+	{ "movs", I_STR, 1, 0xa4 },
+	{ "stos", I_STR, 1, 0xaa },
+	{ "xchg", I_XCHG, 1 },
+	{ "bswap", I_BSWAP, 1 },
+	{ "bsf", I_RM, 1, 0x0fbc },
+	{ "bsr", I_RM, 1, 0x0fbd },
+	{ "popcnt", I_RM, 1, 0x0fb8, 0, 0xf3 },
+	{ "lzcnt", I_RM, 1, 0x0fbd, 0, 0xf3 },
+	{ "tzcnt", I_RM, 1, 0x0fbc, 0, 0xf3 },
+	{ "prefetchnta", I_PREF, 0, 0x0f18, 0 },
+	{ "prefetcht0", I_PREF, 0, 0x0f18, 1 },
+	{ "prefetcht1", I_PREF, 0, 0x0f18, 2 },
+	{ "prefetcht2", I_PREF, 0, 0x0f18, 3 },
+	{ "prefetchw", I_PREF, 0, 0x0f0d, 1 },
+
+	/* x87 */
+	{ "fldz", I_RAW, 0, 0xd9ee },
+	{ "fld1", I_RAW, 0, 0xd9e8 },
+	{ "fldpi", I_RAW, 0, 0xd9eb },
+	{ "fldl2e", I_RAW, 0, 0xd9ea },
+	{ "fldln2", I_RAW, 0, 0xd9ed },
+	{ "fchs", I_RAW, 0, 0xd9e0 },
+	{ "fabs", I_RAW, 0, 0xd9e1 },
+	{ "ftst", I_RAW, 0, 0xd9e4 },
+	{ "fxam", I_RAW, 0, 0xd9e5 },
+	{ "fprem", I_RAW, 0, 0xd9f8 },
+	{ "fsqrt", I_RAW, 0, 0xd9fa },
+	{ "frndint", I_RAW, 0, 0xd9fc },
+	{ "fscale", I_RAW, 0, 0xd9fd },
+	{ "fninit", I_RAW, 0, 0xdbe3 },
+	{ "fwait", I_RAW, 0, 0x9b },
+	{ "wait", I_RAW, 0, 0x9b },
+	{ "fucompp", I_RAW, 0, 0xdae9 },
+	/* the AT&T names of the reversed ops are swapped */
+	{ "faddp", I_RAW, 0, 0xdec1 },
+	{ "fmulp", I_RAW, 0, 0xdec9 },
+	{ "fsubp", I_RAW, 0, 0xdee1 },
+	{ "fsubrp", I_RAW, 0, 0xdee9 },
+	{ "fdivp", I_RAW, 0, 0xdef1 },
+	{ "fdivrp", I_RAW, 0, 0xdef9 },
+	{ "fld", I_FSTK, 0, 0xd9c0, -1 },
+	{ "fst", I_FSTK, 0, 0xddd0, -1 },
+	{ "fstp", I_FSTK, 0, 0xddd8, -1 },
+	{ "fxch", I_FSTK, 0, 0xd9c8, 1 },
+	{ "ffree", I_FSTK, 0, 0xddc0, -1 },
+	{ "fucom", I_FSTK, 0, 0xdde0, 1 },
+	{ "fucomp", I_FSTK, 0, 0xdde8, 1 },
+	{ "fucomi", I_FSTK, 0, 0xdbe8, 1 },
+	{ "fucomip", I_FSTK, 0, 0xdfe8, 1 },
+	{ "fcomi", I_FSTK, 0, 0xdbf0, 1 },
+	{ "fcomip", I_FSTK, 0, 0xdff0, 1 },
+	{ "flds", I_FMEM, 0, 0xd9, 0 },
+	{ "fldl", I_FMEM, 0, 0xdd, 0 },
+	{ "fldt", I_FMEM, 0, 0xdb, 5 },
+	{ "fsts", I_FMEM, 0, 0xd9, 2 },
+	{ "fstl", I_FMEM, 0, 0xdd, 2 },
+	{ "fstps", I_FMEM, 0, 0xd9, 3 },
+	{ "fstpl", I_FMEM, 0, 0xdd, 3 },
+	{ "fstpt", I_FMEM, 0, 0xdb, 7 },
+	{ "filds", I_FMEM, 0, 0xdf, 0 },
+	{ "fildl", I_FMEM, 0, 0xdb, 0 },
+	{ "fildll", I_FMEM, 0, 0xdf, 5 },
+	{ "fildq", I_FMEM, 0, 0xdf, 5 },
+	{ "fists", I_FMEM, 0, 0xdf, 2 },
+	{ "fistl", I_FMEM, 0, 0xdb, 2 },
+	{ "fistps", I_FMEM, 0, 0xdf, 3 },
+	{ "fistpl", I_FMEM, 0, 0xdb, 3 },
+	{ "fistpll", I_FMEM, 0, 0xdf, 7 },
+	{ "fistpq", I_FMEM, 0, 0xdf, 7 },
+	{ "fisttpl", I_FMEM, 0, 0xdb, 1 },
+	{ "fisttpll", I_FMEM, 0, 0xdd, 1 },
+	{ "fisttpq", I_FMEM, 0, 0xdd, 1 },
+	{ "fnstcw", I_FMEM, 0, 0xd9, 7 },
+	{ "fldcw", I_FMEM, 0, 0xd9, 5 },
+	{ "fadds", I_FMEM, 0, 0xd8, 0 },
+	{ "faddl", I_FMEM, 0, 0xdc, 0 },
+	{ "fmuls", I_FMEM, 0, 0xd8, 1 },
+	{ "fmull", I_FMEM, 0, 0xdc, 1 },
+	{ "fcoms", I_FMEM, 0, 0xd8, 2 },
+	{ "fcoml", I_FMEM, 0, 0xdc, 2 },
+	{ "fcomps", I_FMEM, 0, 0xd8, 3 },
+	{ "fcompl", I_FMEM, 0, 0xdc, 3 },
+	{ "fsubs", I_FMEM, 0, 0xd8, 4 },
+	{ "fsubl", I_FMEM, 0, 0xdc, 4 },
+	{ "fsubrs", I_FMEM, 0, 0xd8, 5 },
+	{ "fsubrl", I_FMEM, 0, 0xdc, 5 },
+	{ "fdivs", I_FMEM, 0, 0xd8, 6 },
+	{ "fdivl", I_FMEM, 0, 0xdc, 6 },
+	{ "fdivrs", I_FMEM, 0, 0xd8, 7 },
+	{ "fdivrl", I_FMEM, 0, 0xdc, 7 },
+	{ "fnstsw", I_FNSTSW, 0 },
+
+	/* SSE */
+	{ "movss", I_SSEMOV, 0, 0x0f10, 0x0f11, 0xf3 },
+	{ "movsd", I_SSEMOV, 0, 0x0f10, 0x0f11, 0xf2 },
+	{ "movups", I_SSEMOV, 0, 0x0f10, 0x0f11, 0 },
+	{ "movupd", I_SSEMOV, 0, 0x0f10, 0x0f11, 0x66 },
+	{ "movaps", I_SSEMOV, 0, 0x0f28, 0x0f29, 0 },
+	{ "movapd", I_SSEMOV, 0, 0x0f28, 0x0f29, 0x66 },
+	{ "movdqa", I_SSEMOV, 0, 0x0f6f, 0x0f7f, 0x66 },
+	{ "movdqu", I_SSEMOV, 0, 0x0f6f, 0x0f7f, 0xf3 },
+	{ "movd", I_MOVD, 0 },
+	{ "cvtsi2ss", I_CVTI, 1, 0x0f2a, 0, 0xf3 },
+	{ "cvtsi2sd", I_CVTI, 1, 0x0f2a, 0, 0xf2 },
+	{ "cvttss2si", I_CVTX, 1, 0x0f2c, 0, 0xf3 },
+	{ "cvttsd2si", I_CVTX, 1, 0x0f2c, 0, 0xf2 },
+	{ "cvtss2si", I_CVTX, 1, 0x0f2d, 0, 0xf3 },
+	{ "cvtsd2si", I_CVTX, 1, 0x0f2d, 0, 0xf2 },
+	{ "cvtss2sd", I_SSE, 0, 0x0f5a, 0, 0xf3 },
+	{ "cvtsd2ss", I_SSE, 0, 0x0f5a, 0, 0xf2 },
+	{ "cvtps2pd", I_SSE, 0, 0x0f5a, 0, 0 },
+	{ "cvtpd2ps", I_SSE, 0, 0x0f5a, 0, 0x66 },
+	{ "cvtdq2ps", I_SSE, 0, 0x0f5b, 0, 0 },
+	{ "cvttps2dq", I_SSE, 0, 0x0f5b, 0, 0xf3 },
+	{ "cvtdq2pd", I_SSE, 0, 0x0fe6, 0, 0xf3 },
+	{ "cvttpd2dq", I_SSE, 0, 0x0fe6, 0, 0x66 },
+	{ "ucomiss", I_SSE, 0, 0x0f2e, 0, 0 },
+	{ "ucomisd", I_SSE, 0, 0x0f2e, 0, 0x66 },
+	{ "comiss", I_SSE, 0, 0x0f2f, 0, 0 },
+	{ "comisd", I_SSE, 0, 0x0f2f, 0, 0x66 },
+	{ "sqrtss", I_SSE, 0, 0x0f51, 0, 0xf3 },
+	{ "sqrtsd", I_SSE, 0, 0x0f51, 0, 0xf2 },
+	{ "sqrtps", I_SSE, 0, 0x0f51, 0, 0 },
+	{ "sqrtpd", I_SSE, 0, 0x0f51, 0, 0x66 },
+	{ "andps", I_SSE, 0, 0x0f54, 0, 0 },
+	{ "andpd", I_SSE, 0, 0x0f54, 0, 0x66 },
+	{ "andnps", I_SSE, 0, 0x0f55, 0, 0 },
+	{ "andnpd", I_SSE, 0, 0x0f55, 0, 0x66 },
+	{ "orps", I_SSE, 0, 0x0f56, 0, 0 },
+	{ "orpd", I_SSE, 0, 0x0f56, 0, 0x66 },
+	{ "xorps", I_SSE, 0, 0x0f57, 0, 0 },
+	{ "xorpd", I_SSE, 0, 0x0f57, 0, 0x66 },
+	{ "addss", I_SSE, 0, 0x0f58, 0, 0xf3 },
+	{ "addsd", I_SSE, 0, 0x0f58, 0, 0xf2 },
+	{ "addps", I_SSE, 0, 0x0f58, 0, 0 },
+	{ "addpd", I_SSE, 0, 0x0f58, 0, 0x66 },
+	{ "mulss", I_SSE, 0, 0x0f59, 0, 0xf3 },
+	{ "mulsd", I_SSE, 0, 0x0f59, 0, 0xf2 },
+	{ "mulps", I_SSE, 0, 0x0f59, 0, 0 },
+	{ "mulpd", I_SSE, 0, 0x0f59, 0, 0x66 },
+	{ "subss", I_SSE, 0, 0x0f5c, 0, 0xf3 },
+	{ "subsd", I_SSE, 0, 0x0f5c, 0, 0xf2 },
+	{ "subps", I_SSE, 0, 0x0f5c, 0, 0 },
+	{ "subpd", I_SSE, 0, 0x0f5c, 0, 0x66 },
+	{ "minss", I_SSE, 0, 0x0f5d, 0, 0xf3 },
+	{ "minsd", I_SSE, 0, 0x0f5d, 0, 0xf2 },
+	{ "minps", I_SSE, 0, 0x0f5d, 0, 0 },
+	{ "minpd", I_SSE, 0, 0x0f5d, 0, 0x66 },
+	{ "divss", I_SSE, 0, 0x0f5e, 0, 0xf3 },
+	{ "divsd", I_SSE, 0, 0x0f5e, 0, 0xf2 },
+	{ "divps", I_SSE, 0, 0x0f5e, 0, 0 },
+	{ "divpd", I_SSE, 0, 0x0f5e, 0, 0x66 },
+	{ "maxss", I_SSE, 0, 0x0f5f, 0, 0xf3 },
+	{ "maxsd", I_SSE, 0, 0x0f5f, 0, 0xf2 },
+	{ "maxps", I_SSE, 0, 0x0f5f, 0, 0 },
+	{ "maxpd", I_SSE, 0, 0x0f5f, 0, 0x66 },
+	{ "unpcklps", I_SSE, 0, 0x0f14, 0, 0 },
+	{ "unpcklpd", I_SSE, 0, 0x0f14, 0, 0x66 },
+	{ "unpckhps", I_SSE, 0, 0x0f15, 0, 0 },
+	{ "unpckhpd", I_SSE, 0, 0x0f15, 0, 0x66 },
+	{ "punpcklbw", I_SSE, 0, 0x0f60, 0, 0x66 },
+	{ "punpcklwd", I_SSE, 0, 0x0f61, 0, 0x66 },
+	{ "punpckldq", I_SSE, 0, 0x0f62, 0, 0x66 },
+	{ "punpcklqdq", I_SSE, 0, 0x0f6c, 0, 0x66 },
+	{ "punpckhqdq", I_SSE, 0, 0x0f6d, 0, 0x66 },
+	{ "pcmpgtb", I_SSE, 0, 0x0f64, 0, 0x66 },
+	{ "pcmpgtw", I_SSE, 0, 0x0f65, 0, 0x66 },
+	{ "pcmpgtd", I_SSE, 0, 0x0f66, 0, 0x66 },
+	{ "pcmpeqb", I_SSE, 0, 0x0f74, 0, 0x66 },
+	{ "pcmpeqw", I_SSE, 0, 0x0f75, 0, 0x66 },
+	{ "pcmpeqd", I_SSE, 0, 0x0f76, 0, 0x66 },
+	{ "paddq", I_SSE, 0, 0x0fd4, 0, 0x66 },
+	{ "pmullw", I_SSE, 0, 0x0fd5, 0, 0x66 },
+	{ "pand", I_SSE, 0, 0x0fdb, 0, 0x66 },
+	{ "pandn", I_SSE, 0, 0x0fdf, 0, 0x66 },
+	{ "por", I_SSE, 0, 0x0feb, 0, 0x66 },
+	{ "pxor", I_SSE, 0, 0x0fef, 0, 0x66 },
+	{ "pmuludq", I_SSE, 0, 0x0ff4, 0, 0x66 },
+	{ "psubb", I_SSE, 0, 0x0ff8, 0, 0x66 },
+	{ "psubw", I_SSE, 0, 0x0ff9, 0, 0x66 },
+	{ "psubd", I_SSE, 0, 0x0ffa, 0, 0x66 },
+	{ "psubq", I_SSE, 0, 0x0ffb, 0, 0x66 },
+	{ "paddb", I_SSE, 0, 0x0ffc, 0, 0x66 },
+	{ "paddw", I_SSE, 0, 0x0ffd, 0, 0x66 },
+	{ "paddd", I_SSE, 0, 0x0ffe, 0, 0x66 },
+	{ "pshufd", I_SSEI, 0, 0x0f70, 0, 0x66 },
+	{ "pshuflw", I_SSEI, 0, 0x0f70, 0, 0xf2 },
+	{ "pshufhw", I_SSEI, 0, 0x0f70, 0, 0xf3 },
+	{ "shufps", I_SSEI, 0, 0x0fc6, 0, 0 },
+	{ "shufpd", I_SSEI, 0, 0x0fc6, 0, 0x66 },
+};
+
+static char *ascc[] = { "o", "no", "b", "ae", "e", "ne", "be", "a",
+	"s", "ns", "p", "np", "l", "ge", "le", "g" };
+static struct { char *name; int cc; } ascc2[] = {
+	{ "c", 2 }, { "nae", 2 }, { "nb", 3 }, { "nc", 3 }, { "z", 4 },
+	{ "nz", 5 }, { "na", 6 }, { "nbe", 7 }, { "pe", 10 }, { "po", 11 },
+	{ "nge", 12 }, { "nl", 13 }, { "ng", 14 }, { "nle", 15 },
+};
+
+static struct asins *asins;
+static int nasins, rexforce, rexdeny;
+
+static int
+inscmp(const void *a, const void *b)
+{
+	return strcmp(((const struct asins *)a)->name,
+	    ((const struct asins *)b)->name);
+}
+
+static void
+addcc(struct asins *ip, char *pre, char *cc, int cls, int sfx, int op)
+{
+	char *s = xmalloc(strlen(pre) + strlen(cc) + 1);
+
+	strcpy(s, pre);
+	strcat(s, cc);
+	memset(ip, 0, sizeof(*ip));
+	ip->name = s;
+	ip->cls = cls;
+	ip->sfx = sfx;
+	ip->op = op;
+}
+
+/*
+ * Build the sorted instruction table, with the condition code forms.
+ */
+static void
+insinit(void)
+{
+	struct asins *ip;
+	int i, n, c;
+
+	n = sizeof(asinstab)/sizeof(asinstab[0]);
+	c = sizeof(ascc)/sizeof(ascc[0]) +
+	    sizeof(ascc2)/sizeof(ascc2[0]);
+	asins = ip = xmalloc((n + 3*c) * sizeof(struct asins));
+	memcpy(ip, asinstab, sizeof(asinstab));
+	ip += n;
+	for (i = 0; i < c; i++) {
+		char *s;
+		int cc;
+
+		if (i < 16)
+			s = ascc[i], cc = i;
+		else
+			s = ascc2[i-16].name, cc = ascc2[i-16].cc;
+		addcc(ip++, "j", s, I_JCC, 0, 0x70 + cc);
+		addcc(ip++, "set", s, I_SETCC, 0, 0x0f90 + cc);
+		addcc(ip++, "cmov", s, I_CMOV, 1, 0x0f40 + cc);
+	}
+	nasins = ip - asins;
+	qsort(asins, nasins, sizeof(struct asins), inscmp);
+}
+
+/*
+ * Find a mnemonic, either by its exact name or with a size suffix.
+ */
+static struct asins *
+inslook(char *m, int *szp)
+{
+	struct asins key, *ip;
+	int l, c;
+
+	if (asins == NULL)
+		insinit();
+	key.name = m;
+	ip = bsearch(&key, asins, nasins, sizeof(key), inscmp);
+	if (ip != NULL) {
+		*szp = ip->sz;
+		return ip;
+	}
+	if ((l = strlen(m)) < 2)
+		return NULL;
+	c = m[l-1];
+	switch (c) {
+	case 'b': *szp = 1; break;
+	case 'w': *szp = 2; break;
+	case 'l': *szp = 4; break;
+	case 'q': *szp = 8; break;
+	default: return NULL;
+	}
+	m[l-1] = 0;
+	ip = bsearch(&key, asins, nasins, sizeof(key), inscmp);
+	m[l-1] = c;
+	return ip && ip->sfx ? ip : NULL;
+}
+
+/* number of one of the two-letter legacy register names */
+static int
+aslegacy(char *s)
+{
+	static char names[] = "axcxdxbxspbpsidi";
+	int i;
+
+	for (i = 0; i < 8; i++)
+		if (s[0] == names[2*i] && s[1] == names[2*i+1])
+			return i;
+	return -1;
+}
+
+/*
+ * Parse a register name (after the %).  Returns the hardware number
+ * and sets the class, or returns -1.
+ */
+static int
+asreg(char **sp, int *clsp)
+{
+	static char segs[] = "es\046cs\056ss\066ds\076fs\144gs\145";
+	char *s, *b;
+	int l, n, i;
+
+	for (b = s = *sp; isalnum((int)*s); s++)
+		;
+	*sp = s;
+	l = s - b;
+	if (b[0] == 'r' && isdigit((int)b[1])) {
+		for (n = 0, s = b+1; isdigit((int)*s); s++)
+			n = n * 10 + *s - '0';
+		if (n < 8 || n > 15 || *sp - s > 1)
+			return -1;
+		switch (s == *sp ? 0 : *s) {
+		case 0: *clsp = RC_Q; break;
+		case 'd': *clsp = RC_L; break;
+		case 'w': *clsp = RC_W; break;
+		case 'b': *clsp = RC_B; break;
+		default: return -1;
+		}
+		return n;
+	}
+	if (l == 3 && (b[0] == 'r' || b[0] == 'e')) {
+		if (strncmp(b, "rip", 3) == 0) {
+			*clsp = RC_IP;
+			return 0;
+		}
+		*clsp = b[0] == 'r' ? RC_Q : RC_L;
+		return aslegacy(b+1);
+	}
+	if (l == 2) {
+		if ((n = aslegacy(b)) >= 0) {
+			*clsp = RC_W;
+			return n;
+		}
+		*clsp = RC_B;
+		for (i = 0; i < 4; i++)
+			if (b[0] == "acdb"[i])
+				break;
+		if (i < 4 && b[1] == 'l')
+			return i;
+		if (i < 4 && b[1] == 'h')
+			return (i + 4) | RF_HI;
+		*clsp = RC_SEG;
+		for (i = 0; segs[i]; i += 3)
+			if (b[0] == segs[i] && b[1] == segs[i+1])
+				return segs[i+2] & 0377;
+		return -1;
+	}
+	if (l == 3 && b[2] == 'l' && (n = aslegacy(b)) >= 4) {
+		*clsp = RC_B;
+		return n | RF_REX;
+	}
+	if (l >= 4 && l <= 5 && strncmp(b, "xmm", 3) == 0) {
+		n = atoi(b+3);
+		*clsp = RC_X;
+		return n <= 15 ? n : -1;
+	}
+	return -1;
+}
+
+/*
+ * Parse an operand.  Returns a pointer after it or NULL.
+ */
+static char *
+asopnd(char *s, struct asop *o)
+{
+	int n, c;
+
+	memset(o, 0, sizeof(*o));
+	o->base = o->index = -1;
+	o->scale = 1;
+	while (*s == ' ' || *s == '\t')
+		s++;
+	if (*s == '*') {
+		o->star = 1;
+		s++;
+	}
+	if (*s == '$') {
+		o->type = OP_IMM;
+		return asexpr(s+1, &o->e);
+	}
+	if (*s == '%') {
+		s++;
+		if (s[0] == 's' && s[1] == 't' && !isalnum((int)s[2])) {
+			o->type = OP_REG;
+			o->cls = RC_ST;
+			s += 2;
+			if (*s == '(') {
+				if (s[1] < '0' || s[1] > '7' || s[2] != ')')
+					return NULL;
+				o->reg = s[1] - '0';
+				s += 3;
+			}
+			return s;
+		}
+		if ((n = asreg(&s, &c)) < 0 || c == RC_IP)
+			return NULL;
+		if (c != RC_SEG) {
+			o->type = OP_REG;
+			o->reg = n;
+			o->cls = c;
+			return s;
+		}
+		if (*s++ != ':')
+			return NULL;
+		o->seg = n;
+	}
+	o->type = OP_MEM;
+	if (*s != '(' && (s = asexpr(s, &o->e)) == NULL)
+		return NULL;
+	if (*s != '(')
+		return s;
+	s++;
+	if (*s == '%') {
+		s++;
+		n = asreg(&s, &c);
+		if (c == RC_IP)
+			o->base = BRIP;
+		else if (n < 0 || c != RC_Q)
+			return NULL;
+		else
+			o->base = n;
+	}
+	if (*s == ',') {
+		if (*++s == '%') {
+			s++;
+			n = asreg(&s, &c);
+			if (n < 0 || n == 4 || c != RC_Q)
+				return NULL;
+			o->index = n;
+		}
+		if (*s == ',') {
+			switch (*++s) {
+			case '1': o->scale = 0; break;
+			case '2': o->scale = 0100; break;
+			case '4': o->scale = 0200; break;
+			case '8': o->scale = 0300; break;
+			default: return NULL;
+			}
+			s++;
+		}
+	}
+	if (o->base == BRIP && o->index >= 0)
+		return NULL;
+	return *s == ')' ? s+1 : NULL;
+}
+
+/* size of a general register operand, 0 if something else */
+static int
+gsz(struct asop *o)
+{
+	if (o->type != OP_REG || o->cls < RC_B || o->cls > RC_Q)
+		return 0;
+	return 1 << (o->cls - RC_B);
+}
+
+/*
+ * Check that the operands agree on the size sz (0 if not known yet).
+ * Returns the size or 0.
+ */
+static int
+opsz(int sz, struct asop *a, struct asop *b)
+{
+	struct asop *o;
+	int i, r;
+
+	for (i = 0; i < 2; i++) {
+		o = i ? b : a;
+		if (o == NULL || o->type != OP_REG)
+			continue;
+		if ((r = gsz(o)) == 0)
+			return 0;
+		if (sz == 0)
+			sz = r;
+		else if (sz != r)
+			return 0;
+	}
+	return sz;
+}
+
+/* register number of an operand, noting what it needs of a REX */
+static int
+opreg(struct asop *o)
+{
+	if (o->reg & RF_REX)
+		rexforce = 1;
+	if (o->reg & RF_HI)
+		rexdeny = 1;
+	return o->reg & 017;
+}
+
+/* constant operand */
+#define	iscon(o)	((o)->e.sym == NULL && (o)->e.sub == NULL)
+
+/* v as seen by an instruction of size sz */
+static CONSZ
+asval(CONSZ v, int sz)
+{
+	switch (sz) {
+	case 1: return (signed char)v;
+	case 2: return (short)v;
+	case 4: return (int)v;
+	}
+	return v;
+}
+
+/* immediate v fits in an instruction of size sz */
+static int
+asrange(CONSZ v, int sz)
+{
+	if (sz == 8)
+		return v >= -2147483648LL && v <= 2147483647LL;
+	return v >= -(1LL << (8*sz-1)) && v < (1LL << (8*sz));
+}
+
+/* emit an immediate field of n bytes for an instruction of size sz */
+static int
+asimm(struct asop *o, int n, int sz)
+{
+	if (iscon(o) && !asrange(o->e.val, sz))
+		return 1;
+	return asfixup(&o->e, n, sz == 8 ? AF_SIGNED : 0, 0);
+}
+
+static int
+aspre(int sz, int pfx, int seg, int rex)
+{
+	if (seg)
+		asemit(seg, 1);
+	if (sz == 2)
+		asemit(0x66, 1);
+	if (pfx)
+		asemit(pfx, 1);
+	if (sz == 8)
+		rex |= 8;
+	if (rex || rexforce) {
+		if (rexdeny)
+			return 1;
+		asemit(0x40 | rex, 1);
+	}
+	return 0;
+}
+
+static void
+asopc(int op)
+{
+	if (op > 0xffff)
+		asemit(op >> 16, 1);
+	if (op > 0xff)
+		asemit(op >> 8, 1);
+	asemit(op, 1);
+}
+
+/*
+ * Emit an instruction with a ModRM byte.  sz is the operand size (2
+ * gives an 0x66 prefix, 8 a REX.W), pfx a mandatory prefix, reg the
+ * reg field and rm the r/m operand.  imm is the size of an immediate
+ * that follows, flags are added to those of a displacement fixup.
+ */
+static int
+asmodrm(int sz, int pfx, int op, int reg, struct asop *rm, int imm,
+    int flags)
+{
+	int rex = 0, base, index, mod, sym;
+	CONSZ v;
+
+	if (reg & 8)
+		rex |= 4;
+	reg = (reg & 7) << 3;
+	if (rm->type == OP_REG) {
+		base = opreg(rm);
+		if (base & 8)
+			rex |= 1;
+		if (aspre(sz, pfx, 0, rex))
+			return 1;
+		asopc(op);
+		asemit(0300 | reg | (base & 7), 1);
+		return 0;
+	}
+	if (rm->type != OP_MEM)
+		return 1;
+	base = rm->base;
+	index = rm->index;
+	if (index >= 8)
+		rex |= 2;
+	if (base >= 8)
+		rex |= 1;
+	if (sz == 8 || rex || rexforce)
+		flags |= AF_REX;
+	if (rm->e.mod != AM_GOTPCREL)
+		flags &= ~(AF_GOTX|AF_REX);
+	if (aspre(sz, pfx, rm->seg, rex))
+		return 1;
+	asopc(op);
+	if (base == BRIP) {
+		asemit(reg | 5, 1);
+		return asfixup(&rm->e, 4, AF_PCREL|flags, imm);
+	}
+	sym = !iscon(rm);
+	v = rm->e.val;
+	if (!sym && !asrange(v, 8))
+		return 1;
+	if (base < 0) {
+		/* no base, disp32 through a SIB byte */
+		asemit(reg | 4, 1);
+		asemit((index < 0 ? 040 : rm->scale | (index & 7) << 3) | 5, 1);
+		return asfixup(&rm->e, 4, AF_SIGNED|flags, 0);
+	}
+	if (sym || v < -128 || v > 127)
+		mod = 0200;
+	else if (v == 0 && (base & 7) != 5)
+		mod = 0;
+	else
+		mod = 0100;
+	if (index >= 0 || (base & 7) == 4) {
+		asemit(mod | reg | 4, 1);
+		asemit((index < 0 ? 040 : rm->scale | (index & 7) << 3) |
+		    (base & 7), 1);
+	} else
+		asemit(mod | reg | (base & 7), 1);
+	if (mod == 0100)
+		asemit(v, 1);
+	else if (mod == 0200)
+		return asfixup(&rm->e, 4, AF_SIGNED|flags, 0);
+	return 0;
+}
+
+/* opcode with the register in the low bits */
+static int
+asoprr(int sz, int op, struct asop *o)
+{
+	int r = opreg(o);
+
+	if (aspre(sz, 0, 0, r & 8 ? 1 : 0))
+		return 1;
+	asemit(op + (r & 7), 1);
+	return 0;
+}
+
+/* accumulator, for the short forms */
+#define	isacc(o)	((o)->type == OP_REG && (o)->reg == 0)
+
+/* xmm register */
+#define	isx(o)		((o)->type == OP_REG && (o)->cls == RC_X)
+
+/* xmm register or memory */
+#define	isxm(o)		(isx(o) || (o)->type == OP_MEM)
+
+/* general register or memory */
+#define	isgm(o)		(gsz(o) || (o)->type == OP_MEM)
+
+static int
+asalu(struct asins *ip, int sz, struct asop *src, struct asop *dst)
+{
+	int op = ip->op;
+	CONSZ v;
+
+	if ((sz = opsz(sz, src, dst)) == 0 || !isgm(dst))
+		return 1;
+	if (src->type == OP_IMM) {
+		if (iscon(src) && !asrange(src->e.val, sz))
+			return 1;
+		v = asval(src->e.val, sz);
+		if (sz == 1) {
+			if (isacc(dst)) {
+				aspre(1, 0, 0, 0);
+				asemit(op*8 + 4, 1);
+			} else if (asmodrm(1, 0, 0x80, op, dst, 1, 0))
+				return 1;
+			return asimm(src, 1, 1);
+		}
+		if (iscon(src) && v >= -128 && v <= 127) {
+			if (asmodrm(sz, 0, 0x83, op, dst, 1, 0))
+				return 1;
+			asemit(v, 1);
+			return 0;
+		}
+		if (isacc(dst)) {
+			aspre(sz, 0, 0, 0);
+			asemit(op*8 + 5, 1);
+		} else if (asmodrm(sz, 0, 0x81, op, dst, sz == 2 ? 2 : 4, 0))
+			return 1;
+		return asimm(src, sz == 2 ? 2 : 4, sz);
+	}
+	if (src->type == OP_REG)
+		return asmodrm(sz, 0, op*8 + (sz > 1), opreg(src), dst, 0, 0);
+	if (dst->type == OP_REG)
+		return asmodrm(sz, 0, op*8 + 2 + (sz > 1), opreg(dst), src,
+		    0, sz >= 4 ? AF_GOTX : 0);
+	return 1;
+}
+
+static int
+asmov(int sz, struct asop *src, struct asop *dst)
+{
+	CONSZ v;
+
+	if (isx(src) || isx(dst)) {
+		/* movq between xmm and something else */
+		if (sz != 8 && sz != 0)
+			return 1;
+		if (isx(dst) && isxm(src))
+			return asmodrm(0, 0xf3, 0x0f7e, dst->reg, src, 0, 0);
+		if (isx(src) && dst->type == OP_MEM)
+			return asmodrm(0, 0x66, 0x0fd6, src->reg, dst, 0, 0);
+		if (isx(dst) && gsz(src) == 8)
+			return asmodrm(8, 0x66, 0x0f6e, dst->reg, src, 0, 0);
+		if (isx(src) && gsz(dst) == 8)
+			return asmodrm(8, 0x66, 0x0f7e, src->reg, dst, 0, 0);
+		return 1;
+	}
+	if ((sz = opsz(sz, src, dst)) == 0 || !isgm(dst))
+		return 1;
+	if (src->type == OP_IMM) {
+		v = src->e.val;
+		if (dst->type == OP_REG && sz < 8) {
+			if (asoprr(sz, sz == 1 ? 0xb0 : 0xb8, dst))
+				return 1;
+			return asimm(src, sz, sz);
+		}
+		if (dst->type == OP_REG && iscon(src) && !asrange(v, 8)) {
+			if (asoprr(8, 0xb8, dst))
+				return 1;
+			asemit(v, 8);
+			return 0;
+		}
+		if (asmodrm(sz, 0, sz == 1 ? 0xc6 : 0xc7, 0, dst,
+		    sz > 4 ? 4 : sz, 0))
+			return 1;
+		return asimm(src, sz > 4 ? 4 : sz, sz);
+	}
+	if (src->type == OP_REG)
+		return asmodrm(sz, 0, sz == 1 ? 0x88 : 0x89, opreg(src), dst,
+		    0, 0);
+	if (dst->type == OP_REG)
+		return asmodrm(sz, 0, sz == 1 ? 0x8a : 0x8b, opreg(dst), src,
+		    0, sz >= 4 ? AF_GOTX : 0);
+	return 1;
+}
+
+static int
+asimul(int sz, int nops, struct asop *ops)
+{
+	struct asop *src, *dst, *imm;
+	CONSZ v;
+	int n;
+
+	if (nops == 1) {
+		if ((sz = opsz(sz, &ops[0], NULL)) == 0)
+			return 1;
+		return asmodrm(sz, 0, sz == 1 ? 0xf6 : 0xf7, 5, &ops[0], 0, 0);
+	}
+	if (nops == 2 && ops[0].type == OP_IMM) {
+		imm = &ops[0];
+		src = dst = &ops[1];
+	} else if (nops == 3 && ops[0].type == OP_IMM) {
+		imm = &ops[0];
+		src = &ops[1];
+		dst = &ops[2];
+	} else if (nops == 2) {
+		imm = NULL;
+		src = &ops[0];
+		dst = &ops[1];
+	} else
+		return 1;
+	if ((sz = opsz(sz, src, dst)) < 2 || dst->type != OP_REG ||
+	    !isgm(src))
+		return 1;
+	if (imm == NULL)
+		return asmodrm(sz, 0, 0x0faf, opreg(dst), src, 0, 0);
+	v = asval(imm->e.val, sz);
+	if (iscon(imm) && v >= -128 && v <= 127) {
+		if (!asrange(imm->e.val, sz) ||
+		    asmodrm(sz, 0, 0x6b, opreg(dst), src, 1, 0))
+			return 1;
+		asemit(v, 1);
+		return 0;
+	}
+	n = sz == 2 ? 2 : 4;
+	if (asmodrm(sz, 0, 0x69, opreg(dst), src, n, 0))
+		return 1;
+	return asimm(imm, n, sz);
+}
+
+static int
+asshift(struct asins *ip, int sz, int nops, struct asop *ops)
+{
+	struct asop *dst = &ops[nops-1];
+	int op;
+
+	if (nops < 1 || nops > 2 || (sz = opsz(sz, dst, NULL)) == 0 ||
+	    !isgm(dst))
+		return 1;
+	op = sz == 1 ? 0xd0 : 0xd1;
+	if (nops == 1)
+		return asmodrm(sz, 0, op, ip->op, dst, 0, 0);
+	if (ops[0].type == OP_REG) {
+		if (ops[0].cls != RC_B || ops[0].reg != 1)
+			return 1;
+		return asmodrm(sz, 0, op + 2, ip->op, dst, 0, 0);
+	}
+	if (ops[0].type != OP_IMM || !iscon(&ops[0]))
+		return 1;
+	if (ops[0].e.val == 1)
+		return asmodrm(sz, 0, op, ip->op, dst, 0, 0);
+	if (asmodrm(sz, 0, op - 0x10, ip->op, dst, 1, 0))
+		return 1;
+	asemit(ops[0].e.val, 1);
+	return 0;
+}
+
+/* a direct branch target */
+#define	isdirect(o)	((o)->type == OP_MEM && (o)->star == 0 && \
+	(o)->base == -1 && (o)->index == -1 && (o)->seg == 0)
+
+/*
+ * Assemble an instruction.  Returns non-zero if it cannot be handled.
+ */
+int
+asinsn(char *m, char *args)
+{
+	struct asop ops[3], *src, *dst;
+	struct asins *ip;
+	char *s;
+	int nops, sz, i;
+
+	if ((ip = inslook(m, &sz)) == NULL)
+		return 1;
+	if (ip->cls == I_PFX) {
+		asemit(ip->op, 1);
+		if (*args == 0)
+			return 0;
+		for (s = args; *s && *s != ' ' && *s != '\t'; s++)
+			;
+		if (*s)
+			*s++ = 0;
+		while (*s == ' ' || *s == '\t')
+			s++;
+		return asinsn(args, s);
+	}
+	for (nops = 0, s = args; *s; ) {
+		if (nops == 3 || (s = asopnd(s, &ops[nops++])) == NULL)
+			return 1;
+		while (*s == ' ' || *s == '\t')
+			s++;
+		if (*s == ',' && s[1] != 0)
+			s++;
+		else if (*s)
+			return 1;
+	}
+	for (i = 0; i < nops; i++)
+		if (ops[i].star && ip->cls != I_CALL && ip->cls != I_JMP)
+			return 1;
+	rexforce = rexdeny = 0;
+	src = &ops[0];
+	dst = &ops[nops > 0 ? nops-1 : 0];
+
+	switch (ip->cls) {
+	case I_ALU:
+		if (nops != 2)
+			return 1;
+		return asalu(ip, sz, src, dst);
+
+	case I_MOV:
+		if (nops != 2)
+			return 1;
+		return asmov(sz, src, dst);
+
+	case I_MOVABS:
+		if (nops != 2 || src->type != OP_IMM || gsz(dst) != 8 ||
+		    (sz != 0 && sz != 8))
+			return 1;
+		if (asoprr(8, 0xb8, dst))
+			return 1;
+		return asfixup(&src->e, 8, 0, 0);
+
+	case I_TEST:
+		if (nops != 2 || (sz = opsz(sz, src, dst)) == 0 ||
+		    !isgm(dst))
+			return 1;
+		if (src->type == OP_IMM) {
+			i = sz > 4 ? 4 : sz;
+			if (isacc(dst)) {
+				aspre(sz, 0, 0, 0);
+				asemit(sz == 1 ? 0xa8 : 0xa9, 1);
+			} else if (asmodrm(sz, 0, sz == 1 ? 0xf6 : 0xf7, 0,
+			    dst, i, 0))
+				return 1;
+			return asimm(src, i, sz);
+		}
+		if (src->type == OP_REG)
+			return asmodrm(sz, 0, sz == 1 ? 0x84 : 0x85,
+			    opreg(src), dst, 0, 0);
+		if (dst->type == OP_REG)
+			return asmodrm(sz, 0, sz == 1 ? 0x84 : 0x85,
+			    opreg(dst), src, 0, sz >= 4 ? AF_GOTX : 0);
+		return 1;
+
+	case I_MOVX:
+		if (nops != 2 || gsz(dst) != ip->sz || !isgm(src) ||
+		    (src->type == OP_REG && gsz(src) != ip->op2))
+			return 1;
+		return asmodrm(ip->sz, 0, ip->op, opreg(dst), src, 0, 0);
+
+	case I_LEA:
+		if (nops != 2 || src->type != OP_MEM ||
+		    (sz = opsz(sz, dst, NULL)) < 2 || dst->type != OP_REG)
+			return 1;
+		return asmodrm(sz, 0, 0x8d, opreg(dst), src, 0, 0);
+
+	case I_GRP3:
+	case I_INC:
+		if (nops != 1 || (sz = opsz(sz, src, NULL)) == 0 ||
+		    !isgm(src))
+			return 1;
+		return asmodrm(sz, 0, (ip->cls == I_INC ? 0xfe : 0xf6) +
+		    (sz > 1), ip->op, src, 0, 0);
+
+	case I_IMUL:
+		return asimul(sz, nops, ops);
+
+	case I_SHIFT:
+		return asshift(ip, sz, nops, ops);
+
+	case I_PUSH:
+	case I_POP:
+		if (nops != 1 || (sz = opsz(sz ? sz : 8, src, NULL)) < 2 ||
+		    sz == 4)
+			return 1;
+		sz = sz == 2 ? 2 : 4;	/* 64 bits need no REX.W */
+		if (src->type == OP_REG)
+			return asoprr(sz, ip->cls == I_PUSH ? 0x50 : 0x58, src);
+		if (ip->cls == I_PUSH && src->type == OP_IMM) {
+			if (iscon(src) && src->e.val >= -128 &&
+			    src->e.val <= 127) {
+				aspre(sz, 0, 0, 0);
+				asemit(0x6a, 1);
+				asemit(src->e.val, 1);
+				return 0;
+			}
+			aspre(sz, 0, 0, 0);
+			asemit(0x68, 1);
+			return asimm(src, sz, sz == 2 ? 2 : 8);
+		}
+		if (src->type != OP_MEM)
+			return 1;
+		if (ip->cls == I_PUSH)
+			return asmodrm(sz, 0, 0xff, 6, src, 0, 0);
+		return asmodrm(sz, 0, 0x8f, 0, src, 0, 0);
+
+	case I_CALL:
+	case I_JMP:
+		if (nops != 1 || (sz != 0 && sz != 8))
+			return 1;
+		if (isdirect(src)) {
+			if (ip->cls == I_JMP)
+				return asjump(0xeb, 0xe9, 1, &src->e);
+			asemit(0xe8, 1);
+			return asfixup(&src->e, 4, AF_PCREL|AF_BRANCH, 0);
+		}
+		if (!src->star || (src->type == OP_REG && gsz(src) != 8))
+			return 1;
+		return asmodrm(4, 0, 0xff, ip->cls == I_CALL ? 2 : 4, src, 0,
+		    AF_GOTX);
+
+	case I_JCC:
+		if (nops != 1 || !isdirect(src))
+			return 1;
+		return asjump(ip->op, 0x0f00 + ip->op + 0x10, 2, &src->e);
+
+	case I_SETCC:
+		if (nops != 1 || (src->type == OP_REG && gsz(src) != 1) ||
+		    !isgm(src))
+			return 1;
+		return asmodrm(1, 0, ip->op, 0, src, 0, 0);
+
+	case I_CMOV:
+		if (nops != 2 || (sz = opsz(sz, src, dst)) < 2 ||
+		    dst->type != OP_REG || !isgm(src))
+			return 1;
+		return asmodrm(sz, 0, ip->op, opreg(dst), src, 0, 0);
+
+	case I_RAW:
+		if (nops != 0 || (sz != 0 && sz != 8))
+			return 1;
+		asopc(ip->op);
+		return 0;
+
+	case I_RET:
+		if (sz != 0 && sz != 8)
+			return 1;
+		if (nops == 0) {
+			asemit(0xc3, 1);
+			return 0;
+		}
+		if (nops != 1 || src->type != OP_IMM || !iscon(src) ||
+		    !asrange(src->e.val, 2))
+			return 1;
+		asemit(0xc2, 1);
+		asemit(src->e.val, 2);
+		return 0;
+
+	case I_STR:
+		if (nops != 0 || sz == 0)
+			return 1;
+		aspre(sz, 0, 0, 0);
+		asemit(ip->op + (sz > 1), 1);
+		return 0;
+
+	case I_XCHG:
+		if (nops != 2 || (sz = opsz(sz, src, dst)) == 0)
+			return 1;
+		if (src->type == OP_REG && dst->type == OP_REG && sz > 1 &&
+		    (isacc(src) || isacc(dst)) && !(sz == 4 &&
+		    isacc(src) && isacc(dst)))
+			return asoprr(sz, 0x90, isacc(src) ? dst : src);
+		if (src->type == OP_REG)
+			return asmodrm(sz, 0, 0x86 + (sz > 1), opreg(src), dst,
+			    0, 0);
+		if (dst->type == OP_REG)
+			return asmodrm(sz, 0, 0x86 + (sz > 1), opreg(dst), src,
+			    0, 0);
+		return 1;
+
+	case I_BSWAP:
+		if (nops != 1 || (sz = opsz(sz, src, NULL)) < 4 ||
+		    src->type != OP_REG)
+			return 1;
+		if (aspre(sz, 0, 0, src->reg & 8 ? 1 : 0))
+			return 1;
+		asemit(0x0f, 1);
+		asemit(0xc8 + (src->reg & 7), 1);
+		return 0;
+
+	case I_RM:
+		if (nops != 2 || (sz = opsz(sz, src, dst)) < 2 ||
+		    dst->type != OP_REG || !isgm(src))
+			return 1;
+		return asmodrm(sz, ip->pfx, ip->op, opreg(dst), src, 0, 0);
+
+	case I_PREF:
+		if (nops != 1 || src->type != OP_MEM)
+			return 1;
+		return asmodrm(0, 0, ip->op, ip->op2, src, 0, 0);
+
+	case I_FSTK:
+		if (nops == 0 && ip->op2 >= 0)
+			i = ip->op2;
+		else if (nops == 1 && src->cls == RC_ST)
+			i = src->reg;
+		else if (nops == 2 && src->cls == RC_ST &&
+		    dst->cls == RC_ST && dst->reg == 0 && ip->op2 >= 0)
+			i = src->reg;
+		else
+			return 1;
+		asopc(ip->op + i);
+		return 0;
+
+	case I_FMEM:
+		if (nops != 1 || src->type != OP_MEM)
+			return 1;
+		return asmodrm(0, 0, ip->op, ip->op2, src, 0, 0);
+
+	case I_FNSTSW:
+		if (nops != 1)
+			return 1;
+		if (src->type == OP_MEM)
+			return asmodrm(0, 0, 0xdd, 7, src, 0, 0);
+		if (gsz(src) != 2 || src->reg != 0)
+			return 1;
+		asopc(0xdfe0);
+		return 0;
+
+	case I_SSE:
+		if (nops != 2 || !isx(dst) || !isxm(src))
+			return 1;
+		return asmodrm(0, ip->pfx, ip->op, dst->reg, src, 0, 0);
+
+	case I_SSEI:
+		if (nops != 3 || src->type != OP_IMM || !iscon(src) ||
+		    !isx(dst) || !isxm(&ops[1]))
+			return 1;
+		if (asmodrm(0, ip->pfx, ip->op, dst->reg, &ops[1], 1, 0))
+			return 1;
+		asemit(src->e.val, 1);
+		return 0;
+
+	case I_SSEMOV:
+		if (nops == 0 && ip->pfx == 0xf2) {
+			asemit(0xa5, 1);	/* string movsd */
+			return 0;
+		}
+		if (nops != 2)
+			return 1;
+		if (isx(dst) && isxm(src))
+			return asmodrm(0, ip->pfx, ip->op, dst->reg, src, 0, 0);
+		if (isx(src) && dst->type == OP_MEM)
+			return asmodrm(0, ip->pfx, ip->op2, src->reg, dst,
+			    0, 0);
+		return 1;
+
+	case I_MOVD:	/* gas takes a 64-bit register here as well */
+		if (nops != 2)
+			return 1;
+		if (isx(dst) && (gsz(src) >= 4 || src->type == OP_MEM))
+			return asmodrm(gsz(src) == 8 ? 8 : 0, 0x66, 0x0f6e,
+			    dst->reg, src, 0, 0);
+		if (isx(src) && (gsz(dst) >= 4 || dst->type == OP_MEM))
+			return asmodrm(gsz(dst) == 8 ? 8 : 0, 0x66, 0x0f7e,
+			    src->reg, dst, 0, 0);
+		return 1;
+
+	case I_CVTI:
+		if (nops != 2 || !isx(dst) || !isgm(src))
+			return 1;
+		if (src->type == OP_REG) {
+			if ((sz = opsz(sz, src, NULL)) < 4)
+				return 1;
+		} else if (sz == 0)
+			sz = 4;
+		return asmodrm(sz, ip->pfx, ip->op, dst->reg, src, 0, 0);
+
+	case I_CVTX:
+		if (nops != 2 || !isxm(src) || (sz = opsz(sz, dst, NULL)) < 4)
+			return 1;
+		return asmodrm(sz, ip->pfx, ip->op, opreg(dst), src, 0, 0);
+	}
+	return 1;
+}
+
+/*
+ * Relocation type for a field of sz bytes.
+ */
+int
+asrtype(int mod, int sz, int flags)
+{
+	int pc = flags & AF_PCREL;
+
+	switch (mod) {
+	case 0:
+		switch (sz) {
+		case 8: return pc ? 24 : 1;	/* R_X86_64_PC64, 64 */
+		case 4:
+			if (pc)
+				return flags & AF_BRANCH ? 4 : 2; /* PLT32, PC32 */
+			return flags & AF_SIGNED ? 11 : 10;	/* 32S, 32 */
+		case 2: return pc ? 13 : 12;	/* PC16, 16 */
+		case 1: return pc ? 15 : 14;	/* PC8, 8 */
+		}
+		break;
+	case AM_PLT:
+		if (pc && sz == 4)
+			return 4;		/* R_X86_64_PLT32 */
+		break;
+	case AM_GOTPCREL:
+		if (pc && sz == 4) {
+			if (flags & AF_GOTX)	/* REX_GOTPCRELX, GOTPCRELX */
+				return flags & AF_REX ? 42 : 41;
+			return 9;		/* R_X86_64_GOTPCREL */
+		}
+		break;
+	case AM_GOTOFF:
+		if (!pc && sz == 8)
+			return 25;		/* R_X86_64_GOTOFF64 */
+		break;
+	case AM_GOTTPOFF:
+		if (pc && sz == 4)
+			return 22;		/* R_X86_64_GOTTPOFF */
+		break;
+	case AM_TPOFF:
+		if (!pc && sz == 4)
+			return 23;		/* R_X86_64_TPOFF32 */
+		if (!pc && sz == 8)
+			return 18;		/* R_X86_64_TPOFF64 */
+		break;
+	}
+	return -1;
+}
+
+/*
+ * Fill n bytes of code with nops, the same ones as gas uses.
+ */
+void
+asnops(char *p, int n)
+{
+	static char nops[11][11] = {
+		{ 0x90 },
+		{ 0x66, 0x90 },
+		{ 0x0f, 0x1f, 0x00 },
+		{ 0x0f, 0x1f, 0x40, 0x00 },
+		{ 0x0f, 0x1f, 0x44, 0x00, 0x00 },
+		{ 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00 },
+		{ 0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00,
+		    0x00 },
+		{ 0x66, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00,
+		    0x00, 0x00 },
+	};
+	int i;
+
+	while (n > 0) {
+		i = n > 11 ? 11 : n;
+		memcpy(p, nops[i-1], i);
+		p += i;
+		n -= i;
+	}
+}
+#endif
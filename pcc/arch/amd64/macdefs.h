@@ -52,6 +52,7 @@
 #define SZFLOAT		32
 #define SZDOUBLE	64
 #define SZLDOUBLE	128
+#define SZXTYPE		128	/* SSE2 vectors */
 
 /*
  * Alignment constraints
@@ -66,6 +67,7 @@
 #define ALFLOAT		32
 #define ALDOUBLE	64
 #define ALLDOUBLE	128
+#define ALXTYPE		128
 /* #undef ALSTRUCT	amd64 struct alignment is member defined */
 #define ALSTACK		64
 #define ALMAX		128 
@@ -115,6 +117,7 @@ typedef long long OFFSZ;
 #define	TARGET_TIMODE		/* has TI/TF/TC types (128 bit) */
 
 #define STACK_DOWN 		/* stack grows negatively for automatics */
+#define	SWTABLES	/* indirect goto usable for switch tables */
 
 #undef	FIELDOPS		/* no bit-field instructions */
 #define	TARGET_ENDIAN TARGET_LE	/* little-endian only */
@@ -127,6 +130,13 @@ typedef long long OFFSZ;
 #define	HASP2ALIGN
 #endif
 
+#define	PEEPHOLE		/* has peephole rules, see peep.c */
+
+#ifdef ELFABI
+#define	ELFOBJ			/* can write object files, see elfobj.c */
+#define	ELF_MACHINE	62	/* EM_X86_64 */
+#endif
+
 /* Definitions mostly used in pass2 */
 
 #define BYTEOFF(x)	((x)&07)
@@ -138,7 +148,8 @@ typedef long long OFFSZ;
 #define genfcall(a,b)	gencall(a,b)
 
 /* How many integer registers are needed? (used for stack allocation) */
-#define	szty(t)	(t < LONG || t == FLOAT ? 1 : t == LDOUBLE ? 4 : 2)
+#define	szty(t)	(t < LONG || t == FLOAT ? 1 : \
+	t == LDOUBLE || t == XTYPE ? 4 : 2)
 
 /*
  * The amd64 architecture has a much cleaner interface to its registers
@@ -212,7 +223,8 @@ typedef long long OFFSZ;
 
 
 /* Return a register class based on the type of the node */
-#define PCLASS(p) (p->n_type == FLOAT || p->n_type == DOUBLE ? SBREG : \
+#define PCLASS(p) (p->n_type == FLOAT || p->n_type == DOUBLE || \
+		   p->n_type == XTYPE ? SBREG : \
 		   p->n_type == LDOUBLE ? SCREG : SAREG)
 
 #define	NUMCLASS 	3	/* highest number of reg classes used */
@@ -263,6 +275,30 @@ int numconv(void *ip, void *p, void *q);
 
 #define	HAVE_WEAKREF
 #define TARGET_FLT_EVAL_METHOD	0	/* all as their type */
+
+/* index scale factors of the address modes, for ivsr */
+#define	IVSCALE(k)	((k) == 1 || (k) == 2 || (k) == 4 || (k) == 8)
+
+/*
+ * Operations on SSE2 vectors of element type t that have an instruction.
+ * SCONV is the splat of a scalar.  Used both by vecxop() in pass1 and
+ * by the loop vectorizer in pass2.  There is no psraq, and no 64-bit
+ * element multiply or compare.
+ */
+#define	VECFP(t)	((t) == FLOAT || (t) == DOUBLE)
+#define	VECOP(op, t)							\
+	((op) == SCONV || (op) == PLUS || (op) == MINUS ||		\
+	    (op) == UMINUS ? 1 :					\
+	 (op) == MUL ? (t) == SHORT || (t) == USHORT || VECFP(t) :	\
+	 (op) == DIV || (op) == NE || (op) == LT || (op) == LE ?	\
+	    VECFP(t) :							\
+	 (op) == AND || (op) == OR || (op) == ER || (op) == COMPL ?	\
+	    !VECFP(t) :							\
+	 (op) == LS ? !VECFP(t) && (t) > UCHAR :			\
+	 (op) == RS ? !VECFP(t) && (t) > UCHAR &&			\
+	    (ISUNSIGNED(t) || (t) < LONG) :				\
+	 (op) == EQ ? VECFP(t) || (t) < LONG :				\
+	 (op) == GT ? !VECFP(t) && !ISUNSIGNED(t) && (t) < LONG : 0)
 /*
  * builtins.
  */
@@ -300,6 +336,18 @@ P1ND *amd64_builtin_va_copy(const struct bitable *, P1ND *a);
 #define	MCLARGE		01000
 #define	MCALL		(MCSMALL|MCMEDIUM|MCLARGE)
 extern int mcmodel;
+#define	MPOPCNT		00001	/* popcnt */
+#define	MLZCNT		00002	/* lzcnt */
+#define	MBMI		00004	/* tzcnt */
+#define	MPRFCHW		00010	/* prefetchw */
+extern int msettings;
+
+#define	MYBITOP		/* bsr/bsf, others by -m */
+
+#define	UNALIGNED_BLKMOV	/* words at any alignment */
+#define	BLKMOVMAX	64	/* struct copies inline in pass1 */
+#define	STASGMAX	256	/* unrolled through xmm in pass2 */
+#define	BLKCPYMAX	STASGMAX	/* memcpy inline as a struct copy */
 
 /* floating point definitions */
 #define USE_IEEEFP_32
@@ -789,14 +789,12 @@ struct optab table[] = {
 		0,	RLEFT|RESCC,
 		"	Ob AR,AL\n", },
 
-/* m/r |= const */
-#ifdef notdef	/* amd64 lacks immediate 64-bit simple ops */
+/* m/r |= const, sign-extended from 32 bits */
 { OPSIMP,	INAREG|FOREFF|FORCC,
 	SAREG|SNAME|SOREG,	TLL|TPOINT,
-	SCON,	TANY,
+	SCON32,	TANY,
 		0,	RLEFT|RESCC,
 		"	Oq AR,AL\n", },
-#endif
 
 { OPSIMP,	INAREG|FOREFF|FORCC,
 	SAREG|SNAME|SOREG,	TWORD,
@@ -1123,7 +1121,8 @@ struct optab table[] = {
 	SOREG|SNAME,	TANY,
 	SAREG,		TPTRTO|TANY,
 		NEEDS(NEVER(RDI), NRIGHT(RSI), NOLEFT(RSI),
-		    NOLEFT(RCX), NORIGHT(RCX), NEVER(RCX), NREG(A,1)), RDEST,
+		    NOLEFT(RCX), NORIGHT(RCX), NEVER(RCX), NREG(A,1),
+		    NREG(B,1)), RDEST,
 		"F	movq AR,A1\nZQF	movq A1,AR\n", },
 
 /*
@@ -1582,10 +1581,40 @@ struct optab table[] = {
 		0,	RLEFT,
 		"	notb AL\n", },
 
+{ POPCNT,	INAREG,
+	SAREG|SOREG|SNAME,	TLL,
+	SANY,	TANY,
+		NEEDS(NREG(A, 1)), RESC1,
+		"	popcntq AL,A1\n", },
+
+{ POPCNT,	INAREG,
+	SAREG|SOREG|SNAME,	TWORD,
+	SANY,	TANY,
+		NEEDS(NREG(A, 1)), RESC1,
+		"	popcntl AL,A1\n", },
+
+{ CLZ,	INAREG,
+	SAREG|SOREG|SNAME,	TLL|TWORD,
+	SANY,	TANY,
+		NEEDS(NREG(A, 1)), RESC1,
+		"ZB", },
+
+{ CTZ,	INAREG,
+	SAREG|SOREG|SNAME,	TLL|TWORD,
+	SANY,	TANY,
+		NEEDS(NREG(A, 1)), RESC1,
+		"ZB", },
+
+{ PREFETCH,	FOREFF,
+	SOREG|SNAME,	TANY,
+	SANY,	TANY,
+		0,	0,
+		"	prefetchZp AL\n", },
+
 { STARG,	FOREFF,
 	SAREG|SOREG|SNAME|SCON, TANY,
 	SANY,	TSTRUCT,
-		NEEDS(NEVER(RDI), NLEFT(RSI), NEVER(RCX)), 0,
+		NEEDS(NEVER(RDI), NLEFT(RSI), NEVER(RCX), NREG(B,1)), 0,
 		"ZF", },
 
 { ADDROF,	INAREG,
@@ -1594,6 +1623,82 @@ struct optab table[] = {
 		NEEDS(NREG(A, 1)), RESC1,
 		"	leaq AL,A1\n", },
 
+/*
+ * SSE2 vectors.  Memory operands may be unaligned.
+ */
+{ OPLTYPE,	INBREG,
+	SANY,			TANY,
+	SOREG|SNAME|SBREG,	TXTYPE,
+		NEEDS(NREG(B, 1)),	RESC1,
+		"	movdqu AL,A1\n", },
+
+{ UMUL,	INBREG,
+	SANY,	TANY,
+	SOREG,	TXTYPE,
+		NEEDS(NREG(B, 1)),	RESC1,
+		"	movdqu AL,A1\n", },
+
+{ ASSIGN,	INBREG|FOREFF,
+	SBREG|SOREG|SNAME,	TXTYPE,
+	SBREG,			TXTYPE,
+		0,	RDEST,
+		"	movdqu AR,AL\n", },
+
+{ OPSIMP,	INBREG,
+	SBREG,	TXTYPE,
+	SBREG,	TXTYPE,
+		0,	RLEFT,
+		"ZV", },
+
+{ OPMUL,	INBREG,
+	SBREG,	TXTYPE,
+	SBREG,	TXTYPE,
+		0,	RLEFT,
+		"ZV", },
+
+{ OPLOG,	INBREG,
+	SBREG,	TXTYPE,
+	SBREG,	TXTYPE,
+		0,	RLEFT,
+		"ZV", },
+
+{ OPSHFT,	INBREG,
+	SBREG,	TXTYPE,
+	SCON,	TANY,
+		0,	RLEFT,
+		"ZV", },
+
+{ OPSHFT,	INBREG,
+	SBREG,	TXTYPE,
+	SAREG,	TWORD,
+		NEEDS(NREG(B, 1)),	RLEFT,
+		"ZV", },
+
+{ UMINUS,	INBREG,
+	SBREG,	TXTYPE,
+	SBREG,	TXTYPE,
+		NEEDS(NREG(B, 1)),	RESC1,
+		"ZV", },
+
+{ COMPL,	INBREG,
+	SBREG,	TXTYPE,
+	SBREG,	TXTYPE,
+		NEEDS(NREG(B, 1)),	RESC1,
+		"ZV", },
+
+/* splat a scalar */
+{ SCONV,	INBREG,
+	SAREG,	TCHAR|TUCHAR|TSHORT|TUSHORT|TWORD|TLL,
+	SBREG,	TXTYPE,
+		NEEDS(NREG(B, 1)),	RESC1,
+		"ZV", },
+
+{ SCONV,	INBREG,
+	SBREG,	TFLOAT|TDOUBLE,
+	SBREG,	TXTYPE,
+		NEEDS(NREG(B, 1)),	RESC1,
+		"ZV", },
+
 # define DF(x) FORREW,SANY,TANY,SANY,TANY,NEEDS(NREWRITE),x,""
 
 { UMUL, DF( UMUL ), },
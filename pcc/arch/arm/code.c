@@ -467,6 +467,21 @@ fldty(struct symtab *p)
 {
 }
 
+/*
+ * clz from armv5, rbit (for trailing zeros) from armv6t2.
+ */
+int
+mybitop(int op, TWORD t)
+{
+	if (t != INT && t != UNSIGNED && t != LONG && t != ULONG)
+		return 0;
+	if (op == CLZ)
+		return features(FEATURE_CLZ);
+	if (op == CTZ)
+		return features(FEATURE_RBIT);
+	return 0;
+}
+
 /*
  * Build target-dependent switch tree/table.
  *
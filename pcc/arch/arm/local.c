@@ -333,7 +333,7 @@ myp2tree(NODE *p)
 
 #define IALLOC(sz)	(isinlining ? permalloc(sz) : tmpalloc(sz))
 
-	sp = IALLOC(sizeof(struct symtab));
+	sp = memset(IALLOC(sizeof(struct symtab)), 0, sizeof(struct symtab));
 	sp->sclass = STATIC;
 	sp->sap = 0;
 	sp->slevel = 1; /* fake numeric label */
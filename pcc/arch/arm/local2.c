@@ -1394,102 +1394,136 @@ mflags(char *str)
 		fset &= ~FEATURE_MUL;
 		fset &= ~FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset &= ~FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv2") == 0) {
 		fset &= ~FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset &= ~FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset &= ~FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv2a") == 0) {
 		fset &= ~FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset &= ~FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset &= ~FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv3") == 0) {
 		fset &= ~FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset &= ~FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset &= ~FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv4") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset &= ~FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv4t") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset &= ~FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv4tej") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset &= ~FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv5") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv5te") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv5tej") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset &= ~FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv6") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset |= FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv6t2") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset |= FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset |= FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv6kz") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset |= FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv6k") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset |= FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset &= ~FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv7") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset |= FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset |= FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset |= FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv7-m") == 0 || strcasecmp(str, "arch=armv7e-m") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset |= FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset |= FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset |= FEATURE_RBIT;
 	} else if (strcasecmp(str, "arch=armv7-a") == 0) {
 		fset |= FEATURE_HALFWORDS;
 		fset |= FEATURE_EXTEND;
 		fset |= FEATURE_MUL;
 		fset |= FEATURE_MULL;
 		fset &= ~FEATURE_DIV;
+		fset |= FEATURE_CLZ;
+		fset |= FEATURE_RBIT;
 	} else {
 		fprintf(stderr, "unknown m option '%s'\n", str);
 		exit(1);
@@ -1522,3 +1556,137 @@ myxasm(struct interpass *ip, NODE *p)
 {
 	return 0;
 }
+
+/*
+ * Pipeline model and instruction table for the scheduler, see sched.c.
+ *
+ * A single issue core with interlocks, like the ARM9E and ARM11.
+ * Only the unconditional forms are known; anything conditional,
+ * writing back its base register or moving several registers stays
+ * where it is.
+ */
+struct schedmodel schedmodel = {
+	1,
+	{ 1, 3, 1, 3, 12, 4, 18, 1 },
+	{ 0 },
+	NULL,
+};
+
+#define	SR_S	16	/* s0/d0, s pairs are one register */
+#define	SR_F	48	/* fpa f0 */
+#define	SR_CPSR	56
+
+static struct {
+	char *name;
+	int reg;
+} sregs[] = {
+	{ "sl", 10 }, { "fp", 11 }, { "ip", 12 }, { "sp", 13 },
+	{ "lr", 14 }, { "pc", 15 },
+	{ NULL },
+};
+
+int
+schedreg(char *s)
+{
+	char *e;
+	int i;
+
+	if (*s == 'r' || *s == 's' || *s == 'd' || *s == 'f') {
+		if (!isdigit((unsigned char)s[1]))
+			goto named;
+		i = strtol(s+1, &e, 10);
+		if (*e)
+			return -1;
+		switch (*s) {
+		case 'r': return i < 16 ? i : -1;
+		case 's': return i < 32 ? SR_S + i/2 : -1;
+		case 'd': return i < 16 ? SR_S + i : -1;
+		case 'f': return i < 8 ? SR_F + i : -1;
+		}
+	}
+named:	for (i = 0; sregs[i].name; i++)
+		if (strcmp(s, sregs[i].name) == 0)
+			return sregs[i].reg;
+	return -1;
+}
+
+#define	D	SO_DEF
+#define	L	SF_MEM
+#define	S	(SF_MEM|SF_STORE)
+
+static struct schedop schedops[] = {
+	{ "mov", SC_ALU, D }, { "mvn", SC_ALU, D },
+	{ "add", SC_ALU, D }, { "sub", SC_ALU, D },
+	{ "rsb", SC_ALU, D },
+	{ "adc", SC_ALU, D, 0, 0, SR_CPSR },
+	{ "sbc", SC_ALU, D, 0, 0, SR_CPSR },
+	{ "rsc", SC_ALU, D, 0, 0, SR_CPSR },
+	{ "and", SC_ALU, D }, { "orr", SC_ALU, D },
+	{ "eor", SC_ALU, D }, { "bic", SC_ALU, D },
+	{ "lsl", SC_ALU, D }, { "lsr", SC_ALU, D },
+	{ "asr", SC_ALU, D }, { "ror", SC_ALU, D },
+	{ "sxtb", SC_ALU, D }, { "sxth", SC_ALU, D },
+	{ "uxtb", SC_ALU, D }, { "uxth", SC_ALU, D },
+	{ "movs", SC_ALU, D, 0, SR_CPSR }, { "adds", SC_ALU, D, 0, SR_CPSR },
+	{ "subs", SC_ALU, D, 0, SR_CPSR }, { "rsbs", SC_ALU, D, 0, SR_CPSR },
+	{ "negs", SC_ALU, D, 0, SR_CPSR }, { "ands", SC_ALU, D, 0, SR_CPSR },
+	{ "cmp", SC_ALU, 0, 0, SR_CPSR }, { "cmn", SC_ALU, 0, 0, SR_CPSR },
+	{ "tst", SC_ALU, 0, 0, SR_CPSR }, { "teq", SC_ALU, 0, 0, SR_CPSR },
+	{ "mul", SC_MUL, D }, { "mla", SC_MUL, D },
+	{ "umull", SC_MUL, D }, { "smull", SC_MUL, D },
+	{ "ldr", SC_LOAD, D|L, 4 }, { "ldrb", SC_LOAD, D|L, 1 },
+	{ "ldrh", SC_LOAD, D|L, 2 }, { "ldrsb", SC_LOAD, D|L, 1 },
+	{ "ldrsh", SC_LOAD, D|L, 2 },
+	{ "str", SC_STORE, S, 4 }, { "strb", SC_STORE, S, 1 },
+	{ "strh", SC_STORE, S, 2 },
+	{ "ldfs", SC_LOAD, D|L, 4 }, { "ldfd", SC_LOAD, D|L, 8 },
+	{ "ldfe", SC_LOAD, D|L, 12 },
+	{ "stfs", SC_STORE, S, 4 }, { "stfd", SC_STORE, S, 8 },
+	{ "stfe", SC_STORE, S, 12 },
+	{ "mvfs", SC_FPU, D }, { "mvfd", SC_FPU, D }, { "mvfe", SC_FPU, D },
+	{ "adfs", SC_FPU, D }, { "adfd", SC_FPU, D }, { "adfe", SC_FPU, D },
+	{ "sufs", SC_FPU, D }, { "sufd", SC_FPU, D }, { "sufe", SC_FPU, D },
+	{ "mufs", SC_FPU, D }, { "mufd", SC_FPU, D }, { "mufe", SC_FPU, D },
+	{ "dvfs", SC_FDIV, D }, { "dvfd", SC_FDIV, D }, { "dvfe", SC_FDIV, D },
+	{ "flts", SC_FPU, D }, { "fltd", SC_FPU, D }, { "flte", SC_FPU, D },
+	{ "fix", SC_FPU, D },
+	{ "fcpys", SC_FPU, D }, { "fcpyd", SC_FPU, D },
+	{ "fnegs", SC_FPU, D }, { "fnegd", SC_FPU, D },
+	{ "fadds", SC_FPU, D }, { "faddd", SC_FPU, D },
+	{ "fsubs", SC_FPU, D }, { "fsubd", SC_FPU, D },
+	{ "fmuls", SC_FPU, D }, { "fmuld", SC_FPU, D },
+	{ "fdivs", SC_FDIV, D }, { "fdivd", SC_FDIV, D },
+	{ "fcvtsd", SC_FPU, D }, { "fcvtds", SC_FPU, D },
+	{ "fsitos", SC_FPU, D }, { "fsitod", SC_FPU, D },
+	{ "fuitos", SC_FPU, D }, { "fuitod", SC_FPU, D },
+	{ "ftosis", SC_FPU, D }, { "ftosid", SC_FPU, D },
+	{ "ftouis", SC_FPU, D }, { "ftouid", SC_FPU, D },
+	{ NULL },
+};
+
+#undef D
+#undef L
+#undef S
+
+int
+schedinsn(struct minsn *mi, struct schedinfo *si)
+{
+	int i;
+
+	for (i = 0; i < mi->nopd; i++)
+		if (strchr(mi->opd[i], '!'))
+			return 0;
+	if (schedtab(mi, mi->op, schedops, si) == 0)
+		return 0;
+	if (si->flags & SF_MEM) {
+		/* post-indexed */
+		if (mi->nopd > 2)
+			return 0;
+		if (si->mreg != SP && si->mreg != FP)
+			si->mreg = -1;
+	}
+	if ((strcmp(mi->op, "umull") == 0 || strcmp(mi->op, "smull") == 0) &&
+	    mi->nopd > 1)
+		schedopd(si, mi->opd[1], 1);
+	return 1;
+}
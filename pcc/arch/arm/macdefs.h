@@ -204,6 +204,7 @@ typedef long long OFFSZ;
 	{ -1, },					\
 
 #define STACK_DOWN 		/* stack grows negatively for temporaries */
+#define	SWTABLES	/* indirect goto usable for switch tables */
 
 #define ARGINIT		(4*8)	/* # bits above fp where arguments start */
 #define AUTOINIT	(12*8)	/* # bits above fp where automatics start */
@@ -235,10 +236,14 @@ int features(int f);
 #define FEATURE_MUL		0x00080000
 #define FEATURE_MULL		0x00100000
 #define FEATURE_DIV		0x00200000
+#define FEATURE_CLZ		0x00400000	/* clz */
+#define FEATURE_RBIT		0x00800000	/* rbit */
 #define FEATURE_FPA		0x10000000
 #define FEATURE_VFP		0x20000000
 #define FEATURE_HARDFLOAT	(FEATURE_FPA|FEATURE_VFP)
 
+#define	MYBITOP		/* clz and rbit by -march */
+
 #if 0
 #define TARGET_STDARGS
 #define TARGET_BUILTINS						\
@@ -272,3 +277,6 @@ NODE *arm_builtin_va_copy(const struct bitable *bt, NODE *a);
 #define DBL_PREFIX	IEEEFP_64
 #define LDBL_PREFIX	IEEEFP_64
 #define DEFAULT_FPI_DEFS { &fpi_binary32, &fpi_binary64, &fpi_binary64 }
+
+#define	SCHEDULE		/* has a pipeline model, see sched.c */
+#define	MICOMMENT	"@"	/* starts a comment, for peep.c */
@@ -1811,6 +1811,19 @@ struct optab table[] = {
 		"	mvn A1,AL" COM "64-bit complement\n"
 		"	mvn U1,UL\n", },
 
+{ CLZ,	INAREG | FEATURE_CLZ,
+	SAREG,	TWORD,
+	SANY,	TANY,
+		XSL(A),	RESC1,
+		"	clz A1,AL" COM "count leading zeros\n", },
+
+{ CTZ,	INAREG | FEATURE_RBIT,
+	SAREG,	TWORD,
+	SANY,	TANY,
+		XSL(A),	RESC1,
+		"	rbit A1,AL" COM "count trailing zeros\n"
+		"	clz A1,A1\n", },
+
 /*
  * Arguments to functions.
  */
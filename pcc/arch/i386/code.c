@@ -380,6 +380,21 @@ fldty(struct symtab *p)
 {
 }
 
+/*
+ * Bit counts on 32-bit words only, popcnt if asked for.
+ */
+int
+mybitop(int op, TWORD t)
+{
+	if (t != INT && t != UNSIGNED && t != LONG && t != ULONG)
+		return 0;
+#ifndef PASS1
+	return op != POPCNT || (msettings & MPOPCNT);
+#else
+	return op != POPCNT;	/* -m is only seen by pass2 */
+#endif
+}
+
 /*
  * XXX - fix genswitch.
  */
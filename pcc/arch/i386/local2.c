@@ -43,7 +43,8 @@ static int flabwrtn, loadlab;
 void
 deflab(int label)
 {
-	printf(LABFMT ":\n", label);
+	oputlab(stdout, label);
+	fputs(":\n", stdout);
 }
 
 static int regoff[7];
@@ -123,7 +124,7 @@ prologue(struct interpass_prolog *ipp)
 		printf("	popl %%ebx\n");
 #else
 		int l;
-		printf("	call " LABFMT "\n", l = getlab());
+		printf("	call " LABFMT "\n", l = getlab2());
 		printf(LABFMT ":\n", l);
 		printf("	popl %%ebx\n");
 		printf("	addl $_GLOBAL_OFFSET_TABLE_+[.-" LABFMT 
@@ -202,7 +203,8 @@ hopcode(int f, int o)
 		comperr("hopcode2: %d", o);
 		str = 0; /* XXX gcc */
 	}
-	printf("%s%c", str, f);
+	fputs(str, stdout);
+	putchar(f);
 }
 
 /*
@@ -446,6 +448,16 @@ zzzcode(NODE *p, int c)
 		}
 		break;
 
+	case 'B': /* clz/ctz, as lzcnt/tzcnt if asked for */
+		if (p->n_op == CLZ && (msettings & MLZCNT))
+			expand(p, 0, "\tlzcntl AL,A1\n");
+		else if (p->n_op == CLZ)
+			expand(p, 0, "\tbsrl AL,A1\n\txorl $31,A1\n");
+		else
+			expand(p, 0, (msettings & MBMI) ?
+			    "\ttzcntl AL,A1\n" : "\tbsfl AL,A1\n");
+		break;
+
 	case 'C':  /* remove from stack after subroutine call */
 #ifdef GCC_COMPAT
 		if (attr_find(p->n_left->n_ap, GCC_ATYP_STDCALL))
@@ -517,7 +529,7 @@ zzzcode(NODE *p, int c)
 #endif
 
 	case 'N': /* output extended reg name */
-		printf("%s", rnames[getlr(p, '1')->n_rval]);
+		fputs(rnames[getlr(p, '1')->n_rval], stdout);
 		break;
 
 	case 'O': /* print out emulated ops */
@@ -668,11 +680,11 @@ zzzcode(NODE *p, int c)
 		case EDX: ch = "%dl"; break;
 		default: ch = "ERROR"; break;
 		}
-		printf("%s", ch);
+		fputs(ch, stdout);
 		break;
 
 	case 'U': /* print a/h for right shift */
-		printf("%c", ISUNSIGNED(p->n_type) ? 'h' : 'a');
+		putchar(ISUNSIGNED(p->n_type) ? 'h' : 'a');
 		break;
 
 	default:
@@ -741,7 +753,8 @@ shtemp(NODE *p)
 void
 adrcon(CONSZ val)
 {
-	printf("$" CONFMT, val);
+	putchar('$');
+	oputcon(stdout, val);
 }
 
 void
@@ -752,11 +765,13 @@ conput(FILE *fp, NODE *p)
 	switch (p->n_op) {
 	case ICON:
 		if (p->n_name[0] != '\0') {
-			fprintf(fp, "%s", p->n_name);
-			if (val)
-				fprintf(fp, "+%d", val);
+			fputs(p->n_name, fp);
+			if (val) {
+				fputc('+', fp);
+				oputd(fp, val);
+			}
 		} else
-			fprintf(fp, "%d", val);
+			oputd(fp, val);
 		return;
 
 	default:
@@ -782,7 +797,8 @@ upput(NODE *p, int size)
 	size /= SZCHAR;
 	switch (p->n_op) {
 	case REG:
-		printf("%%%s", &rnames[p->n_rval][3]);
+		putchar('%');
+		fputs(&rnames[p->n_rval][3], stdout);
 		break;
 
 	case NAME:
@@ -792,7 +808,8 @@ upput(NODE *p, int size)
 		setlval(p, getlval(p) - size);
 		break;
 	case ICON:
-		printf("$" CONFMT, getlval(p) >> 32);
+		putchar('$');
+		oputcon(stdout, getlval(p) >> 32);
 		break;
 	default:
 		comperr("upput bad op %d size %d", p->n_op, size);
@@ -810,23 +827,32 @@ adrput(FILE *io, NODE *p)
 	case NAME:
 		if (p->n_name[0] != '\0') {
 			fputs(p->n_name, io);
-			if (getlval(p) != 0)
-				fprintf(io, "+" CONFMT, getlval(p));
+			if (getlval(p) != 0) {
+				fputc('+', io);
+				oputcon(io, getlval(p));
+			}
 		} else
-			fprintf(io, CONFMT, getlval(p));
+			oputcon(io, getlval(p));
 		return;
 
 	case OREG:
 		r = p->n_rval;
-		if (p->n_name[0])
-			printf("%s%s", p->n_name, getlval(p) ? "+" : "");
+		if (p->n_name[0]) {
+			fputs(p->n_name, io);
+			if (getlval(p))
+				fputc('+', io);
+		}
 		if (getlval(p))
-			fprintf(io, "%d", (int)getlval(p));
+			oputd(io, (int)getlval(p));
+		fputc('(', io);
 		if (R2TEST(r)) {
-			fprintf(io, "(%s,%s,4)", rnames[R2UPK1(r)],
-			    rnames[R2UPK2(r)]);
+			fputs(rnames[R2UPK1(r)], io);
+			fputc(',', io);
+			fputs(rnames[R2UPK2(r)], io);
+			fputs(",4", io);
 		} else
-			fprintf(io, "(%s)", rnames[p->n_rval]);
+			fputs(rnames[p->n_rval], io);
+		fputc(')', io);
 		return;
 	case ICON:
 #ifdef PCC_DEBUG
@@ -850,15 +876,16 @@ adrput(FILE *io, NODE *p)
 		switch (p->n_type) {
 		case LONGLONG:
 		case ULONGLONG:
-			fprintf(io, "%%%c%c%c", rnames[p->n_rval][0],
-			    rnames[p->n_rval][1], rnames[p->n_rval][2]);
+			fputc('%', io);
+			fwrite(rnames[p->n_rval], 1, 3, io);
 			break;
 		case SHORT:
 		case USHORT:
-			fprintf(io, "%%%s", &rnames[p->n_rval][2]);
+			fputc('%', io);
+			fputs(&rnames[p->n_rval][2], io);
 			break;
 		default:
-			fprintf(io, "%s", rnames[p->n_rval]);
+			fputs(rnames[p->n_rval], io);
 		}
 		return;
 
@@ -890,7 +917,11 @@ cbgen(int o, int lab)
 {
 	if (o < EQ || o > UGT)
 		comperr("bad conditional branch: %s", opst[o]);
-	printf("	%s " LABFMT "\n", ccbranches[o-EQ], lab);
+	putchar('\t');
+	fputs(ccbranches[o-EQ], stdout);
+	putchar(' ');
+	oputlab(stdout, lab);
+	putchar('\n');
 }
 
 static void
@@ -1341,6 +1372,14 @@ mflags(char *str)
 	MSET("arch=i486",MI486);
 	MSET("arch=i586",MI586);
 	MSET("arch=i686",MI686);
+
+#define	MFLAG(s,a) if (strcmp(str, s) == 0) msettings |= a; \
+	if (strcmp(str, "no-" s) == 0) msettings &= ~a
+
+	MFLAG("popcnt",MPOPCNT);
+	MFLAG("lzcnt",MLZCNT);
+	MFLAG("bmi",MBMI);
+	MFLAG("abm",MPOPCNT|MLZCNT);
 }
 
 /*
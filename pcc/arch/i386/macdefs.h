@@ -101,6 +101,7 @@
 #undef	CHAR_UNSIGNED
 #define	BOOL_TYPE	UCHAR	/* what used to store _Bool */
 #undef UNALIGNED_ACCESS
+#define	UNALIGNED_BLKMOV	/* block moves need no alignment */
 /*
  * Use large-enough types.
  */
@@ -133,6 +134,7 @@ typedef long long OFFSZ;
 #endif
 
 #define STACK_DOWN 		/* stack grows negatively for automatics */
+#define	SWTABLES	/* indirect goto usable for switch tables */
 
 #undef	FIELDOPS		/* no bit-field instructions */
 #define TARGET_ENDIAN TARGET_LE
@@ -414,10 +416,12 @@ int COLORMAP(int c, int *r);
 #define TARGET_IPP_MEMBERS			\
 	int ipp_argstacksize;
 
-#define	target_members_print_prolog(ipp) printf("%d", ipp->ipp_argstacksize)
-#define	target_members_print_epilog(ipp) printf("%d", ipp->ipp_argstacksize)
-#define target_members_read_prolog(ipp) ipp->ipp_argstacksize = rdint(&p)
-#define target_members_read_epilog(ipp) ipp->ipp_argstacksize = rdint(&p)
+#define	target_members_print_prolog(ipp) \
+	fwrite(&(ipp)->ipp_argstacksize, sizeof(int), 1, stdout)
+#define	target_members_print_epilog(ipp) \
+	fwrite(&(ipp)->ipp_argstacksize, sizeof(int), 1, stdout)
+#define target_members_read_prolog(ipp) IRGET((ipp)->ipp_argstacksize)
+#define target_members_read_epilog(ipp) IRGET((ipp)->ipp_argstacksize)
 
 #define	HAVE_WEAKREF
 #define	TARGET_FLT_EVAL_METHOD	2	/* all as long double */
@@ -453,6 +457,14 @@ extern int msettings;
 #define	MI586	0x004
 #define	MI686	0x008
 #define	MCPUMSK	0x00f
+#define	MPOPCNT	0x010	/* popcnt */
+#define	MLZCNT	0x020	/* lzcnt */
+#define	MBMI	0x040	/* tzcnt */
+
+#define	MYBITOP		/* bsr/bsf, others by -m */
+
+/* index scale factors of the address modes, for ivsr */
+#define	IVSCALE(k)	((k) == 1 || (k) == 2 || (k) == 4 || (k) == 8)
 
 /* target specific attributes */
 #define	ATTR_MI_TARGET	ATTR_I386_FCMPLRET, ATTR_I386_FPPOP
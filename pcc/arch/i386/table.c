@@ -1991,6 +1991,24 @@ struct optab table[] = {
 		0,	RLEFT,
 		"	notb AL\n", },
 
+{ POPCNT,	INAREG,
+	SA_O_N,	TWORD,
+	SANY,	TANY,
+		NEEDS(NREG(A, 1)),	RESC1,
+		"	popcntl AL,A1\n", },
+
+{ CLZ,	INAREG,
+	SA_O_N,	TWORD,
+	SANY,	TANY,
+		NEEDS(NREG(A, 1)),	RESC1,
+		"ZB", },
+
+{ CTZ,	INAREG,
+	SA_O_N,	TWORD,
+	SANY,	TANY,
+		NEEDS(NREG(A, 1)),	RESC1,
+		"ZB", },
+
 /*
  * Arguments to functions.
  */
@@ -101,6 +101,7 @@ typedef long long OFFSZ;
 #endif
 
 #define STACK_DOWN		/* stack grows negatively for automatics */
+#define	SWTABLES	/* indirect goto usable for switch tables */
 
 #undef	FIELDOPS		/* no bit-field instructions */
 #define TARGET_ENDIAN TARGET_BE /* big-endian */
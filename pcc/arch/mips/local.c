@@ -330,7 +330,7 @@ myp2tree(NODE *p)
 
 	/* Write float constants to memory */
  
-	sp = IALLOC(sizeof(struct symtab));
+	sp = memset(IALLOC(sizeof(struct symtab)), 0, sizeof(struct symtab));
 	sp->sclass = STATIC;
 	sp->sap = 0;
 	sp->slevel = 1; /* fake numeric label */
@@ -1337,3 +1337,149 @@ myxasm(struct interpass *ip, NODE *p)
 {
 	return 0;
 }
+
+/*
+ * Pipeline model and instruction table for the scheduler, see sched.c.
+ *
+ * An R3000-like pipeline without interlocks: loads and moves from
+ * the coprocessor have one delay slot, mult results are read two
+ * instructions later and the fp condition one instruction after the
+ * compare.  mfhi/mflo must be two instructions before the next mult
+ * or div.  Branch delay slots are filled by the assembler since the
+ * code is assembled with .set reorder.
+ */
+struct schedmodel schedmodel = {
+	1,
+	{ 1, 2, 1, 3, 1, 1, 1, 1 },
+	{ 0 },
+	"nop",
+};
+
+#define	SR_FP	32	/* $f0, pairs are one register */
+#define	SR_HILO	64
+#define	SR_FCC	65
+
+static char *sregs[] = {
+	"zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+	"t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+	"s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+	"t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra",
+};
+
+int
+schedreg(char *s)
+{
+	char *e;
+	int i;
+
+	if (*s++ != '$')
+		return -1;
+	if (*s == 'f' && isdigit((unsigned char)s[1])) {
+		i = strtol(s+1, &e, 10);
+		return *e == 0 && i < 32 ? SR_FP + (i & ~1) : -1;
+	}
+	if (isdigit((unsigned char)*s)) {
+		i = strtol(s, &e, 10);
+		return *e == 0 && i > 0 && i < 32 ? i : -1;
+	}
+	if (strcmp(s, "s8") == 0)
+		return FP;
+	if (strcmp(s, "kt0") == 0 || strcmp(s, "kt1") == 0)
+		return s[2] - '0' + 26;
+	for (i = 1; i < 32; i++)
+		if (strcmp(s, sregs[i]) == 0)
+			return i;
+	return -1;
+}
+
+#define	D	SO_DEF
+#define	L	SF_MEM
+#define	S	(SF_MEM|SF_STORE)
+#define	B	SF_BARRIER
+
+static struct schedop schedops[] = {
+	{ "add", SC_ALU, D }, { "addu", SC_ALU, D },
+	{ "addi", SC_ALU, D }, { "addiu", SC_ALU, D },
+	{ "sub", SC_ALU, D }, { "subu", SC_ALU, D },
+	{ "and", SC_ALU, D }, { "andi", SC_ALU, D },
+	{ "or", SC_ALU, D }, { "ori", SC_ALU, D },
+	{ "xor", SC_ALU, D }, { "xori", SC_ALU, D },
+	{ "nor", SC_ALU, D }, { "not", SC_ALU, D },
+	{ "neg", SC_ALU, D }, { "negu", SC_ALU, D },
+	{ "sll", SC_ALU, D }, { "sllv", SC_ALU, D },
+	{ "srl", SC_ALU, D }, { "srlv", SC_ALU, D },
+	{ "sra", SC_ALU, D }, { "srav", SC_ALU, D },
+	{ "slt", SC_ALU, D }, { "sltu", SC_ALU, D },
+	{ "slti", SC_ALU, D }, { "sltiu", SC_ALU, D },
+	{ "move", SC_ALU, D }, { "li", SC_ALU, D },
+	{ "lui", SC_ALU, D }, { "la", SC_ALU, D },
+	{ "mult", SC_MUL, 0, 0, SR_HILO }, { "multu", SC_MUL, 0, 0, SR_HILO },
+	{ "div", SC_DIV, 0, 0, SR_HILO }, { "divu", SC_DIV, 0, 0, SR_HILO },
+	{ "mfhi", SC_ALU, D, 0, 0, SR_HILO },
+	{ "mflo", SC_ALU, D, 0, 0, SR_HILO },
+	{ "lw", SC_LOAD, D|L, 4 }, { "lh", SC_LOAD, D|L, 2 },
+	{ "lhu", SC_LOAD, D|L, 2 }, { "lb", SC_LOAD, D|L, 1 },
+	{ "lbu", SC_LOAD, D|L, 1 },
+	{ "l.s", SC_LOAD, D|L, 4 }, { "lwc1", SC_LOAD, D|L, 4 },
+	{ "l.d", SC_LOAD, D|L, 8 }, { "ldc1", SC_LOAD, D|L, 8 },
+	{ "sw", SC_STORE, S, 4 }, { "sh", SC_STORE, S, 2 },
+	{ "sb", SC_STORE, S, 1 },
+	{ "s.s", SC_STORE, S, 4 }, { "swc1", SC_STORE, S, 4 },
+	{ "s.d", SC_STORE, S, 8 }, { "sdc1", SC_STORE, S, 8 },
+	{ "mfc1", SC_LOAD, D }, { "mtc1", SC_LOAD, 0 },
+	{ "nop", SC_ALU, SF_NOP },
+	{ "j", SC_BRANCH, B }, { "jal", SC_BRANCH, B },
+	{ "jr", SC_BRANCH, B }, { "jalr", SC_BRANCH, B },
+	{ "b", SC_BRANCH, B }, { "bal", SC_BRANCH, B },
+	{ "beq", SC_BRANCH, B }, { "bne", SC_BRANCH, B },
+	{ "beqz", SC_BRANCH, B }, { "bnez", SC_BRANCH, B },
+	{ "bgez", SC_BRANCH, B }, { "bgtz", SC_BRANCH, B },
+	{ "blez", SC_BRANCH, B }, { "bltz", SC_BRANCH, B },
+	{ "bc1t", SC_BRANCH, B }, { "bc1f", SC_BRANCH, B },
+	{ NULL },
+};
+
+#undef D
+#undef L
+#undef S
+#undef B
+
+int
+schedinsn(struct minsn *mi, struct schedinfo *si)
+{
+	char *op = mi->op;
+	int r;
+
+	if (op[0] == 'c' && op[1] == '.') {
+		/* fp compare, sets the condition */
+		si->class = SC_FPU;
+		si->lat = 2;
+		schedopd(si, mi->opd[0], 0);
+		if (mi->nopd > 1)
+			schedopd(si, mi->opd[1], 0);
+		BITSET(si->def, SR_FCC);
+		return 1;
+	}
+	if (strncmp(op, "add.", 4) == 0 || strncmp(op, "sub.", 4) == 0 ||
+	    strncmp(op, "mul.", 4) == 0 || strncmp(op, "div.", 4) == 0 ||
+	    strncmp(op, "neg.", 4) == 0 || strncmp(op, "abs.", 4) == 0 ||
+	    strncmp(op, "mov.", 4) == 0 || strncmp(op, "cvt.", 4) == 0) {
+		si->class = op[0] == 'd' ? SC_FDIV : SC_FPU;
+		for (r = 0; r < mi->nopd; r++)
+			schedopd(si, mi->opd[r], r == 0);
+		return 1;
+	}
+	if (schedtab(mi, op, schedops, si) == 0)
+		return 0;
+	if (strcmp(op, "mtc1") == 0 && mi->nopd == 2) {
+		/* the second operand is written */
+		memset(si->use, 0, sizeof(si->use));
+		schedopd(si, mi->opd[0], 0);
+		schedopd(si, mi->opd[1], 1);
+	}
+	if (strcmp(op, "mfhi") == 0 || strcmp(op, "mflo") == 0)
+		si->war = 3;
+	if ((si->flags & SF_MEM) && si->mreg != SP && si->mreg != FP)
+		si->mreg = -1;
+	return 1;
+}
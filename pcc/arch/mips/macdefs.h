@@ -364,3 +364,5 @@ P1ND *mips_builtin_va_copy(const struct bitable *, P1ND *a);
 #define DBL_PREFIX	IEEEFP_64
 #define LDBL_PREFIX	IEEEFP_64
 #define DEFAULT_FPI_DEFS { &fpi_binary32, &fpi_binary64, &fpi_binary64 }
+
+#define	SCHEDULE		/* has a pipeline model, see sched.c */
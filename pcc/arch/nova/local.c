@@ -160,7 +160,8 @@ myp2tree(P1ND *p)
 		break;
 
 	case FCON:
-		sp = tmpalloc(sizeof(struct symtab));
+		sp = memset(tmpalloc(sizeof(struct symtab)), 0,
+		    sizeof(struct symtab));
 		sp->sclass = STATIC;
 		sp->sap = 0;
 		sp->slevel = 1; /* fake numeric label */
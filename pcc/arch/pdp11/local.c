@@ -219,7 +219,7 @@ myp2tree(NODE *p)
 	if (p->n_op != FCON)
 		return;
 
-	sp = IALLOC(sizeof(struct symtab));
+	sp = memset(IALLOC(sizeof(struct symtab)), 0, sizeof(struct symtab));
 	sp->sclass = STATIC;
 	sp->sap = 0;
 	sp->slevel = 1; /* fake numeric label */
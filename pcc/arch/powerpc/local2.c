@@ -300,7 +300,7 @@ int idx = 1;
 
 #if defined(ELFABI)
 
-	sz =  = p2autooff;
+	sz = p2autooff;
 
 	/* calculate the frame space */
 	for (i = 0; i < MAXREGS; i++) {
@@ -1848,3 +1848,134 @@ myxasm(struct interpass *ip, NODE *p)
 {
 	return 0;
 }
+
+/*
+ * Pipeline model and instruction table for the scheduler, see sched.c.
+ *
+ * An in-order core issuing two instructions per cycle with one unit
+ * of each kind, like the 603e.  The record forms (with a dot) also
+ * write cr0, compares write the cr field they name or cr0.
+ */
+struct schedmodel schedmodel = {
+	2,
+	{ 1, 2, 1, 4, 20, 3, 18, 1 },
+	{ 0, 1, 1, 1, 1, 1, 1, 1 },
+	NULL,
+};
+
+#define	SR_SP	1
+#define	SR_FP	30
+#define	SR_F	32
+#define	SR_CR	64	/* cr0 */
+#define	SR_CA	72
+
+int
+schedreg(char *s)
+{
+	char *e;
+	int i;
+
+	if (*s == '%')
+		s++;
+	if (*s == 'r' || *s == 'f') {
+		if (!isdigit((unsigned char)s[1]))
+			return -1;
+		i = strtol(s+1, &e, 10);
+		if (*e || i > 31)
+			return -1;
+		return *s == 'r' ? i : SR_F + i;
+	}
+	if (s[0] == 'c' && s[1] == 'r' && s[2] >= '0' && s[2] <= '7' &&
+	    s[3] == 0)
+		return SR_CR + s[2] - '0';
+	return -1;
+}
+
+#define	D	SO_DEF
+#define	L	SF_MEM
+#define	S	(SF_MEM|SF_STORE)
+
+static struct schedop schedops[] = {
+	{ "add", SC_ALU, D }, { "addi", SC_ALU, D },
+	{ "addis", SC_ALU, D },
+	{ "addc", SC_ALU, D, 0, SR_CA }, { "addic", SC_ALU, D, 0, SR_CA },
+	{ "adde", SC_ALU, D, 0, SR_CA, SR_CA },
+	{ "addze", SC_ALU, D, 0, SR_CA, SR_CA },
+	{ "addme", SC_ALU, D, 0, SR_CA, SR_CA },
+	{ "subf", SC_ALU, D },
+	{ "subfc", SC_ALU, D, 0, SR_CA }, { "subfic", SC_ALU, D, 0, SR_CA },
+	{ "subfe", SC_ALU, D, 0, SR_CA, SR_CA },
+	{ "subfze", SC_ALU, D, 0, SR_CA, SR_CA },
+	{ "neg", SC_ALU, D }, { "not", SC_ALU, D },
+	{ "and", SC_ALU, D }, { "andi", SC_ALU, D },
+	{ "or", SC_ALU, D }, { "ori", SC_ALU, D },
+	{ "oris", SC_ALU, D },
+	{ "xor", SC_ALU, D }, { "xori", SC_ALU, D },
+	{ "xoris", SC_ALU, D },
+	{ "slw", SC_ALU, D }, { "slwi", SC_ALU, D },
+	{ "srw", SC_ALU, D }, { "srwi", SC_ALU, D },
+	{ "sraw", SC_ALU, D, 0, SR_CA }, { "srawi", SC_ALU, D, 0, SR_CA },
+	{ "extsb", SC_ALU, D }, { "extsh", SC_ALU, D },
+	{ "mr", SC_ALU, D }, { "li", SC_ALU, D },
+	{ "lis", SC_ALU, D },
+	{ "cmpw", SC_ALU, 0 }, { "cmpwi", SC_ALU, 0 },
+	{ "cmplw", SC_ALU, 0 }, { "cmplwi", SC_ALU, 0 },
+	{ "fcmpu", SC_FPU, 0 },
+	{ "mullw", SC_MUL, D }, { "mulli", SC_MUL, D },
+	{ "mulhw", SC_MUL, D }, { "mulhwu", SC_MUL, D },
+	{ "divw", SC_DIV, D }, { "divwu", SC_DIV, D },
+	{ "lwz", SC_LOAD, D|L, 4 }, { "lhz", SC_LOAD, D|L, 2 },
+	{ "lha", SC_LOAD, D|L, 2 }, { "lbz", SC_LOAD, D|L, 1 },
+	{ "lwzx", SC_LOAD, D|L, 4 }, { "lhzx", SC_LOAD, D|L, 2 },
+	{ "lhax", SC_LOAD, D|L, 2 }, { "lbzx", SC_LOAD, D|L, 1 },
+	{ "lfs", SC_LOAD, D|L, 4 }, { "lfd", SC_LOAD, D|L, 8 },
+	{ "lfsx", SC_LOAD, D|L, 4 }, { "lfdx", SC_LOAD, D|L, 8 },
+	{ "stw", SC_STORE, S, 4 }, { "sth", SC_STORE, S, 2 },
+	{ "stb", SC_STORE, S, 1 },
+	{ "stwx", SC_STORE, S, 4 }, { "sthx", SC_STORE, S, 2 },
+	{ "stbx", SC_STORE, S, 1 },
+	{ "stfs", SC_STORE, S, 4 }, { "stfd", SC_STORE, S, 8 },
+	{ "stfsx", SC_STORE, S, 4 }, { "stfdx", SC_STORE, S, 8 },
+	{ "fadd", SC_FPU, D }, { "fadds", SC_FPU, D },
+	{ "fsub", SC_FPU, D }, { "fsubs", SC_FPU, D },
+	{ "fmul", SC_FPU, D }, { "fmuls", SC_FPU, D },
+	{ "fmr", SC_FPU, D }, { "fneg", SC_FPU, D },
+	{ "fabs", SC_FPU, D }, { "frsp", SC_FPU, D },
+	{ "fctiwz", SC_FPU, D },
+	{ "fdiv", SC_FDIV, D }, { "fdivs", SC_FDIV, D },
+	{ NULL },
+};
+
+#undef D
+#undef L
+#undef S
+
+int
+schedinsn(struct minsn *mi, struct schedinfo *si)
+{
+	char buf[16], *op = mi->op;
+	size_t l = strlen(op);
+	int r;
+
+	if (l > 1 && l < sizeof(buf) && op[l-1] == '.') {
+		strcpy(buf, op);
+		buf[l-1] = 0;
+		op = buf;
+	}
+	if (schedtab(mi, op, schedops, si) == 0)
+		return 0;
+	if (op == buf)
+		BITSET(si->def, SR_CR);
+	if (strncmp(op, "cmp", 3) == 0 || strcmp(op, "fcmpu") == 0) {
+		/* writes the cr field named first, or cr0 */
+		r = mi->nopd > 0 ? schedreg(mi->opd[0]) : -1;
+		if (r < SR_CR || r >= SR_CR+8)
+			r = SR_CR;
+		BITSET(si->def, r);
+		BITCLEAR(si->use, r);
+		return 1;
+	}
+	if ((si->flags & SF_MEM) && si->mreg != SR_SP && si->mreg != SR_FP)
+		si->mreg = -1;
+	return 1;
+}
@@ -127,6 +127,7 @@ typedef long long OFFSZ;
 
 #undef	FIELDOPS		/* no bit-field instructions */
 #define TARGET_ENDIAN TARGET_BE
+#define	SWTABLES	/* indirect goto usable for switch tables */
 #ifndef MACHOABI
 #define MYINSTRING
 #endif
@@ -473,3 +474,6 @@ P1ND *powerpc_builtin_return_address(const struct bitable *f, P1ND *a);
 #define DBL_PREFIX      IEEEFP_64
 #define LDBL_PREFIX     IEEEFP_64
 #define DEFAULT_FPI_DEFS { &fpi_binary32, &fpi_binary64, &fpi_binary64 }
+
+#define	SCHEDULE		/* has a pipeline model, see sched.c */
+#define	MICOMMENT	"#;"	/* starts a comment, for peep.c */
@@ -550,6 +550,17 @@ fldty(struct symtab *p)
 {
 }
 
+/*
+ * Zbb counts in 32-bit words; rv64 would need the w forms.
+ */
+int
+mybitop(int op, TWORD t)
+{
+	if (!RVHASZBB() || RVIS64())
+		return 0;
+	return t == INT || t == UNSIGNED || t == LONG || t == ULONG;
+}
+
 /*
  * XXX - fix genswitch.
  */
@@ -319,6 +319,8 @@ static char *fcomp[] = { "feq", "feq", "fgt", "fge", "flt", "fle" };
 void
 zzzcode(NODE *p, int c)
 {
+	NODE *l, *r;
+
 	switch (c) {
 
 	case 'A': /* AREG comparisons 2-reg */
@@ -365,6 +367,21 @@ zzzcode(NODE *p, int c)
 		}
 		break;
 		
+	case 'H': /* prefetch, offset must be a multiple of 32 */
+		l = p->n_left;
+		r = getlr(p, '1');
+		if (l->n_op == NAME) {
+			expand(p, 0, "\tlla A1, AL\n");
+			l = r;
+		} else if (getlval(l) & 31) {
+			expand(p, 0, "\taddi A1, ");
+			printf("%s, %d\n", rnames[regno(l)], (int)getlval(l));
+			l = r;
+		}
+		printf("\tprefetch.%c %d(%s)\n", p->n_rval & PF_WRITE ? 'w' : 'r',
+		    l->n_op == OREG ? (int)getlval(l) : 0, rnames[regno(l)]);
+		break;
+
 	case 'Q': /* emit struct assign */
 		printf("%d", attr_find(p->n_ap, ATTR_P2STRUCT)->iarg(0));
 		/* stasg(p); */
@@ -1468,6 +1485,17 @@ void
 mflags(char *str)
 {
 
+	if (strncmp(str, "arch=", 5) == 0) {
+		if (strstr(str, "_zbb") != NULL)
+			msettings |= RV_ZBB;
+		else
+			msettings &= ~RV_ZBB;
+		if (strstr(str, "_zicbop") != NULL)
+			msettings |= RV_ZICBOP;
+		else
+			msettings &= ~RV_ZICBOP;
+		return;
+	}
 	fprintf(stderr, "unknown m option '%s'\n", str);
 }
 
@@ -1494,3 +1522,134 @@ int xasmconstregs(char *s)
 
 	return -1;
 }
+
+/*
+ * Pipeline model and instruction table for the scheduler, see sched.c.
+ *
+ * A single issue core with interlocks, like the SiFive E and U cores.
+ * Registers are numbered as in the hardware.
+ */
+struct schedmodel schedmodel = {
+	1,
+	{ 1, 3, 1, 3, 20, 5, 20, 1 },
+	{ 0 },
+	NULL,
+};
+
+#define	SR_SP	2
+#define	SR_S0	8
+#define	SR_F	32
+
+static char *sregs[] = {
+	"zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+	"s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+	"a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+	"s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+};
+
+static char *sfregs[] = {
+	"ft0", "ft1", "ft2", "ft3", "ft4", "ft5", "ft6", "ft7",
+	"fs0", "fs1", "fa0", "fa1", "fa2", "fa3", "fa4", "fa5",
+	"fa6", "fa7", "fs2", "fs3", "fs4", "fs5", "fs6", "fs7",
+	"fs8", "fs9", "fs10", "fs11", "ft8", "ft9", "ft10", "ft11",
+};
+
+/* x0 is not a register here, writes to it are lost */
+int
+schedreg(char *s)
+{
+	char *e;
+	int i;
+
+	if ((*s == 'x' || *s == 'f') && isdigit((unsigned char)s[1])) {
+		i = strtol(s+1, &e, 10);
+		if (*e || i > 31 || (*s == 'x' && i == 0))
+			return -1;
+		return *s == 'x' ? i : SR_F + i;
+	}
+	if (strcmp(s, "fp") == 0)
+		return SR_S0;
+	for (i = 1; i < 32; i++)
+		if (strcmp(s, sregs[i]) == 0)
+			return i;
+	for (i = 0; i < 32; i++)
+		if (strcmp(s, sfregs[i]) == 0)
+			return SR_F + i;
+	return -1;
+}
+
+#define	D	SO_DEF
+#define	L	SF_MEM
+#define	S	(SF_MEM|SF_STORE)
+
+static struct schedop schedops[] = {
+	{ "add", SC_ALU, D }, { "addi", SC_ALU, D },
+	{ "addw", SC_ALU, D }, { "addiw", SC_ALU, D },
+	{ "sub", SC_ALU, D }, { "subw", SC_ALU, D },
+	{ "and", SC_ALU, D }, { "andi", SC_ALU, D },
+	{ "or", SC_ALU, D }, { "ori", SC_ALU, D },
+	{ "xor", SC_ALU, D }, { "xori", SC_ALU, D },
+	{ "sll", SC_ALU, D }, { "slli", SC_ALU, D },
+	{ "sllw", SC_ALU, D }, { "slliw", SC_ALU, D },
+	{ "srl", SC_ALU, D }, { "srli", SC_ALU, D },
+	{ "srlw", SC_ALU, D }, { "srliw", SC_ALU, D },
+	{ "sra", SC_ALU, D }, { "srai", SC_ALU, D },
+	{ "sraw", SC_ALU, D }, { "sraiw", SC_ALU, D },
+	{ "slt", SC_ALU, D }, { "slti", SC_ALU, D },
+	{ "sltu", SC_ALU, D }, { "sltiu", SC_ALU, D },
+	{ "seqz", SC_ALU, D }, { "snez", SC_ALU, D },
+	{ "sltz", SC_ALU, D }, { "sgtz", SC_ALU, D },
+	{ "neg", SC_ALU, D }, { "negw", SC_ALU, D },
+	{ "not", SC_ALU, D }, { "mv", SC_ALU, D },
+	{ "sext.w", SC_ALU, D }, { "li", SC_ALU, D },
+	{ "lui", SC_ALU, D }, { "auipc", SC_ALU, D },
+	{ "la", SC_ALU, D }, { "lla", SC_ALU, D },
+	{ "mul", SC_MUL, D }, { "mulw", SC_MUL, D },
+	{ "mulh", SC_MUL, D }, { "mulhu", SC_MUL, D },
+	{ "mulhsu", SC_MUL, D },
+	{ "div", SC_DIV, D }, { "divu", SC_DIV, D },
+	{ "divw", SC_DIV, D }, { "divuw", SC_DIV, D },
+	{ "rem", SC_DIV, D }, { "remu", SC_DIV, D },
+	{ "remw", SC_DIV, D }, { "remuw", SC_DIV, D },
+	{ "lb", SC_LOAD, D|L, 1 }, { "lbu", SC_LOAD, D|L, 1 },
+	{ "lh", SC_LOAD, D|L, 2 }, { "lhu", SC_LOAD, D|L, 2 },
+	{ "lw", SC_LOAD, D|L, 4 }, { "lwu", SC_LOAD, D|L, 4 },
+	{ "ld", SC_LOAD, D|L, 8 },
+	{ "flw", SC_LOAD, D|L, 4 }, { "fld", SC_LOAD, D|L, 8 },
+	{ "sb", SC_STORE, S, 1 }, { "sh", SC_STORE, S, 2 },
+	{ "sw", SC_STORE, S, 4 }, { "sd", SC_STORE, S, 8 },
+	{ "fsw", SC_STORE, S, 4 }, { "fsd", SC_STORE, S, 8 },
+	{ "fadd", SC_FPU, D }, { "fsub", SC_FPU, D },
+	{ "fmul", SC_FPU, D }, { "fmadd", SC_FPU, D },
+	{ "fmsub", SC_FPU, D }, { "fneg", SC_FPU, D },
+	{ "fabs", SC_FPU, D }, { "fmv", SC_FPU, D },
+	{ "fsgnj", SC_FPU, D }, { "fsgnjn", SC_FPU, D },
+	{ "fsgnjx", SC_FPU, D }, { "fcvt", SC_FPU, D },
+	{ "fmin", SC_FPU, D }, { "fmax", SC_FPU, D },
+	{ "feq", SC_FPU, D }, { "flt", SC_FPU, D },
+	{ "fle", SC_FPU, D },
+	{ "fdiv", SC_FDIV, D }, { "fsqrt", SC_FDIV, D },
+	{ NULL },
+};
+
+#undef D
+#undef L
+#undef S
+
+int
+schedinsn(struct minsn *mi, struct schedinfo *si)
+{
+	char buf[16], *op = mi->op;
+
+	/* the fp ops are known by their name before the first dot */
+	if (op[0] == 'f' && strchr(op, '.') && strlen(op) < sizeof(buf)) {
+		strcpy(buf, op);
+		*strchr(buf, '.') = 0;
+		op = buf;
+	}
+	if (schedtab(mi, op, schedops, si) == 0)
+		return 0;
+	if ((si->flags & SF_MEM) && si->mreg != SR_SP && si->mreg != SR_S0)
+		si->mreg = -1;
+	return 1;
+}
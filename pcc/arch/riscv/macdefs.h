@@ -425,6 +425,8 @@ extern int msettings;
 #define	RV_C		0040
 #define	RV_64		0100
 #define	RV_E		0200
+#define	RV_ZBB		0400	/* basic bit manipulation */
+#define	RV_ZICBOP	01000	/* cache block prefetch */
 
 #define	RVHASM()	(msettings & RV_M)
 #define	RVHASA()	(msettings & RV_A)
@@ -434,6 +436,11 @@ extern int msettings;
 #define	RVHASC()	(msettings & RV_C)
 #define	RVIS64()	(msettings & RV_64)
 #define	RVISE()		(msettings & RV_E)
+#define	RVHASZBB()	(msettings & RV_ZBB)
+#define	RVHASZICBOP()	(msettings & RV_ZICBOP)
+
+#define	MYBITOP		/* Zbb by -march */
+#define	PREFETCHOK()	RVHASZICBOP()
 
 #define	XLEN	(RVIS64() ? 64 : 32)
 #define	XLENx2	(2*XLEN)
@@ -449,3 +456,6 @@ int szlong, szpoint, allong, alpoint;
 #define LDBL_PREFIX     IEEEFP_64
 
 #define DEFAULT_FPI_DEFS { &fpi_binary32, &fpi_binary64, &fpi_binary64 }
+
+#define	SCHEDULE		/* has a pipeline model, see sched.c */
+#define	MICOMMENT	"#;"	/* starts a comment, for peep.c */
@@ -1034,6 +1034,30 @@ struct optab table[] = {
 	"	not A1,AL\n"
 	"	not U1,UL\n", },
 
+{	POPCNT,	INAREG,
+	SAREG,	TINT|TUNSIGNED,
+	SANY,	TANY,
+	NA,	RESC1,
+	"	cpop A1,AL\n", },
+
+{	CLZ,	INAREG,
+	SAREG,	TINT|TUNSIGNED,
+	SANY,	TANY,
+	NA,	RESC1,
+	"	clz A1,AL\n", },
+
+{	CTZ,	INAREG,
+	SAREG,	TINT|TUNSIGNED,
+	SANY,	TANY,
+	NA,	RESC1,
+	"	ctz A1,AL\n", },
+
+{	PREFETCH,	FOREFF,
+	SOREG|SNAME,	TANY,
+	SANY,	TANY,
+	NA,	0,
+	"ZH", },
+
 {	STASG,        INAREG|FOREFF,
 	SOREG|SNAME,    TANY,
 	SAREG,          TPTRTO|TANY,
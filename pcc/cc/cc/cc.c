@@ -81,9 +81,14 @@
 #include "config.h"
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #ifdef HAVE_SYS_WAIT_H
 #include <sys/wait.h>
 #endif
+#ifndef _WIN32
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
 
 #include <ctype.h>
 #include <errno.h>
@@ -261,6 +266,16 @@ char *deflibs[] = DEFLIBS;
 char *defproflibs[] = DEFPROFLIBS;
 char *defcxxlibs[] = DEFCXXLIBS;
 
+#ifdef HAVE_CC2
+#ifdef NEED_CC2
+#define	C2check	1
+#else
+#define	C2check	Oflag
+#endif
+#else
+#define	C2check	0
+#endif
+
 char	*outfile, *MFfile, *fname;
 static char **lav;
 static int lac;
@@ -314,6 +329,7 @@ int	Mflag, needM, MDflag, MMDflag;	/* dependencies only */
 int	pgflag;
 int	pieflag;
 int	Xflag;
+int	Ztime;	/* time the passes */
 int	nostartfiles, Bstatic, shared;
 int	nostdinc, nostdlib;
 int	pthreads;
@@ -326,6 +342,10 @@ int	xuchar = 0;
 #endif
 int	cxxflag;
 int	cppflag;
+#ifdef USE_ELFOBJ
+int	intas = 0;	/* let ccom write the object file */
+static char *objfile;
+#endif
 int	printprogname, printfilename, printsearchdirs;
 enum { SC11, STRAD, SC89, SGNU89, SC99, SGNU99 } cstd;
 
@@ -450,6 +470,9 @@ main(int argc, char *argv[])
 	char *t, *u, *argp;
 	char *msuffix;
 	int ninput, j;
+#ifdef USE_ELFOBJ
+	struct stat st;
+#endif
 
 	lav = argv;
 	lac = argc;
@@ -640,6 +663,10 @@ main(int argc, char *argv[])
 			} else if (match(u, "stack-protector") ||
 			    match(u, "stack-protector-all")) {
 				sspflag = j ? 0 : 1;
+#ifdef USE_ELFOBJ
+			} else if (match(u, "integrated-as")) {
+				intas = j ? 0 : 1;
+#endif
 			} else if (match(u, "use-ld=")) {
 				/* ignore nonsense -fno-use-ld=* command */
 				if (j)
@@ -662,6 +689,14 @@ main(int argc, char *argv[])
 			Xflag++;
 			break;
 
+		case 'Z':
+			if (match(argp, "-Ztime")) {
+				Ztime++;
+				strlist_append(&compiler_flags, argp);
+			} else
+				oerror(argp);
+			break;
+
 		case 'D':
 		case 'U':
 			strlist_append(&preprocessor_flags, argp);
@@ -727,6 +762,22 @@ main(int argc, char *argv[])
 				break;
 			}
 #endif
+#if defined(mach_amd64) || defined(mach_i386)
+			if (match(argp, "-mpopcnt") || match(argp, "-mlzcnt") ||
+			    match(argp, "-mabm") || match(argp, "-mbmi") ||
+			    match(argp, "-mno-popcnt") ||
+			    match(argp, "-mno-lzcnt") || match(argp, "-mno-bmi")) {
+				strlist_append(&compiler_flags, argp);
+				break;
+			}
+#endif
+#if defined(mach_amd64)
+			if (match(argp, "-mprfchw") ||
+			    match(argp, "-mno-prfchw")) {
+				strlist_append(&compiler_flags, argp);
+				break;
+			}
+#endif
 #if defined(os_sunos)
 			/* Ignore -m64 and -m32 for now.
 			 * TODO set up PCC as a multiarch compiler on Solaris.
@@ -915,6 +966,9 @@ main(int argc, char *argv[])
 					strlist_append(&inputs, u);
 				} while ((u = strtok(NULL, ",")) != NULL);
 			} else if ((t = argnxt(argp, "-Wa,"))) {
+#ifdef USE_ELFOBJ
+				intas = 0;
+#endif
 				u = strtok(t, ",");
 				do {
 					strlist_append(&assembler_flags, u);
@@ -1133,12 +1187,33 @@ main(int argc, char *argv[])
 					ofile = setsuf(s->value, 's');
 			} else
 				strlist_append(&temp_outputs, ofile = gettmp());
+#ifdef USE_ELFOBJ
+			objfile = NULL;
+			if (intas && !Sflag && !gflag && !C2check) {
+				if (cflag) {
+					objfile = outfile;
+					if (objfile == NULL)
+						objfile = setsuf(s->value, 'o');
+					(void)unlink(objfile);
+				} else
+					strlist_append(&temp_outputs,
+					    objfile = gettmp());
+			}
+#endif
 			if (compile_input(ifile, ofile))
 				exandrm(ofile);
 			if (Sflag)
 				continue;
 			ifile = ofile;
 			suffix = "s";
+#ifdef USE_ELFOBJ
+			/* ccom leaves it empty if it could not assemble */
+			if (objfile != NULL && stat(objfile, &st) == 0 &&
+			    st.st_size > 0) {
+				strlist_append(&middle_linker_flags, objfile);
+				continue;
+			}
+#endif
 		}
 
 		/*
@@ -1269,16 +1344,6 @@ find_file(const char *file, struct strlist *path, int mode)
 	return xstrdup(file);
 }
 
-#ifdef HAVE_CC2
-#ifdef NEED_CC2
-#define	C2check	1
-#else
-#define	C2check	Oflag
-#endif
-#else
-#define	C2check	0
-#endif
-
 #ifdef TWOPASS
 static int
 compile_input(char *input, char *output)
@@ -1302,6 +1367,12 @@ compile_input(char *input, char *output)
 
 	strlist_init(&args);
 	strlist_append_list(&args, &compiler_flags);
+#ifdef USE_ELFOBJ
+	if (objfile != NULL) {
+		strlist_append(&args, "-o");
+		strlist_append(&args, objfile);
+	}
+#endif
 	strlist_append(&args, tfile);
 	strlist_append(&args, output);
 	strlist_prepend(&args,
@@ -1324,6 +1395,12 @@ compile_input(char *input, char *output)
 
 	strlist_init(&args);
 	strlist_append_list(&args, &compiler_flags);
+#ifdef USE_ELFOBJ
+	if (objfile != NULL) {
+		strlist_append(&args, "-o");
+		strlist_append(&args, objfile);
+	}
+#endif
 	strlist_append(&args, input);
 	strlist_append(&args, tfile);
 	strlist_prepend(&args,
@@ -1568,6 +1645,8 @@ strlist_exec(struct strlist *l)
 
 #else
 
+#define	TVMS(tv)	((tv).tv_sec * 1000.0 + (tv).tv_usec / 1000.0)
+
 static int
 strlist_exec(struct strlist *l)
 {
@@ -1576,6 +1655,8 @@ strlist_exec(struct strlist *l)
 	char **argv;
 	size_t argc;
 	ssize_t result;
+	struct timeval t0, t1;
+	struct rusage r0, r1;
 	int rv;
 
 	strlist_make_array(l, &argv, &argc);
@@ -1587,6 +1668,10 @@ strlist_exec(struct strlist *l)
 	if (noexec)
 		return 0;
 
+	if (Ztime) {
+		gettimeofday(&t0, NULL);
+		getrusage(RUSAGE_CHILDREN, &r0);
+	}
 	switch ((child = fork())) {
 	case 0:
 		execvp(argv[0], argv);
@@ -1600,6 +1685,14 @@ strlist_exec(struct strlist *l)
 	default:
 		while (waitpid(child, &rv, 0) == -1 && errno == EINTR)
 			/* nothing */(void)0;
+		if (Ztime) {
+			gettimeofday(&t1, NULL);
+			getrusage(RUSAGE_CHILDREN, &r1);
+			fprintf(stderr, "%s: %.3f ms wall, %.3f ms cpu\n",
+			    argv[0], TVMS(t1) - TVMS(t0),
+			    TVMS(r1.ru_utime) + TVMS(r1.ru_stime) -
+			    TVMS(r0.ru_utime) - TVMS(r0.ru_stime));
+		}
 		rv = WEXITSTATUS(rv);
 		if (rv)
 			errorx(1, "%s terminated with status %d", argv[0], rv);
@@ -1962,6 +2055,14 @@ struct flgcheck ccomflgcheck[] = {
 	{ &Oflag, 1, "-xinline" },
 	{ &Oflag, 1, "-xdce" },
 	{ &Oflag, 1, "-xssa" },
+	{ &Oflag, 1, "-xscp" },
+	{ &Oflag, 1, "-xgvn" },
+	{ &Oflag, 1, "-xlicm" },
+	{ &Oflag, 1, "-xivsr" },
+	{ &Oflag, 1, "-xpeep" },
+	{ &Oflag, 1, "-xsched" },
+	{ &Oflag, 1, "-xlayout" },
+	{ &Oflag, 1, "-xvect" },
 	{ &freestanding, 1, "-ffreestanding" },
 	{ &pgflag, 1, "-p" },
 	{ &gflag, 1, "-g" },
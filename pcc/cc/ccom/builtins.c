@@ -83,14 +83,21 @@ builtin_constant_p(const struct bitable *bt, P1ND *a)
 
 /*
  * Hint to the compiler whether this expression will evaluate true or false.
- * Just ignored for now.
+ * The expected value is remembered on the expression; cbranch() uses it
+ * for the branch probability.
  */
 static P1ND *
 builtin_expect(const struct bitable *bt, P1ND *a)
 {
+	struct attr *ap;
 	P1ND *f;
 
 	if (a && a->n_op == CM) {
+		if (nncon(a->n_right)) {
+			ap = attr_new(ATTR_EXPECT, 1);
+			ap->iarg(0) = glval(a->n_right) != 0;
+			a->n_left->n_ap = attr_add(a->n_left->n_ap, ap);
+		}
 		p1tfree(a->n_right);
 		f = a->n_left;
 		p1nfree(a);
@@ -142,7 +149,6 @@ builtin_abs(const struct bitable *bt, P1ND *a)
 }
 
 #define	cmop(x,y) buildtree(COMOP, x, y)
-#define	lblnod(l) nlabel(l)
 
 #ifndef TARGET_BSWAP
 static P1ND *
@@ -192,53 +198,130 @@ builtin_bswap64(const struct bitable *bt, P1ND *a)
 
 #endif
 
-#ifndef TARGET_CXZ
 /*
- * Find number of beginning 0's in a word of type t.
- * t should be deunsigned.
+ * Bit counting.  Targets with instructions for it say so in mybitop()
+ * and get POPCNT/CLZ/CTZ nodes, others get branch-free shift and mask
+ * sequences.  Constant arguments are folded.
+ */
+#ifndef MYBITOP
+#define	mybitop(op, t)	0
+#endif
+
+/*
+ * Return p as a constant or a temp assigned to it; the assignment
+ * is added to *rp.
  */
 static P1ND *
-builtin_cxz(P1ND *a, TWORD t, int isclz)
+bittemp(P1ND **rp, P1ND *p, TWORD t)
 {
-	P1ND *t101, *t102;
-	P1ND *rn, *p;
-	int l15, l16, l17;
-	int sz;
+	P1ND *q;
+
+	if (nncon(p))
+		return p;
+	q = tempnode(0, t, 0, 0);
+	p = buildtree(ASSIGN, ccopy(q), p);
+	*rp = *rp ? cmop(*rp, p) : p;
+	return q;
+}
+
+static P1ND *
+bitend(P1ND *r, P1ND *p)
+{
+	p = cast(p, INT, 0);
+	return r ? cmop(r, p) : p;
+}
+
+/*
+ * Number of set bits in a, of unsigned type t.
+ */
+static P1ND *
+bitpopc(P1ND **rp, P1ND *a, TWORD t)
+{
+	P1ND *x, *y;
+	U_CONSZ m;
+	int i, sz;
+
+	if (mybitop(POPCNT, t) && !nncon(a))
+		return block(POPCNT, a, NULL, t, 0, 0);
 
-	t = ctype(t);
 	sz = (int)tsize(t, 0, 0);
+	m = SZMASK(sz);
+#define	BC(v)	xbcon((CONSZ)((v) & m), NULL, t)
+	x = bittemp(rp, a, t);
+	/* pairs, nibbles, then bytes summed by shifting */
+	y = buildtree(AND, buildtree(RS, ccopy(x), bcon(1)), BC(~(U_CONSZ)0/3));
+	x = bittemp(rp, buildtree(MINUS, x, y), t);
+	y = buildtree(AND, buildtree(RS, ccopy(x), bcon(2)), BC(~(U_CONSZ)0/5));
+	x = buildtree(AND, x, BC(~(U_CONSZ)0/5));
+	x = bittemp(rp, buildtree(PLUS, x, y), t);
+	y = buildtree(RS, ccopy(x), bcon(4));
+	x = bittemp(rp, buildtree(AND, buildtree(PLUS, x, y),
+	    BC(~(U_CONSZ)0/17)), t);
+	for (i = 8; i < sz; i <<= 1) {
+		y = buildtree(RS, ccopy(x), bcon(i));
+		x = bittemp(rp, buildtree(PLUS, x, y), t);
+	}
+	return buildtree(AND, x, BC(2*sz-1));
+#undef BC
+}
 
-	t101 = tempnode(0, INT, 0, 0);
-	t102 = tempnode(0, t, 0, 0);
-	l15 = getlab();
-	l16 = getlab();
-	l17 = getlab();
-	rn = buildtree(ASSIGN, ccopy(t102), a);
-	rn = cmop(rn, buildtree(ASSIGN, ccopy(t101), bcon(0)));
-	rn = cmop(rn, lblnod(l16));
-
-	p = buildtree(CBRANCH, buildtree(GE, ccopy(t101), bcon(sz)), bcon(l15));
-	rn = cmop(rn, p);
-	if (isclz) {
-		p = buildtree(CBRANCH,
-		    buildtree(GE, ccopy(t102), bcon(0)), bcon(l17));
-	} else {
-		p = buildtree(CBRANCH,
-		    buildtree(EQ, buildtree(AND, ccopy(t102), bcon(1)),
-		    bcon(0)), bcon(l17));
+/*
+ * Leading zeros; the bits below the highest set are filled in
+ * and the rest counted.
+ */
+static P1ND *
+bitclz(P1ND **rp, P1ND *a, TWORD t)
+{
+	P1ND *x, *y;
+	int i, sz;
+
+	if (mybitop(CLZ, t) && !nncon(a))
+		return block(CLZ, a, NULL, t, 0, 0);
+
+	sz = (int)tsize(t, 0, 0);
+	x = bittemp(rp, a, t);
+	for (i = 1; i < sz; i <<= 1) {
+		y = buildtree(RS, ccopy(x), bcon(i));
+		x = bittemp(rp, buildtree(OR, x, y), t);
 	}
-	rn = cmop(rn, p);
+	return bitpopc(rp, buildtree(COMPL, x, NULL), t);
+}
 
-	rn = cmop(rn, block(GOTO, bcon(l15), NULL, INT, 0, 0));
+/*
+ * Trailing zeros; counts the bits below the lowest set.
+ */
+static P1ND *
+bitctz(P1ND **rp, P1ND *a, TWORD t)
+{
+	P1ND *x, *y;
+	int sz;
 
-	rn = cmop(rn, lblnod(l17));
-	rn = cmop(rn, buildtree(isclz ? LSEQ : RSEQ , t102, bcon(1)));
+	if (mybitop(CTZ, t) && !nncon(a))
+		return block(CTZ, a, NULL, t, 0, 0);
+
+	sz = (int)tsize(t, 0, 0);
+	x = bittemp(rp, a, t);
+	if (mybitop(CLZ, t) && !nncon(x)) {
+		y = buildtree(UMINUS, ccopy(x), NULL);
+		y = block(CLZ, buildtree(AND, x, y), NULL, t, 0, 0);
+		return buildtree(MINUS, xbcon(sz-1, NULL, t), y);
+	}
+	y = buildtree(MINUS, ccopy(x), xbcon(1, NULL, t));
+	return bitpopc(rp, buildtree(AND, buildtree(COMPL, x, NULL), y), t);
+}
 
-	rn = cmop(rn, buildtree(INCR, ccopy(t101), bcon(1)));
+#ifndef TARGET_CXZ
+/*
+ * Find number of beginning 0's in a word of type t.
+ */
+static P1ND *
+builtin_cxz(P1ND *a, TWORD t, int isclz)
+{
+	P1ND *r = NULL;
 
-	rn = cmop(rn, block(GOTO, bcon(l16), NULL, INT, 0, 0));
-	rn = cmop(rn, lblnod(l15));
-	return cmop(rn, t101);
+	t = ENUNSIGN(ctype(t));
+	a = isclz ? bitclz(&r, a, t) : bitctz(&r, a, t);
+	return bitend(r, a);
 }
 
 static P1ND *
@@ -288,53 +371,31 @@ builtin_era(const struct bitable *bt, P1ND *a)
 
 #ifndef TARGET_FFS
 /*
- * Find number of beginning 0's in a word of type t.
- * t should be deunsigned.
+ * Find first set bit, counted from 1, in a word of type t.
+ * The count is masked with -1 if the word is non-zero, else 0.
  */
 static P1ND *
 builtin_ff(P1ND *a, TWORD t)
 {
-	P1ND *t101, *t102;
-	P1ND *rn, *p;
-	int l15, l16, l17;
+	P1ND *r = NULL, *x, *n, *p;
 	int sz;
 
-	t = ctype(t);
-	sz = (int)tsize(t, 0, 0)+1;
-
-	t101 = tempnode(0, INT, 0, 0);
-	t102 = tempnode(0, t, 0, 0);
-	l15 = getlab();
-	l16 = getlab();
-	l17 = getlab();
-	rn = buildtree(ASSIGN, ccopy(t101), bcon(0));
-	rn = cmop(rn, buildtree(ASSIGN, ccopy(t102), a));
-
-	p = buildtree(CBRANCH, buildtree(EQ, ccopy(t102), bcon(0)), bcon(l15));
-	rn = cmop(rn, p);
-
-	rn = cmop(rn, buildtree(INCR, ccopy(t101), bcon(1)));
-
-	rn = cmop(rn, lblnod(l16));
-
-	p = buildtree(CBRANCH, buildtree(GE, ccopy(t101), bcon(sz)), bcon(l15));
-	rn = cmop(rn, p);
-
-	p = buildtree(CBRANCH,
-	    buildtree(EQ, buildtree(AND, ccopy(t102), bcon(1)),
-	    bcon(0)), bcon(l17));
-	rn = cmop(rn, p);
-
-	rn = cmop(rn, block(GOTO, bcon(l15), NULL, INT, 0, 0));
-
-	rn = cmop(rn, lblnod(l17));
-	rn = cmop(rn, buildtree(RSEQ, t102, bcon(1)));
-
-	rn = cmop(rn, buildtree(INCR, ccopy(t101), bcon(1)));
+	t = ENUNSIGN(ctype(t));
+	sz = (int)tsize(t, 0, 0);
 
-	rn = cmop(rn, block(GOTO, bcon(l16), NULL, INT, 0, 0));
-	rn = cmop(rn, lblnod(l15));
-	return cmop(rn, t101);
+	x = bittemp(&r, a, t);
+	n = buildtree(OR, ccopy(x), buildtree(UMINUS, ccopy(x), NULL));
+	n = buildtree(RS, n, bcon(sz-1));
+	if (mybitop(CTZ, t) || mybitop(CLZ, t)) {
+		p = bitctz(&r, ccopy(x), t);
+		p = buildtree(PLUS, p, xbcon(1, NULL, t));
+	} else {
+		p = buildtree(MINUS, ccopy(x), xbcon(1, NULL, t));
+		p = bitpopc(&r, buildtree(ER, ccopy(x), p), t);
+	}
+	p1tfree(x);
+	p = buildtree(AND, p, buildtree(UMINUS, n, NULL));
+	return bitend(r, p);
 }
 
 static P1ND *
@@ -359,39 +420,10 @@ builtin_ffsll(const struct bitable *bt, P1ND *a)
 static P1ND *
 builtin_popcnt(P1ND *a, TWORD t)
 {
-	P1ND *t101, *t102;
-	P1ND *rn, *p;
-	int l15, l16, l17;
-
-	t101 = tempnode(0, INT, 0, 0); /* counter for set bits */
-	t102 = tempnode(0, t, 0, 0); /* input data */
-	l15 = getlab();
-	l16 = getlab();
-	l17 = getlab();
-	rn = buildtree(ASSIGN, ccopy(t101), bcon(0)); /* bit counter set to 0 */
-	p = buildtree(ASSIGN, ccopy(t102), a); /* input data */
-	rn = cmop(rn, p);
-
-	rn = cmop(rn, lblnod(l15)); /* place a label here */
-
-	p = buildtree(CBRANCH,
-	    buildtree(EQ, buildtree(AND, ccopy(t102), bcon(1)),
-	    bcon(0)), bcon(l16)); /* if (t103 & 1) == 0, goto l16 */
-	rn = cmop(rn, p);
-
-	rn = cmop(rn, buildtree(INCR, ccopy(t101), bcon(1))); /* bit counter plus 1 */
+	P1ND *r = NULL;
 
-	rn = cmop(rn, lblnod(l16)); /* label */
-
-	rn = cmop(rn, buildtree(RSEQ, t102, bcon(1))); /* right-shift input data 1 position */
-
-	p = buildtree(CBRANCH, buildtree(EQ, ccopy(t102), bcon(0)), bcon(l17)); /* if all bits unset, goto l17 */
-	rn = cmop(rn, p);
-
-	rn = cmop(rn, block(GOTO, bcon(l15), NULL, INT, 0, 0)); /* go to the beginning of loop */
-
-	rn = cmop(rn, lblnod(l17)); /* label, loop exit here */
-	return cmop(rn, t101);
+	a = bitpopc(&r, a, ctype(t));
+	return bitend(r, a);
 }
 
 static P1ND *
@@ -549,7 +581,12 @@ binhelp(P1ND *a, TWORD rt, char *n)
 static P1ND *
 builtin_unimp(const struct bitable *bt, P1ND *a)
 {
-	return binhelp(a, bt->rt, &bt->name[10]);
+	char *n = bt->name;
+
+	/* library functions are called by their own name */
+	if (strncmp(n, "__builtin_", 10) == 0)
+		n += 10;
+	return binhelp(a, bt->rt, n);
 }
 
 #if 0
@@ -561,9 +598,59 @@ builtin_unimp_f(P1ND *f, P1ND *a, TWORD rt)
 #endif
 
 #ifndef TARGET_PREFETCH
+#ifndef PREFETCHOK
+#define	PREFETCHOK()	1
+#endif
+/*
+ * Prefetch (addr, rw, locality); rw and locality are optional constants.
+ * Targets without a PREFETCH rule drop it (and the address) entirely.
+ */
 static P1ND *
 builtin_prefetch(const struct bitable *bt, P1ND *a)
 {
+	P1ND *q[2], *p;
+	CONSZ v;
+	int i, n, rw, loc;
+
+	if (a == NULL) {
+		uerror("wrong argument count to %s", bt->name);
+		return bcon(0);
+	}
+	for (n = 0; a->n_op == CM; n++) {
+		if (n == 2) {
+			uerror("wrong argument count to %s", bt->name);
+			for (i = 0; i < n; i++)
+				p1tfree(q[i]);
+			p1tfree(a);
+			return bcon(0);
+		}
+		q[n] = a->n_right;
+		p = a->n_left;
+		p1nfree(a);
+		a = p;
+	}
+
+	/* q[n-1] is rw, q[0] locality if given */
+	rw = 0, loc = 3;
+	for (i = 0; i < n; i++) {
+		v = nncon(q[i]) ? glval(q[i]) : -1;
+		if (v < 0 || v > (i == n-1 ? 1 : 3))
+			uerror("bad argument %d to %s", n+1-i, bt->name);
+		else if (i == n-1)
+			rw = (int)v;
+		else
+			loc = (int)v;
+		p1tfree(q[i]);
+	}
+
+#ifdef HAS_PREFETCH
+	if (PREFETCHOK()) {
+		a = buildtree(UMUL, makety(a, mkqtyp(INCREF(CHAR))), NULL);
+		p = block(PREFETCH, a, NULL, VOID, 0, 0);
+		p->n_rval = loc | (rw ? PF_WRITE : 0);
+		return p;
+	}
+#endif
 	p1tfree(a);
 	return bcon(0);
 }
@@ -822,15 +909,9 @@ builtin_cir(const struct bitable *bt, P1ND *a)
 #ifndef TARGET_MEMCMP
 #define	builtin_memcmp builtin_unimp
 #endif
-#ifndef TARGET_MEMCPY
-#define	builtin_memcpy builtin_unimp
-#endif
 #ifndef TARGET_MEMPCPY
 #define	builtin_mempcpy builtin_unimp
 #endif
-#ifndef TARGET_MEMSET
-#define	builtin_memset builtin_unimp
-#endif
 
 /* Reasonable type of size_t */
 #ifndef SIZET
@@ -845,6 +926,87 @@ builtin_cir(const struct bitable *bt, P1ND *a)
 
 static TWORD memcpyt[] = { VOID|PTR, VOID|PTR, SIZET, INT };
 static TWORD memsett[] = { VOID|PTR, INT, SIZET, INT };
+
+static int acnt(P1ND *, int, TWORD *);
+
+/*
+ * memcpy and memset of a short constant size are done inline, also
+ * when called by their plain names.  Prototypes are checked here
+ * instead of in builtin_check() so that the pointer types are still
+ * there to tell the alignment.
+ */
+static int
+blkcnt(const struct bitable *bt, P1ND *a, TWORD *tp, int max)
+{
+	CONSZ sz;
+
+	if (acnt(a, 3, tp)) {
+		uerror("wrong argument count to %s", bt->name);
+		return -1;
+	}
+	if (!nncon(a->n_right) || (sz = glval(a->n_right)) <= 0 ||
+	    sz > max)
+		return 0;
+	return (int)sz;
+}
+
+#ifndef TARGET_MEMCPY
+static P1ND *
+builtin_memcpy(const struct bitable *bt, P1ND *a)
+{
+	P1ND *d, *s, *r;
+	int al, sz;
+
+	if (a == NULL || a->n_op != CM || a->n_left->n_op != CM) {
+		uerror("wrong argument count to %s", bt->name);
+		return bcon(0);
+	}
+	al = MIN(blkalign(a->n_left->n_left), blkalign(a->n_left->n_right));
+	if ((sz = blkcnt(bt, a, memcpyt, BLKCPYMAX)) < 0)
+		return bcon(0);
+	if (sz == 0)
+		return builtin_unimp(bt, a);
+
+	r = NULL;
+	d = blkaddr(a->n_left->n_left, &r);
+	s = blkaddr(a->n_left->n_right, &r);
+	p1nfree(a->n_left);
+	p1tfree(a->n_right);
+	p1nfree(a);
+	a = buildtree(COMOP, blkcopy(p1tcopy(d), s, sz, al), d);
+	return r ? buildtree(COMOP, r, a) : a;
+}
+#endif
+
+#ifndef TARGET_MEMSET
+static P1ND *
+builtin_memset(const struct bitable *bt, P1ND *a)
+{
+	P1ND *d, *r;
+	int al, sz, v;
+
+	if (a == NULL || a->n_op != CM || a->n_left->n_op != CM) {
+		uerror("wrong argument count to %s", bt->name);
+		return bcon(0);
+	}
+	al = blkalign(a->n_left->n_left);
+	if ((sz = blkcnt(bt, a, memsett, BLKMOVMAX)) < 0)
+		return bcon(0);
+	if (sz == 0 || !nncon(a->n_left->n_right))
+		return builtin_unimp(bt, a);
+
+	v = (int)glval(a->n_left->n_right);
+	r = NULL;
+	d = blkaddr(a->n_left->n_left, &r);
+	p1tfree(a->n_left->n_right);
+	p1nfree(a->n_left);
+	p1tfree(a->n_right);
+	p1nfree(a);
+	a = buildtree(COMOP, blkset(p1tcopy(d), v, sz, al), d);
+	return r ? buildtree(COMOP, r, a) : a;
+}
+#endif
+
 static TWORD allocat[] = { SIZET };
 static TWORD expectt[] = { LONG, LONG };
 static TWORD strcmpt[] = { CHAR|PTR, CHAR|PTR };
@@ -871,6 +1033,10 @@ static const struct bitable bitable[] = {
 	/* gnu universe only */
 	{ "alloca", builtin_alloca, BTGNUONLY, 1, allocat, VOID|PTR },
 
+	/* library functions expanded inline when possible */
+	{ "memcpy", builtin_memcpy, BTNOPROTO|BTHOSTED, 3, memcpyt, VOID|PTR },
+	{ "memset", builtin_memset, BTNOPROTO|BTHOSTED, 3, memsett, VOID|PTR },
+
 #ifndef NO_COMPLEX
 	/* builtins for complex operations */
 	{ "crealf", builtin_cir, BTNOPROTO, 1, 0, FLOAT },
@@ -929,9 +1095,9 @@ static const struct bitable bitable[] = {
 	{ "__builtin_copysignl", builtin_unimp, 0, 2, fmaxlt, LDOUBLE },
 	{ "__builtin_expect", builtin_expect, 0, 2, expectt, LONG },
 	{ "__builtin_memcmp", builtin_memcmp, 0, 3, memcpyt, INT },
-	{ "__builtin_memcpy", builtin_memcpy, 0, 3, memcpyt, VOID|PTR },
+	{ "__builtin_memcpy", builtin_memcpy, BTNOPROTO, 3, memcpyt, VOID|PTR },
 	{ "__builtin_mempcpy", builtin_mempcpy, 0, 3, memcpyt, VOID|PTR },
-	{ "__builtin_memset", builtin_memset, 0, 3, memsett, VOID|PTR },
+	{ "__builtin_memset", builtin_memset, BTNOPROTO, 3, memsett, VOID|PTR },
 	{ "__builtin_fabsf", builtin_unimp, 0, 1, fmaxft, FLOAT },
 	{ "__builtin_fabs", builtin_unimp, 0, 1, fmaxt, DOUBLE },
 	{ "__builtin_fabsl", builtin_unimp, 0, 1, fmaxlt, LDOUBLE },
@@ -963,7 +1129,7 @@ static const struct bitable bitable[] = {
 	{ "__builtin_nan", builtin_nanx, BTNOEVE, 1, nant, DOUBLE },
 	{ "__builtin_nanl", builtin_nanx, BTNOEVE, 1, nant, LDOUBLE },
 	{ "__builtin_object_size", builtin_object_size, BTNOPROTO, 2, memsett, SIZET },
-	{ "__builtin_prefetch", builtin_prefetch, 0, 1, memsett, VOID },
+	{ "__builtin_prefetch", builtin_prefetch, BTNOPROTO, -1, 0, VOID },
 	{ "__builtin_scalbnf", builtin_unimp, 0, 2, scalbnft, FLOAT },
 	{ "__builtin_scalbn", builtin_unimp, 0, 2, scalbnt, DOUBLE },
 	{ "__builtin_scalbnl", builtin_unimp, 0, 2, scalbnlt, LDOUBLE },
@@ -1070,6 +1236,8 @@ builtin_init(void)
 		bt = &bitable[i];
 		if ((bt->flags & BTGNUONLY) && xgnu99 == 0 && xgnu89 == 0)
 			continue; /* not in c99 universe, at least for now */
+		if ((bt->flags & BTHOSTED) && freestanding)
+			continue;
 		sp = lookup(addname(bt->name), 0);
 		if (bt->rt == 0 && (bt->flags & BTNORVAL) == 0)
 			cerror("function '%s' has no return type", bt->name);
@@ -1479,7 +1479,7 @@ resetbc(int mask)
 struct swdef {
 	struct swdef *next;	/* Next in list */
 	int deflbl;		/* Label for "default" */
-	struct swents *ents;	/* Linked sorted list of case entries */
+	struct swents *ents;	/* Case entries, latest first */
 	int nents;		/* # of entries in list */
 	int num;		/* Node value will end up in */
 	TWORD type;		/* Type of switch expression */
@@ -1491,7 +1491,7 @@ struct swdef {
 static void
 addcase(P1ND *p)
 {
-	struct swents **put, *w, *sw = malloc(sizeof(struct swents));
+	struct swents *sw;
 	CONSZ val;
 
 	p = optloop(p);  /* change enum to ints */
@@ -1513,26 +1513,17 @@ addcase(P1ND *p)
 		if (glval(p) != val)
 			werror("case expression truncated");
 	}
+	sw = malloc(sizeof(struct swents));
 	sw->sval = glval(p);
+	sw->sline = lineno;
 	p1tfree(p);
-	put = &swpole->ents;
-	if (ISUNSIGNED(swpole->type)) {
-		for (w = swpole->ents;
-		     w != NULL && (U_CONSZ)w->sval < (U_CONSZ)sw->sval;
-		     w = w->next)
-			put = &w->next;
-	} else {
-		for (w = swpole->ents; w != NULL && w->sval < sw->sval;
-		     w = w->next)
-			put = &w->next;
-	}
-	if (w != NULL && w->sval == sw->sval) {
-		uerror("duplicate case in switch");
-		return;
-	}
-	plabel(sw->slab = getlab());
-	*put = sw;
-	sw->next = w;
+	/* share the label with a case directly before */
+	if (swpole->ents && lastdeflab == swpole->ents->slab)
+		sw->slab = lastdeflab;
+	else
+		plabel(sw->slab = getlab());
+	sw->next = swpole->ents;
+	swpole->ents = sw;
 	swpole->nents++;
 }
 
@@ -1580,6 +1571,22 @@ swstart(int num, TWORD type)
 	swpole = sw;
 }
 
+static int swuns;
+
+static int
+swcmp(const void *a, const void *b)
+{
+	const struct swents *l = *(struct swents * const *)a;
+	const struct swents *r = *(struct swents * const *)b;
+
+	if (l->sval != r->sval) {
+		if (swuns)
+			return (U_CONSZ)l->sval < (U_CONSZ)r->sval ? -1 : 1;
+		return l->sval < r->sval ? -1 : 1;
+	}
+	return l->sline - r->sline;
+}
+
 /*
  * end a switch block
  */
@@ -1588,7 +1595,7 @@ swend(void)
 {
 	struct swents *sw, **swp;
 	struct swdef *sp;
-	int i;
+	int i, n, ln;
 
 	sw = FUNALLO(sizeof(struct swents));
 	swp = FUNALLO(sizeof(struct swents *) * (swpole->nents+1));
@@ -1596,13 +1603,23 @@ swend(void)
 	sw->slab = swpole->deflbl;
 	swp[0] = sw;
 
-	for (i = 1; i <= swpole->nents; i++) {
-		swp[i] = swpole->ents;
-		swpole->ents = swpole->ents->next;
+	for (i = 1, sw = swpole->ents; sw; sw = sw->next)
+		swp[i++] = sw;
+	swuns = ISUNSIGNED(swpole->type);
+	qsort(swp+1, swpole->nents, sizeof(struct swents *), swcmp);
+	for (i = n = 1; i <= swpole->nents; i++) {
+		if (n > 1 && swp[i]->sval == swp[n-1]->sval) {
+			ln = lineno;
+			lineno = swp[i]->sline;
+			uerror("duplicate case in switch");
+			lineno = ln;
+			continue;
+		}
+		swp[n++] = swp[i];
 	}
-	genswitch(swpole->num, swpole->type, swp, swpole->nents);
+	genswitch(swpole->num, swpole->type, swp, n-1);
 
-	FUNFREE(sw);
+	FUNFREE(swp[0]);
 	FUNFREE(swp);
 	while (swpole->ents) {
 		sw = swpole->ents;
@@ -1614,6 +1631,176 @@ swend(void)
 	swpole = sp;
 }
 
+/*
+ * Switch lowering.  The sorted cases are split into clusters;
+ * dense runs become jump tables, short runs going to a few labels
+ * become bit tests and the rest are single compares.  The clusters
+ * are then searched with a balanced tree of compares, whose leaves
+ * are tested in sequence.
+ */
+#define	SWDENSE		40	/* min % of table slots used */
+#define	SWTABMIN	5	/* min cases in a jump table */
+#define	SWBITMIN	3	/* min cases in a bit test */
+#define	SWBITLAB	3	/* max labels in a bit test */
+#define	SWLEAF		3	/* max clusters tested in sequence */
+
+/* tables need an indirect goto, which is not in functions to inline */
+#ifdef SWTABLES
+#define	SWTABOK		(!isinlining)
+#else
+#define	SWTABOK		0
+#endif
+
+#define	SWCASE	0
+#define	SWTAB	1
+#define	SWBIT	2
+
+struct swclust {
+	int kind;
+	int first, last;	/* entries in cluster */
+};
+
+static struct swgen {
+	int num, deflab;
+	TWORD type;
+	struct swents **p;
+	struct swclust *c;
+} swg;
+
+/*
+ * Return a temp with the switch value less lo, as unsigned,
+ * after branching to miss if it is outside lo..hi.
+ */
+static P1ND *
+swrange(CONSZ lo, CONSZ hi, int miss)
+{
+	TWORD ut = ENUNSIGN(swg.type);
+	P1ND *p, *q;
+
+	p = buildtree(MINUS, tempnode(swg.num, swg.type, 0, 0),
+	    xbcon(lo, NULL, swg.type));
+	q = tempnode(0, ut, 0, 0);
+	ecomp(buildtree(ASSIGN, p1tcopy(q), cast(p, ut, 0)));
+	cbranch(buildtree(GT, p1tcopy(q),
+	    xbcon((U_CONSZ)hi - (U_CONSZ)lo, NULL, ut)), bcon(miss));
+	return q;
+}
+
+/*
+ * Jump via a table of label addresses, holes going to default.
+ */
+static void
+swtable(struct swclust *c, int miss)
+{
+	struct swents **p = swg.p;
+	struct symtab *tbl, *lsp;
+	P1ND *q;
+	CONSZ v, lo = p[c->first]->sval, hi = p[c->last]->sval;
+	int i, lab;
+
+	q = swrange(lo, hi, miss);
+	tbl = getsymtab("<swtab>", STEMP);
+	tbl->sclass = STATIC;
+	tbl->stype = INCREF(VOID);
+	tbl->soffset = getlab();
+	q = buildtree(PLUS, buildtree(ADDROF, nametree(tbl), NULL), q);
+	ecomp(biop(GOTO, buildtree(UMUL, q, NULL), NULL));
+
+	lsp = getsymtab("<swlab>", STEMP);
+	lsp->sclass = STATIC;
+	locctr(RDATA, tbl);
+	defloc(tbl);
+	savlab(swg.deflab);
+	for (i = c->first, v = lo; i <= c->last; v++) {
+		if (p[i]->sval == v) {
+			lab = p[i++]->slab;
+			if (i == c->first+1 || p[i-2]->slab != lab)
+				savlab(lab);
+		} else
+			lab = swg.deflab;
+		lsp->soffset = lab;
+		q = block(ICON, NULL, NULL, INCREF(VOID), 0, 0);
+		slval(q, 0);
+		q->n_sp = lsp;
+		inval(0, SZPOINT(VOID), q);
+		p1tfree(q);
+	}
+}
+
+/*
+ * Test membership of each label's cases with a shifted bit.
+ */
+static void
+swbits(struct swclust *c, int miss)
+{
+	struct swents **p = swg.p;
+	P1ND *q, *r;
+	U_CONSZ mask;
+	CONSZ lo = p[c->first]->sval;
+	int i, j, lab;
+
+	q = swrange(lo, p[c->last]->sval, miss);
+	for (i = c->first; i <= c->last; i++) {
+		lab = p[i]->slab;
+		for (j = c->first; j < i; j++)
+			if (p[j]->slab == lab)
+				break;
+		if (j < i)
+			continue;
+		for (mask = 0, j = i; j <= c->last; j++)
+			if (p[j]->slab == lab)
+				mask |= (U_CONSZ)1 << (p[j]->sval - lo);
+		r = buildtree(LS, xbcon(1, NULL, ULONG), p1tcopy(q));
+		r = buildtree(AND, r, xbcon((CONSZ)mask, NULL, ULONG));
+		cbranch(buildtree(NE, r, xbcon(0, NULL, ULONG)), bcon(lab));
+	}
+	p1tfree(q);
+	branch(swg.deflab);
+}
+
+/*
+ * Search clusters lo..hi, which all lie above any value
+ * already excluded by the tree.
+ */
+static void
+swtree(int lo, int hi)
+{
+	struct swclust *c = swg.c;
+	P1ND *r;
+	int i, mid, lab, miss;
+
+	if (hi - lo < SWLEAF) {
+		for (i = lo; i <= hi; i++) {
+			if (c[i].kind == SWCASE) {
+				r = buildtree(NE, tempnode(swg.num,
+				    swg.type, 0, 0),
+				    xbcon(swg.p[c[i].first]->sval, NULL,
+				    swg.type));
+				xcbranch(r, swg.p[c[i].first]->slab);
+				continue;
+			}
+			miss = i == hi ? swg.deflab : getlab();
+			if (c[i].kind == SWTAB)
+				swtable(&c[i], miss);
+			else
+				swbits(&c[i], miss);
+			if (i != hi)
+				plabel(miss);
+		}
+		if (c[hi].kind == SWCASE)
+			branch(swg.deflab);
+		return;
+	}
+	mid = (lo + hi + 1) / 2;
+	lab = getlab();
+	r = buildtree(GE, tempnode(swg.num, swg.type, 0, 0),
+	    xbcon(swg.p[c[mid].first]->sval, NULL, swg.type));
+	cbranch(r, bcon(lab));
+	swtree(lo, mid-1);
+	plabel(lab);
+	swtree(mid, hi);
+}
+
 /*
  * num: tempnode the value of the switch expression is in
  * type: type of the switch expression
@@ -1622,28 +1809,78 @@ swend(void)
  * of a constant value and a label.
  * The first is >=0 if there is a default label;
  * its value is the label number
- * The entries p[1] to p[n] are the nontrivial cases
+ * The entries p[1] to p[n] are the nontrivial cases, sorted
  * n is the number of case statements (length of list)
  */
 static void
 genswitch(int num, TWORD type, struct swents **p, int n)
 {
-	P1ND *r, *q;
-	int i;
+	struct swclust *c;
+	U_CONSZ span;
+	int i, j, jt, k, m, nlab, labs[SWBITLAB];
 
 	if (mygenswitch(num, type, p, n))
 		return;
 
-	/* simple switch code */
-	for (i = 1; i <= n; ++i) {
-		/* already in 1 */
-		r = tempnode(num, type, 0, 0);
-		q = xbcon(p[i]->sval, NULL, type);
-		r = buildtree(NE, r, clocal(q));
-		xcbranch(r, p[i]->slab);
+	if (n == 0) {
+		if (p[0]->slab > 0)
+			branch(p[0]->slab);
+		return;
+	}
+
+	c = FUNALLO(sizeof(struct swclust) * n);
+	for (m = 0, i = 1; i <= n; m++, i = j + 1) {
+		c[m].first = i;
+		c[m].kind = SWCASE;
+
+		/* longest dense run from i */
+		for (jt = i; jt < n; jt++) {
+			span = (U_CONSZ)p[jt+1]->sval - (U_CONSZ)p[i]->sval;
+			if (span >= (U_CONSZ)(jt+2-i) * 100 / SWDENSE)
+				break;
+		}
+		if (jt+1-i < SWTABMIN || !SWTABOK)
+			jt = 0;
+
+		/* longest run fitting a word, to few labels */
+		nlab = 0;
+		for (j = i; j <= n; j++) {
+			span = (U_CONSZ)p[j]->sval - (U_CONSZ)p[i]->sval;
+			if (span >= SZLONG)
+				break;
+			for (k = 0; k < nlab; k++)
+				if (labs[k] == p[j]->slab)
+					break;
+			if (k == nlab) {
+				if (nlab == SWBITLAB)
+					break;
+				labs[nlab++] = p[j]->slab;
+			}
+		}
+		j--;
+		if (j+1-i < SWBITMIN || nlab == j+1-i)
+			j = 0;
+
+		/* bit tests are cheaper if they cover as much */
+		if (j && j >= jt) {
+			c[m].kind = SWBIT;
+			c[m].last = j;
+		} else if (jt) {
+			c[m].kind = SWTAB;
+			c[m].last = j = jt;
+		} else
+			c[m].last = j = i;
 	}
-	if (p[0]->slab > 0)
-		branch(p[0]->slab);
+
+	swg.num = num;
+	swg.type = type;
+	swg.p = p;
+	swg.c = c;
+	swg.deflab = p[0]->slab > 0 ? p[0]->slab : getlab();
+	swtree(0, m-1);
+	if (p[0]->slab <= 0)
+		plabel(swg.deflab);
+	FUNFREE(c);
 }
 
 /*
@@ -1870,6 +2107,8 @@ fundef(P1ND *tp, P1ND *p)
 		xtemps = 1;
 	}
 #endif
+	if (ztime)
+		tmfunc(getexname(cftnsp));
 	prolab = getlab();
 	send_passt(IP_PROLOG, -1, getexname(cftnsp), cftnsp->stype,
 	    cftnsp->sclass == EXTDEF, prolab, ctval);
@@ -1889,6 +2128,7 @@ fend(void)
 	if (blevel)
 		cerror("function level error");
 	ftnend();
+	tmfunc(NULL);
 	fun_inline = 0;
 	if (alwinl & 2) xtemps = 0;
 	alwinl = 0;
@@ -2171,6 +2411,10 @@ eve(P1ND *p)
 #ifdef TARGET_TIMODE
 		if ((r = gcc_eval_ticast(CAST, p1, p2)) != NULL)
 			break;
+#endif
+#ifdef GCC_COMPAT
+		if ((r = gcc_eval_vector(CAST, p1, p2)) != NULL)
+			break;
 #endif
 		p1 = buildtree(CAST, p1, p2);
 		p1nfree(p1->n_left);
@@ -2200,6 +2444,10 @@ eve(P1ND *p)
 				p2 = r;
 			p1nfree(s);
 		}
+#endif
+#ifdef GCC_COMPAT
+		if ((r = gcc_eval_vector(LB, p1, p2)) != NULL)
+			break;
 #endif
 		r = buildtree(UMUL, buildtree(PLUS, p1, p2), NULL);
 		break;
@@ -2207,6 +2455,10 @@ eve(P1ND *p)
 	case COMPL:
 #ifndef NO_COMPLEX
 		p1 = eve(p1);
+#ifdef GCC_COMPAT
+		if ((r = gcc_eval_vector(COMPL, p1, NULL)) != NULL)
+			break;
+#endif
 		if (ANYCX(p1))
 			r = cxconj(p1);
 		else
@@ -2222,6 +2474,10 @@ eve(P1ND *p)
 	case UMINUS:
 #ifndef NO_COMPLEX
 		p1 = eve(p1);
+#ifdef GCC_COMPAT
+		if ((r = gcc_eval_vector(UMINUS, p1, NULL)) != NULL)
+			break;
+#endif
 		if (ANYCX(p1))
 			r = cxop(UMINUS, p1, p1);
 		else
@@ -2235,6 +2491,10 @@ eve(P1ND *p)
 		if ((r = gcc_eval_tiuni(p->n_op, p1)) != NULL)
 			break;
 #endif
+#ifdef GCC_COMPAT
+		if ((r = gcc_eval_vector(p->n_op, p1, NULL)) != NULL)
+			break;
+#endif
 #ifndef NO_COMPLEX
 		if (p->n_op == NOT && ANYCX(p1))
 			p1 = cxop(NE, p1, bcon(0));
@@ -2310,6 +2570,10 @@ eve(P1ND *p)
 #ifdef TARGET_TIMODE
 		if ((r = gcc_eval_timode(p->n_op, p1, p2)) != NULL)
 			break;
+#endif
+#ifdef GCC_COMPAT
+		if ((r = gcc_eval_vector(p->n_op, p1, p2)) != NULL)
+			break;
 #endif
 		if (ANYCX(p1) || ANYCX(p2)) {
 			r = cxop(p->n_op, p1, p2);
@@ -2341,6 +2605,10 @@ eve(P1ND *p)
 #ifdef TARGET_TIMODE
 		if ((r = gcc_eval_timode(p->n_op, p1, p2)) != NULL)
 			break;
+#endif
+#ifdef GCC_COMPAT
+		if ((r = gcc_eval_vector(p->n_op, p1, p2)) != NULL)
+			break;
 #endif
 		r = buildtree(p->n_op, p1, p2);
 		break;
@@ -2365,6 +2633,10 @@ eve(P1ND *p)
 		if ((r = gcc_eval_timode(p->n_op, p1, p2)) != NULL)
 			break;
 #endif
+#ifdef GCC_COMPAT
+		if ((r = gcc_eval_vector(p->n_op, p1, p2)) != NULL)
+			break;
+#endif
 #ifndef NO_COMPLEX
 		if (ANYCX(p1) || ANYCX(p2)) {
 			r = cxop(UNASG p->n_op, p1tcopy(p1), p2);
@@ -416,6 +416,7 @@ struct atax {
 	CS(GCC_ATYP_NOCLONE)	{ A_0ARG, "noclone" },
 	CS(GCC_ATYP_REGPARM)	{ A_1ARG, "regparm" },
 	CS(GCC_ATYP_FASTCALL)	{ A_0ARG, "fastcall" },
+	CS(ATTR_VECTOR)		{ A_1ARG, "vector_size" },
 
 	CS(GCC_ATYP_BOUNDED)	{ A_3ARG|A_MANY|A1_NAME, "bounded" },
 
@@ -711,8 +712,8 @@ pragmas_gcc(char *t)
 /*
  * Fixup types when modes given in defid().
  */
-void
-gcc_modefix(NODE *p)
+static void
+modefix(NODE *p)
 {
 	struct ssdesc *ss;
 	struct attr *ap;
@@ -780,6 +781,18 @@ gcc_modefix(NODE *p)
 	}
 }
 
+static void vecfix(NODE *);
+
+/*
+ * Fixup types when modes or vector sizes are given.
+ */
+void
+gcc_modefix(NODE *p)
+{
+	modefix(p);
+	vecfix(p);
+}
+
 #ifdef TARGET_TIMODE
 
 /*
@@ -1116,6 +1129,671 @@ gcc_eval_timode(int op, NODE *p1, NODE *p2)
 }
 #endif
 
+/*
+ * GCC vector types.
+ *
+ * A vector is a struct with an array of its elements as only member,
+ * so it is laid out and initialized as an aggregate; targets may pass
+ * and return it in vector registers (see vecss()).
+ * The ATTR_VECTOR attribute of the type has the vector size in bytes
+ * and the element type.  Operations are done element by element into
+ * a stack temporary, except that targets defining SZXTYPE may do them
+ * on XTYPE nodes in vector registers if vecxop() allows.
+ *
+ * An XTYPE result is stored into its temporary as
+ * COMOP(ASSIGN(xtmp, x), tmp) where the COMOP has the vector attribute
+ * of the temporary (iarg(2) set); other vector operations take x
+ * directly, so that chains of operations stay in registers.
+ */
+struct vecdef {
+	struct vecdef *next;
+	struct ssdesc *ss;
+	struct attr *ap;	/* type attribute */
+	struct attr *tap;	/* attribute of temporaries */
+	TWORD t;
+	int sz;
+};
+static struct vecdef *vecdefs;
+static char *vecmemb = "0v";
+
+#define	vcomop(a,b)	((a) ? buildtree(COMOP, a, b) : (b))
+
+/*
+ * Return the definition of the vector of sz bytes of type t.
+ */
+static struct vecdef *
+vecdef(TWORD t, int sz)
+{
+	struct vecdef *vd;
+	struct rstack *rp;
+	NODE *p, *q;
+	int al;
+
+	for (vd = vecdefs; vd; vd = vd->next)
+		if (vd->t == t && vd->sz == sz)
+			return vd;
+
+	p = block(NAME, NIL, NIL, ARY|t, NULL, NULL);
+	p->n_df = permalloc(sizeof(union dimfun));
+	p->n_df->ddim = sz / (int)(tsize(t, NULL, NULL)/SZCHAR);
+	rp = bstruct(NULL, STNAME, NULL);
+	soumemb(p, vecmemb, 0);
+	q = dclstruct(rp);
+	if ((al = sz * SZCHAR) > ALMAX)
+		al = ALMAX;
+	if (al > q->pss->al)
+		q->pss->al = al;
+
+	vd = permalloc(sizeof(struct vecdef));
+	vd->ss = q->pss;
+	vd->ap = attr_new(ATTR_VECTOR, 3);
+	vd->ap->iarg(0) = sz;
+	vd->ap->iarg(1) = t;
+	vd->tap = attr_dup(vd->ap);
+	vd->tap->iarg(2) = 1;
+	vd->t = t;
+	vd->sz = sz;
+	vd->next = vecdefs;
+	vecdefs = vd;
+	nfree(q);
+	nfree(p);
+	return vd;
+}
+
+/*
+ * Change the base type of a declaration with the vector_size
+ * attribute to the vector type.
+ */
+static void
+vecfix(NODE *p)
+{
+	struct vecdef *vd;
+	struct attr *ap;
+	TWORD t;
+	int sz, esz;
+
+	if ((ap = attr_find(p->n_ap, ATTR_VECTOR)) == NULL || ap->iarg(1))
+		return;
+	t = BTYPE(p->n_type);
+	if ((!ISINTEGER(t) || t == BOOL) && t != FLOAT && t != DOUBLE) {
+		uerror("invalid vector type");
+		return;
+	}
+	sz = ap->iarg(0);
+	esz = (int)(tsize(t, NULL, NULL)/SZCHAR);
+	if (sz <= 0 || sz % esz || ((sz/esz) & (sz/esz - 1))) {
+		uerror("invalid vector size %d", sz);
+		return;
+	}
+	vd = vecdef(t, sz);
+	MODTYPE(p->n_type, STRTY);
+	p->pss = vd->ss;
+	ap->iarg(1) = t;
+}
+
+/*
+ * Return the vector attribute if p is a vector, else NULL.
+ * Type attributes are not kept through typedefs, so look at the
+ * struct descriptor instead.
+ */
+struct attr *
+isvec(NODE *p)
+{
+	if (p->n_type != STRTY)
+		return NULL;
+	return vecss(p->pss);
+}
+
+/*
+ * Return the vector attribute if ss describes a vector, else NULL.
+ * Used by targets whose ABI passes vectors unlike structs.
+ */
+struct attr *
+vecss(struct ssdesc *ss)
+{
+	struct vecdef *vd;
+
+	for (vd = vecdefs; vd; vd = vd->next)
+		if (vd->ss == ss)
+			return vd->ap;
+	return NULL;
+}
+
+/*
+ * Signed integer type of the same size as t, for comparison results.
+ */
+static TWORD
+vecitype(TWORD t)
+{
+	int sz = (int)tsize(t, NULL, NULL);
+
+	return ctype(sz == SZCHAR ? CHAR : sz == SZSHORT ? SHORT :
+	    sz == SZINT ? INT : sz == SZLONG ? LONG : LONGLONG);
+}
+
+/*
+ * Allocate a vector temporary on stack.
+ */
+static NODE *
+vecstore(struct vecdef *vd)
+{
+	struct symtab *sp;
+
+	sp = getsymtab("0vec", SSTMT);
+	sp->stype = STRTY;
+	sp->sss = vd->ss;
+	sp->sap = vd->ap;
+	sp->sclass = AUTO;
+	sp->soffset = NOOFFSET;
+	oalloc(sp, &autooff);
+	return nametree(sp);
+}
+
+/*
+ * Return the address of vector p.
+ */
+static NODE *
+vecaddr(NODE *p)
+{
+	NODE *q;
+
+	switch (p->n_op) {
+	case UMUL:
+		q = p->n_left;
+		nfree(p);
+		return q;
+	case COMOP:
+		q = buildtree(COMOP, p->n_left, vecaddr(p->n_right));
+		nfree(p);
+		return q;
+	case NAME:
+		return buildtree(ADDROF, p, NIL);
+	default:
+		q = vecstore(vecdef(isvec(p)->iarg(1), isvec(p)->iarg(0)));
+		return buildtree(ADDROF, buildtree(ASSIGN, q, p), NIL);
+	}
+}
+
+/*
+ * Is pointer p cheap and safe to evaluate more than once?
+ */
+static int
+vecsimple(NODE *p)
+{
+	switch (p->n_op) {
+	case REG:
+	case TEMP:
+	case ICON:
+		return 1;
+	case ADDROF:
+		return p->n_left->n_op == NAME;
+	case PLUS:
+	case MINUS:
+		return p->n_right->n_op == ICON && vecsimple(p->n_left);
+	}
+	return 0;
+}
+
+/*
+ * Return a pointer to vector p that can be copied.
+ * Code needed to evaluate it is added to *se.
+ */
+static NODE *
+vecptr(NODE *p, NODE **se)
+{
+	NODE *q, *t;
+
+	q = vecaddr(p);
+	while (q->n_op == COMOP) {
+		*se = vcomop(*se, q->n_left);
+		t = q->n_right;
+		nfree(q);
+		q = t;
+	}
+	if (vecsimple(q))
+		return q;
+	t = tempnode(0, q->n_type, q->n_df, q->pss);
+	t->n_ap = q->n_ap;
+	*se = vcomop(*se, buildtree(ASSIGN, p1tcopy(t), q));
+	return t;
+}
+
+/*
+ * Vector through pointer p.
+ */
+static NODE *
+vecderef(NODE *p, struct vecdef *vd)
+{
+	p = buildtree(UMUL, p, NIL);
+	p->pss = vd->ss;
+	p->n_ap = vd->ap;
+	return p;
+}
+
+/*
+ * Element i of type t of the vector pointed to by p.
+ */
+static NODE *
+vecelem(NODE *p, TWORD t, int i)
+{
+	p = cast(p1tcopy(p), INCREF(t), 0);
+	return buildtree(UMUL, buildtree(PLUS, p, bcon(i)), NIL);
+}
+
+/*
+ * Scalar operand of type t, that can be copied.
+ */
+static NODE *
+vecscal(NODE *p, TWORD t, NODE **se)
+{
+	NODE *q;
+
+	p = cast(p, t, 0);
+	if (p->n_op == ICON || p->n_op == FCON)
+		return p;
+	q = tempnode(0, t, NULL, NULL);
+	*se = vcomop(*se, buildtree(ASSIGN, p1tcopy(q), p));
+	return q;
+}
+
+#ifdef SZXTYPE
+/*
+ * Is p a vector temporary that holds an XTYPE value?
+ */
+static int
+vecpeel(NODE *p)
+{
+	struct attr *ap;
+
+	if (p->n_op != COMOP || p->n_left->n_op != ASSIGN ||
+	    p->n_left->n_type != XTYPE)
+		return 0;
+	return isvec(p) && (ap = attr_find(p->n_ap, ATTR_VECTOR)) && ap->iarg(2);
+}
+
+/*
+ * Return vector p as an XTYPE node.
+ */
+static NODE *
+vecx(NODE *p, struct vecdef *vd, NODE **se)
+{
+	NODE *q;
+
+	while (p->n_op == COMOP && !vecpeel(p) && isvec(p->n_right)) {
+		*se = vcomop(*se, p->n_left);
+		q = p->n_right;
+		nfree(p);
+		p = q;
+	}
+	if (vecpeel(p)) {
+		q = p->n_left->n_right;
+		tfree(p->n_left->n_left);
+		nfree(p->n_left);
+		tfree(p->n_right);
+		nfree(p);
+		return q;
+	}
+	if (p->n_op == UMUL && p->n_left->n_op == ADDROF) {
+		q = p->n_left->n_left;
+		nfree(p->n_left);
+		nfree(p);
+		p = q;
+	}
+	if (p->n_op != NAME && p->n_op != UMUL)
+		p = buildtree(UMUL, vecptr(p, se), NIL);
+	if (p->n_op == UMUL) {
+		q = p->n_left;
+		if (coptype(q->n_op) == LTYPE ||
+		    q->n_op == PLUS || q->n_op == MINUS) {
+			q->n_type = INCREF(XTYPE);
+			q->pss = NULL;
+		} else
+			p->n_left = block(PCONV, q, NIL, INCREF(XTYPE), 0, 0);
+	}
+	p->n_type = XTYPE;
+	p->n_df = NULL;
+	p->pss = NULL;
+	p->n_ap = vd->ap;
+	return p;
+}
+
+/*
+ * Scalar p of the element type in all elements of an XTYPE.
+ */
+static NODE *
+vecsplat(NODE *p, struct vecdef *vd, NODE **se)
+{
+	NODE *q;
+
+	q = tempnode(0, vd->t, NULL, NULL);
+	*se = vcomop(*se, buildtree(ASSIGN, p1tcopy(q), p));
+	q = block(SCONV, q, NIL, XTYPE, NULL, NULL);
+	q->n_ap = vd->ap;
+	return q;
+}
+
+/*
+ * Store XTYPE x into a new vector temporary.
+ */
+static NODE *
+vecres(NODE *x, struct vecdef *vd)
+{
+	NODE *p, *q, *se;
+
+	se = NULL;
+	p = vecstore(vd);
+	q = vecx(p1tcopy(p), vd, &se);
+	q = block(ASSIGN, q, x, XTYPE, NULL, NULL);
+	q->n_ap = vd->ap;
+	p = block(COMOP, q, p, STRTY, NULL, vd->ss);
+	p->n_ap = vd->tap;
+	return p;
+}
+
+/*
+ * Assign an XTYPE value in p2 to vector p1.
+ */
+static NODE *
+vecxasg(NODE *p1, NODE *p2, struct vecdef *vd)
+{
+	NODE *se, *q, *x;
+
+	if (vd->sz * SZCHAR != SZXTYPE || p1->pss != p2->pss)
+		return NIL;
+	for (q = p2; q->n_op == COMOP && !vecpeel(q); q = q->n_right)
+		;
+	if (!vecpeel(q))
+		return NIL;
+	se = NULL;
+	x = vecx(p2, vd, &se);
+	q = vecptr(p1, &se);
+	p1 = vecx(vecderef(p1tcopy(q), vd), vd, &se);
+	p1 = block(ASSIGN, p1, x, XTYPE, NULL, NULL);
+	p1->n_ap = vd->ap;
+	return vcomop(se, buildtree(COMOP, p1, vecderef(q, vd)));
+}
+
+/*
+ * Try to do a vector operation in vector registers.
+ */
+static NODE *
+vecxop1(int op, NODE *p1, NODE *p2, struct vecdef *vd, struct vecdef *rd)
+{
+	extern short revrel[];
+	extern int p1negrel[];
+	NODE *se, *q;
+	TWORD t = vd->t;
+	int neg, swap;
+
+	if (vd->sz * SZCHAR != SZXTYPE)
+		return NIL;
+	if ((p1 && !isvec(p1)) || (p2 && !isvec(p2) &&
+	    op != LS && op != RS)) {
+		if (!vecxop(SCONV, t))
+			return NIL;
+	}
+	neg = swap = 0;
+	if (op == LS || op == RS) {
+		if (isvec(p2) || !vecxop(op, t))
+			return NIL;
+	} else if (clogop(op)) {
+		if (vecxop(op, t))
+			;
+		else if (vecxop(revrel[op - EQ], t))
+			swap = 1;
+		else if (ISFTY(t) || !vecxop(COMPL, rd->t))
+			return NIL;
+		else if (vecxop(p1negrel[op - EQ], t))
+			neg = 1;
+		else if (vecxop(revrel[p1negrel[op - EQ] - EQ], t))
+			neg = swap = 1;
+		else
+			return NIL;
+		if (neg)
+			op = p1negrel[op - EQ];
+		if (swap)
+			op = revrel[op - EQ];
+	} else if (!vecxop(op, t))
+		return NIL;
+
+	se = NULL;
+	p1 = isvec(p1) ? vecx(p1, vd, &se) : vecsplat(p1, vd, &se);
+	if (op == LS || op == RS)
+		p2 = cast(p2, INT, 0);
+	else if (p2 != NIL)
+		p2 = isvec(p2) ? vecx(p2, vd, &se) : vecsplat(p2, vd, &se);
+	if (swap)
+		q = p1, p1 = p2, p2 = q;
+	q = block(op, p1, p2, XTYPE, NULL, NULL);
+	q->n_ap = vd->ap;
+	if (neg) {
+		q = block(COMPL, q, NIL, XTYPE, NULL, NULL);
+		q->n_ap = rd->ap;
+	}
+	return vcomop(se, vecres(q, rd));
+}
+#endif
+
+/*
+ * Evaluate a vector operation element by element.
+ * p2 is NIL for unary operations.
+ */
+static NODE *
+vecop(int op, NODE *p1, NODE *p2, struct vecdef *vd)
+{
+	struct vecdef *rd;
+	NODE *se, *l, *r, *d, *q;
+	TWORD t = vd->t;
+	int i, n, v1, v2, rel;
+
+	v1 = isvec(p1) != NULL;
+	v2 = p2 && isvec(p2);
+	if ((v1 && v2 && p1->pss != p2->pss) ||
+	    (!v1 && !ISINTEGER(p1->n_type) && !ISFTY(p1->n_type)) ||
+	    (p2 && !v2 && !ISINTEGER(p2->n_type) && !ISFTY(p2->n_type)) ||
+	    (ISFTY(t) && op != PLUS && op != MINUS && op != MUL &&
+	    op != DIV && op != UMINUS && !clogop(op))) {
+		uerror("invalid operands to vector %s", copst(op));
+		if (!v1) {
+			tfree(p1);
+			return p2;
+		}
+		if (p2)
+			tfree(p2);
+		return p1;
+	}
+	rel = clogop(op);
+	rd = rel ? vecdef(vecitype(t), vd->sz) : vd;
+#ifdef SZXTYPE
+	if ((q = vecxop1(op, p1, p2, vd, rd)) != NIL)
+		return q;
+#endif
+
+	se = NULL;
+	l = v1 ? vecptr(p1, &se) : vecscal(p1, t, &se);
+	r = NIL;
+	if (p2)
+		r = v2 ? vecptr(p2, &se) : vecscal(p2, t, &se);
+	q = vecstore(rd);
+	d = vecptr(p1tcopy(q), &se);
+	n = vd->sz / (int)(tsize(t, NULL, NULL)/SZCHAR);
+	for (i = 0; i < n; i++) {
+		p1 = v1 ? vecelem(l, t, i) : p1tcopy(l);
+		if (r == NIL)
+			p1 = buildtree(op, p1, NIL);
+		else
+			p1 = buildtree(op, p1, v2 ? vecelem(r, t, i) : p1tcopy(r));
+		if (rel)
+			p1 = buildtree(UMINUS, p1, NIL);
+		p1 = buildtree(ASSIGN, vecelem(d, rd->t, i), p1);
+		se = vcomop(se, p1);
+	}
+	tfree(l);
+	if (r)
+		tfree(r);
+	tfree(d);
+	return buildtree(COMOP, se, q);
+}
+
+/*
+ * Assign p2 to vector p1.
+ */
+static NODE *
+vecasg(NODE *p1, NODE *p2, struct vecdef *vd)
+{
+#ifdef SZXTYPE
+	NODE *q;
+
+	if ((q = vecxasg(p1, p2, vd)) != NIL)
+		return q;
+#endif
+	return buildtree(ASSIGN, p1, p2);
+}
+
+/*
+ * Casts to and from vectors.  Only reinterpretation of values
+ * of the same size is allowed.
+ */
+static NODE *
+veccast(NODE *p1, NODE *p2)
+{
+	struct attr *a1, *a2;
+	struct vecdef *vd;
+	NODE *q;
+
+	a1 = isvec(p1);
+	a2 = isvec(p2);
+	if (p1->n_type == VOID)
+		return NIL;
+	if ((!a1 && !ISINTEGER(p1->n_type)) || (!a2 && !ISINTEGER(p2->n_type)) ||
+	    tsize(p1->n_type, p1->n_df, p1->pss) !=
+	    tsize(p2->n_type, p2->n_df, p2->pss)) {
+		uerror("cannot convert to or from vector of different size");
+		tfree(p1);
+		return p2;
+	}
+	if (a1 && a2) {
+		vd = vecdef(a1->iarg(1), a1->iarg(0));
+#ifdef SZXTYPE
+		if (vecpeel(p2) || (p2->n_op == COMOP && vecpeel(p2->n_right))) {
+			NODE *se = NULL;
+
+			q = vecx(p2, vecdef(a2->iarg(1), a2->iarg(0)), &se);
+			q = vcomop(se, vecres(q, vd));
+			tfree(p1);
+			return q;
+		}
+#endif
+		q = block(PCONV, vecaddr(p2), NIL, INCREF(STRTY), NULL, vd->ss);
+		q = vecderef(q, vd);
+	} else if (a1) {
+		vd = vecdef(a1->iarg(1), a1->iarg(0));
+		q = vecstore(vd);
+		p2 = buildtree(ASSIGN, buildtree(UMUL,
+		    cast(buildtree(ADDROF, p1tcopy(q), NIL),
+		    INCREF(p2->n_type), 0), NIL), p2);
+		q = buildtree(COMOP, p2, q);
+	} else {
+		q = cast(vecaddr(p2), INCREF(p1->n_type), 0);
+		q = buildtree(UMUL, q, NIL);
+	}
+	tfree(p1);
+	return q;
+}
+
+/*
+ * Evaluate operations with vector operands.
+ * Returns NIL if there are none.
+ */
+NODE *
+gcc_eval_vector(int op, NODE *p1, NODE *p2)
+{
+	struct attr *a1, *a2;
+	struct vecdef *vd;
+	NODE *q, *r, *se;
+
+	a1 = isvec(p1);
+	a2 = p2 ? isvec(p2) : NULL;
+	if (a1 == NULL && a2 == NULL)
+		return NIL;
+	vd = a1 ? vecdef(a1->iarg(1), a1->iarg(0)) :
+	    vecdef(a2->iarg(1), a2->iarg(0));
+
+	switch (op) {
+	case CAST:
+		return veccast(p1, p2);
+
+	case LB:
+		if (a1 == NULL)
+			q = p1, p1 = p2, p2 = q;
+		q = cast(vecaddr(p1), INCREF(vd->t), 0);
+		return buildtree(UMUL, buildtree(PLUS, q, p2), NIL);
+
+	case ASSIGN:
+		if (a1 == NULL || a2 == NULL)
+			return NIL;
+		if (a1 != a2 && a1->iarg(0) == a2->iarg(0) &&
+		    ISINTEGER(a1->iarg(1)) && ISINTEGER(a2->iarg(1)) &&
+		    ENUNSIGN(a1->iarg(1)) == ENUNSIGN(a2->iarg(1))) {
+			/* only signedness differs */
+			q = block(NAME, NIL, NIL, STRTY, NULL, vd->ss);
+			p2 = veccast(q, p2);
+		}
+		return vecasg(p1, p2, vd);
+
+	case UMINUS:
+	case COMPL:
+		return vecop(op, p1, NIL, vd);
+
+	case PLUS:
+	case MINUS:
+	case MUL:
+	case DIV:
+	case MOD:
+	case AND:
+	case OR:
+	case ER:
+	case LS:
+	case RS:
+	case EQ:
+	case NE:
+	case LT:
+	case LE:
+	case GT:
+	case GE:
+		return vecop(op, p1, p2, vd);
+
+	case INCR:
+	case DECR:
+	case PLUSEQ:
+	case MINUSEQ:
+	case MULEQ:
+	case DIVEQ:
+	case MODEQ:
+	case ANDEQ:
+	case OREQ:
+	case EREQ:
+	case LSEQ:
+	case RSEQ:
+		if (a1 == NULL)
+			return NIL;
+		se = NULL;
+		q = vecptr(p1, &se);
+		if (op == INCR || op == DECR) {
+			r = vecstore(vd);
+			se = vcomop(se, buildtree(ASSIGN, p1tcopy(r),
+			    vecderef(p1tcopy(q), vd)));
+			p1 = vecop(op == INCR ? PLUS : MINUS,
+			    vecderef(p1tcopy(q), vd), p2, vd);
+			se = vcomop(se, vecasg(vecderef(q, vd), p1, vd));
+			return buildtree(COMOP, se, r);
+		}
+		p1 = vecop(UNASG op, vecderef(p1tcopy(q), vd), p2, vd);
+		return vcomop(se, vecasg(vecderef(q, vd), p1, vd));
+	}
+	return NIL;
+}
+
 #ifdef PCC_DEBUG
 void
 dump_attr(struct attr *ap)
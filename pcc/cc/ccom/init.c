@@ -796,10 +796,14 @@ insbf(OFFSZ off, int fsz, int val)
 
 /*
  * Clear a bitfield, starting at off and size fsz.
+ * Whole bytes are cleared as a block.
  */
 static void
 clearbf(OFFSZ off, OFFSZ fsz)
 {
+	NODE *p;
+	int al, n;
+
 	/* Pad up to the next even initializer */
 	if ((off & (ALCHAR-1)) || (fsz < SZCHAR)) {
 		int ba = (int)(((off + (SZCHAR-1)) & ~(SZCHAR-1)) - off);
@@ -809,6 +813,18 @@ clearbf(OFFSZ off, OFFSZ fsz)
 		off += ba;
 		fsz -= ba;
 	}
+	if ((n = (int)(fsz / SZCHAR)) > 1 && BLKMOVMAX > 0) {
+		al = talign(csym->stype, csym->sss) / SZCHAR;
+		while (al > 1 && (off / SZCHAR) % al)
+			al >>= 1;
+		p = buildtree(ADDROF, nametree(csym), NIL);
+		p = makety(p, mkqtyp(INCREF(UCHAR)));
+		if (off)
+			p = buildtree(PLUS, p, bcon((int)(off / SZCHAR)));
+		blkzero(p, n, al);
+		off += (OFFSZ)n * SZCHAR;
+		fsz -= (OFFSZ)n * SZCHAR;
+	}
 	while (fsz >= SZCHAR) {
 		insbf(off, SZCHAR, 0);
 		off += SZCHAR;
@@ -326,7 +326,7 @@ puto(struct istat *w)
 				epp = (struct interpass_prolog *)ip;
 				crslab += (epp->ip_lblnum - ipp->ip_lblnum);
 			}
-			pp = xmalloc(sizeof(struct interpass_prolog));
+			pp = tmpalloc(sizeof(struct interpass_prolog));
 			memcpy(pp, ip, sizeof(struct interpass_prolog));
 			pp->ip_lblnum += lbloff;
 #ifdef PCC_DEBUG
@@ -341,7 +341,7 @@ puto(struct istat *w)
 			break;
 
 		default:
-			nip = xmalloc(sizeof(struct interpass));
+			nip = tmpalloc(sizeof(struct interpass));
 			*nip = *ip;
 			if (nip->type == IP_NODE) {
 				NODE *p;
@@ -91,8 +91,8 @@ short revrel[] ={ EQ, NE, GE, GT, LE, LT, UGE, UGT, ULE, ULT };
  * local optimizations, most of which are probably
  * machine independent
  */
-NODE *
-optim(NODE *p)
+static NODE *
+loptim(NODE *p)
 {
 	int o, ty;
 	NODE *sp, *q;
@@ -104,8 +104,8 @@ optim(NODE *p)
 	ty = coptype(p->n_op);
 	if( ty == LTYPE ) return(p);
 
-	if( ty == BITYPE ) p->n_right = optim(p->n_right);
-	p->n_left = optim(p->n_left);
+	if( ty == BITYPE ) p->n_right = loptim(p->n_right);
+	p->n_left = loptim(p->n_left);
 
 	/* collect constants */
 again:	o = p->n_op;
@@ -493,6 +493,15 @@ again:	o = p->n_op;
 	return(p);
 	}
 
+NODE *
+optim(NODE *p)
+{
+	tmenter(TM_OPTIM);
+	p = loptim(p);
+	tmleave();
+	return(p);
+}
+
 int
 ispow2(CONSZ c)
 {
@@ -107,6 +107,20 @@ extern	char *scnames(int);
 	/* alignment of initialized quantities */
 #ifndef AL_INIT
 #define	AL_INIT ALINT
+#endif
+
+	/* largest block move or set expanded inline, in bytes */
+#ifndef BLKMOVMAX
+#ifdef WORD_ADDRESSED
+#define	BLKMOVMAX	0
+#else
+#define	BLKMOVMAX	(4*SZPOINT(CHAR)/SZCHAR)
+#endif
+#endif
+
+	/* largest memcpy expanded inline (as a struct copy), in bytes */
+#ifndef BLKCPYMAX
+#define	BLKCPYMAX	BLKMOVMAX
 #endif
 
 struct rstack;
@@ -198,8 +212,13 @@ struct swents {			/* switch table */
 	struct swents *next;	/* Next struct in linked list */
 	CONSZ	sval;		/* case value */
 	int	slab;		/* associated label */
+	int	sline;		/* line of the case */
 };
 int mygenswitch(int, TWORD, struct swents **, int);
+int mybitop(int, TWORD);
+#ifdef SZXTYPE
+int vecxop(int, TWORD);
+#endif
 
 extern	int blevel;
 extern	int oldstyle;
@@ -214,7 +233,7 @@ extern	OFFSZ inoff;
 
 extern	int reached;
 extern	int isinlining;
-extern	int xinline, xgnu89, xgnu99;
+extern	int xinline, xgnu89, xgnu99, freestanding;
 extern	int bdebug, ddebug, edebug, idebug, ndebug;
 extern	int odebug, pdebug, sdebug, tdebug, xdebug;
 
@@ -223,6 +242,7 @@ extern	int brklab;
 extern	int contlab;
 extern	int flostat, fp_contract;
 extern	int retlab;
+extern	int lastdeflab;
 extern	int doing_init, statinit;
 extern	short sztable[];
 extern	char *astypnames[];
@@ -336,6 +356,12 @@ extern	P1ND
 	*eve(P1ND *),
 	*doacall(struct symtab *, P1ND *, P1ND *);
 P1ND	*intprom(P1ND *);
+P1ND	*blkaddr(P1ND *, P1ND **),
+	*blkmove(P1ND *, P1ND *, int, int),
+	*blkcopy(P1ND *, P1ND *, int, int),
+	*blkset(P1ND *, int, int, int);
+void	blkzero(P1ND *, int, int);
+int	blkalign(P1ND *);
 OFFSZ	tsize(TWORD, union dimfun *, struct ssdesc *),
 	psize(P1ND *);
 P1ND *	typenode(P1ND *new);
@@ -545,6 +571,7 @@ enum {	ATTR_FIRST = ATTR_MI_MAX + 1,
 
 	ATTR_P1LABELS,	/* used to store stuff while parsing */
 	ATTR_SONAME,	/* output name of symbol */
+	ATTR_EXPECT,	/* value given to __builtin_expect */
 
 #ifdef GCC_COMPAT
 	/* type attributes */
@@ -638,6 +665,9 @@ P1ND *gcc_eval_timode(int op, P1ND *, P1ND *);
 P1ND *gcc_eval_ticast(int op, P1ND *, P1ND *);
 P1ND *gcc_eval_tiuni(int op, P1ND *);
 struct attr *isti(P1ND *p);
+P1ND *gcc_eval_vector(int op, P1ND *, P1ND *);
+struct attr *isvec(P1ND *p);
+struct attr *vecss(struct ssdesc *);
 
 #ifndef NO_C_BUILTINS
 struct bitable {
@@ -648,6 +678,7 @@ struct bitable {
 #define	BTNORVAL	002
 #define	BTNOEVE		004
 #define	BTGNUONLY	010
+#define	BTHOSTED	020	/* library function, not if freestanding */
 	short narg;
 	TWORD *tp;
 	TWORD rt;
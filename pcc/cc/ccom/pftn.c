@@ -968,6 +968,9 @@ soumemb(NODE *n, char *name, int class)
  
 	if (rpole == NULL)
 		cerror("soumemb");
+#ifdef GCC_COMPAT
+	gcc_modefix(n);
+#endif
  
 #ifdef PCC_DEBUG
         if (ddebug) {
@@ -1136,6 +1139,9 @@ talign(unsigned int ty, struct ssdesc *ss)
 	case FLOAT: a = ALFLOAT; break;
 	case DOUBLE: a = ALDOUBLE; break;
 	case LDOUBLE: a = ALLDOUBLE; break;
+#ifdef SZXTYPE
+	case XTYPE: a = ALXTYPE; break;
+#endif
 	default:
 		uerror("no alignment");
 		a = ALINT;
@@ -1192,6 +1198,10 @@ tsize(TWORD ty, union dimfun *d, struct ssdesc *ss)
 			sz = SZINT;
 		} else
 			sz = ss->sz;
+#ifdef SZXTYPE
+	} else if (ty == XTYPE) {
+		sz = SZXTYPE;
+#endif
 	} else {
 		uerror("unknown type");
 		sz = SZINT;
@@ -2051,8 +2061,13 @@ doacall(struct symtab *sp, NODE *f, NODE *a)
 	/* Do prototype checking for function call */
 	pr_callchk(sp, f, a);
 
-build:	if (sp != NULL && (sp->sflags & SINLINE) && (w = inlinetree(sp, f, a)))
-		return w;
+build:	if (sp != NULL && (sp->sflags & SINLINE)) {
+		tmenter(TM_INLINE);
+		w = inlinetree(sp, f, a);
+		tmleave();
+		if (w != NULL)
+			return w;
+	}
 	return buildtree(a == NIL ? UCALL : CALL, f, a);
 }
 
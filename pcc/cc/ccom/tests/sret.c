@@ -0,0 +1,183 @@
+int printf(const char *, ...);
+
+static int
+chk(char *p, int n, int k)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (p[i] != (char)(k + i))
+			return 1;
+	return 0;
+}
+struct s17 { char c[17]; };
+struct s17 f17(int k) { struct s17 s; int i; for (i = 0; i < 17; i++) s.c[i] = k + i; return s; }
+struct s18 { char c[18]; };
+struct s18 f18(int k) { struct s18 s; int i; for (i = 0; i < 18; i++) s.c[i] = k + i; return s; }
+struct s19 { char c[19]; };
+struct s19 f19(int k) { struct s19 s; int i; for (i = 0; i < 19; i++) s.c[i] = k + i; return s; }
+struct s20 { char c[20]; };
+struct s20 f20(int k) { struct s20 s; int i; for (i = 0; i < 20; i++) s.c[i] = k + i; return s; }
+struct s21 { char c[21]; };
+struct s21 f21(int k) { struct s21 s; int i; for (i = 0; i < 21; i++) s.c[i] = k + i; return s; }
+struct s22 { char c[22]; };
+struct s22 f22(int k) { struct s22 s; int i; for (i = 0; i < 22; i++) s.c[i] = k + i; return s; }
+struct s23 { char c[23]; };
+struct s23 f23(int k) { struct s23 s; int i; for (i = 0; i < 23; i++) s.c[i] = k + i; return s; }
+struct s24 { char c[24]; };
+struct s24 f24(int k) { struct s24 s; int i; for (i = 0; i < 24; i++) s.c[i] = k + i; return s; }
+struct s25 { char c[25]; };
+struct s25 f25(int k) { struct s25 s; int i; for (i = 0; i < 25; i++) s.c[i] = k + i; return s; }
+struct s26 { char c[26]; };
+struct s26 f26(int k) { struct s26 s; int i; for (i = 0; i < 26; i++) s.c[i] = k + i; return s; }
+struct s27 { char c[27]; };
+struct s27 f27(int k) { struct s27 s; int i; for (i = 0; i < 27; i++) s.c[i] = k + i; return s; }
+struct s28 { char c[28]; };
+struct s28 f28(int k) { struct s28 s; int i; for (i = 0; i < 28; i++) s.c[i] = k + i; return s; }
+struct s29 { char c[29]; };
+struct s29 f29(int k) { struct s29 s; int i; for (i = 0; i < 29; i++) s.c[i] = k + i; return s; }
+struct s30 { char c[30]; };
+struct s30 f30(int k) { struct s30 s; int i; for (i = 0; i < 30; i++) s.c[i] = k + i; return s; }
+struct s31 { char c[31]; };
+struct s31 f31(int k) { struct s31 s; int i; for (i = 0; i < 31; i++) s.c[i] = k + i; return s; }
+struct s32 { char c[32]; };
+struct s32 f32(int k) { struct s32 s; int i; for (i = 0; i < 32; i++) s.c[i] = k + i; return s; }
+struct s33 { char c[33]; };
+struct s33 f33(int k) { struct s33 s; int i; for (i = 0; i < 33; i++) s.c[i] = k + i; return s; }
+struct s34 { char c[34]; };
+struct s34 f34(int k) { struct s34 s; int i; for (i = 0; i < 34; i++) s.c[i] = k + i; return s; }
+struct s35 { char c[35]; };
+struct s35 f35(int k) { struct s35 s; int i; for (i = 0; i < 35; i++) s.c[i] = k + i; return s; }
+struct s36 { char c[36]; };
+struct s36 f36(int k) { struct s36 s; int i; for (i = 0; i < 36; i++) s.c[i] = k + i; return s; }
+struct s37 { char c[37]; };
+struct s37 f37(int k) { struct s37 s; int i; for (i = 0; i < 37; i++) s.c[i] = k + i; return s; }
+struct s38 { char c[38]; };
+struct s38 f38(int k) { struct s38 s; int i; for (i = 0; i < 38; i++) s.c[i] = k + i; return s; }
+struct s39 { char c[39]; };
+struct s39 f39(int k) { struct s39 s; int i; for (i = 0; i < 39; i++) s.c[i] = k + i; return s; }
+struct s40 { char c[40]; };
+struct s40 f40(int k) { struct s40 s; int i; for (i = 0; i < 40; i++) s.c[i] = k + i; return s; }
+struct s41 { char c[41]; };
+struct s41 f41(int k) { struct s41 s; int i; for (i = 0; i < 41; i++) s.c[i] = k + i; return s; }
+struct s42 { char c[42]; };
+struct s42 f42(int k) { struct s42 s; int i; for (i = 0; i < 42; i++) s.c[i] = k + i; return s; }
+struct s43 { char c[43]; };
+struct s43 f43(int k) { struct s43 s; int i; for (i = 0; i < 43; i++) s.c[i] = k + i; return s; }
+struct s44 { char c[44]; };
+struct s44 f44(int k) { struct s44 s; int i; for (i = 0; i < 44; i++) s.c[i] = k + i; return s; }
+struct s45 { char c[45]; };
+struct s45 f45(int k) { struct s45 s; int i; for (i = 0; i < 45; i++) s.c[i] = k + i; return s; }
+struct s46 { char c[46]; };
+struct s46 f46(int k) { struct s46 s; int i; for (i = 0; i < 46; i++) s.c[i] = k + i; return s; }
+struct s47 { char c[47]; };
+struct s47 f47(int k) { struct s47 s; int i; for (i = 0; i < 47; i++) s.c[i] = k + i; return s; }
+struct s48 { char c[48]; };
+struct s48 f48(int k) { struct s48 s; int i; for (i = 0; i < 48; i++) s.c[i] = k + i; return s; }
+struct s49 { char c[49]; };
+struct s49 f49(int k) { struct s49 s; int i; for (i = 0; i < 49; i++) s.c[i] = k + i; return s; }
+struct s50 { char c[50]; };
+struct s50 f50(int k) { struct s50 s; int i; for (i = 0; i < 50; i++) s.c[i] = k + i; return s; }
+struct s51 { char c[51]; };
+struct s51 f51(int k) { struct s51 s; int i; for (i = 0; i < 51; i++) s.c[i] = k + i; return s; }
+struct s52 { char c[52]; };
+struct s52 f52(int k) { struct s52 s; int i; for (i = 0; i < 52; i++) s.c[i] = k + i; return s; }
+struct s53 { char c[53]; };
+struct s53 f53(int k) { struct s53 s; int i; for (i = 0; i < 53; i++) s.c[i] = k + i; return s; }
+struct s54 { char c[54]; };
+struct s54 f54(int k) { struct s54 s; int i; for (i = 0; i < 54; i++) s.c[i] = k + i; return s; }
+struct s55 { char c[55]; };
+struct s55 f55(int k) { struct s55 s; int i; for (i = 0; i < 55; i++) s.c[i] = k + i; return s; }
+struct s56 { char c[56]; };
+struct s56 f56(int k) { struct s56 s; int i; for (i = 0; i < 56; i++) s.c[i] = k + i; return s; }
+struct s57 { char c[57]; };
+struct s57 f57(int k) { struct s57 s; int i; for (i = 0; i < 57; i++) s.c[i] = k + i; return s; }
+struct s58 { char c[58]; };
+struct s58 f58(int k) { struct s58 s; int i; for (i = 0; i < 58; i++) s.c[i] = k + i; return s; }
+struct s59 { char c[59]; };
+struct s59 f59(int k) { struct s59 s; int i; for (i = 0; i < 59; i++) s.c[i] = k + i; return s; }
+struct s60 { char c[60]; };
+struct s60 f60(int k) { struct s60 s; int i; for (i = 0; i < 60; i++) s.c[i] = k + i; return s; }
+struct s61 { char c[61]; };
+struct s61 f61(int k) { struct s61 s; int i; for (i = 0; i < 61; i++) s.c[i] = k + i; return s; }
+struct s62 { char c[62]; };
+struct s62 f62(int k) { struct s62 s; int i; for (i = 0; i < 62; i++) s.c[i] = k + i; return s; }
+struct s63 { char c[63]; };
+struct s63 f63(int k) { struct s63 s; int i; for (i = 0; i < 63; i++) s.c[i] = k + i; return s; }
+struct s64 { char c[64]; };
+struct s64 f64(int k) { struct s64 s; int i; for (i = 0; i < 64; i++) s.c[i] = k + i; return s; }
+
+struct l3 { long l[3]; };
+struct l8 { long l[8]; };
+struct m { long l; char c[9]; int i; };
+
+struct l3 g3(long k) { struct l3 s; s.l[0] = k; s.l[1] = k + 1; s.l[2] = k + 2; return s; }
+struct l8 g8(long k) { struct l8 s; int i; for (i = 0; i < 8; i++) s.l[i] = k + i; return s; }
+struct m gm(long k) { struct m s; int i; s.l = k; for (i = 0; i < 9; i++) s.c[i] = k + i; s.i = k; return s; }
+
+int
+main(void)
+{
+	struct l3 a3;
+	struct l8 a8;
+	struct m am;
+	int e = 0, i;
+	{ struct s17 a = f17(17); e += chk(a.c, 17, 17); }
+	{ struct s18 a = f18(18); e += chk(a.c, 18, 18); }
+	{ struct s19 a = f19(19); e += chk(a.c, 19, 19); }
+	{ struct s20 a = f20(20); e += chk(a.c, 20, 20); }
+	{ struct s21 a = f21(21); e += chk(a.c, 21, 21); }
+	{ struct s22 a = f22(22); e += chk(a.c, 22, 22); }
+	{ struct s23 a = f23(23); e += chk(a.c, 23, 23); }
+	{ struct s24 a = f24(24); e += chk(a.c, 24, 24); }
+	{ struct s25 a = f25(25); e += chk(a.c, 25, 25); }
+	{ struct s26 a = f26(26); e += chk(a.c, 26, 26); }
+	{ struct s27 a = f27(27); e += chk(a.c, 27, 27); }
+	{ struct s28 a = f28(28); e += chk(a.c, 28, 28); }
+	{ struct s29 a = f29(29); e += chk(a.c, 29, 29); }
+	{ struct s30 a = f30(30); e += chk(a.c, 30, 30); }
+	{ struct s31 a = f31(31); e += chk(a.c, 31, 31); }
+	{ struct s32 a = f32(32); e += chk(a.c, 32, 32); }
+	{ struct s33 a = f33(33); e += chk(a.c, 33, 33); }
+	{ struct s34 a = f34(34); e += chk(a.c, 34, 34); }
+	{ struct s35 a = f35(35); e += chk(a.c, 35, 35); }
+	{ struct s36 a = f36(36); e += chk(a.c, 36, 36); }
+	{ struct s37 a = f37(37); e += chk(a.c, 37, 37); }
+	{ struct s38 a = f38(38); e += chk(a.c, 38, 38); }
+	{ struct s39 a = f39(39); e += chk(a.c, 39, 39); }
+	{ struct s40 a = f40(40); e += chk(a.c, 40, 40); }
+	{ struct s41 a = f41(41); e += chk(a.c, 41, 41); }
+	{ struct s42 a = f42(42); e += chk(a.c, 42, 42); }
+	{ struct s43 a = f43(43); e += chk(a.c, 43, 43); }
+	{ struct s44 a = f44(44); e += chk(a.c, 44, 44); }
+	{ struct s45 a = f45(45); e += chk(a.c, 45, 45); }
+	{ struct s46 a = f46(46); e += chk(a.c, 46, 46); }
+	{ struct s47 a = f47(47); e += chk(a.c, 47, 47); }
+	{ struct s48 a = f48(48); e += chk(a.c, 48, 48); }
+	{ struct s49 a = f49(49); e += chk(a.c, 49, 49); }
+	{ struct s50 a = f50(50); e += chk(a.c, 50, 50); }
+	{ struct s51 a = f51(51); e += chk(a.c, 51, 51); }
+	{ struct s52 a = f52(52); e += chk(a.c, 52, 52); }
+	{ struct s53 a = f53(53); e += chk(a.c, 53, 53); }
+	{ struct s54 a = f54(54); e += chk(a.c, 54, 54); }
+	{ struct s55 a = f55(55); e += chk(a.c, 55, 55); }
+	{ struct s56 a = f56(56); e += chk(a.c, 56, 56); }
+	{ struct s57 a = f57(57); e += chk(a.c, 57, 57); }
+	{ struct s58 a = f58(58); e += chk(a.c, 58, 58); }
+	{ struct s59 a = f59(59); e += chk(a.c, 59, 59); }
+	{ struct s60 a = f60(60); e += chk(a.c, 60, 60); }
+	{ struct s61 a = f61(61); e += chk(a.c, 61, 61); }
+	{ struct s62 a = f62(62); e += chk(a.c, 62, 62); }
+	{ struct s63 a = f63(63); e += chk(a.c, 63, 63); }
+	{ struct s64 a = f64(64); e += chk(a.c, 64, 64); }
+	a3 = g3(3);
+	e += a3.l[0] != 3 || a3.l[1] != 4 || a3.l[2] != 5;
+	a8 = g8(8);
+	for (i = 0; i < 8; i++)
+		e += a8.l[i] != 8 + i;
+	am = gm(5);
+	e += am.l != 5 || chk(am.c, 9, 5) || am.i != 5;
+	if (e)
+		printf("%d struct returns failed\n", e);
+	return e != 0;
+}
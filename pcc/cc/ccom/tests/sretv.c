@@ -0,0 +1,35 @@
+typedef int v4si __attribute__((vector_size(16)));
+struct W { int tag; v4si v; };
+struct W gw(struct W);
+int printf(const char *, ...);
+
+static struct W
+pw(int k)
+{
+	struct W w;
+	long pad[3];
+
+	pad[0] = k;
+	w.tag = (int)pad[0];
+	w.v = (v4si){ k, k + 1, k + 2, k + 3 };
+	return gw(w);
+}
+
+int
+main(void)
+{
+	struct W w;
+	char c;
+	int e = 0;
+
+	c = 1;
+	w.tag = c;
+	w.v = (v4si){ 1, 2, 3, 4 };
+	w = gw(w);
+	e += w.tag != 2 || w.v[0] != 2 || w.v[3] != 8;
+	w = pw(5);
+	e += w.tag != 6 || w.v[0] != 10 || w.v[3] != 16;
+	if (e)
+		printf("%d vector struct returns failed\n", e);
+	return e != 0;
+}
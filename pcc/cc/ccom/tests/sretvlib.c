@@ -0,0 +1,11 @@
+typedef int v4si __attribute__((vector_size(16)));
+struct W { int tag; v4si v; };
+struct W gw(struct W);
+
+struct W
+gw(struct W w)
+{
+	w.tag++;
+	w.v += w.v;
+	return w;
+}
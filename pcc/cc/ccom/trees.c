@@ -88,8 +88,10 @@ static void rmcops(P1ND *p);
 static P1ND *tymatch(P1ND *p);
 static P1ND *rewincop(P1ND *p1, P1ND *p2, int op);
 static int has_se(P1ND *p);
+static int expectprob(P1ND *p);
 static struct symtab *findmember(struct symtab *, char *);
 int inftn; /* currently between epilog/prolog */
+int lastdeflab; /* label just sent, 0 if anything followed it */
 P1ND *cstknode(TWORD t, union dimfun *df, struct ssdesc *ap);
 
 static char *tnames[] = {
@@ -865,12 +867,60 @@ concast(P1ND *p, TWORD t)
 	return 1;
 }
 
+/*
+ * Return the probability that branch condition p is true, as given
+ * by __builtin_expect(), or -1 if not known.
+ */
+static int
+expectprob(P1ND *p)
+{
+	struct attr *ap;
+	int l, r;
+
+	if ((ap = attr_find(p->n_ap, ATTR_EXPECT)) != NULL)
+		return ap->iarg(0) ? PROB_LIKELY : PROB_UNLIKELY;
+	switch (p->n_op) {
+	case NOT:
+		l = expectprob(p->n_left);
+		return l < 0 ? l : PROB_MAX - l;
+
+	case EQ:
+	case NE:
+		if (!nncon(p->n_right) || glval(p->n_right) != 0)
+			return -1;
+		l = expectprob(p->n_left);
+		return l < 0 || p->n_op == NE ? l : PROB_MAX - l;
+
+	case ANDAND:
+	case OROR:
+		/* a || b is !(!a && !b) */
+		l = expectprob(p->n_left);
+		r = expectprob(p->n_right);
+		if (p->n_op == OROR) {
+			l = l < 0 ? l : PROB_MAX - l;
+			r = r < 0 ? r : PROB_MAX - r;
+		}
+		if (l < 0 && r < 0)
+			return -1;
+		if (l >= 0 && r >= 0)
+			l = l * r / PROB_MAX;
+		else if ((l = l < 0 ? r : l) >= PROB_MAX/2)
+			return -1; /* the other one may still make it false */
+		return p->n_op == OROR ? PROB_MAX - l : l;
+	}
+	return -1;
+}
+
 /*
  * Do a conditional branch.
  */
 void
 cbranch(P1ND *p, P1ND *q)
 {
+	struct attr *ap;
+	int prob;
+
+	prob = expectprob(p);
 	p = buildtree(CBRANCH, p, q);
 	if (p->n_left->n_op == ICON) {
 		if (glval(p->n_left) != 0) {
@@ -880,6 +930,11 @@ cbranch(P1ND *p, P1ND *q)
 		p1tfree(p);
 		return;
 	}
+	if (prob >= 0) {
+		ap = attr_new(ATTR_BPROB, 1);
+		ap->iarg(0) = prob;
+		p->n_ap = attr_add(p->n_ap, ap);
+	}
 	ecomp(p);
 }
 
@@ -2104,12 +2159,15 @@ logwalk(P1ND *p)
 	}
 }
 
+static int cbrlab, cbrprob = -1;	/* probability of branches to cbrlab */
+
 /*
  * Removes redundant logical operators for branch conditions.
  */
 static void
 fixbranch(P1ND *p, int label)
 {
+	struct attr *ap;
 
 	logwalk(p);
 
@@ -2120,7 +2178,13 @@ fixbranch(P1ND *p, int label)
 	} else {
 		if (!clogop(p->n_op)) /* Always conditional */
 			p = buildtree(NE, p, bcon(0));
-		ecode(buildtree(CBRANCH, p, bcon(label)));
+		p = buildtree(CBRANCH, p, bcon(label));
+		if (cbrprob >= 0 && label == cbrlab) {
+			ap = attr_new(ATTR_BPROB, 1);
+			ap->iarg(0) = cbrprob;
+			p->n_ap = attr_add(p->n_ap, ap);
+		}
+		ecode(p);
 	}
 }
 
@@ -2239,6 +2303,15 @@ calc:		if (true < 0) {
 		break;
 
 	default:
+		/* widening an integer keeps its truth value */
+		if (o == SCONV && ISINTEGER(p->n_type) &&
+		    ISINTEGER(p->n_left->n_type) && tsize(p->n_type, 0, 0) >=
+		    tsize(p->n_left->n_type, 0, 0)) {
+			q = p->n_left;
+			p1nfree(p);
+			andorbr(q, true, false);
+			break;
+		}
 		rmcops(p);
 		if (true >= 0)
 			fixbranch(p, true);
@@ -2287,6 +2360,7 @@ cstknode(TWORD t, union dimfun *df, struct ssdesc *ss)
 static void
 rmcops(P1ND *p)
 {
+	struct attr *ap;
 	TWORD type;
 	P1ND *q, *r, *tval;
 	int o, ty, lbl, lbl2;
@@ -2362,6 +2436,12 @@ rmcops(P1ND *p)
 	case ANDAND:
 	case OROR:
 	case NOT:
+		if (p->n_type == XTYPE) {
+			/* vector compares give a value */
+			rmcops(p->n_left);
+			rmcops(p->n_right);
+			break;
+		}
 #ifdef SPECIAL_CCODES
 #error fix for private CCODES handling
 #else
@@ -2383,7 +2463,13 @@ rmcops(P1ND *p)
 #endif
 		break;
 	case CBRANCH:
+		/* the branches to the same label get its probability */
+		if ((ap = attr_find(p->n_ap, ATTR_BPROB)) != NULL) {
+			cbrlab = (int)glval(p->n_right);
+			cbrprob = ap->iarg(0);
+		}
 		andorbr(p->n_left, glval(p->n_right), -1);
+		cbrprob = -1;
 		p1nfree(p->n_right);
 		p->n_op = ICON; p->n_type = VOID;
 		break;
@@ -2418,6 +2504,222 @@ has_se(P1ND *p)
 	return 0;
 }
 
+/*
+ * Block moves and sets of known size.  They are done as a series of
+ * the widest integer moves that the alignment allows, at most the
+ * size of a pointer.  UNALIGNED_BLKMOV targets ignore the alignment.
+ */
+static TWORD
+blktype(int n, int al)
+{
+	static TWORD bt[] = { ULONGLONG, ULONG, UNSIGNED, USHORT };
+	int i, sz;
+
+	for (i = 0; i < 4; i++) {
+		sz = (int)(tsize(bt[i], 0, 0)/SZCHAR);
+		if (sz > SZPOINT(CHAR)/SZCHAR || sz > n)
+			continue;
+#ifndef UNALIGNED_BLKMOV
+		if (sz > al)
+			continue;
+#endif
+		return ctype(bt[i]);
+	}
+	return UCHAR;
+}
+
+/*
+ * Reference the type t at byte offset off from address p.
+ */
+static P1ND *
+blkref(P1ND *p, TWORD t, int off)
+{
+	p = makety(p, mkqtyp(INCREF(t)));
+	if (off)
+		p = buildtree(PLUS, p,
+		    bcon(off / (int)(tsize(t, 0, 0)/SZCHAR)));
+	return buildtree(UMUL, p, NULL);
+}
+
+/*
+ * Make the address p reusable, by a temp if needed.  The assignment
+ * to the temp is added to *bt.  Hard registers other than the frame
+ * pointer may be used by the moves themselves (as the struct return
+ * register is), so they are copied too.
+ */
+P1ND *
+blkaddr(P1ND *p, P1ND **bt)
+{
+	P1ND *q = p;
+
+	while (q->n_op == PCONV || ((q->n_op == PLUS || q->n_op == MINUS) &&
+	    q->n_right->n_op == ICON))
+		q = q->n_left;
+	if (q->n_op == ICON || q->n_op == TEMP ||
+	    (q->n_op == REG && regno(q) == FPREG) ||
+	    (q->n_op == ADDROF && q->n_left->n_op == NAME))
+		return p;
+	q = tempnode(0, p->n_type, p->n_df, p->pss);
+	p = buildtree(ASSIGN, p1tcopy(q), p);
+	*bt = *bt ? buildtree(COMOP, *bt, p) : p;
+	return q;
+}
+
+/*
+ * Alignment in bytes of what p points to, 1 if unknown.
+ */
+int
+blkalign(P1ND *p)
+{
+	TWORD t;
+
+	while (p->n_op == PCONV)
+		p = p->n_left;
+	if (!ISPTR(p->n_type))
+		return 1;
+	t = DECREF(p->n_type);
+	if (ISFTN(t) || BTYPE(t) == VOID)
+		return 1;
+	return talign(t, p->pss)/SZCHAR;
+}
+
+/*
+ * Copy sz bytes from s to d.  Both must be reusable addresses.
+ */
+P1ND *
+blkmove(P1ND *d, P1ND *s, int sz, int al)
+{
+	P1ND *p, *q;
+	TWORD t;
+	int off;
+
+	p = NULL;
+	for (off = 0; off < sz; off += (int)(tsize(t, 0, 0)/SZCHAR)) {
+		t = blktype(sz - off, al);
+		q = buildtree(ASSIGN, blkref(p1tcopy(d), t, off),
+		    blkref(p1tcopy(s), t, off));
+		p = p ? buildtree(COMOP, p, q) : q;
+	}
+	p1tfree(d);
+	p1tfree(s);
+	return p;
+}
+
+/*
+ * Copy sz bytes from s to d.  Up to BLKMOVMAX bytes are moved as by
+ * blkmove(), longer blocks by a struct assignment of that size.
+ */
+P1ND *
+blkcopy(P1ND *d, P1ND *s, int sz, int al)
+{
+	struct ssdesc *ss;
+	struct tdef td;
+
+	if (sz <= BLKMOVMAX)
+		return blkmove(d, s, sz, al);
+	ss = memset(permalloc(sizeof(struct ssdesc)), 0,
+	    sizeof(struct ssdesc));
+	ss->sz = sz * SZCHAR;
+	ss->al = (short)(al * SZCHAR);
+	td.type = INCREF(STRTY);
+	td.qual = 0;
+	td.df = NULL;
+	td.ss = ss;
+	d = buildtree(UMUL, makety(d, &td), NULL);
+	s = buildtree(UMUL, makety(s, &td), NULL);
+	return buildtree(ASSIGN, d, s);
+}
+
+/*
+ * Set sz bytes at d to c.  d must be a reusable address.
+ */
+P1ND *
+blkset(P1ND *d, int c, int sz, int al)
+{
+	P1ND *p, *q;
+	U_CONSZ v;
+	TWORD t;
+	int i, n, off;
+
+	p = NULL;
+	for (off = 0; off < sz; off += n) {
+		t = blktype(sz - off, al);
+		n = (int)(tsize(t, 0, 0)/SZCHAR);
+		for (v = 0, i = 0; i < n; i++)
+			v = (v << SZCHAR) | (c & ((1 << SZCHAR) - 1));
+		q = buildtree(ASSIGN, blkref(p1tcopy(d), t, off),
+		    xbcon((CONSZ)v, NULL, t));
+		p = p ? buildtree(COMOP, p, q) : q;
+	}
+	p1tfree(d);
+	return p;
+}
+
+/*
+ * Clear sz bytes at d.  Long blocks are cleared in a word loop
+ * instead of being unrolled.
+ */
+void
+blkzero(P1ND *d, int sz, int al)
+{
+	P1ND *bt, *p, *c;
+	TWORD t;
+	int n, lab;
+
+	bt = NULL;
+	d = blkaddr(d, &bt);
+	if (bt)
+		ecomp(bt);
+	if (sz <= BLKMOVMAX) {
+		ecomp(blkset(d, 0, sz, al));
+		return;
+	}
+	t = blktype(sz, al);
+	n = (int)(tsize(t, 0, 0)/SZCHAR);
+	p = tempnode(0, INCREF(t), 0, 0);
+	c = tempnode(0, INT, 0, 0);
+	ecomp(buildtree(ASSIGN, p1tcopy(p),
+	    makety(p1tcopy(d), mkqtyp(INCREF(t)))));
+	ecomp(buildtree(ASSIGN, p1tcopy(c), bcon(sz / n)));
+	plabel(lab = getlab());
+	ecomp(buildtree(ASSIGN, buildtree(UMUL, p1tcopy(p), NULL),
+	    xbcon(0, NULL, t)));
+	ecomp(buildtree(PLUSEQ, p, bcon(1)));
+	cbranch(buildtree(NE, buildtree(MINUSEQ, c, bcon(1)), bcon(0)),
+	    bcon(lab));
+	if (sz % n)
+		ecomp(blkset(buildtree(PLUS, makety(d, mkqtyp(INCREF(UCHAR))),
+		    bcon(sz - sz % n)), 0, sz % n, n));
+	else
+		p1tfree(d);
+}
+
+/*
+ * A statement-level struct assignment of at most BLKMOVMAX bytes
+ * becomes a series of word moves instead of a STASG.
+ */
+static P1ND *
+blkasg(P1ND *p)
+{
+	P1ND *l, *r, *bt;
+	int sz, al;
+
+	l = p->n_left->n_left;
+	r = p->n_left->n_right;
+	sz = (int)(tsize(p->n_type, p->n_df, p->pss)/SZCHAR);
+	al = talign(p->n_type, p->pss)/SZCHAR;
+	if (sz > BLKMOVMAX || ISVOL(l->n_qual) || ISVOL(DECQAL(r->n_qual)))
+		return p;
+
+	bt = NULL;
+	l = blkaddr(buildtree(ADDROF, l, NULL), &bt);
+	r = blkaddr(r, &bt);
+	r = blkmove(l, r, sz, al);
+	p1nfree(p->n_left);
+	p1nfree(p);
+	return bt ? buildtree(COMOP, bt, r) : r;
+}
+
 #ifndef FIELDOPS
 
 /* avoid promotion to int */
@@ -2724,6 +3026,8 @@ ecomp(P1ND *p)
 #ifndef FIELDOPS
 	p = rmfldops(p);
 #endif
+	if (p->n_op == UMUL && p->n_left->n_op == STASG)
+		p = blkasg(p);
 	comops(p);
 	rmcops(p);
 	if (p->n_op == ICON && p->n_type == VOID)
@@ -2733,129 +3037,6 @@ ecomp(P1ND *p)
 }
 
 
-#ifdef PASS1
-/* 
- * Print out full tree.
- * Nodes are already converted to pass2 style.
- */
-static void	
-p2print(NODE *p)
-{
-	struct attr *ap;
-	int ty, i;
-
-	ty = optype(p->n_op);
-
-	printf("\" %d ", p->n_op);
-
-	printf("%d %d ", p->n_type, p->n_qual);
-	if (ty == LTYPE)
-		printf(CONFMT " ", glval(p));
-	if (ty != BITYPE) {
-		if (p->n_op != NAME && p->n_op != ICON)
-			printf("%d ", p->n_rval);
-	}
-
-	/* handle special cases */
-	if (p->n_op == NAME || p->n_op == ICON ||
-	    p->n_op == XASM || p->n_op == XARG)
-		printf("%s", p->n_name);
-
-	if (p->n_ap) {
-		printf(" + ");
-		for (ap = p->n_ap; ap; ap = ap->next) {
-			printf("%d %d ", ap->atype, ap->sz);
-			for (i = 0; i < ap->sz; i++)
-				printf("%d ", ap->iarg(i));
-		}
-	}
-	printf("\n");
-
-	if (ty != LTYPE)
-		p2print(p->n_left);
-	if (ty == BITYPE)
-		p2print(p->n_right);
-}
-
-/*
- * Print out the code trees for pass2.
- * First on line is always a sync char, second is space:
- *	! - Prologue.
- *	" - Node
- *	^ - Label
- *	$ - Assembler statement
- *	% - Epilog.
- *	# - Line number
- *	& - File name
- *	* - Passthrough line.
- */
-void
-pass2_compile(struct interpass *ip)
-{
-	struct interpass_prolog *ipp;
-	static int oldlineno;
-	int i;
-
-	if (oldlineno != ip->lineno)
-		printf("# %d\n", oldlineno = ip->lineno);
-
-	switch (ip->type) {
-	case IP_PROLOG:
-		ipp = (struct interpass_prolog *)ip;
-		printf("! %d %d %d %d %d %s\n",
-		    ipp->ipp_type, ipp->ipp_vis, ip->ip_lbl, ipp->ip_tmpnum,
-		    ipp->ip_lblnum, ipp->ipp_name);
-#ifdef TARGET_IPP_MEMBERS
-		printf("( ");
-		target_members_print_prolog(ipp);
-		printf("\n");
-#endif
-		break;
-	case IP_NODE:
-		p2print(ip->ip_node);
-		tfree(ip->ip_node);
-		break;
-	case IP_DEFLAB:
-		printf("^ %d\n", ip->ip_lbl);
-		break;
-	case IP_ASM:
-		{
-			const char *s = ip->ip_asm;
-			printf("$ ");
-			while (*s != '\0') {
-				putchar(*s);
-				if (*s++ == '\n') 
-					printf("$ ");
-			}
-			printf("\n");
-		}
-		break;
-	case IP_EPILOG:
-		ipp = (struct interpass_prolog *)ip;
-		printf("%% %d %d %d %d %s", 
-		    ipp->ipp_autos, ip->ip_lbl, ipp->ip_tmpnum,
-		    ipp->ip_lblnum, ipp->ipp_name);
-		if (ipp->ip_labels[0]) {
-			for (i = 0; ipp->ip_labels[i]; i++)
-				;
-			printf(" + %d", i);
-			for (i = 0; ipp->ip_labels[i]; i++)
-				printf(" %d", ipp->ip_labels[i]);
-		}
-		printf("\n");
-#ifdef TARGET_IPP_MEMBERS
-		printf(") ");
-		target_members_print_epilog(ipp);
-		printf("\n");
-#endif
-		break;
-	default:
-		cerror("Missing %d", ip->type);
-	}
-	free(ip);
-}
-#endif
-
 static char *
 sptostr(struct symtab *sp)
 {
@@ -2915,6 +3096,11 @@ p2tree(P1ND *p)
 		if (ap->atype < ATTR_MI_MAX)
 			np->n_ap = attr_add(np->n_ap, attr_dup(ap));
 
+	/* tell pass2 about calls to functions that do not return */
+	if ((cdope(p->n_op) & CALLFLG) && p->n_left->n_op == ICON &&
+	    (q = p->n_left->n_sp) != NULL && attr_find(q->sap, ATTR_NORETURN))
+		np->n_ap = attr_add(np->n_ap, attr_new(ATTR_NORET, 0));
+
 	switch( p->n_op ){
 	case NAME:
 	case ICON:
@@ -2949,6 +3135,177 @@ p2tree(P1ND *p)
 	return np;
 }
 
+#ifdef PASS1
+/*
+ * Write the intermediate file for pass2, see pass2.h for the format.
+ * Strings are entered in a hash table the first time they are seen.
+ */
+#define	IRHSZ	1024
+static struct irstr {
+	struct irstr *next;
+	char *str;
+	int idx;
+} *irhash[IRHSZ];
+static int nirstr;
+
+static int
+irstr(char *s)
+{
+	struct irstr *is;
+	unsigned int h;
+	char *p;
+	int l;
+
+	if (s == NULL || *s == 0)
+		return -1;
+	for (h = 0, p = s; *p; p++)
+		h = h * 31 + (unsigned char)*p;
+	h %= IRHSZ;
+	for (is = irhash[h]; is; is = is->next)
+		if (strcmp(is->str, s) == 0)
+			return is->idx;
+
+	l = strlen(s) + 1;
+	is = permalloc(sizeof(struct irstr));
+	is->str = memcpy(permalloc(l), s, l);
+	is->idx = nirstr++;
+	is->next = irhash[h];
+	irhash[h] = is;
+	putchar(IR_STR);
+	fwrite(&l, sizeof(int), 1, stdout);
+	fwrite(s, l, 1, stdout);
+	return is->idx;
+}
+
+/*
+ * Enter the names used in a tree before the tree itself is written.
+ */
+static void
+irnames(NODE *p)
+{
+	int o = p->n_op;
+
+	if (o == NAME || o == ICON || o == XASM || o == XARG)
+		(void)irstr(p->n_name);
+	if (optype(o) != LTYPE)
+		irnames(p->n_left);
+	if (optype(o) == BITYPE)
+		irnames(p->n_right);
+}
+
+static void
+p2print(NODE *p)
+{
+	struct irnode irn;
+	struct attr *ap;
+	int ty, i, a[2];
+
+	ty = optype(p->n_op);
+	memset(&irn, 0, sizeof(irn));
+	irn.op = p->n_op;
+	irn.type = p->n_type;
+	irn.qual = p->n_qual;
+	if (ty == LTYPE)
+		irn.lval = getlval(p);
+	if (ty != BITYPE && p->n_op != NAME && p->n_op != ICON)
+		irn.rval = p->n_rval;
+	irn.name = -1;
+	if (p->n_op == NAME || p->n_op == ICON ||
+	    p->n_op == XASM || p->n_op == XARG)
+		irn.name = irstr(p->n_name);
+	for (ap = p->n_ap; ap; ap = ap->next)
+		irn.nattr += 2 + ap->sz;
+	fwrite(&irn, sizeof(irn), 1, stdout);
+
+	for (ap = p->n_ap; ap; ap = ap->next) {
+		a[0] = ap->atype;
+		a[1] = ap->sz;
+		fwrite(a, sizeof(int), 2, stdout);
+		for (i = 0; i < ap->sz; i++)
+			fwrite(&ap->iarg(i), sizeof(int), 1, stdout);
+	}
+
+	if (ty != LTYPE)
+		p2print(p->n_left);
+	if (ty == BITYPE)
+		p2print(p->n_right);
+}
+
+static void
+irprolog(int c, struct interpass_prolog *ipp)
+{
+	struct irprolog irp;
+	int i;
+
+	memset(&irp, 0, sizeof(irp));
+	irp.name = irstr(ipp->ipp_name);
+	irp.flags = ipp->ipp_flags;
+	irp.type = ipp->ipp_type;
+	irp.autos = ipp->ipp_autos;
+	irp.lbl = ipp->ipp_ip.ip_lbl;
+	irp.tmpnum = ipp->ip_tmpnum;
+	irp.lblnum = ipp->ip_lblnum;
+	if (c == IR_EPILOG && ipp->ip_labels)
+		for (i = 0; ipp->ip_labels[i]; i++)
+			irp.nlabels++;
+	putchar(c);
+	fwrite(&irp, sizeof(irp), 1, stdout);
+	if (irp.nlabels)
+		fwrite(ipp->ip_labels, sizeof(int), irp.nlabels, stdout);
+}
+
+/*
+ * Send the code trees to pass2.
+ */
+void
+pass2_compile(struct interpass *ip)
+{
+	static int oldlineno;
+	int l;
+
+	if (oldlineno != ip->lineno) {
+		oldlineno = ip->lineno;
+		putchar(IR_LINE);
+		fwrite(&oldlineno, sizeof(int), 1, stdout);
+	}
+
+	switch (ip->type) {
+	case IP_PROLOG:
+		irprolog(IR_PROLOG, (struct interpass_prolog *)ip);
+#ifdef TARGET_IPP_MEMBERS
+		putchar('(');
+		target_members_print_prolog((struct interpass_prolog *)ip);
+#endif
+		break;
+	case IP_NODE:
+		irnames(ip->ip_node);
+		putchar(IR_NODE);
+		p2print(ip->ip_node);
+		tfree(ip->ip_node);
+		break;
+	case IP_DEFLAB:
+		putchar(IR_LABEL);
+		fwrite(&ip->ip_lbl, sizeof(int), 1, stdout);
+		break;
+	case IP_ASM:
+		l = strlen(ip->ip_asm) + 1;
+		putchar(IR_ASM);
+		fwrite(&l, sizeof(int), 1, stdout);
+		fwrite(ip->ip_asm, l, 1, stdout);
+		break;
+	case IP_EPILOG:
+		irprolog(IR_EPILOG, (struct interpass_prolog *)ip);
+#ifdef TARGET_IPP_MEMBERS
+		putchar(')');
+		target_members_print_epilog((struct interpass_prolog *)ip);
+#endif
+		break;
+	default:
+		cerror("Missing %d", ip->type);
+	}
+}
+#endif
+
 #undef n_type
 #define n_type ptype
 #undef n_qual
@@ -3210,6 +3567,7 @@ ecode(P1ND *p)
 void
 send_passt(int type, ...)
 {
+	static int nlabs;
 	struct interpass *ip;
 	struct interpass_prolog *ipp;
 	extern int crslab;
@@ -3230,21 +3588,27 @@ send_passt(int type, ...)
 	else
 		sz = sizeof(struct interpass);
 
-	ip = xmalloc(sz);
+	/* released with the function unless saved for inlining */
+	ip = isinlining ? permalloc(sz) : tmpalloc(sz);
 	ip->type = type;
 	ip->lineno = lineno;
 	switch (type) {
 	case IP_NODE:
 		ip->ip_node = va_arg(ap, NODE *);
+		if (xp2jobs > 1)
+			nlabs += p2labels(ip);
 		break;
 	case IP_EPILOG:
 		if (!isinlining) {
 			locctr(PROG, cftnsp);
 			defloc(cftnsp);
 		}
+		/* leave labels for a pass2 worker, see reader.c */
+		crslab += 2 * nlabs;
 		/* FALLTHROUGH */
 	case IP_PROLOG:
 		inftn = type == IP_PROLOG ? 1 : 0;
+		nlabs = 0;
 		ipp = (struct interpass_prolog *)ip;
 		ipp->ipp_autos = va_arg(ap, int);
 		ipp->ipp_name = va_arg(ap, char *);
@@ -3259,6 +3623,8 @@ send_passt(int type, ...)
 		break;
 	case IP_DEFLAB:
 		ip->ip_lbl = va_arg(ap, int);
+		if (xp2jobs > 1)
+			nlabs += p2labels(ip);
 		break;
 	case IP_ASM:
 		if (blevel == 0) { /* outside function */
@@ -3274,6 +3640,7 @@ send_passt(int type, ...)
 		cerror("bad send_passt type %d", type);
 	}
 	va_end(ap);
+	lastdeflab = type == IP_DEFLAB ? ip->ip_lbl : 0;
 	pass1_lastchance(ip); /* target-specific info */
 	if (isinlining)
 		inline_addarg(ip);
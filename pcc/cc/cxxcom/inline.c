@@ -78,17 +78,29 @@ int inlnodecnt, inlstatcnt;
 #define	SZSI	sizeof(struct istat)
 #define	ialloc() memset(permalloc(SZSI), 0, SZSI); inlstatcnt++
 
-static void
-tcnt(NODE *p, void *arg)
+/*
+ * Copy a tree onto the permanent heap to save for inline.
+ */
+static NODE *
+intcopy(NODE *p)
 {
+	NODE *q = permalloc(sizeof(NODE));
+	int o = coptype(p->n_op);
+
+	*q = *p;
 	inlnodecnt++;
 	if (nlabs > 1 && (p->n_op == REG || p->n_op == OREG) &&
 	    regno(p) == FPREG)
 		SLIST_FIRST(&ipole)->flags &= ~CANINL; /* no stack refs */
-	if (p->n_op == NAME || p->n_op == ICON)
-		p->n_sp = NULL; /* let symtabs be freed for inline funcs */
+	if (q->n_op == NAME || q->n_op == ICON)
+		q->n_sp = NULL; /* let symtabs be freed for inline funcs */
 	if (ndebug)
-		printf("locking node %p\n", p);
+		printf("locking node %p\n", q);
+	if (o == BITYPE)
+		q->n_right = intcopy(q->n_right);
+	if (o != LTYPE)
+		q->n_left = intcopy(q->n_left);
+	return q;
 }
 
 static struct istat *
@@ -119,13 +131,17 @@ void
 inline_addarg(struct interpass *ip)
 {
 	extern NODE *cftnod;
+	NODE *q;
 
 	SDEBUG(("inline_addarg(%p)\n", ip));
 	DLIST_INSERT_BEFORE(&cifun->shead, ip, qelem);
 	if (ip->type == IP_DEFLAB)
 		nlabs++;
-	if (ip->type == IP_NODE)
-		walkf(ip->ip_node, tcnt, 0); /* Count as saved */
+	if (ip->type == IP_NODE) {
+		q = ip->ip_node;
+		ip->ip_node = intcopy(q);
+		tfree(q);
+	}
 	if (cftnod)
 		cifun->retval = regno(cftnod);
 }
@@ -44,12 +44,17 @@ int b2debug, c2debug, e2debug, f2debug, g2debug, o2debug;
 int r2debug, s2debug, t2debug, u2debug, x2debug;
 int gflag, kflag, pflag, sflag;
 int sspflag;
-int xscp, xssa, xtailcall, xtemps, xdeljumps, xdce, xinline, xccp, xgnu89, xgnu99;
+int xscp, xssa, xtailcall, xtemps, xdeljumps, xdce, xgvn, xlicm, xivsr;
+int xlinearscan, xpeep, xsched, xlayout, xvect;
+int ztime;
+int xinline, xccp, xgnu89, xgnu99;
+int xp2jobs;
 int xuchar;
 int freestanding;
 char *prgname;
 
 static void prtstats(void);
+static char *objfile;
 
 static void
 usage(void)
@@ -83,6 +88,22 @@ xopt(char *str)
 		xdeljumps++;
 	else if (strcmp(str, "dce") == 0)
 		xdce++;
+	else if (strcmp(str, "gvn") == 0)
+		xgvn++;
+	else if (strcmp(str, "licm") == 0)
+		xlicm++;
+	else if (strcmp(str, "ivsr") == 0)
+		xivsr++;
+	else if (strcmp(str, "linearscan") == 0)
+		xlinearscan++;
+	else if (strcmp(str, "peep") == 0)
+		xpeep++;
+	else if (strcmp(str, "sched") == 0)
+		xsched++;
+	else if (strcmp(str, "layout") == 0)
+		xlayout++;
+	else if (strcmp(str, "vect") == 0)
+		xvect++;
 	else if (strcmp(str, "inline") == 0)
 		xinline++;
 	else if (strcmp(str, "ccp") == 0)
@@ -93,6 +114,8 @@ xopt(char *str)
 		xgnu99++;
 	else if (strcmp(str, "uchar") == 0)
 		xuchar++;
+	else if (strncmp(str, "p2jobs=", 7) == 0)
+		xp2jobs = atoi(str+7);
 	else {
 		fprintf(stderr, "unknown -x option '%s'\n", str);
 		usage();
@@ -137,7 +160,7 @@ main(int argc, char *argv[])
 
 	prgname = argv[0];
 
-	while ((ch = getopt(argc, argv, "OT:VW:X:Z:f:gkm:psvwx:")) != -1) {
+	while ((ch = getopt(argc, argv, "OT:VW:X:Z:f:gkm:o:psvwx:")) != -1) {
 		switch (ch) {
 #if !defined(MULTIPASS) || defined(PASS1)
 		case 'X':	/* pass1 debugging */
@@ -163,6 +186,10 @@ main(int argc, char *argv[])
 #endif
 #if !defined(MULTIPASS) || defined(PASS2)
 		case 'Z':	/* pass2 debugging */
+			if (strcmp(optarg, "time") == 0) {
+				++ztime; /* time spent in each phase */
+				break;
+			}
 			while (*optarg)
 				switch (*optarg++) {
 				case 'b': /* basic block and SSA building */
@@ -224,6 +251,10 @@ main(int argc, char *argv[])
 			mflags(optarg);
 			break;
 
+		case 'o': /* write an object file */
+			objfile = optarg;
+			break;
+
 		case 'p': /* Profiling */
 			pflag = 1;
 			break;
@@ -267,8 +298,12 @@ main(int argc, char *argv[])
 			perror(NULL);
 			exit(1);
 		}
+#ifndef PASS1
+		oinit();
+#endif
 	}
 
+	tmenter(TM_PARSE);
 	mkdope();
 	signal(SIGSEGV, segvcatch);
 #ifdef SIGBUS
@@ -330,8 +365,21 @@ main(int argc, char *argv[])
 	    t2.tv_sec, t2.tv_usec);
 #endif
 
+#ifndef PASS1
+	pass2_sync();
+#ifdef ELFOBJ
+	/* assemble our own output, if it fails the driver runs as(1) */
+	if (objfile != NULL && nerrors == 0 && argc > 1) {
+		fflush(stdout);
+		(void)elfobj(argv[1], objfile);
+	}
+#endif
+#endif
+
 	if (sflag)
 		prtstats();
+	if (ztime)
+		tmreport();
 
 	return(nerrors?1:0);
 }
@@ -174,6 +174,10 @@ struct swents {			/* switch table */
 	int	slab;		/* associated label */
 };
 int mygenswitch(int, TWORD, struct swents **, int);
+int mybitop(int, TWORD);
+#ifdef SZXTYPE
+int vecxop(int, TWORD);
+#endif
 
 extern	int blevel;
 extern	int oldstyle;
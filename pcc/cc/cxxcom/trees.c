@@ -3058,6 +3058,7 @@ ecode(NODE *p)
 void
 send_passt(int type, ...)
 {
+	static int nlabs;
 	struct interpass *ip;
 	struct interpass_prolog *ipp;
 	extern int crslab;
@@ -3090,15 +3091,20 @@ send_passt(int type, ...)
 			ip->type = IP_DEFLAB;
 			nfree(nfree(p));
 		}
+		if (xp2jobs > 1)
+			nlabs += p2labels(ip);
 		break;
 	case IP_EPILOG:
 		if (!isinlining) {
 			locctr(PROG, cftnsp);
 			defloc(cftnsp);
 		}
+		/* leave labels for a pass2 worker, see reader.c */
+		crslab += 2 * nlabs;
 		/* FALLTHROUGH */
 	case IP_PROLOG:
 		inftn = type == IP_PROLOG ? 1 : 0;
+		nlabs = 0;
 		ipp = (struct interpass_prolog *)ip;
 		ipp->ipp_autos = va_arg(ap, int);
 		ipp->ipp_name = va_arg(ap, char *);
@@ -3112,6 +3118,8 @@ send_passt(int type, ...)
 		break;
 	case IP_DEFLAB:
 		ip->ip_lbl = va_arg(ap, int);
+		if (xp2jobs > 1)
+			nlabs += p2labels(ip);
 		break;
 	case IP_ASM:
 		if (blevel == 0) { /* outside function */
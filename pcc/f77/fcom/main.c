@@ -45,7 +45,9 @@ int ndebug;
 int b2debug, c2debug, e2debug, f2debug, g2debug, o2debug;
 int r2debug, s2debug, t2debug, u2debug, x2debug;
 int kflag, wdebug;
-int xdeljumps, xtemps, xssa, xdce, xscp;
+int xdeljumps, xtemps, xssa, xdce, xscp, xgvn, xlicm, xivsr, xp2jobs;
+int xlinearscan, xpeep, xsched, xlayout, xvect;
+int ztime;
 
 int mflag, tflag;
 
@@ -217,13 +219,15 @@ main(int argc, char **argv)
 			DONE(1);
 		if (!quietflag)
 			fprintf(diagfile, "%s:\n", argv[0]);
-		if (argc != 1)
+		if (argc != 1) {
 			if (freopen(argv[1], "w", stdout) == NULL) {
 				fprintf(stderr, "open output file '%s':",
 				    argv[1]);
 				perror(NULL);
 				exit(1);
 			}
+			oinit();
+		}
 	} else {
 		inilex(copys(""));
 	}
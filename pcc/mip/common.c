@@ -63,6 +63,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <sys/time.h>
 
 #include "pass2.h"
 #include "unicode.h"
@@ -332,6 +334,54 @@ static NODE *freelink;
 int usednodes;
 
 #ifndef LANG_F77
+/*
+ * Nodes are allocated in chunks owned by the function being compiled.
+ * When a function is ended (via tmpfree()) and all its nodes are
+ * freed, the chunks are released at once and the freelist is emptied,
+ * so the next function gets its nodes in allocation order.
+ * Trees saved for inlining are copied onto the permanent heap.
+ */
+#define	NODECHUNK	128	/* nodes per chunk */
+struct nodechunk {
+	struct nodechunk *next;
+	NODE n[NODECHUNK];
+};
+static struct nodechunk *nodechunks;
+static int nodeleft;	/* unused nodes in first chunk */
+
+static NODE *
+nodealloc(void)
+{
+	struct nodechunk *nc;
+
+	if (nodeleft == 0) {
+		nc = xmalloc(sizeof(struct nodechunk));
+		nc->next = nodechunks;
+		nodechunks = nc;
+		nodeleft = NODECHUNK;
+	}
+	return &nodechunks->n[NODECHUNK - nodeleft--];
+}
+
+/*
+ * Release all node chunks except the first one.
+ * Nothing is done if any node is still in use.
+ */
+static void
+nodefree(void)
+{
+	struct nodechunk *nc;
+
+	if (usednodes != 0 || nodechunks == NULL)
+		return;
+	while ((nc = nodechunks->next) != NULL) {
+		nodechunks->next = nc->next;
+		free(nc);
+	}
+	nodeleft = NODECHUNK;
+	freelink = NULL;
+}
+
 NODE *
 talloc(void)
 {
@@ -349,7 +399,7 @@ talloc(void)
 		return p;
 	}
 
-	p = permalloc(sizeof(NODE));
+	p = nodealloc();
 	nodesszcnt += sizeof(NODE);
 	p->n_op = FREE;
 	if (ndebug)
@@ -386,17 +436,12 @@ tcopy(NODE *p)
 void
 tcheck(void)
 {
-#ifdef LANG_CXX
-	extern int inlnodecnt;
-#else
-#define	inlnodecnt 0
-#endif
 
 	if (nerrors)
 		return;
 
-	if ((usednodes - inlnodecnt) != 0)
-		cerror("usednodes == %d, inlnodecnt %d", usednodes, inlnodecnt);
+	if (usednodes != 0)
+		cerror("usednodes == %d", usednodes);
 }
 #endif
 
@@ -506,6 +551,37 @@ walkf(NODE *t, void (*f)(NODE *, void *), void *arg)
 	(*f)(t, arg);
 }
 
+#ifndef MKEXT
+static void
+p2lcnt(NODE *p, void *arg)
+{
+	(*(int *)arg)++;
+}
+
+/*
+ * Max number of labels pass2 makes for an interpass entry.  A statement
+ * may be a branch, which gets one in add_labels(), removephi() and
+ * twice in layout(), one if it ends up in a vectorized loop, and up
+ * to three per node in the target and in asm statements.  A label may
+ * start a loop that gets a preheader for licm and the vectorizer and
+ * a vectorized loop.
+ */
+int
+p2labels(struct interpass *ip)
+{
+	int n = 0;
+
+	switch (ip->type) {
+	case IP_NODE:
+		walkf(ip->ip_node, p2lcnt, &n);
+		return 5 + 3 * n;
+	case IP_DEFLAB:
+		return 3;
+	}
+	return 0;
+}
+#endif
+
 int dope[DSIZE];
 char *opst[DSIZE];
 
@@ -568,6 +644,10 @@ struct dopest {
 	{ USTCALL, "USTCALL", UTYPE|CALLFLG, },
 	{ STCLR, "STCLR", BITYPE, },
 	{ ADDROF, "U&", UTYPE, },
+	{ POPCNT, "POPCNT", UTYPE, },
+	{ CLZ, "CLZ", UTYPE, },
+	{ CTZ, "CTZ", UTYPE, },
+	{ PREFETCH, "PREFETCH", UTYPE, },
 
 	{ -1,	"",	0 },
 };
@@ -607,7 +687,7 @@ tprint(TWORD t, TWORD q)
 		"ldouble",
 		"strty",
 		"unionty",
-		"enumty",
+		"xtype",
 		"moety",
 		"void",
 		"signed", /* pass1 */
@@ -790,6 +870,9 @@ tmpfree(void)
 	}
 	if (tapole)
 		uselem = 0;
+#if !defined(MKEXT) && !defined(LANG_F77)
+	nodefree();
+#endif
 }
 
 /*
@@ -1024,3 +1107,182 @@ xcalloc(int a, int b)
 		cerror("out of memory!");
 	return rv;
 }
+
+#ifndef MKEXT
+/*
+ * Compile time profiling (-Ztime).
+ *
+ * Time is counted for the innermost phase entered with tmenter(), so
+ * a phase does not include the phases it calls.  Entering the phase
+ * already running only nests.  Times and counts are kept both in
+ * total and for the function set by tmfunc().
+ */
+#define	TMDEPTH	32	/* max nested phases */
+#define	TMWORST	10	/* slowest functions reported */
+
+static char *tmname[TM_MAX] = {
+	"parse", "optim", "inline", "pass2", "deljumps", "layout", "cfg",
+	"ssa", "sccp", "gvn", "ivsr", "licm", "vect", "insn select",
+	"ra build", "ra color", "ra spill", "emit", "peephole",
+};
+
+struct tmrec {
+	char *name;		/* function, NULL outside of them */
+	double wall[TM_MAX];	/* seconds */
+	double cpu[TM_MAX];
+	int cnt[TM_MAX];
+	double sum;		/* wall time, for sorting */
+};
+
+static struct tmrec tmtot, tmfile, *tmcur = &tmfile;
+static struct tmrec *tmfun;
+static int ntmfun, tmfunsz;
+static struct {
+	int phase, nest;
+} tmstk[TMDEPTH];
+static int tmsp;
+static double tmwall, tmcpu;	/* start of the running interval */
+
+/*
+ * Charge the time since the last call to the running phase.
+ */
+static void
+tmcharge(void)
+{
+	struct timeval tv;
+	double w, c;
+	int ph;
+
+	gettimeofday(&tv, NULL);
+	w = tv.tv_sec + tv.tv_usec / 1e6;
+	c = (double)clock() / CLOCKS_PER_SEC;
+	if (tmsp > 0) {
+		ph = tmstk[tmsp-1].phase;
+		tmcur->wall[ph] += w - tmwall;
+		tmcur->cpu[ph] += c - tmcpu;
+		tmtot.wall[ph] += w - tmwall;
+		tmtot.cpu[ph] += c - tmcpu;
+	}
+	tmwall = w;
+	tmcpu = c;
+}
+
+void
+tmenter(int phase)
+{
+	if (ztime == 0)
+		return;
+	if (tmsp > 0 && (tmstk[tmsp-1].phase == phase || tmsp == TMDEPTH)) {
+		tmstk[tmsp-1].nest++;
+		return;
+	}
+	tmcharge();
+	tmstk[tmsp].phase = phase;
+	tmstk[tmsp].nest = 0;
+	tmsp++;
+	tmcur->cnt[phase]++;
+	tmtot.cnt[phase]++;
+}
+
+void
+tmleave(void)
+{
+	if (ztime == 0 || tmsp == 0)
+		return;
+	if (tmstk[tmsp-1].nest) {
+		tmstk[tmsp-1].nest--;
+		return;
+	}
+	tmcharge();
+	tmsp--;
+}
+
+/*
+ * Count the following time for function name, or outside of
+ * functions if name is NULL.
+ */
+void
+tmfunc(char *name)
+{
+	if (ztime == 0)
+		return;
+	if (name == NULL ? tmcur == &tmfile :
+	    tmcur != &tmfile && strcmp(tmcur->name, name) == 0)
+		return;
+	tmcharge();
+	if (name == NULL) {
+		tmcur = &tmfile;
+		return;
+	}
+	if (ntmfun == tmfunsz) {
+		tmfunsz = tmfunsz ? tmfunsz * 2 : 64;
+		tmfun = xrealloc(tmfun, tmfunsz * sizeof(struct tmrec));
+	}
+	tmcur = &tmfun[ntmfun++];
+	memset(tmcur, 0, sizeof(struct tmrec));
+	tmcur->name = xstrdup(name);
+}
+
+static int
+tmcmp(const void *a, const void *b)
+{
+	const struct tmrec *x = a, *y = b;
+
+	return x->sum < y->sum ? 1 : x->sum > y->sum ? -1 : 0;
+}
+
+/*
+ * Print the time per phase and the slowest functions on stderr.
+ */
+void
+tmreport(void)
+{
+	struct tmrec *r;
+	double w, c;
+	int i, j, k, n, best;
+	char *sep;
+
+	if (ztime == 0)
+		return;
+	tmcharge();
+	fprintf(stderr, "%-12s %12s %12s %8s\n",
+	    "phase", "wall ms", "cpu ms", "count");
+	for (i = 0, w = c = 0; i < TM_MAX; i++) {
+		if (tmtot.cnt[i] == 0)
+			continue;
+		fprintf(stderr, "%-12s %12.3f %12.3f %8d\n", tmname[i],
+		    tmtot.wall[i] * 1000, tmtot.cpu[i] * 1000, tmtot.cnt[i]);
+		w += tmtot.wall[i];
+		c += tmtot.cpu[i];
+	}
+	fprintf(stderr, "%-12s %12.3f %12.3f\n", "total", w * 1000, c * 1000);
+	if (ntmfun == 0)
+		return;
+
+	for (i = 0; i < ntmfun; i++)
+		for (j = 0, tmfun[i].sum = 0; j < TM_MAX; j++)
+			tmfun[i].sum += tmfun[i].wall[j];
+	qsort(tmfun, ntmfun, sizeof(struct tmrec), tmcmp);
+	fprintf(stderr, "\nslowest functions (wall ms):\n");
+	for (i = 0; i < ntmfun && i < TMWORST; i++) {
+		r = &tmfun[i];
+		fprintf(stderr, "%-24s %10.3f ", r->name, r->sum * 1000);
+		/* its three slowest phases */
+		sep = "(";
+		for (n = 0; n < 3; n++) {
+			best = -1;
+			for (k = 0; k < TM_MAX; k++)
+				if (r->cnt[k] && (best < 0 ||
+				    r->wall[k] > r->wall[best]))
+					best = k;
+			if (best < 0)
+				break;
+			fprintf(stderr, "%s%s %.3f/%d", sep, tmname[best],
+			    r->wall[best] * 1000, r->cnt[best]);
+			r->cnt[best] = 0;
+			sep = ", ";
+		}
+		fprintf(stderr, "%s\n", n ? ")" : "");
+	}
+}
+#endif
@@ -0,0 +1,1586 @@
+/*	$Id$	*/
+/*
+ * Copyright (c) 2026 The pcc project.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Integrated assembler.
+ *
+ * The assembler text written by pass2 is read back and turned into an
+ * ELF64 relocatable object, so that the driver need not run as(1).
+ * Only the syntax that the compiler itself emits is understood; on
+ * anything else (unknown instructions in inline asm, debug directives)
+ * elfobj() gives up without writing the object and the driver falls
+ * back to the external assembler.  Since the encoder does not yet
+ * cover the whole instruction table, the driver only asks for an
+ * object with -fintegrated-as.
+ *
+ * Section contents are kept as fixed bytes plus frags for the parts
+ * whose size depends on addresses: alignment padding and branches that
+ * may use a short displacement.  Branches start short and are grown
+ * until all displacements fit, then fixups are either resolved or
+ * turned into relocations.
+ *
+ * The target supplies asinsn() to encode an instruction, asrtype() to
+ * select relocation types and asnops() to pad code sections.
+ */
+
+#include "pass2.h"
+
+#ifdef ELFOBJ
+
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* ELF definitions, only what is needed here */
+#define	ET_REL		1
+#define	SHT_PROGBITS	1
+#define	SHT_SYMTAB	2
+#define	SHT_STRTAB	3
+#define	SHT_RELA	4
+#define	SHT_NOTE	7
+#define	SHT_NOBITS	8
+#define	SHT_INIT_ARRAY	14
+#define	SHT_FINI_ARRAY	15
+#define	SHT_PREINIT_ARRAY 16
+#define	SHF_WRITE	0x1
+#define	SHF_ALLOC	0x2
+#define	SHF_EXECINSTR	0x4
+#define	SHF_MERGE	0x10
+#define	SHF_STRINGS	0x20
+#define	SHF_INFO_LINK	0x40
+#define	SHF_TLS		0x400
+#define	STB_LOCAL	0
+#define	STB_GLOBAL	1
+#define	STB_WEAK	2
+#define	STT_NOTYPE	0
+#define	STT_OBJECT	1
+#define	STT_FUNC	2
+#define	STT_SECTION	3
+#define	STT_FILE	4
+#define	STT_TLS		6
+#define	STV_INTERNAL	1
+#define	STV_HIDDEN	2
+#define	STV_PROTECTED	3
+#define	SHN_ABS		0xfff1
+#define	SHN_COMMON	0xfff2
+
+#define	EHSZ	64	/* sizes of the Elf64 structures */
+#define	SHSZ	64
+#define	SYMSZ	24
+#define	RELSZ	24
+
+struct asfrag {
+	int pos;		/* offset in the fixed bytes */
+	int size;		/* current size */
+	int align;		/* alignment, 0 for a branch */
+	int fill;		/* fill byte, -1 for nops */
+	int sop, lop, llen;	/* short and long branch opcodes */
+	struct asexp e;		/* branch target */
+};
+
+struct asfix {
+	struct asfix *next;
+	int pos, nfrag;		/* where the field is */
+	int sz, flags, tail;
+	struct asexp e;
+};
+
+struct asrel {
+	CONSZ off;
+	struct assym *sym;	/* symbol, or NULL for the section symbol */
+	struct assec *sec;
+	int type;
+	CONSZ addend;
+};
+
+struct assec {
+	struct assec *next;
+	char *name;
+	int type, flags, align, entsz;
+	char *buf;		/* fixed bytes */
+	int len, blen;
+	struct asfrag *frag;
+	int nfrag, afrag;
+	int *fsum;		/* size of the frags before frag n */
+	struct asfix *fix, **lfix;
+	char *data;		/* final contents */
+	int size;
+	struct asrel *rel;
+	int nrel, arel;
+	int shndx, symndx, off, reloff;
+};
+
+struct assym {
+	struct assym *hnext;	/* hash chain */
+	struct assym *next;	/* all symbols, in order */
+	char *name;
+	struct assec *sec;	/* defining section, NULL if undefined */
+	int pos, nfrag;		/* where it is defined */
+	int bind, type, vis;
+	int flags;
+	struct asexp size;	/* .size */
+	struct asexp set;	/* .set */
+	CONSZ comsz;		/* .comm */
+	int comal;
+	int ndx;		/* index in the symbol table */
+	CONSZ value;
+};
+
+#define	SF_BIND		001	/* binding given explicitly */
+#define	SF_USED		002	/* used by a relocation */
+#define	SF_SIZE		004	/* has .size */
+#define	SF_SET		010	/* defined by .set */
+#define	SF_COMM		020	/* common */
+#define	SF_TEMP		040	/* never in the symbol table */
+#define	SF_TLS		0100	/* used by a TLS relocation */
+#define	SF_ABS		0200	/* absolute value */
+
+#define	ASHSZ	1024
+
+static struct assym *ashash[ASHSZ], *asyms, **lsym;
+static struct assec *assecs, **lsec, *cursec, *comment;
+static char *asfile;
+static int asbad, nlcnt[100];
+
+static char *asmods[] = { "", "PLT", "GOTPCREL", "GOT", "GOTOFF",
+	"TPOFF", "GOTTPOFF", "TLSGD", "TLSLD", "DTPOFF", 0 };
+
+#define	issym(c)	(isalnum((int)(c)) || (c) == '_' || (c) == '.' || \
+			    (c) == '$')
+
+static char *
+skipws(char *s)
+{
+	while (*s == ' ' || *s == '\t')
+		s++;
+	return s;
+}
+
+static struct assym *
+aslook(char *s, int len)
+{
+	struct assym *sp;
+	unsigned int h;
+	int i;
+
+	for (h = 0, i = 0; i < len; i++)
+		h = h * 31 + (unsigned char)s[i];
+	h %= ASHSZ;
+	for (sp = ashash[h]; sp; sp = sp->hnext)
+		if (strncmp(sp->name, s, len) == 0 && sp->name[len] == 0)
+			return sp;
+	sp = xcalloc(1, sizeof(struct assym));
+	sp->name = xmalloc(len+1);
+	memcpy(sp->name, s, len);
+	sp->name[len] = 0;
+	if ((len > 1 && s[0] == '.' && s[1] == 'L') || s[0] == '\001')
+		sp->flags = SF_TEMP;
+	sp->hnext = ashash[h];
+	ashash[h] = sp;
+	*lsym = sp;
+	lsym = &sp->next;
+	return sp;
+}
+
+/*
+ * Numeric local labels, "1:" referenced as "1b" or "1f".
+ */
+static struct assym *
+asnlab(int n, int fwd)
+{
+	char buf[32];
+	int c;
+
+	if (n < 0 || n >= 100)
+		return NULL;
+	c = nlcnt[n] + fwd;
+	if (c == 0)
+		return NULL;
+	snprintf(buf, sizeof(buf), "\001%d\001%d", n, c);
+	return aslook(buf, strlen(buf));
+}
+
+static void
+asdef(struct assym *sp)
+{
+	sp->sec = cursec;
+	sp->pos = cursec->len;
+	sp->nfrag = cursec->nfrag;
+}
+
+/*
+ * Parse a term of an expression: a number, a symbol with an optional
+ * @modifier, or "." for the current location.
+ */
+static char *
+asterm(char *s, struct asexp *t)
+{
+	struct assym *sp;
+	U_CONSZ v;
+	char *b;
+	int i;
+
+	t->sym = t->sub = NULL;
+	t->val = 0;
+	t->mod = 0;
+	s = skipws(s);
+	if (*s == '-' || *s == '~' || *s == '+') {
+		i = *s;
+		if ((s = asterm(s+1, t)) == NULL || t->sym != NULL)
+			return NULL;
+		if (i == '-')
+			t->val = -(U_CONSZ)t->val;
+		else if (i == '~')
+			t->val = ~t->val;
+		return s;
+	}
+	if (isdigit((int)*s)) {
+		b = s;
+		while (isdigit((int)*s))
+			s++;
+		if ((*s == 'f' || *s == 'b') && !issym(s[1])) {
+			t->sym = asnlab(atoi(b), *s == 'f');
+			return t->sym ? s+1 : NULL;
+		}
+		s = b;
+		v = 0;
+		if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+			for (s += 2; isxdigit((int)*s); s++)
+				v = v * 16 + (isdigit((int)*s) ? *s - '0' :
+				    (*s | 040) - 'a' + 10);
+		} else if (s[0] == '0' && (s[1] == 'b' || s[1] == 'B')) {
+			for (s += 2; *s == '0' || *s == '1'; s++)
+				v = v * 2 + *s - '0';
+		} else if (s[0] == '0') {
+			for (; *s >= '0' && *s <= '7'; s++)
+				v = v * 8 + *s - '0';
+		} else {
+			for (; isdigit((int)*s); s++)
+				v = v * 10 + *s - '0';
+		}
+		if (issym(*s))
+			return NULL;
+		t->val = v;
+		return s;
+	}
+	if (!issym(*s))
+		return NULL;
+	for (b = s; issym(*s); s++)
+		;
+	if (s - b == 1 && *b == '.') {
+		/* a new temporary at the current location */
+		t->sym = xcalloc(1, sizeof(struct assym));
+		t->sym->name = ".";
+		t->sym->flags = SF_TEMP;
+		asdef(t->sym);
+		return s;
+	}
+	t->sym = aslook(b, s - b);
+	if (*s == '@') {
+		for (b = ++s; isalnum((int)*s); s++)
+			;
+		for (i = 1; asmods[i]; i++)
+			if (strncmp(asmods[i], b, s - b) == 0 &&
+			    asmods[i][s - b] == 0)
+				break;
+		if (asmods[i] == 0)
+			return NULL;
+		t->mod = i;
+		if (i != AM_PLT) {
+			/* as gas, which refers to the GOT for these */
+			sp = aslook("_GLOBAL_OFFSET_TABLE_", 21);
+			sp->flags |= SF_USED;
+			sp->bind = STB_GLOBAL;
+		}
+	}
+	return s;
+}
+
+/*
+ * Parse an expression sym - sub + val.  Returns a pointer after the
+ * expression or NULL if it cannot be handled.
+ */
+char *
+asexpr(char *s, struct asexp *e)
+{
+	struct asexp t;
+	int neg = 0;
+
+	e->sym = e->sub = NULL;
+	e->val = 0;
+	e->mod = 0;
+	for (;;) {
+		if ((s = asterm(s, &t)) == NULL)
+			return NULL;
+		if (t.sym != NULL) {
+			if (neg == 0 && e->sym == NULL) {
+				e->sym = t.sym;
+				e->mod = t.mod;
+			} else if (neg && e->sub == NULL && t.mod == 0)
+				e->sub = t.sym;
+			else
+				return NULL;
+		}
+		e->val += neg ? -t.val : t.val;
+		s = skipws(s);
+		if (*s != '+' && *s != '-')
+			break;
+		neg = *s++ == '-';
+	}
+	return s;
+}
+
+static struct assec *
+assect(char *name, int type, int flags)
+{
+	struct assec *sp;
+
+	for (sp = assecs; sp; sp = sp->next)
+		if (strcmp(sp->name, name) == 0)
+			return sp;
+	sp = xcalloc(1, sizeof(struct assec));
+	sp->name = xstrdup(name);
+	sp->type = type;
+	sp->flags = flags;
+	sp->align = 1;
+	sp->lfix = &sp->fix;
+	*lsec = sp;
+	lsec = &sp->next;
+	return sp;
+}
+
+/*
+ * Append n bytes of v, little-endian.
+ */
+void
+asemit(U_CONSZ v, int n)
+{
+	struct assec *sp = cursec;
+
+	if (sp->type == SHT_NOBITS) {
+		if (v != 0)
+			asbad = 1;
+		sp->len += n;
+		return;
+	}
+	if (sp->len + n > sp->blen) {
+		sp->blen = sp->blen * 2 + n + 256;
+		sp->buf = xrealloc(sp->buf, sp->blen);
+	}
+	while (n-- > 0) {
+		sp->buf[sp->len++] = v & 0377;
+		v >>= 8;
+	}
+}
+
+static struct asfrag *
+asfrag(void)
+{
+	struct assec *sp = cursec;
+	struct asfrag *f;
+
+	if (sp->nfrag == sp->afrag) {
+		sp->afrag = sp->afrag * 2 + 16;
+		sp->frag = xrealloc(sp->frag, sp->afrag * sizeof(*f));
+	}
+	f = &sp->frag[sp->nfrag++];
+	memset(f, 0, sizeof(*f));
+	f->pos = sp->len;
+	return f;
+}
+
+/*
+ * Emit a field of sz bytes holding the value of e.  flags tell how the
+ * instruction uses it, tail is the number of bytes of the instruction
+ * that follow the field.  Returns non-zero if it cannot be handled.
+ */
+int
+asfixup(struct asexp *e, int sz, int flags, int tail)
+{
+	struct asfix *f;
+
+	if (e->sym == NULL && e->sub == NULL) {
+		if (flags & AF_PCREL)
+			return 1;
+		asemit(e->val, sz);
+		return 0;
+	}
+	if (cursec->type == SHT_NOBITS)
+		return 1;
+	f = xmalloc(sizeof(struct asfix));
+	f->next = NULL;
+	f->pos = cursec->len;
+	f->nfrag = cursec->nfrag;
+	f->sz = sz;
+	f->flags = flags;
+	f->tail = tail;
+	f->e = *e;
+	*cursec->lfix = f;
+	cursec->lfix = &f->next;
+	asemit(0, sz);
+	return 0;
+}
+
+/*
+ * Emit a branch to e.  The short form is sop followed by a one byte
+ * displacement, the long form the llen bytes of lop followed by a four
+ * byte displacement.
+ */
+int
+asjump(int sop, int lop, int llen, struct asexp *e)
+{
+	struct asfrag *f;
+
+	if (e->sym == NULL || e->sub != NULL || cursec->type == SHT_NOBITS)
+		return 1;
+	f = asfrag();
+	f->sop = sop;
+	f->lop = lop;
+	f->llen = llen;
+	f->e = *e;
+	return 0;
+}
+
+static void
+asalign(int al, int fill)
+{
+	struct asfrag *f;
+
+	if (al <= 1)
+		return;
+	if (al > cursec->align)
+		cursec->align = al;
+	f = asfrag();
+	f->align = al;
+	f->fill = fill < 0 && (cursec->flags & SHF_EXECINSTR) == 0 ? 0 : fill;
+}
+
+/*
+ * Directives.
+ */
+static int
+dsect(char *s, int n)
+{
+	static char *names[] = { ".text", ".data", ".bss" };
+	static int types[] = { SHT_PROGBITS, SHT_PROGBITS, SHT_NOBITS };
+	static int flags[] = { SHF_ALLOC|SHF_EXECINSTR, SHF_ALLOC|SHF_WRITE,
+	    SHF_ALLOC|SHF_WRITE };
+
+	if (*s)
+		return 1;	/* subsections */
+	cursec = assect(names[n], types[n], flags[n]);
+	return 0;
+}
+
+static struct {
+	char *name;
+	int type, flags;
+} asdefsec[] = {
+	{ ".text", SHT_PROGBITS, SHF_ALLOC|SHF_EXECINSTR },
+	{ ".data", SHT_PROGBITS, SHF_ALLOC|SHF_WRITE },
+	{ ".rodata", SHT_PROGBITS, SHF_ALLOC },
+	{ ".bss", SHT_NOBITS, SHF_ALLOC|SHF_WRITE },
+	{ ".tdata", SHT_PROGBITS, SHF_ALLOC|SHF_WRITE|SHF_TLS },
+	{ ".tbss", SHT_NOBITS, SHF_ALLOC|SHF_WRITE|SHF_TLS },
+	{ ".init_array", SHT_INIT_ARRAY, SHF_ALLOC|SHF_WRITE },
+	{ ".fini_array", SHT_FINI_ARRAY, SHF_ALLOC|SHF_WRITE },
+	{ ".preinit_array", SHT_PREINIT_ARRAY, SHF_ALLOC|SHF_WRITE },
+	{ ".ctors", SHT_PROGBITS, SHF_ALLOC|SHF_WRITE },
+	{ ".dtors", SHT_PROGBITS, SHF_ALLOC|SHF_WRITE },
+	{ ".init", SHT_PROGBITS, SHF_ALLOC|SHF_EXECINSTR },
+	{ ".fini", SHT_PROGBITS, SHF_ALLOC|SHF_EXECINSTR },
+	{ ".note", SHT_NOTE, 0 },
+	{ 0 },
+};
+
+static int
+dsection(char *s, int n)
+{
+	char *b, *name;
+	int i, l, type, flags;
+
+	for (b = s; issym(*s) || *s == '-'; s++)
+		;
+	if ((l = s - b) == 0)
+		return 1;
+	name = tmpalloc(l+1);
+	memcpy(name, b, l);
+	name[l] = 0;
+	type = SHT_PROGBITS;
+	flags = 0;
+	for (i = 0; asdefsec[i].name; i++) {
+		n = strlen(asdefsec[i].name);
+		if (strncmp(name, asdefsec[i].name, n) == 0 &&
+		    (name[n] == 0 || name[n] == '.')) {
+			type = asdefsec[i].type;
+			flags = asdefsec[i].flags;
+			break;
+		}
+	}
+	s = skipws(s);
+	if (*s == ',') {
+		s = skipws(s+1);
+		if (*s++ != '"')
+			return 1;
+		for (flags = 0; *s != '"'; s++) {
+			switch (*s) {
+			case 'a': flags |= SHF_ALLOC; break;
+			case 'w': flags |= SHF_WRITE; break;
+			case 'x': flags |= SHF_EXECINSTR; break;
+			case 'T': flags |= SHF_TLS; break;
+			default: return 1;
+			}
+		}
+		s = skipws(s+1);
+		if (*s == ',') {
+			s = skipws(s+1);
+			if (*s != '@' && *s != '%')
+				return 1;
+			s++;
+			if (strncmp(s, "progbits", 8) == 0)
+				type = SHT_PROGBITS, s += 8;
+			else if (strncmp(s, "nobits", 6) == 0)
+				type = SHT_NOBITS, s += 6;
+			else if (strncmp(s, "note", 4) == 0)
+				type = SHT_NOTE, s += 4;
+			else
+				return 1;
+		}
+	}
+	if (*skipws(s))
+		return 1;
+	cursec = assect(name, type, flags);
+	return 0;
+}
+
+/* parse a symbol name, return end or NULL */
+static char *
+asname(char *s, struct assym **spp)
+{
+	char *b;
+
+	s = skipws(s);
+	for (b = s; issym(*s); s++)
+		;
+	if (s == b || isdigit((int)*b))
+		return NULL;
+	*spp = aslook(b, s - b);
+	return skipws(s);
+}
+
+static int
+dbind(char *s, int bind)
+{
+	struct assym *sp;
+
+	for (;;) {
+		if ((s = asname(s, &sp)) == NULL)
+			return 1;
+		sp->bind = bind;
+		sp->flags |= SF_BIND;
+		if (*s != ',')
+			break;
+		s++;
+	}
+	return *s != 0;
+}
+
+static int
+dvis(char *s, int vis)
+{
+	struct assym *sp;
+
+	if ((s = asname(s, &sp)) == NULL || *s)
+		return 1;
+	sp->vis = vis;
+	return 0;
+}
+
+static int
+dtype(char *s, int n)
+{
+	struct assym *sp;
+
+	if ((s = asname(s, &sp)) == NULL || *s++ != ',')
+		return 1;
+	s = skipws(s);
+	if (*s != '@' && *s != '%')
+		return 1;
+	s++;
+	if (strcmp(s, "function") == 0)
+		sp->type = STT_FUNC;
+	else if (strcmp(s, "object") == 0)
+		sp->type = STT_OBJECT;
+	else if (strcmp(s, "tls_object") == 0)
+		sp->type = STT_TLS;
+	else if (strcmp(s, "notype") == 0)
+		sp->type = STT_NOTYPE;
+	else
+		return 1;
+	return 0;
+}
+
+static int
+dsize(char *s, int n)
+{
+	struct assym *sp;
+
+	if ((s = asname(s, &sp)) == NULL || *s++ != ',')
+		return 1;
+	if ((s = asexpr(s, &sp->size)) == NULL || *s || sp->size.mod)
+		return 1;
+	sp->flags |= SF_SIZE;
+	return 0;
+}
+
+static int
+dset(char *s, int n)
+{
+	struct assym *sp;
+
+	if ((s = asname(s, &sp)) == NULL || *s++ != ',')
+		return 1;
+	if (sp->sec != NULL || (sp->flags & (SF_SET|SF_COMM)))
+		return 1;
+	if ((s = asexpr(s, &sp->set)) == NULL || *s)
+		return 1;
+	if (sp->set.sub != NULL || sp->set.mod != 0 ||
+	    (sp->set.sym != NULL && sp->set.val != 0))
+		return 1;
+	sp->flags |= SF_SET;
+	return 0;
+}
+
+static int
+dcons(char *s, int sz)
+{
+	struct asexp e;
+
+	for (;;) {
+		if ((s = asexpr(s, &e)) == NULL)
+			return 1;
+		if (asfixup(&e, sz, 0, 0))
+			return 1;
+		if (*s != ',')
+			break;
+		s++;
+	}
+	return *s != 0;
+}
+
+/*
+ * Parse a string into buf, return end or NULL.
+ */
+static char *
+asstr(char *s, char *buf, int *lenp)
+{
+	int c, i, n = 0;
+
+	if (*s++ != '"')
+		return NULL;
+	while ((c = *s++) != '"') {
+		if (c == 0)
+			return NULL;
+		if (c == '\\') {
+			switch (c = *s++) {
+			case 'n': c = '\n'; break;
+			case 't': c = '\t'; break;
+			case 'r': c = '\r'; break;
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case '\\': case '"': break;
+			case '0': case '1': case '2': case '3':
+			case '4': case '5': case '6': case '7':
+				for (c -= '0', i = 0; i < 2 &&
+				    *s >= '0' && *s <= '7'; i++)
+					c = c * 8 + *s++ - '0';
+				break;
+			case 'x':
+				if (!isxdigit((int)*s))
+					return NULL;
+				for (c = 0; isxdigit((int)*s); s++)
+					c = c * 16 + (isdigit((int)*s) ?
+					    *s - '0' : (*s | 040) - 'a' + 10);
+				break;
+			default:
+				return NULL;
+			}
+		}
+		buf[n++] = c;
+	}
+	*lenp = n;
+	return skipws(s);
+}
+
+static int
+dascii(char *s, int z)
+{
+	char *buf;
+	int i, n;
+
+	buf = tmpalloc(strlen(s) + 1);
+	for (;;) {
+		if ((s = asstr(s, buf, &n)) == NULL)
+			return 1;
+		for (i = 0; i < n; i++)
+			asemit(buf[i], 1);
+		if (z)
+			asemit(0, 1);
+		if (*s != ',')
+			break;
+		s = skipws(s+1);
+	}
+	return *s != 0;
+}
+
+static int
+dspace(char *s, int n)
+{
+	struct asexp e, f;
+
+	if ((s = asexpr(s, &e)) == NULL || e.sym || e.sub || e.val < 0)
+		return 1;
+	f.val = 0;
+	if (*s == ',') {
+		if ((s = asexpr(s+1, &f)) == NULL || f.sym || f.sub)
+			return 1;
+	}
+	if (*s)
+		return 1;
+	while (e.val-- > 0)
+		asemit(f.val, 1);
+	return 0;
+}
+
+static int
+dalign(char *s, int p2)
+{
+	struct asexp e, f;
+
+	if ((s = asexpr(s, &e)) == NULL || e.sym || e.sub)
+		return 1;
+	f.val = -1;
+	if (*s == ',') {
+		if ((s = asexpr(s+1, &f)) == NULL || f.sym || f.sub)
+			return 1;
+	}
+	if (*s)
+		return 1;	/* maximum skip not handled */
+	if (p2) {
+		if (e.val < 0 || e.val > 16)
+			return 1;
+		e.val = 1 << e.val;
+	}
+	if (e.val <= 0 || e.val > 65536 || (e.val & (e.val-1)))
+		return 1;
+	asalign(e.val, f.val < 0 ? -1 : f.val & 0377);
+	return 0;
+}
+
+static int
+dcomm(char *s, int local)
+{
+	struct assec *sp;
+	struct assym *sym;
+	struct asexp e, a;
+
+	if ((s = asname(s, &sym)) == NULL || *s++ != ',')
+		return 1;
+	if ((s = asexpr(s, &e)) == NULL || e.sym || e.sub || e.val < 0)
+		return 1;
+	a.val = 1;
+	if (*s == ',') {
+		if ((s = asexpr(s+1, &a)) == NULL || a.sym || a.sub)
+			return 1;
+	}
+	if (*s || sym->sec || (sym->flags & (SF_SET|SF_COMM)) ||
+	    a.val <= 0 || (a.val & (a.val-1)))
+		return 1;
+	if (sym->type == STT_NOTYPE)
+		sym->type = STT_OBJECT;
+	if (local || ((sym->flags & SF_BIND) && sym->bind == STB_LOCAL)) {
+		/* local common goes into .bss */
+		sp = cursec;
+		cursec = assect(".bss", SHT_NOBITS, SHF_ALLOC|SHF_WRITE);
+		asalign(a.val, 0);
+		asdef(sym);
+		cursec->len += e.val;
+		cursec = sp;
+		sym->size.val = e.val;
+		sym->flags |= SF_SIZE;
+	} else {
+		sym->flags |= SF_COMM;
+		sym->comsz = e.val;
+		sym->comal = a.val;
+		if ((sym->flags & SF_BIND) == 0)
+			sym->bind = STB_GLOBAL;
+	}
+	return 0;
+}
+
+static int
+dident(char *s, int n)
+{
+	struct assec *sp;
+	char *buf;
+	int i, l;
+
+	buf = tmpalloc(strlen(s) + 1);
+	if ((s = asstr(s, buf, &l)) == NULL || *s)
+		return 1;
+	sp = cursec;
+	if (comment == NULL) {
+		comment = cursec = assect(".comment", SHT_PROGBITS,
+		    SHF_MERGE|SHF_STRINGS);
+		comment->entsz = 1;
+		asemit(0, 1);
+	}
+	cursec = comment;
+	for (i = 0; i < l; i++)
+		asemit(buf[i], 1);
+	asemit(0, 1);
+	cursec = sp;
+	return 0;
+}
+
+static int
+dfile(char *s, int n)
+{
+	char *buf;
+	int l;
+
+	buf = tmpalloc(strlen(s) + 1);
+	if ((s = asstr(s, buf, &l)) == NULL || *s || asfile != NULL)
+		return 1;
+	asfile = xmalloc(l + 1);
+	memcpy(asfile, buf, l);
+	asfile[l] = 0;
+	return 0;
+}
+
+static int
+dnop(char *s, int n)
+{
+	return 0;
+}
+
+static struct asdir {
+	char *name;
+	int (*fn)(char *, int);
+	int arg;
+} asdirs[] = {
+	{ "long", dcons, 4 },
+	{ "quad", dcons, 8 },
+	{ "short", dcons, 2 },
+	{ "byte", dcons, 1 },
+	{ "ascii", dascii, 0 },
+	{ "align", dalign, 0 },
+	{ "size", dsize, 0 },
+	{ "type", dtype, 0 },
+	{ "globl", dbind, STB_GLOBAL },
+	{ "space", dspace, 0 },
+	{ "section", dsection, 0 },
+	{ "text", dsect, 0 },
+	{ "data", dsect, 1 },
+	{ "bss", dsect, 2 },
+	{ "comm", dcomm, 0 },
+	{ "lcomm", dcomm, 1 },
+	{ "local", dbind, STB_LOCAL },
+	{ "global", dbind, STB_GLOBAL },
+	{ "weak", dbind, STB_WEAK },
+	{ "hidden", dvis, STV_HIDDEN },
+	{ "protected", dvis, STV_PROTECTED },
+	{ "internal", dvis, STV_INTERNAL },
+	{ "set", dset, 0 },
+	{ "equ", dset, 0 },
+	{ "int", dcons, 4 },
+	{ "value", dcons, 2 },
+	{ "word", dcons, 2 },
+	{ "asciz", dascii, 1 },
+	{ "string", dascii, 1 },
+	{ "zero", dspace, 0 },
+	{ "skip", dspace, 0 },
+	{ "p2align", dalign, 1 },
+	{ "balign", dalign, 0 },
+	{ "ident", dident, 0 },
+	{ "file", dfile, 0 },
+	{ "end", dnop, 0 },
+	{ 0 },
+};
+
+/*
+ * Find the end of a statement, which is a newline, a ';' or a comment.
+ */
+static char *
+asend(char *s)
+{
+	for (; *s && *s != '\n' && *s != ';' && *s != '#'; s++) {
+		if (*s == '"') {
+			for (s++; *s && *s != '"' && *s != '\n'; s++)
+				if (*s == '\\' && s[1] != 0 && s[1] != '\n')
+					s++;
+			if (*s != '"')
+				return s;
+		}
+	}
+	return s;
+}
+
+/*
+ * Assemble one statement, s is NUL-terminated.
+ */
+static int
+asstmt(char *s)
+{
+	struct asdir *dp;
+	struct assym *sp;
+	char *b, *e;
+	int c;
+
+	for (;;) {
+		s = skipws(s);
+		if (*s == 0)
+			return 0;
+		for (b = s; issym(*s); s++)
+			;
+		if (*s != ':' || s == b)
+			break;
+		/* label */
+		if (isdigit((int)*b)) {
+			for (e = b; isdigit((int)*e); e++)
+				;
+			if (e != s || (c = atoi(b)) >= 100)
+				return 1;
+			nlcnt[c]++;
+			sp = asnlab(c, 0);
+		} else
+			sp = aslook(b, s - b);
+		if (sp->sec != NULL || (sp->flags & (SF_SET|SF_COMM)))
+			return 1;
+		asdef(sp);
+		s++;
+	}
+	if (s == b)
+		return 1;
+	/* strip trailing blanks */
+	for (e = s + strlen(s); e > s && (e[-1] == ' ' || e[-1] == '\t'); )
+		*--e = 0;
+	if (*b == '.') {
+		c = *s;
+		*s = 0;
+		for (dp = asdirs; dp->name; dp++)
+			if (strcmp(dp->name, b+1) == 0)
+				break;
+		*s = c;
+		if (dp->name == NULL || (c != 0 && c != ' ' && c != '\t'))
+			return 1;
+		return (*dp->fn)(skipws(s), dp->arg);
+	}
+	if (*s != 0) {
+		if (*s != ' ' && *s != '\t')
+			return 1;
+		*s++ = 0;
+	}
+	if (cursec->type == SHT_NOBITS)
+		return 1;
+	return asinsn(b, skipws(s));
+}
+
+static CONSZ
+symaddr(struct assym *sp)
+{
+	return sp->pos + sp->sec->fsum[sp->nfrag];
+}
+
+/* a branch to e may be resolved without a relocation */
+static int
+asnear(struct assec *sp, struct asexp *e)
+{
+	return e->sym->sec == sp && e->mod == 0 && e->sym->bind != STB_WEAK;
+}
+
+/*
+ * Give branches and alignments their final sizes.
+ */
+static void
+asrelax(struct assec *sp)
+{
+	struct asfrag *f;
+	CONSZ d;
+	int i, chg;
+
+	sp->fsum = xcalloc(sp->nfrag + 1, sizeof(int));
+	for (i = 0; i < sp->nfrag; i++) {
+		f = &sp->frag[i];
+		if (f->align == 0)
+			f->size = asnear(sp, &f->e) ? 2 : f->llen + 4;
+	}
+	do {
+		chg = 0;
+		for (i = 0; i < sp->nfrag; i++) {
+			f = &sp->frag[i];
+			if (f->align)
+				f->size = -(f->pos + sp->fsum[i]) & (f->align-1);
+			sp->fsum[i+1] = sp->fsum[i] + f->size;
+		}
+		for (i = 0; i < sp->nfrag; i++) {
+			f = &sp->frag[i];
+			if (f->align || f->size != 2)
+				continue;
+			d = symaddr(f->e.sym) + f->e.val -
+			    (f->pos + sp->fsum[i] + 2);
+			if (d < -128 || d > 127) {
+				f->size = f->llen + 4;
+				chg = 1;
+			}
+		}
+	} while (chg);
+	sp->size = sp->len + sp->fsum[sp->nfrag];
+}
+
+static void
+asput(char *p, U_CONSZ v, int n)
+{
+	while (n-- > 0) {
+		*p++ = v & 0377;
+		v >>= 8;
+	}
+}
+
+static void
+addrel(struct assec *sp, CONSZ off, struct assym *sym, int type, CONSZ a)
+{
+	struct asrel *r;
+
+	if (sp->nrel == sp->arel) {
+		sp->arel = sp->arel * 2 + 16;
+		sp->rel = xrealloc(sp->rel, sp->arel * sizeof(*r));
+	}
+	r = &sp->rel[sp->nrel++];
+	r->off = off;
+	r->type = type;
+	if (sym->sec != NULL && sym->bind == STB_LOCAL &&
+	    (sym->sec->flags & SHF_TLS) == 0) {
+		/* relative to the section symbol */
+		r->sym = NULL;
+		r->sec = sym->sec;
+		r->addend = a + symaddr(sym);
+		sym->sec->symndx = -1;
+	} else {
+		r->sym = sym;
+		r->sec = NULL;
+		r->addend = a;
+		sym->flags |= SF_USED;
+	}
+}
+
+/*
+ * Resolve the field of sz bytes at off in sp that should hold e.
+ */
+static int
+asresolve(struct assec *sp, int off, int sz, int flags, int tail,
+    struct asexp *e)
+{
+	struct assym *sym = e->sym;
+	CONSZ v = e->val;
+	int type;
+
+	if (sym != NULL && (sym->flags & SF_ABS)) {
+		v += sym->value;
+		sym = NULL;
+	}
+	if (e->sub != NULL) {
+		if (sym == NULL || sym->sec == NULL || e->mod ||
+		    sym->sec != e->sub->sec || (flags & AF_PCREL))
+			return 1;
+		v += symaddr(sym) - symaddr(e->sub);
+		asput(sp->data + off, v, sz);
+		return 0;
+	}
+	if (sym == NULL) {
+		if (flags & AF_PCREL)
+			return 1;
+		asput(sp->data + off, v, sz);
+		return 0;
+	}
+	if ((flags & AF_PCREL) && sym->sec == sp && e->mod == 0 &&
+	    sym->bind == STB_LOCAL) {
+		v += symaddr(sym) - (off + sz + tail);
+		asput(sp->data + off, v, sz);
+		return 0;
+	}
+	if (sym->sec == NULL && (sym->flags & (SF_COMM|SF_BIND)) == 0) {
+		if (sym->flags & SF_TEMP)
+			return 1;	/* undefined local label */
+		sym->bind = STB_GLOBAL;
+	}
+	if ((type = asrtype(e->mod, sz, flags)) < 0)
+		return 1;
+	if (e->mod >= AM_TPOFF)
+		sym->flags |= SF_TLS;
+	if (flags & AF_PCREL)
+		v -= sz + tail;
+	addrel(sp, off, sym, type, v);
+	return 0;
+}
+
+/*
+ * Lay out the final contents of a section and resolve its fixups.
+ */
+static int
+aslayout(struct assec *sp)
+{
+	struct asfrag *f;
+	struct asfix *fx;
+	struct asexp e;
+	char *p;
+	int i, j, q, pos, off;
+
+	if (sp->type == SHT_NOBITS)
+		return sp->fix != NULL;
+	p = sp->data = xmalloc(sp->size ? sp->size : 1);
+	for (pos = 0, i = 0; i < sp->nfrag; i++) {
+		f = &sp->frag[i];
+		memcpy(p, sp->buf + pos, f->pos - pos);
+		p += f->pos - pos;
+		pos = f->pos;
+		if (f->align) {
+			if (f->fill < 0)
+				asnops(p, f->size);
+			else
+				memset(p, f->fill, f->size);
+		} else if (f->size == 2) {
+			p[0] = f->sop;
+			p[1] = symaddr(f->e.sym) + f->e.val -
+			    (p - sp->data + 2);
+		} else {
+			for (j = f->llen; j > 0; j--)
+				*p++ = f->lop >> ((j-1) * 8);
+			memset(p, 0, 4);
+			off = p - sp->data;
+			if (asnear(sp, &f->e))
+				asput(p, symaddr(f->e.sym) + f->e.val -
+				    (off + 4), 4);
+			else {
+				e = f->e;
+				if (asresolve(sp, off, 4, AF_PCREL|AF_BRANCH,
+				    0, &e))
+					return 1;
+			}
+			p -= f->llen;
+		}
+		p += f->size;
+	}
+	if (sp->len > pos)
+		memcpy(p, sp->buf + pos, sp->len - pos);
+
+	for (fx = sp->fix; fx; fx = fx->next) {
+		q = fx->pos + sp->fsum[fx->nfrag];
+		if (asresolve(sp, q, fx->sz, fx->flags, fx->tail, &fx->e))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Everything is read, give addresses to everything.
+ */
+static int
+asfinish(void)
+{
+	struct assec *sp;
+	struct assym *sym, *t;
+	int n;
+
+	/* .set, at most a simple chain of aliases */
+	for (sym = asyms; sym; sym = sym->next) {
+		if ((sym->flags & SF_SET) == 0)
+			continue;
+		for (n = 0, t = sym; t->flags & SF_SET; n++) {
+			if (t->set.sym == NULL || n > 10)
+				break;
+			t = t->set.sym;
+		}
+		if (t->flags & SF_SET) {
+			if (t->set.sym != NULL)
+				return 1;
+			sym->flags |= SF_ABS;
+			sym->value = t->set.val;
+		} else if (t->sec != NULL) {
+			sym->sec = t->sec;
+			sym->pos = t->pos;
+			sym->nfrag = t->nfrag;
+			if (sym->type == STT_NOTYPE)
+				sym->type = t->type;
+		} else
+			return 1;
+	}
+
+	for (sp = assecs; sp; sp = sp->next)
+		asrelax(sp);
+	for (sp = assecs; sp; sp = sp->next)
+		if (aslayout(sp))
+			return 1;
+
+	for (sym = asyms; sym; sym = sym->next) {
+		if (sym->sec != NULL)
+			sym->value = symaddr(sym);
+		if ((sym->flags & SF_SIZE) == 0)
+			continue;
+		if (sym->size.sub != NULL) {
+			t = sym->size.sym;
+			if (t == NULL || t->sec == NULL ||
+			    t->sec != sym->size.sub->sec)
+				return 1;
+			sym->size.val += symaddr(t) - symaddr(sym->size.sub);
+		} else if (sym->size.sym != NULL)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Output.
+ */
+static char *obuf;
+static int olen, oalen;
+
+static int
+ostr(char *s)
+{
+	int l = strlen(s) + 1, o = olen;
+
+	if (olen + l > oalen) {
+		oalen = oalen * 2 + l + 1024;
+		obuf = xrealloc(obuf, oalen);
+	}
+	memcpy(obuf + olen, s, l);
+	olen += l;
+	return o;
+}
+
+static void
+oshdr(char *p, int name, int type, CONSZ flags, int off, int size,
+    int link, int info, int align, int entsz)
+{
+	asput(p, name, 4);
+	asput(p+4, type, 4);
+	asput(p+8, flags, 8);
+	asput(p+16, 0, 8);
+	asput(p+24, off, 8);
+	asput(p+32, size, 8);
+	asput(p+40, link, 4);
+	asput(p+44, info, 4);
+	asput(p+48, align, 8);
+	asput(p+56, entsz, 8);
+}
+
+static void
+osym(char *p, int name, int bind, int type, int vis, int shndx,
+    CONSZ value, CONSZ size)
+{
+	asput(p, name, 4);
+	p[4] = (bind << 4) | type;
+	p[5] = vis;
+	asput(p+6, shndx, 2);
+	asput(p+8, value, 8);
+	asput(p+16, size, 8);
+}
+
+/* symbol is in the symbol table */
+static int
+insymtab(struct assym *sym)
+{
+	if (sym->flags & SF_TEMP)
+		return 0;
+	return sym->sec != NULL || (sym->flags & (SF_ABS|SF_COMM|SF_USED)) ||
+	    ((sym->flags & SF_BIND) && sym->bind != STB_LOCAL);
+}
+
+static int
+aswrite(char *out)
+{
+	struct assec *sp;
+	struct assym *sym;
+	struct asrel *r;
+	FILE *fp;
+	char *buf, *symbuf, *p;
+	int nsec, nsym, nloc, symoff, stroff, shstroff, shoff, strsz, shstrsz;
+	int symsec, strsec, shstrsec, off, i, type, rv, *names;
+
+	/* section numbers, with each relocation section after its section */
+	nsec = 1;
+	for (sp = assecs; sp; sp = sp->next) {
+		sp->shndx = nsec++;
+		if (sp->nrel)
+			nsec++;
+	}
+	symsec = nsec++;
+	strsec = nsec++;
+	shstrsec = nsec++;
+
+	/* symbol table: locals first */
+	olen = 0;
+	ostr("");
+	nsym = 1;
+	if (asfile)
+		nsym++;
+	for (sp = assecs; sp; sp = sp->next)
+		if (sp->symndx)
+			sp->symndx = nsym++;
+	for (sym = asyms; sym; sym = sym->next)
+		if (insymtab(sym) && sym->bind == STB_LOCAL)
+			sym->ndx = nsym++;
+	nloc = nsym;
+	for (sym = asyms; sym; sym = sym->next)
+		if (insymtab(sym) && sym->bind != STB_LOCAL)
+			sym->ndx = nsym++;
+
+	/* symbols, their names go first in obuf */
+	symbuf = xcalloc(nsym, SYMSZ);
+	p = symbuf + SYMSZ;
+	if (asfile) {
+		osym(p, ostr(asfile), STB_LOCAL, STT_FILE, 0, SHN_ABS, 0, 0);
+		p += SYMSZ;
+	}
+	for (sp = assecs; sp; sp = sp->next) {
+		if (sp->symndx) {
+			osym(p, 0, STB_LOCAL, STT_SECTION, 0, sp->shndx, 0, 0);
+			p += SYMSZ;
+		}
+	}
+	for (sym = asyms; sym; sym = sym->next) {
+		if (!insymtab(sym))
+			continue;
+		type = sym->type;
+		if ((type == STT_NOTYPE && (sym->flags & SF_TLS)) ||
+		    ((type == STT_NOTYPE || type == STT_OBJECT) &&
+		    sym->sec && (sym->sec->flags & SHF_TLS)))
+			type = STT_TLS;
+		p = symbuf + sym->ndx * SYMSZ;
+		if (sym->flags & SF_COMM)
+			osym(p, ostr(sym->name), sym->bind, type, sym->vis,
+			    SHN_COMMON, sym->comal, sym->comsz);
+		else
+			osym(p, ostr(sym->name), sym->bind, type, sym->vis,
+			    (sym->flags & SF_ABS) ? SHN_ABS :
+			    sym->sec ? sym->sec->shndx : 0,
+			    sym->value, sym->size.val);
+	}
+	strsz = olen;
+
+	/* then the section names */
+	names = tmpalloc(nsec * sizeof(int));
+	names[0] = ostr("");
+	for (sp = assecs; sp; sp = sp->next) {
+		names[sp->shndx] = ostr(sp->name);
+		if (sp->nrel) {
+			names[sp->shndx+1] = ostr(".rela");
+			olen--;
+			ostr(sp->name);
+		}
+	}
+	names[symsec] = ostr(".symtab");
+	names[strsec] = ostr(".strtab");
+	names[shstrsec] = ostr(".shstrtab");
+	for (i = 0; i < nsec; i++)
+		names[i] -= strsz;
+	shstrsz = olen - strsz;
+
+	/*
+	 * File layout as gas does it: contents, symbols, strings,
+	 * relocations, section names and the section headers.
+	 */
+	off = EHSZ;
+	for (sp = assecs; sp; sp = sp->next) {
+		off = (off + sp->align - 1) & ~(sp->align - 1);
+		sp->off = off;
+		if (sp->type != SHT_NOBITS)
+			off += sp->size;
+	}
+	symoff = off = (off + 7) & ~7;
+	stroff = off += nsym * SYMSZ;
+	off += strsz;
+	for (sp = assecs; sp; sp = sp->next) {
+		if (sp->nrel == 0)
+			continue;
+		off = (off + 7) & ~7;
+		sp->reloff = off;
+		off += sp->nrel * RELSZ;
+	}
+	shstroff = off;
+	shoff = (off + shstrsz + 7) & ~7;
+	off = shoff + nsec * SHSZ;
+
+	buf = xcalloc(1, off);
+	for (sp = assecs; sp; sp = sp->next) {
+		if (sp->type != SHT_NOBITS)
+			memcpy(buf + sp->off, sp->data, sp->size);
+		for (i = 0; i < sp->nrel; i++) {
+			r = &sp->rel[i];
+			p = buf + sp->reloff + i * RELSZ;
+			asput(p, r->off, 8);
+			asput(p+8, ((U_CONSZ)(r->sym ? r->sym->ndx :
+			    r->sec->symndx) << 32) | r->type, 8);
+			asput(p+16, r->addend, 8);
+		}
+	}
+	memcpy(buf + symoff, symbuf, nsym * SYMSZ);
+	free(symbuf);
+	memcpy(buf + stroff, obuf, strsz);
+	memcpy(buf + shstroff, obuf + strsz, shstrsz);
+
+	/* section headers */
+	p = buf + shoff + SHSZ;
+	for (sp = assecs; sp; sp = sp->next) {
+		oshdr(p, names[sp->shndx], sp->type, sp->flags, sp->off,
+		    sp->size, 0, 0, sp->align, sp->entsz);
+		p += SHSZ;
+		if (sp->nrel) {
+			oshdr(p, names[sp->shndx+1], SHT_RELA, SHF_INFO_LINK,
+			    sp->reloff, sp->nrel * RELSZ, symsec, sp->shndx,
+			    8, RELSZ);
+			p += SHSZ;
+		}
+	}
+	oshdr(p, names[symsec], SHT_SYMTAB, 0, symoff, nsym * SYMSZ,
+	    strsec, nloc, 8, SYMSZ);
+	oshdr(p + SHSZ, names[strsec], SHT_STRTAB, 0, stroff, strsz,
+	    0, 0, 1, 0);
+	oshdr(p + 2*SHSZ, names[shstrsec], SHT_STRTAB, 0, shstroff, shstrsz,
+	    0, 0, 1, 0);
+
+	/* file header */
+	memcpy(buf, "\177ELF\2\1\1", 7);
+	asput(buf+16, ET_REL, 2);
+	asput(buf+18, ELF_MACHINE, 2);
+	asput(buf+20, 1, 4);
+	asput(buf+40, shoff, 8);
+	asput(buf+52, EHSZ, 2);
+	asput(buf+58, SHSZ, 2);
+	asput(buf+60, nsec, 2);
+	asput(buf+62, shstrsec, 2);
+
+	rv = 1;
+	if ((fp = fopen(out, "w")) != NULL) {
+		rv = fwrite(buf, 1, off, fp) != (size_t)off;
+		rv |= fclose(fp) != 0;
+		if (rv)
+			(void)unlink(out);
+	}
+	free(buf);
+	return rv;
+}
+
+static void
+ascleanup(void)
+{
+	struct assec *sp, *nsp;
+	struct assym *sym, *nsym;
+	struct asfix *fx, *nfx;
+
+	for (sp = assecs; sp; sp = nsp) {
+		nsp = sp->next;
+		for (fx = sp->fix; fx; fx = nfx) {
+			nfx = fx->next;
+			free(fx);
+		}
+		free(sp->name);
+		free(sp->buf);
+		free(sp->frag);
+		free(sp->fsum);
+		free(sp->data);
+		free(sp->rel);
+		free(sp);
+	}
+	for (sym = asyms; sym; sym = nsym) {
+		nsym = sym->next;
+		free(sym->name);
+		free(sym);
+	}
+	free(asfile);
+	free(obuf);
+	memset(ashash, 0, sizeof(ashash));
+	memset(nlcnt, 0, sizeof(nlcnt));
+	asyms = NULL;
+	assecs = comment = NULL;
+	asfile = obuf = NULL;
+	olen = oalen = 0;
+}
+
+/*
+ * Assemble the file in into the object file out.  Returns non-zero if
+ * something could not be handled; out is not written then.
+ */
+int
+elfobj(char *in, char *out)
+{
+	FILE *fp;
+	char *buf, *s, *e;
+	long sz;
+	int rv, c;
+
+	if ((fp = fopen(in, "r")) == NULL)
+		return 1;
+	if (fseek(fp, 0L, SEEK_END) != 0 || (sz = ftell(fp)) < 0) {
+		fclose(fp);
+		return 1;
+	}
+	rewind(fp);
+	buf = xmalloc(sz + 1);
+	sz = fread(buf, 1, sz, fp);
+	fclose(fp);
+	buf[sz] = 0;
+
+	lsym = &asyms;
+	lsec = &assecs;
+	cursec = assect(".text", SHT_PROGBITS, SHF_ALLOC|SHF_EXECINSTR);
+	assect(".data", SHT_PROGBITS, SHF_ALLOC|SHF_WRITE);
+	assect(".bss", SHT_NOBITS, SHF_ALLOC|SHF_WRITE);
+
+	rv = asbad = 0;
+	for (s = buf; *s && rv == 0; s = e) {
+		e = asend(s);
+		if (*e == '#')
+			while (*e && *e != '\n')
+				*e++ = 0;
+		c = *e;
+		*e = 0;
+		rv = asstmt(s) | asbad;
+		if (c)
+			e++;
+	}
+	free(buf);
+	if (rv == 0)
+		rv = asfinish();
+	if (rv == 0)
+		rv = aswrite(out);
+	ascleanup();
+	return rv;
+}
+
+#endif
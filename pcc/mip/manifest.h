@@ -174,8 +174,11 @@
  */
 extern int gflag, kflag, pflag;
 extern int sspflag;
-extern int xscp, xssa, xtailcall, xtemps, xdeljumps, xdce;
+extern int xscp, xssa, xtailcall, xtemps, xdeljumps, xdce, xgvn, xlicm, xivsr;
+extern int xlinearscan, xpeep, xsched, xlayout, xvect;
+extern int xp2jobs;
 extern int xuchar;
+extern int ztime;
 
 int yyparse(void);
 void yyaccpt(void);
@@ -315,6 +318,9 @@ enum {
 	ATTR_NONE,
 	ATTR_FP_SWAPPED,
 	ATTR_STKADJ,
+	ATTR_BPROB,	/* CBRANCH: probability that it is taken */
+	ATTR_NORET,	/* CALL: function does not return */
+	ATTR_VECTOR,	/* vector type: size in bytes, element type */
 #ifdef GCC_COMPAT
 	GCC_ATYP_STDCALL,
 	GCC_ATYP_CDECL,
@@ -325,6 +331,13 @@ enum {
 	ATTR_MI_MAX
 };
 
+/*
+ * Branch probabilities, in percent.
+ */
+#define	PROB_MAX	100
+#define	PROB_LIKELY	90	/* __builtin_expect() */
+#define	PROB_UNLIKELY	(PROB_MAX-PROB_LIKELY)
+
 struct attr *attr_add(struct attr *orig, struct attr *new);
 struct attr *attr_new(int, int);
 struct attr *attr_find(struct attr *, int);
@@ -356,6 +369,34 @@ void *xrealloc(void *p, int size);
 void *xcalloc(int a, int b);
 void *xstrdup(char *s);
 
+/* compile time profiling (-Ztime), see common.c */
+enum {
+	TM_PARSE,	/* pass1, except what is below */
+	TM_OPTIM,	/* optim() */
+	TM_INLINE,	/* inline expansion */
+	TM_PASS2,	/* pass2, except what is below */
+	TM_DELJUMPS,
+	TM_LAYOUT,
+	TM_CFG,		/* basic blocks, cfg, dominators, loops */
+	TM_SSA,		/* ssa building and removal */
+	TM_SCCP,
+	TM_GVN,
+	TM_IVSR,
+	TM_LICM,
+	TM_VECT,
+	TM_GENINSN,	/* instruction selection */
+	TM_RABUILD,	/* interference graph */
+	TM_RACOLOR,	/* simplify, coalesce, select */
+	TM_RASPILL,	/* rewrite after spill */
+	TM_EMIT,
+	TM_PEEP,	/* peephole and scheduling */
+	TM_MAX
+};
+void tmenter(int phase);
+void tmleave(void);
+void tmfunc(char *name);
+void tmreport(void);
+
 int getlab(void);
 
 /* command-line processing */
@@ -368,6 +409,7 @@ void topt_compile(struct interpass *);
 
 /* pass 2 communication subroutines */
 void pass2_compile(struct interpass *);
+int p2labels(struct interpass *);
 
 /* node routines */
 NODE *nfree(NODE *);
@@ -330,11 +330,65 @@ ttype(TWORD t, int tword)
 		return( tword & TDOUBLE );
 	case LDOUBLE:
 		return( tword & TLDOUBLE );
+	case XTYPE:
+		return( tword & TXTYPE );
 	}
 
 	return(0);
 }
 
+/*
+ * Cache of the table entries for an op that matches given node types.
+ * The shapes depend on the actual nodes, but the types are only
+ * checked against the table, so the filtered lists can be reused.
+ * With QRONLY set only the right type is checked.
+ */
+#define	QCSZ	256
+#define	QRONLY	1
+static struct qcache {
+	struct qcache *next;
+	TWORD lt, rt;
+	int op, how;
+	int *ixp;
+} *qcache[QCSZ];
+
+static int *
+qtypes(int op, TWORD lt, TWORD rt, int how)
+{
+	extern int *qtable[];
+	struct qcache *qc;
+	struct optab *q;
+	int *ixp, i, n, h;
+
+	h = (int)((op + lt * 3 + rt * 5 + how) & (QCSZ-1));
+	for (qc = qcache[h]; qc; qc = qc->next)
+		if (qc->op == op && qc->lt == lt && qc->rt == rt &&
+		    qc->how == how)
+			return qc->ixp;
+
+	ixp = qtable[op];
+	for (n = 0; ixp[n] >= 0; n++)
+		;
+	qc = permalloc(sizeof(struct qcache));
+	qc->ixp = permalloc((n+1) * sizeof(int));
+	for (i = n = 0; ixp[i] >= 0; i++) {
+		q = &table[ixp[i]];
+		if ((how & QRONLY) == 0 && ttype(lt, q->ltype) == 0)
+			continue;
+		if (ttype(rt, q->rtype) == 0)
+			continue;
+		qc->ixp[n++] = ixp[i];
+	}
+	qc->ixp[n] = -1;
+	qc->op = op;
+	qc->lt = lt;
+	qc->rt = rt;
+	qc->how = how;
+	qc->next = qcache[h];
+	qcache[h] = qc;
+	return qc->ixp;
+}
+
 #define FLDSZ(x)	UPKFSZ(x)
 #if TARGET_ENDIAN == TARGET_LE
 #define	FLDSHF(x)	UPKFOFF(x)
@@ -378,13 +432,13 @@ expand(NODE *p, int cookie, char *cp)
 		case 'S':  /* field size */
 			if (fldexpand(p, cookie, &cp))
 				continue;
-			printf("%d", FLDSZ(p->n_rval));
+			oputd(stdout, FLDSZ(p->n_rval));
 			continue;
 
 		case 'H':  /* field shift */
 			if (fldexpand(p, cookie, &cp))
 				continue;
-			printf("%d", FLDSHF(p->n_rval));
+			oputd(stdout, FLDSHF(p->n_rval));
 			continue;
 
 		case 'M':  /* field mask */
@@ -400,9 +454,9 @@ expand(NODE *p, int cookie, char *cp)
 
 		case 'L':  /* output special label field */
 			if (*++cp == 'C')
-				printf(LABFMT, p->n_label);
+				oputlab(stdout, p->n_label);
 			else
-				printf(LABFMT, (int)getlval(getlr(p,*cp)));
+				oputlab(stdout, (int)getlval(getlr(p,*cp)));
 			continue;
 
 		case 'O':  /* opcode string */
@@ -417,7 +471,7 @@ expand(NODE *p, int cookie, char *cp)
 		case 'B':  /* byte offset in word */
 			val = getlval(getlr(p,*++cp));
 			val = BYTEOFF(val);
-			printf( CONFMT, val );
+			oputcon(stdout, val);
 			continue;
 
 		case 'C': /* for constant value only */
@@ -636,7 +690,6 @@ hasneed2(char *w, int need, int need2)
 int
 findops(NODE *p, int cookie)
 {
-	extern int *qtable[];
 	struct optab *q, *qq = NULL;
 	int i, shl, shr, *ixp, sh;
 	int lvl = 10, idx = 0, gol = 0, gor = 0;
@@ -645,9 +698,9 @@ findops(NODE *p, int cookie)
 	F2DEBUG(("findops node %p (%s)\n", p, prcook(cookie)));
 	F2WALK(p);
 
-	ixp = qtable[p->n_op];
 	l = getlr(p, 'L');
 	r = getlr(p, 'R');
+	ixp = qtypes(p->n_op, l->n_type, r->n_type, 0);
 	for (i = 0; ixp[i] >= 0; i++) {
 		q = &table[ixp[i]];
 
@@ -655,10 +708,6 @@ findops(NODE *p, int cookie)
 		if (!acceptable(q))		/* target-dependent filter */
 			continue;
 
-		if (ttype(l->n_type, q->ltype) == 0 ||
-		    ttype(r->n_type, q->rtype) == 0)
-			continue; /* Types must be correct */
-
 		if ((cookie & q->visit) == 0)
 			continue; /* must get a result */
 
@@ -747,7 +796,6 @@ findops(NODE *p, int cookie)
 int
 relops(NODE *p)
 {
-	extern int *qtable[];
 	struct optab *q;
 	int i, shl = 0, shr = 0, sh;
 	NODE *l, *r;
@@ -759,7 +807,7 @@ relops(NODE *p)
 
 	l = getlr(p, 'L');
 	r = getlr(p, 'R');
-	ixp = qtable[p->n_op];
+	ixp = qtypes(p->n_op, l->n_type, r->n_type, 0);
 	for (i = 0; ixp[i] >= 0; i++) {
 		q = &table[ixp[i]];
 
@@ -767,10 +815,6 @@ relops(NODE *p)
 		if (!acceptable(q))		/* target-dependent filter */
 			continue;
 
-		if (ttype(l->n_type, q->ltype) == 0 ||
-		    ttype(r->n_type, q->rtype) == 0)
-			continue; /* Types must be correct */
-
 		F2DEBUG(("relops got types\n"));
 		if ((shl = chcheck(l, n2osh(q->lshape), 0)) == SRNOPE)
 			continue;
@@ -834,7 +878,6 @@ relops(NODE *p)
 int
 findasg(NODE *p, int cookie)
 {
-	extern int *qtable[];
 	struct optab *q;
 	int i, sh, shl, shr, lvl = 10;
 	NODE *l, *r;
@@ -847,9 +890,9 @@ findasg(NODE *p, int cookie)
 	F2DEBUG(("findasg tree: %s\n", prcook(cookie)));
 	F2WALK(p);
 
-	ixp = qtable[p->n_op];
 	l = getlr(p, 'L');
 	r = getlr(p, 'R');
+	ixp = qtypes(p->n_op, l->n_type, r->n_type, 0);
 	for (i = 0; ixp[i] >= 0; i++) {
 		q = &table[ixp[i]];
 
@@ -857,10 +900,6 @@ findasg(NODE *p, int cookie)
 		if (!acceptable(q))		/* target-dependent filter */
 			continue;
 
-		if (ttype(l->n_type, q->ltype) == 0 ||
-		    ttype(r->n_type, q->rtype) == 0)
-			continue; /* Types must be correct */
-
 		if ((cookie & q->visit) == 0)
 			continue; /* must get a result */
 
@@ -959,7 +998,6 @@ findasg(NODE *p, int cookie)
 int
 findumul(NODE *p, int cookie)
 {
-	extern int *qtable[];
 	struct optab *q = NULL; /* XXX gcc */
 	int i, shl = 0, shr = 0, sh;
 	int *ixp;
@@ -967,7 +1005,7 @@ findumul(NODE *p, int cookie)
 	F2DEBUG(("findumul p %p (%s)\n", p, prcook(cookie)));
 	F2WALK(p);
 
-	ixp = qtable[p->n_op];
+	ixp = qtypes(p->n_op, 0, p->n_type, QRONLY);
 	for (i = 0; ixp[i] >= 0; i++) {
 		q = &table[ixp[i]];
 
@@ -978,10 +1016,6 @@ findumul(NODE *p, int cookie)
 		if ((q->visit & cookie) == 0)
 			continue; /* wrong registers */
 
-		if (ttype(p->n_type, q->rtype) == 0)
-			continue; /* Types must be correct */
-		
-
 		F2DEBUG(("findumul got types, rshape %s\n", prcook(n2osh(q->rshape))));
 		/*
 		 * Try to create an OREG of the node.
@@ -1025,7 +1059,6 @@ findumul(NODE *p, int cookie)
 int
 findleaf(NODE *p, int cookie)
 {
-	extern int *qtable[];
 	struct optab *q = NULL; /* XXX gcc */
 	int i, sh;
 	int *ixp;
@@ -1033,7 +1066,7 @@ findleaf(NODE *p, int cookie)
 	F2DEBUG(("findleaf p %p (%s)\n", p, prcook(cookie)));
 	F2WALK(p);
 
-	ixp = qtable[p->n_op];
+	ixp = qtypes(p->n_op, p->n_type, p->n_type, 0);
 	for (i = 0; ixp[i] >= 0; i++) {
 		q = &table[ixp[i]];
 
@@ -1043,10 +1076,6 @@ findleaf(NODE *p, int cookie)
 		if ((q->visit & cookie) == 0)
 			continue; /* wrong registers */
 
-		if (ttype(p->n_type, q->rtype) == 0 ||
-		    ttype(p->n_type, q->ltype) == 0)
-			continue; /* Types must be correct */
-
 		F2DEBUG(("findleaf got types, rshape %s\n", prcook(n2osh(q->rshape))));
 
 		if (chcheck(p, n2osh(q->rshape), 0) != SRDIR)
@@ -1081,7 +1110,6 @@ findleaf(NODE *p, int cookie)
 int
 finduni(NODE *p, int cookie)
 {
-	extern int *qtable[];
 	struct optab *q;
 	NODE *l, *r;
 	int i, shl = 0, num = 4;
@@ -1096,7 +1124,7 @@ finduni(NODE *p, int cookie)
 		r = p;
 	else
 		r = getlr(p, 'R');
-	ixp = qtable[p->n_op];
+	ixp = qtypes(p->n_op, l->n_type, r->n_type, 0);
 	for (i = 0; ixp[i] >= 0; i++) {
 		q = &table[ixp[i]];
 
@@ -1104,13 +1132,6 @@ finduni(NODE *p, int cookie)
 		if (!acceptable(q))		/* target-dependent filter */
 			continue;
 
-		if (ttype(l->n_type, q->ltype) == 0)
-			continue; /* Type must be correct */
-
-		F2DEBUG(("finduni got left type\n"));
-		if (ttype(r->n_type, q->rtype) == 0)
-			continue; /* Type must be correct */
-
 		F2DEBUG(("finduni got types\n"));
 		if ((shl = chcheck(l, n2osh(q->lshape), q->rewrite & RLEFT)) == SRNOPE)
 			continue;
@@ -1181,7 +1202,6 @@ finduni(NODE *p, int cookie)
 int
 findmops(NODE *p, int cookie)
 {
-	extern int *qtable[];
 	struct optab *q;
 	int i, sh, shl, shr, lvl = 10;
 	NODE *l, *r;
@@ -1204,8 +1224,8 @@ findmops(NODE *p, int cookie)
 	F2DEBUG(("findmops is useable\n"));
 
 	/* We can try to find a match.  Use right op */
-	ixp = qtable[r->n_op];
 	l = getlr(r, 'L');
+	ixp = qtypes(r->n_op, l->n_type, getlr(r, 'R')->n_type, 0);
 	r = getlr(r, 'R');
 
 	for (i = 0; ixp[i] >= 0; i++) {
@@ -1215,10 +1235,6 @@ findmops(NODE *p, int cookie)
 		if (!acceptable(q))		/* target-dependent filter */
 			continue;
 
-		if (ttype(l->n_type, q->ltype) == 0 ||
-		    ttype(r->n_type, q->rtype) == 0)
-			continue; /* Types must be correct */
-
 		F2DEBUG(("findmops got types\n"));
 
 		switch (cookie) {
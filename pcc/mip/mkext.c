@@ -260,6 +260,13 @@ printf("reg %d rstatus 0x%x %s\n", i, rstatus[i],
 	}
 	
 	
+	/* let pass1 know if prefetch is worth building */
+	for (q = table; q->op != FREE; q++)
+		if (q->op == PREFETCH) {
+			fprintf(fh, "#define HAS_PREFETCH\n");
+			break;
+		}
+
 	/* Sanity-check the table */
 	rval = 0;
 	for (q = table; q->op != FREE; q++) {
@@ -223,6 +223,21 @@ typedef struct node {
 #define	FUNARG	57
 #define	ADDROF	58
 
-#define	MAXOP	58
+/*
+ * Bit counting, only made for targets that ask for them.
+ * CLZ and CTZ of 0 are undefined.
+ */
+#define	POPCNT	59
+#define	CLZ	60
+#define	CTZ	61
+
+/*
+ * Prefetch of the memory in n_left.  n_rval is the locality (0-3),
+ * or'ed with PF_WRITE if the line is to be written.
+ */
+#define	PREFETCH 62
+#define	PF_WRITE 4
+
+#define	MAXOP	62
 
 #endif
@@ -75,8 +75,12 @@ void findTemps(struct interpass *ip);
 void placePhiFunctions(struct p2env *);
 void renamevar(struct p2env *p2e,struct basicblock *bblock);
 void removephi(struct p2env *p2e);
-void simple_cp(struct p2env *p2e);
-void remunreach(struct p2env *);
+static void sccp(struct p2env *);
+static void loopopt(struct p2env *);
+static void ivsr(struct p2env *);
+#ifdef VECOP
+static void vectorize(struct p2env *);
+#endif
 static void liveanal(struct p2env *p2e);
 static void printip2(struct interpass *);
 
@@ -87,9 +91,11 @@ static void add_labels(struct p2env*) ;
 /* Perform trace scheduling, try to get rid of gotos as much as possible */
 void TraceSchedule(struct p2env*) ;
 
-#ifdef ENABLE_NEW
-static void do_cse(struct p2env* p2e) ;
-#endif
+static void do_cse(struct p2env *);
+static void layout(struct p2env *);
+static int cbrneg(NODE *, int);
+static int isbranch(struct interpass *);
+static void bbdeljumps(struct p2env *);
 
 /* Walk the complete set, performing a function on each node. 
  * if type is given, apply function on only that type */
@@ -114,15 +120,28 @@ optimize(struct p2env *p2e)
 		printip(ipole);
 	}
 
-	if (xdeljumps)
+	if (xdeljumps) {
+		tmenter(TM_DELJUMPS);
 		deljumps(p2e); /* Delete redundant jumps and dead code */
+		tmleave();
+	}
+
+	if (xlayout) {
+		tmenter(TM_LAYOUT);
+		layout(p2e); /* Move unlikely code out of the way */
+		tmleave();
+	}
 
 	if (xssa)
 		add_labels(p2e) ;
-#ifdef ENABLE_NEW
-	do_cse(p2e);
+#ifdef VECOP
+	if (xvect && xtemps) {
+		BDEBUG(("Calling vectorize\n"));
+		tmenter(TM_VECT);
+		vectorize(p2e);
+		tmleave();
+	}
 #endif
-
 #ifdef PCC_DEBUG
 	if (b2debug) {
 		printf("links after deljumps\n");
@@ -130,15 +149,18 @@ optimize(struct p2env *p2e)
 	}
 #endif
 	if (xssa || xtemps) {
+		tmenter(TM_CFG);
 		bblocks_build(p2e);
 		BDEBUG(("Calling cfg_build\n"));
 		cfg_build(p2e);
+		tmleave();
 	
 #ifdef PCC_DEBUG
 		printflowdiagram(p2e, "first");
 #endif
 	}
 	if (xssa) {
+		tmenter(TM_CFG);
 		BDEBUG(("Calling liveanal\n"));
 		liveanal(p2e);
 		BDEBUG(("Calling dominators\n"));
@@ -151,12 +173,36 @@ optimize(struct p2env *p2e)
 		}
 
 		BDEBUG(("Calling placePhiFunctions\n"));
+		tmleave();
+		tmenter(TM_SSA);
 
 		placePhiFunctions(p2e);
 
 		BDEBUG(("Calling renamevar\n"));
 
 		renamevar(p2e,DLIST_NEXT(&p2e->bblocks, bbelem));
+		tmleave();
+
+		if (xscp) {
+			BDEBUG(("Calling sccp\n"));
+			tmenter(TM_SCCP);
+			sccp(p2e);
+			tmleave();
+		}
+
+		if (xgvn) {
+			BDEBUG(("Calling do_cse\n"));
+			tmenter(TM_GVN);
+			do_cse(p2e);
+			tmleave();
+		}
+
+		if (xivsr) {
+			BDEBUG(("Calling ivsr\n"));
+			tmenter(TM_IVSR);
+			ivsr(p2e);
+			tmleave();
+		}
 
 		BDEBUG(("Calling removephi\n"));
 
@@ -164,22 +210,18 @@ optimize(struct p2env *p2e)
 		printflowdiagram(p2e, "ssa");
 #endif
 
+		tmenter(TM_SSA);
 		removephi(p2e);
+		tmleave();
 
-		/* Simple constant propagation */
-		if (xscp)
-			simple_cp(p2e);
-
-		BDEBUG(("Calling remunreach\n"));
-/*		remunreach(p2e); */
-		
-		/*
-		 * Recalculate basic blocks and cfg that was destroyed
-		 * by removephi
-		 */
-		/* first, clean up all what deljumps should have done, and more */
+		if (xlicm) {
+			BDEBUG(("Calling loopopt\n"));
+			tmenter(TM_LICM);
+			loopopt(p2e);
+			tmleave();
+		}
 
-		/* TODO: add the basic blocks done by the ssa code by hand. 
+		/* TODO:
 		 * The trace scheduler should not change the order in
 		 * which blocks are executed or what data is calculated.
 		 * Thus, the BBlock order should remain correct.
@@ -202,13 +244,16 @@ optimize(struct p2env *p2e)
 #endif
 #endif
 
-		/* Now, clean up the gotos we do not need any longer */
-		if (xdeljumps)
-			deljumps(p2e); /* Delete redundant jumps and dead code */
-
-		bblocks_build(p2e);
-		BDEBUG(("Calling cfg_build\n"));
-		cfg_build(p2e);
+		/*
+		 * Now, clean up the gotos we do not need any longer.
+		 * removephi and bbdeljumps keep the basic blocks and
+		 * the cfg up to date, so they need not be rebuilt.
+		 */
+		if (xdeljumps) {
+			tmenter(TM_DELJUMPS);
+			bbdeljumps(p2e); /* Delete redundant jumps and dead code */
+			tmleave();
+		}
 
 #ifdef PCC_DEBUG
 		printflowdiagram(p2e, "no_phi");
@@ -219,6 +264,13 @@ optimize(struct p2env *p2e)
 		}
 #endif
 	}
+	if (xtemps) {
+		/* loop nesting is used for spill costs */
+		tmenter(TM_CFG);
+		dominators(p2e);
+		findloops(p2e);
+		tmleave();
+	}
 	myoptim(ipole);
 }
 
@@ -565,7 +617,6 @@ static void
 iterate(struct p2env *p2e, struct dlnod *dl)
 {
 	struct dlnod *p, *rp, *p1;
-	extern int negrel[];
 	extern size_t negrelsize;
 	int i;
 
@@ -609,7 +660,7 @@ iterate(struct p2env *p2e, struct dlnod *dl)
 				i = p->dlip->ip_node->n_left->n_op;
 				if (i < EQ || i - EQ >= (int)negrelsize)
 					comperr("deljumps: unexpected op");
-				p->dlip->ip_node->n_left->n_op = negrel[i - EQ];
+				cbrneg(p->dlip->ip_node, 0);
 				nchange++;
 			}
 		}
@@ -671,6 +722,343 @@ deljumps(struct p2env *p2e)
 	markfree(&mark);
 }
 
+/*
+ * Negate the condition of CBRANCH p, and its probability.  Return 0
+ * if it cannot be done; with nofp floating point compares are left
+ * alone, since they are not simply reversed if unordered.
+ */
+static int
+cbrneg(NODE *p, int nofp)
+{
+	extern int negrel[];
+	extern size_t negrelsize;
+	struct attr *ap;
+	TWORD t;
+	int o, prob;
+
+	o = p->n_left->n_op;
+	if (o < EQ || o - EQ >= (int)negrelsize)
+		return 0;
+	t = p->n_left->n_left->n_type;
+	if (nofp && (t == FLOAT || t == DOUBLE || t == LDOUBLE))
+		return 0;
+	p->n_left->n_op = negrel[o - EQ];
+	if ((ap = attr_find(p->n_ap, ATTR_BPROB)) != NULL) {
+		/* may be shared with a copy; make a new one */
+		prob = ap->iarg(0);
+		ap = attr_new(ATTR_BPROB, 1);
+		ap->iarg(0) = PROB_MAX - prob;
+		p->n_ap = attr_add(p->n_ap, ap);
+	}
+	return 1;
+}
+
+/*
+ * Block layout (-xlayout).
+ *
+ * Code that is unlikely to run is moved to the end of the function,
+ * before the return label, so that the likely path of a branch falls
+ * through and the code that runs is kept together.  The probability
+ * of a branch comes from __builtin_expect() through ATTR_BPROB;
+ * without it, straight code calling a function that does not return
+ * is taken as unlikely.  Loops with their test at the top get it
+ * moved to the bottom instead, where it branches back to the loop
+ * body, so that an iteration takes one branch instead of two.
+ *
+ * Runs on the statement list before the basic blocks are built.
+ */
+
+#define	PROBCOLD	(PROB_MAX/5)	/* taken at most this often is cold */
+
+static struct interpass *lyfirst;	/* start of the code */
+static struct interpass *lyret;		/* return label */
+static struct interpass *lycold;	/* first moved statement */
+static char *lyseen;			/* labels already passed */
+static int lylow, lyhigh;
+
+static int
+lyisgoto(struct interpass *ip)
+{
+	return ip->type == IP_NODE && ip->ip_node->n_op == GOTO;
+}
+
+static struct interpass *
+lymkgoto(int lbl, int line)
+{
+	struct interpass *ip;
+
+	ip = ipnode(mkunode(GOTO, mklnode(ICON, lbl, 0, INT), 0, INT));
+	ip->lineno = line;
+	return ip;
+}
+
+static struct interpass *
+lymklab(int lbl, int line)
+{
+	struct interpass *ip = tmpalloc(sizeof(struct interpass));
+
+	ip->type = IP_DEFLAB;
+	ip->lineno = line;
+	ip->ip_lbl = lbl;
+	return ip;
+}
+
+/*
+ * Does any call in p not return?
+ */
+static int
+lynoret(NODE *p)
+{
+	int o = optype(p->n_op);
+
+	if (callop(p->n_op) && attr_find(p->n_ap, ATTR_NORET))
+		return 1;
+	if (o == LTYPE)
+		return 0;
+	if (o == BITYPE && lynoret(p->n_right))
+		return 1;
+	return lynoret(p->n_left);
+}
+
+/*
+ * Is the code from ip up to end cold, because it calls a function
+ * that does not return before any branch?
+ */
+static int
+lycoldat(struct interpass *ip, struct interpass *end)
+{
+	for (; ip != end; ip = DLIST_NEXT(ip, qelem)) {
+		if (ip->type == IP_DEFLAB)
+			continue;
+		if (ip->type != IP_NODE || isbranch(ip))
+			return 0;
+		if (lynoret(ip->ip_node))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Search from ip for the labels before the cold code, for lbl or,
+ * if lbl is 0, any label.  Return the first label of the run it is
+ * in, or NULL if not found or anything but code is in the way.
+ */
+static struct interpass *
+lyfind(struct interpass *ip, int lbl)
+{
+	struct interpass *l;
+
+	for (; ip != lycold; ip = DLIST_NEXT(ip, qelem)) {
+		if (ip->type == IP_NODE)
+			continue;
+		if (ip->type != IP_DEFLAB)
+			return NULL;
+		if (lbl == 0)
+			return ip;
+		for (l = ip; l != lycold && l->type == IP_DEFLAB;
+		    l = DLIST_NEXT(l, qelem))
+			if (l->ip_lbl == lbl)
+				return ip;
+	}
+	return NULL;
+}
+
+/*
+ * Is ip a jump to the labels that follow it?
+ */
+static int
+lyjumpnext(struct interpass *ip)
+{
+	struct interpass *l;
+	int lbl;
+
+	if (!lyisgoto(ip) || ip->ip_node->n_left->n_op != ICON)
+		return 0;
+	lbl = (int)getlval(ip->ip_node->n_left);
+	for (l = DLIST_NEXT(ip, qelem); l->type == IP_DEFLAB;
+	    l = DLIST_NEXT(l, qelem))
+		if (l->ip_lbl == lbl)
+			return 1;
+	return 0;
+}
+
+/*
+ * Move the statements from first up to end to the cold code, after
+ * a new label lbl if not 0, and continue at label next.
+ */
+static void
+lymove(struct interpass *first, struct interpass *end, int lbl, int next)
+{
+	struct interpass *ip, *nip;
+
+	ip = DLIST_PREV(lyret, qelem);
+	if (!lyisgoto(ip)) {
+		ip = lymkgoto(lyret->ip_lbl, ip->lineno);
+		DLIST_INSERT_BEFORE(lyret, ip, qelem);
+	}
+	if (lbl) {
+		ip = lymklab(lbl, first->lineno);
+		DLIST_INSERT_BEFORE(lyret, ip, qelem);
+		if (lycold == lyret)
+			lycold = ip;
+	}
+	for (ip = first; ip != end; ip = nip) {
+		nip = DLIST_NEXT(ip, qelem);
+		DLIST_REMOVE(ip, qelem);
+		DLIST_INSERT_BEFORE(lyret, ip, qelem);
+		if (lycold == lyret)
+			lycold = ip;
+	}
+	ip = DLIST_PREV(lyret, qelem);
+	if (!lyisgoto(ip)) {
+		ip = lymkgoto(next, ip->lineno);
+		DLIST_INSERT_BEFORE(lyret, ip, qelem);
+	}
+}
+
+/*
+ * ip is the test at the top of a loop, branching out of it to the
+ * labels at t.  If the loop ends with a jump back to the labels just
+ * before ip, move the test there and let it branch back to the body.
+ * Return the new label before the body, or NULL.
+ */
+static struct interpass *
+lyrotate(struct interpass *ip, struct interpass *t)
+{
+	struct interpass *h, *g, *b, *q, *nq;
+	int lbl;
+
+	for (h = ip; (q = DLIST_PREV(h, qelem)) != lyfirst &&
+	    q->type == IP_DEFLAB; h = q)
+		;
+	g = DLIST_PREV(t, qelem);
+	if (h == ip || g == ip || !lyisgoto(g) ||
+	    g->ip_node->n_left->n_op != ICON)
+		return NULL;
+	lbl = (int)getlval(g->ip_node->n_left);
+	for (q = h; q != ip && q->ip_lbl != lbl; q = DLIST_NEXT(q, qelem))
+		;
+	if (q == ip || cbrneg(ip->ip_node, 1) == 0)
+		return NULL;
+
+	b = lymklab(getlab2(), ip->lineno);
+	setlval(ip->ip_node->n_right, b->ip_lbl);
+	DLIST_REMOVE(g, qelem);
+	DLIST_INSERT_BEFORE(h, g, qelem);
+	DLIST_INSERT_BEFORE(h, b, qelem);
+	for (q = h; ; q = nq) {
+		nq = DLIST_NEXT(q, qelem);
+		DLIST_REMOVE(q, qelem);
+		DLIST_INSERT_BEFORE(t, q, qelem);
+		if (q == ip)
+			break;
+	}
+	return b;
+}
+
+static void
+layout(struct p2env *p2e)
+{
+	struct interpass *ipole = &p2e->ipole;
+	struct interpass *ip, *next, *t, *e, *f, *g;
+	struct attr *ap;
+	NODE *p;
+	int n, lbl, prob;
+
+	lylow = p2e->ipp->ip_lblnum;
+	lyhigh = p2e->epp->ip_lblnum;
+	lyseen = tmpcalloc(lyhigh - lylow + 1);
+	lyfirst = lyret = NULL;
+	n = 0;
+	DLIST_FOREACH(ip, ipole, qelem) {
+		if (ip->type != IP_DEFLAB)
+			continue;
+		if (++n == 2)
+			lyfirst = ip;
+		if (ip->ip_lbl == p2e->epp->ipp_ip.ip_lbl)
+			lyret = ip;
+	}
+	if (lyfirst == NULL || lyret == NULL)
+		return;
+	lycold = lyret;
+
+	for (ip = DLIST_NEXT(lyfirst, qelem); ip != lycold; ip = next) {
+		next = DLIST_NEXT(ip, qelem);
+		if (ip->type == IP_DEFLAB) {
+			if (ip->ip_lbl >= lylow && ip->ip_lbl < lyhigh)
+				lyseen[ip->ip_lbl - lylow] = 1;
+			continue;
+		}
+		if (ip->type != IP_NODE || (p = ip->ip_node)->n_op != CBRANCH)
+			continue;
+		lbl = (int)getlval(p->n_right);
+		if (lbl < lylow || lbl >= lyhigh || lyseen[lbl - lylow])
+			continue; /* backward, likely taken */
+		if (lbl == lyret->ip_lbl) {
+			/* returns; is the code after it the last? */
+			for (t = next; t != lycold && (t->type == IP_NODE ||
+			    t->type == IP_DEFLAB); t = DLIST_NEXT(t, qelem))
+				;
+			ap = attr_find(p->n_ap, ATTR_BPROB);
+			if (t == lycold && next != lycold && (ap ?
+			    ap->iarg(0) >= PROB_MAX - PROBCOLD :
+			    lycoldat(next, lycold))) {
+				lycold = next; /* then it is cold already */
+				continue;
+			}
+		}
+		if ((t = lyfind(next, lbl)) == NULL)
+			continue;
+
+		if ((ap = attr_find(p->n_ap, ATTR_BPROB)) != NULL)
+			prob = ap->iarg(0);
+		else if (lycoldat(next, t))
+			prob = PROB_MAX;
+		else if (lycoldat(t, lycold))
+			prob = 0;
+		else
+			prob = -1;
+
+		if (prob >= PROB_MAX - PROBCOLD) {
+			/* the code after the branch is cold */
+			if (t == next || cbrneg(p, 1) == 0)
+				continue;
+			n = getlab2();
+			setlval(p->n_right, n);
+			lymove(next, t, n, lbl);
+			next = t;
+		} else if (prob <= PROB_MAX/2 && (g = lyrotate(ip, t))) {
+			if (g->ip_lbl < lyhigh)
+				lyseen[g->ip_lbl - lylow] = 1;
+			next = DLIST_NEXT(g, qelem);
+		} else if (prob >= 0 && prob <= PROBCOLD) {
+			/*
+			 * The code at the label is cold.  Nothing must
+			 * fall into it, and it ends where the jump before
+			 * it goes, or at the next label.
+			 */
+			g = DLIST_PREV(t, qelem);
+			if (!lyisgoto(g))
+				continue;
+			for (e = t; e != lycold && e->type == IP_DEFLAB;
+			    e = DLIST_NEXT(e, qelem))
+				;
+			if (e == lycold)
+				continue;
+			n = g->ip_node->n_left->n_op == ICON ?
+			    (int)getlval(g->ip_node->n_left) : 0;
+			if ((n == 0 || (f = lyfind(e, n)) == NULL) &&
+			    (f = lyfind(e, 0)) == NULL)
+				continue;
+			lymove(t, f, 0, f->ip_lbl);
+			if (lyjumpnext(g)) {
+				DLIST_REMOVE(g, qelem);
+				tfree(g->ip_node);
+			}
+		}
+	}
+}
+
 void
 optdump(struct interpass *ip)
 {
@@ -699,6 +1087,23 @@ optdump(struct interpass *ip)
  * that contain which label.
  */
 
+/*
+ * Allocate a new basic block that begins with ip.
+ */
+static struct basicblock *
+bb_alloc(struct p2env *p2e, struct interpass *ip)
+{
+	struct basicblock *bb;
+
+	bb = tmpcalloc(sizeof(struct basicblock));
+	bb->first = bb->last = ip;
+	SLIST_INIT(&bb->parents);
+	SLIST_INIT(&bb->child);
+	SLIST_INIT(&bb->phi);
+	bb->bbnum = p2e->nbblocks++;
+	return bb;
+}
+
 void
 bblocks_build(struct p2env *p2e)
 {
@@ -706,7 +1111,6 @@ bblocks_build(struct p2env *p2e)
 	struct interpass *ip;
 	struct basicblock *bb = NULL;
 	int low, high;
-	int count = 0;
 	int i;
 
 	BDEBUG(("bblocks_build (%p, %p)\n", &p2e->labinfo, &p2e->bbinfo));
@@ -719,28 +1123,12 @@ bblocks_build(struct p2env *p2e)
 	 * Any statement that immediately follows a jump is a leader.
 	 */
 	DLIST_INIT(&p2e->bblocks, bbelem);
+	p2e->nbblocks = 0;
 	DLIST_FOREACH(ip, ipole, qelem) {
 		if (bb == NULL || (ip->type == IP_EPILOG) ||
 		    (ip->type == IP_DEFLAB) || (ip->type == IP_DEFNAM)) {
-			bb = tmpalloc(sizeof(struct basicblock));
-			bb->first = ip;
-			SLIST_INIT(&bb->parents);
-			SLIST_INIT(&bb->child);
-			bb->dfnum = 0;
-			bb->dfparent = 0;
-			bb->semi = 0;
-			bb->ancestor = 0;
-			bb->idom = 0;
-			bb->samedom = 0;
-			bb->bucket = NULL;
-			bb->df = NULL;
-			bb->dfchildren = NULL;
-			bb->Aorig = NULL;
-			bb->Aphi = NULL;
-			SLIST_INIT(&bb->phi);
-			bb->bbnum = count;
+			bb = bb_alloc(p2e, ip);
 			DLIST_INSERT_BEFORE(&p2e->bblocks, bb, bbelem);
-			count++;
 		}
 		bb->last = ip;
 		if ((ip->type == IP_NODE) && (ip->ip_node->n_op == GOTO || 
@@ -749,11 +1137,10 @@ bblocks_build(struct p2env *p2e)
 		if (ip->type == IP_PROLOG)
 			bb = NULL;
 	}
-	p2e->nbblocks = count;
 
 	if (b2debug) {
 		printf("Basic blocks in func: %d, low %d, high %d\n",
-		    count, low, high);
+		    p2e->nbblocks, low, high);
 		DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
 			printf("bb(%d) %p: first %p last %p\n", bb->bbnum, bb,
 			    bb->first, bb->last);
@@ -766,12 +1153,6 @@ bblocks_build(struct p2env *p2e)
 	for (i = 0; i < p2e->labinfo.size; i++) {
 		p2e->labinfo.arr[i] = NULL;
 	}
-	
-	p2e->bbinfo.size = count + 1;
-	p2e->bbinfo.arr = tmpalloc(p2e->bbinfo.size * sizeof(struct basicblock *));
-	for (i = 0; i < p2e->bbinfo.size; i++) {
-		p2e->bbinfo.arr[i] = NULL;
-	}
 
 	/* Build the label table */
 	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
@@ -889,81 +1270,678 @@ cfg_build(struct p2env *p2e)
 	}
 }
 
-void
-cfg_dfs(struct basicblock *bb, unsigned int parent, struct bblockinfo *bbinfo)
+/*
+ * Keep the basic blocks and the cfg up to date when statements are
+ * added, deleted or moved, so that they need not be rebuilt with
+ * bblocks_build() and cfg_build() afterwards.  bb_insert_before()
+ * and bb_remove() handle ordinary statements; passes that change
+ * labels and branches update the edges with the cfg_ functions.
+ * If not optimizing there are no basic blocks to update.
+ */
+static int
+isbranch(struct interpass *ip)
 {
-	struct cfgnode *cn;
+	return ip->type == IP_NODE &&
+	    (ip->ip_node->n_op == GOTO || ip->ip_node->n_op == CBRANCH);
+}
 
-	if (bb->dfnum != 0)
-		return;
+/*
+ * Return the basic block that begins with ip, or NULL.
+ */
+static struct basicblock *
+bb_leader(struct p2env *p2e, struct interpass *ip)
+{
+	struct interpass *pip = DLIST_PREV(ip, qelem);
+	struct basicblock *bb;
+	int l;
+
+	if (ip->type == IP_DEFLAB) {
+		l = ip->ip_lbl - p2e->labinfo.low;
+		if (l >= 0 && l < p2e->labinfo.size &&
+		    (bb = p2e->labinfo.arr[l]) != NULL && bb->first == ip)
+			return bb;
+	} else if (ip->type != IP_DEFNAM && ip->type != IP_EPILOG &&
+	    pip->type != IP_PROLOG && !isbranch(pip))
+		return NULL;
+	DLIST_FOREACH(bb, &p2e->bblocks, bbelem)
+		if (bb->first == ip)
+			return bb;
+	return NULL;
+}
 
-	bb->dfnum = ++dfsnum;
-	bb->dfparent = parent;
-	bbinfo->arr[bb->dfnum] = bb;
-	SLIST_FOREACH(cn, &bb->child, chld)
-		cfg_dfs(cn->bblock, bb->dfnum, bbinfo);
-	/* Don't bring in unreachable nodes in the future */
-	bbinfo->size = dfsnum + 1;
+/*
+ * Return the basic block that contains ip.
+ */
+struct basicblock *
+bb_find(struct p2env *p2e, struct interpass *ip)
+{
+	struct basicblock *bb;
+
+	if (xtemps == 0)
+		return NULL;
+	for (; ip != &p2e->ipole; ip = DLIST_PREV(ip, qelem))
+		if ((bb = bb_leader(p2e, ip)) != NULL)
+			return bb;
+	return NULL;
 }
 
-static bittype *
-setalloc(int nelem)
+/*
+ * Insert statement ip before pos in basic block bb.
+ * If bb is NULL it is looked up.
+ */
+void
+bb_insert_before(struct p2env *p2e, struct basicblock *bb,
+    struct interpass *pos, struct interpass *ip)
 {
-	bittype *b;
-	int sz = (nelem+NUMBITS-1)/NUMBITS;
+	if (pos->type == IP_DEFLAB || pos->type == IP_EPILOG || isbranch(ip))
+		comperr("bb_insert_before");
+	if (bb == NULL && xtemps)
+		bb = bb_leader(p2e, pos);
+	DLIST_INSERT_BEFORE(pos, ip, qelem);
+	if (bb && bb->first == pos)
+		bb->first = ip;
+}
 
-	b = tmpalloc(sz * sizeof(bittype));
-	memset(b, 0, sz * sizeof(bittype));
-	return b;
+/*
+ * Remove bb from the parents of cbb.
+ */
+static void
+cfg_delparent(struct basicblock *cbb, struct basicblock *bb)
+{
+	struct cfgnode **l, *cn;
+
+	for (l = &cbb->parents.q_forw; (cn = *l); l = &cn->cfgelem.q_forw) {
+		if (cn->bblock == bb) {
+			if ((*l = cn->cfgelem.q_forw) == NULL)
+				cbb->parents.q_last = l;
+			return;
+		}
+	}
 }
 
 /*
- * Algorithm 19.9, pp 414 from Appel.
+ * Remove the edge bb -> cbb from the cfg, and its phi operands.
  */
+static void
+cfg_deledge(struct basicblock *bb, struct basicblock *cbb)
+{
+	struct cfgnode **l, **m, *cn;
+	struct phiinfo *phi;
+	int i, j;
+
+	for (l = &bb->child.q_forw; (*l)->bblock != cbb;
+	    l = &(*l)->chld.q_forw)
+		;
+	cn = *l;
+	if ((*l = cn->chld.q_forw) == NULL)
+		bb->child.q_last = l;
+
+	/* take the last one; renamevar only fills in the first duplicate */
+	m = NULL;
+	j = 0;
+	for (i = 0, l = &cbb->parents.q_forw; (cn = *l);
+	    l = &cn->cfgelem.q_forw, i++)
+		if (cn->bblock == bb)
+			m = l, j = i;
+	cn = *m;
+	if ((*m = cn->cfgelem.q_forw) == NULL)
+		cbb->parents.q_last = m;
+	SLIST_FOREACH(phi, &cbb->phi, phielem) {
+		for (i = j; i < phi->size - 1; i++)
+			phi->intmpregno[i] = phi->intmpregno[i+1];
+		phi->size--;
+	}
+}
 
-void
-dominators(struct p2env *p2e)
+/*
+ * Remove an empty basic block; its parents will fall through
+ * directly to its only child.
+ */
+static void
+bb_delete(struct basicblock *bb)
 {
-	struct cfgnode *cnode;
-	struct basicblock *bb, *y, *v;
-	struct basicblock *s, *sprime, *p;
-	int h, i;
+	struct cfgnode *cn, *pn, *nn;
+	struct basicblock *cbb;
 
-	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
-		bb->bucket = setalloc(p2e->bbinfo.size);
-		bb->df = setalloc(p2e->bbinfo.size);
-		bb->dfchildren = setalloc(p2e->bbinfo.size);
+	DLIST_REMOVE(bb, bbelem);
+	if (SLIST_ISEMPTY(&bb->child))
+		return;
+	cbb = SLIST_FIRST(&bb->child)->bblock;
+	cfg_delparent(cbb, bb);
+	SLIST_FOREACH(pn, &bb->parents, cfgelem) {
+		SLIST_FOREACH(cn, &pn->bblock->child, chld)
+			if (cn->bblock == bb)
+				cn->bblock = cbb;
+		nn = tmpalloc(sizeof(struct cfgnode));
+		nn->bblock = pn->bblock;
+		SLIST_INSERT_LAST(&cbb->parents, nn, cfgelem);
 	}
+}
 
-	dfsnum = 0;
-	cfg_dfs(DLIST_NEXT(&p2e->bblocks, bbelem), 0, &p2e->bbinfo);
+/*
+ * Remove statement ip from basic block bb.
+ * If bb is NULL it is looked up.
+ */
+void
+bb_remove(struct p2env *p2e, struct basicblock *bb, struct interpass *ip)
+{
+	if (ip->type == IP_DEFLAB || ip->type == IP_EPILOG || isbranch(ip))
+		comperr("bb_remove");
+	if (bb == NULL)
+		bb = bb_find(p2e, ip);
+	if (bb == NULL)
+		;
+	else if (ip == bb->first && ip == bb->last)
+		bb_delete(bb);
+	else if (ip == bb->first)
+		bb->first = DLIST_NEXT(ip, qelem);
+	else if (ip == bb->last)
+		bb->last = DLIST_PREV(ip, qelem);
+	DLIST_REMOVE(ip, qelem);
+}
 
-	if (b2debug) {
-		struct basicblock *bbb;
-		struct cfgnode *ccnode, *cn;
+/*
+ * Return the basic block that begins with label lbl, or NULL.
+ */
+static struct basicblock *
+bb_bylab(struct p2env *p2e, int lbl)
+{
+	int l = lbl - p2e->labinfo.low;
 
-		DLIST_FOREACH(bbb, &p2e->bblocks, bbelem) {
-			printf("Basic block %d, parents: ", bbb->dfnum);
-			SLIST_FOREACH(ccnode, &bbb->parents, cfgelem) {
-				printf("%d, ", ccnode->bblock->dfnum);
-			}
-			printf("\nChildren: ");
-			SLIST_FOREACH(cn, &bbb->child, chld)
-				printf("%d, ", cn->bblock->dfnum);
-			printf("\n");
-		}
+	if (l < 0 || l >= p2e->labinfo.size)
+		return NULL;
+	return p2e->labinfo.arr[l];
+}
+
+/*
+ * Enter label lbl that begins bb in the label table.  Labels from
+ * getlab2() may be above the table.
+ */
+static void
+bb_setlab(struct p2env *p2e, int lbl, struct basicblock *bb)
+{
+	struct basicblock **arr;
+	int l = lbl - p2e->labinfo.low;
+
+	if (l >= p2e->labinfo.size) {
+		arr = tmpcalloc((l + 16) * sizeof(struct basicblock *));
+		memcpy(arr, p2e->labinfo.arr,
+		    p2e->labinfo.size * sizeof(struct basicblock *));
+		p2e->labinfo.arr = arr;
+		p2e->labinfo.size = l + 16;
 	}
+	p2e->labinfo.arr[l] = bb;
+}
 
-	for(h = p2e->bbinfo.size - 1; h > 1; h--) {
-		bb = p2e->bbinfo.arr[h];
-		p = s = p2e->bbinfo.arr[bb->dfparent];
-		SLIST_FOREACH(cnode, &bb->parents, cfgelem) {
-			if (cnode->bblock->dfnum ==0)
-				continue; /* Ignore unreachable code */
+/*
+ * Add the edge bb -> cbb to the cfg.
+ */
+static void
+cfg_addedge(struct basicblock *bb, struct basicblock *cbb)
+{
+	struct cfgnode *cn;
 
-			if (cnode->bblock->dfnum <= bb->dfnum) 
-				sprime = cnode->bblock;
-			else 
+	cn = tmpalloc(sizeof(struct cfgnode));
+	cn->bblock = cbb;
+	SLIST_INSERT_LAST(&bb->child, cn, chld);
+	cn = tmpalloc(sizeof(struct cfgnode));
+	cn->bblock = bb;
+	SLIST_INSERT_LAST(&cbb->parents, cn, cfgelem);
+}
+
+/*
+ * Let the branch that ends bb go to label lbl of cbb instead of to obb.
+ */
+static void
+cfg_retarget(struct basicblock *bb, struct basicblock *obb,
+    struct basicblock *cbb, int lbl)
+{
+	struct cfgnode *cn;
+	NODE *p = bb->last->ip_node;
+
+	if (p->n_op == GOTO)
+		setlval(p->n_left, lbl);
+	else {
+		setlval(p->n_right, lbl);
+		p->n_left->n_label = lbl;
+	}
+	SLIST_FOREACH(cn, &bb->child, chld)
+		if (cn->bblock == obb)
+			break;
+	cn->bblock = cbb;
+	cfg_delparent(obb, bb);
+	cn = tmpalloc(sizeof(struct cfgnode));
+	cn->bblock = bb;
+	SLIST_INSERT_LAST(&cbb->parents, cn, cfgelem);
+}
+
+/*
+ * Put the new block nbb on the edge bb -> cbb.  pn is the node of bb
+ * among the parents of cbb; it is kept in place, since the phi
+ * operands are in the order of the parents.
+ */
+static void
+cfg_split(struct basicblock *bb, struct basicblock *cbb,
+    struct cfgnode *pn, struct basicblock *nbb)
+{
+	struct cfgnode *cn;
+
+	SLIST_FOREACH(cn, &bb->child, chld)
+		if (cn->bblock == cbb)
+			break;
+	cn->bblock = nbb;
+	pn->bblock = nbb;
+	cn = tmpalloc(sizeof(struct cfgnode));
+	cn->bblock = cbb;
+	SLIST_INSERT_LAST(&nbb->child, cn, chld);
+	cn = tmpalloc(sizeof(struct cfgnode));
+	cn->bblock = bb;
+	SLIST_INSERT_LAST(&nbb->parents, cn, cfgelem);
+}
+
+/*
+ * Delete basic block bb and all its statements.
+ */
+static void
+bb_free(struct p2env *p2e, struct basicblock *bb)
+{
+	struct interpass *ip, *nip;
+
+	while (!SLIST_ISEMPTY(&bb->child))
+		cfg_deledge(bb, SLIST_FIRST(&bb->child)->bblock);
+	for (ip = bb->first; ; ip = nip) {
+		nip = DLIST_NEXT(ip, qelem);
+		if (ip->type == IP_NODE)
+			tfree(ip->ip_node);
+		else if (ip->type == IP_DEFLAB)
+			p2e->labinfo.arr[ip->ip_lbl - p2e->labinfo.low] = NULL;
+		DLIST_REMOVE(ip, qelem);
+		if (ip == bb->last)
+			break;
+	}
+	DLIST_REMOVE(bb, bbelem);
+}
+
+/*
+ * Append basic block cbb to bb, which is its only parent and
+ * falls through to it.
+ */
+static void
+bb_merge(struct basicblock *bb, struct basicblock *cbb)
+{
+	struct cfgnode *cn, *pn;
+
+	cfg_deledge(bb, cbb);
+	SLIST_FOREACH(cn, &cbb->child, chld)
+		SLIST_FOREACH(pn, &cn->bblock->parents, cfgelem)
+			if (pn->bblock == cbb)
+				pn->bblock = bb;
+	bb->child = cbb->child;
+	if (SLIST_ISEMPTY(&cbb->child))
+		SLIST_INIT(&bb->child);
+	bb->last = cbb->last;
+	DLIST_REMOVE(cbb, bbelem);
+}
+
+/*
+ * deljumps() for after the basic blocks are built.  The same changes
+ * are done as on the statement list, but block by block, and the
+ * blocks and the cfg are kept up to date.  As with listsetup(), the
+ * code before the beginning of the execution code is left alone.
+ */
+static struct basicblock *bbstart;
+
+static int
+bb_fixed(struct p2env *p2e, struct basicblock *bb)
+{
+	struct basicblock *b;
+
+	if (bb->first->type == IP_EPILOG)
+		return 1;
+	DLIST_FOREACH(b, &p2e->bblocks, bbelem) {
+		if (b == bb)
+			return 1;
+		if (b == bbstart)
+			break;
+	}
+	return 0;
+}
+
+static int
+isjbr(struct interpass *ip)
+{
+	return ip->type == IP_NODE && ip->ip_node->n_op == GOTO &&
+	    ip->ip_node->n_left->n_op == ICON;
+}
+
+/*
+ * A block with only a label, that falls through to the next one.
+ */
+static int
+bb_labonly(struct basicblock *bb)
+{
+	return bb->first == bb->last && bb->first->type == IP_DEFLAB;
+}
+
+/*
+ * See if the label that begins bb is used.
+ */
+static int
+bb_labused(struct p2env *p2e, struct basicblock *bb)
+{
+	struct cfgnode *cn;
+	NODE *p;
+	int lbl = bb->first->ip_lbl;
+
+	if (inuse(p2e, lbl))
+		return 1;
+	SLIST_FOREACH(cn, &bb->parents, cfgelem) {
+		if (!isbranch(cn->bblock->last))
+			continue;
+		p = cn->bblock->last->ip_node;
+		if (p->n_op == GOTO && (p->n_left->n_op != ICON ||
+		    getlval(p->n_left) == lbl))
+			return 1;
+		if (p->n_op == CBRANCH && getlval(p->n_right) == lbl)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Remove the jump that ends bb if it goes to tbb and only labels
+ * are in between.
+ */
+static int
+bb_jumpnext(struct basicblock *bb, struct basicblock *tbb)
+{
+	struct basicblock *nbb = DLIST_NEXT(bb, bbelem);
+	struct basicblock *b;
+	struct interpass *ip = bb->last;
+
+	for (b = nbb; b != tbb; b = DLIST_NEXT(b, bbelem))
+		if (!bb_labonly(b))
+			return 0;
+	if (nbb != tbb) {
+		cfg_deledge(bb, tbb);
+		cfg_addedge(bb, nbb);
+	}
+	tfree(ip->ip_node);
+	if (ip == bb->first)
+		bb_delete(bb);
+	else
+		bb->last = DLIST_PREV(ip, qelem);
+	DLIST_REMOVE(ip, qelem);
+	return 1;
+}
+
+/*
+ * Move the blocks sbb to ebb so that they follow bb.
+ */
+static void
+bb_move(struct basicblock *bb, struct basicblock *sbb, struct basicblock *ebb)
+{
+	struct interpass *ip, *nip, *pos;
+	struct basicblock *b, *nb;
+
+	pos = bb->last;
+	for (ip = sbb->first; ; ip = nip) {
+		nip = DLIST_NEXT(ip, qelem);
+		DLIST_REMOVE(ip, qelem);
+		DLIST_INSERT_AFTER(pos, ip, qelem);
+		if (ip == ebb->last)
+			break;
+		pos = ip;
+	}
+	for (b = sbb; ; b = nb) {
+		nb = DLIST_NEXT(b, bbelem);
+		DLIST_REMOVE(b, bbelem);
+		DLIST_INSERT_AFTER(bb, b, bbelem);
+		if (b == ebb)
+			break;
+		bb = b;
+	}
+}
+
+static void
+bbdeljumps(struct p2env *p2e)
+{
+	struct basicblock *bb, *tbb, *ubb, *b, *nb;
+	struct interpass *ip, *nip;
+	NODE *p;
+	int ch, n, lbl;
+
+	n = 0;
+	DLIST_FOREACH(bbstart, &p2e->bblocks, bbelem)
+		if (bbstart->first->type == IP_DEFLAB && ++n == 2)
+			break;
+	if (bbstart == &p2e->bblocks)
+		return;
+
+	/* remove ASSIGN to self for regs */
+	for (bb = bbstart; bb != &p2e->bblocks; bb = DLIST_NEXT(bb, bbelem)) {
+		for (ip = bb->first; ; ip = nip) {
+			nip = DLIST_NEXT(ip, qelem);
+			n = ip == bb->last;
+			if (ip->type == IP_NODE && (p = ip->ip_node)->n_op ==
+			    ASSIGN && p->n_left->n_op == REG &&
+			    p->n_right->n_op == REG &&
+			    regno(p->n_left) == regno(p->n_right)) {
+				tfree(p);
+				bb_remove(p2e, bb, ip);
+			}
+			if (n)
+				break;
+		}
+	}
+
+	do {
+		ch = 0;
+		for (bb = bbstart; bb->first->type != IP_EPILOG;
+		    bb = DLIST_NEXT(bb, bbelem)) {
+			if (!bb_fixed(p2e, bb) && SLIST_ISEMPTY(&bb->parents) &&
+			    (bb->first->type != IP_DEFLAB ||
+			    !inuse(p2e, bb->first->ip_lbl))) {
+				/* Removes dead code */
+				bb_free(p2e, bb);
+				ch++;
+				continue;
+			}
+			if (!bb_fixed(p2e, bb) && bb->first->type == IP_DEFLAB &&
+			    !bb_labused(p2e, bb)) {
+				/* Removes unused labels */
+				ip = bb->first;
+				p2e->labinfo.arr[ip->ip_lbl - p2e->labinfo.low] = NULL;
+				if (ip == bb->last) {
+					bb_delete(bb);
+				} else {
+					bb->first = DLIST_NEXT(ip, qelem);
+					b = DLIST_PREV(bb, bbelem);
+					if (!isbranch(b->last) &&
+					    b->last->type != IP_PROLOG)
+						bb_merge(b, bb);
+				}
+				DLIST_REMOVE(ip, qelem);
+				ch++;
+				continue;
+			}
+
+			ip = bb->last;
+			if (!isbranch(ip) || (ip->ip_node->n_op == GOTO &&
+			    !isjbr(ip)))
+				continue;
+			p = ip->ip_node;
+			lbl = (int)getlval(p->n_op == GOTO ? p->n_left : p->n_right);
+			if ((tbb = bb_bylab(p2e, lbl)) == NULL ||
+			    bb_fixed(p2e, tbb))
+				continue;
+
+			/* Jumps to the last of several labels */
+			for (ubb = tbb; bb_labonly(ubb) &&
+			    DLIST_NEXT(ubb, bbelem)->first->type == IP_DEFLAB; )
+				ubb = DLIST_NEXT(ubb, bbelem);
+			if (ubb == tbb && tbb->first->type == IP_DEFLAB &&
+			    DLIST_NEXT(tbb->first, qelem) == tbb->last &&
+			    isjbr(tbb->last) && (n = (int)getlval(
+			    tbb->last->ip_node->n_left)) != lbl) {
+				/* Resolves:
+				 * jbr L7
+				 * ...
+				 * L7: jbr L8
+				 */
+				ubb = bb_bylab(p2e, n);
+			}
+			if (ubb != NULL && ubb != tbb) {
+				lbl = ubb->first->ip_lbl;
+				cfg_retarget(bb, tbb, ubb, lbl);
+				tbb = ubb;
+				ch++;
+				if (bb_fixed(p2e, tbb))
+					continue;
+			}
+
+			if (p->n_op == CBRANCH) {
+				/* Resolves:
+				 * cbr L7
+				 * jbr L8
+				 * L7:
+				 */
+				b = DLIST_NEXT(bb, bbelem);
+				ip = b->first;
+				if (ip != b->last || !isjbr(ip))
+					continue;
+				n = (int)getlval(ip->ip_node->n_left);
+				if ((ubb = bb_bylab(p2e, n)) == NULL)
+					continue;
+				for (nb = DLIST_NEXT(b, bbelem); nb != tbb &&
+				    bb_labonly(nb); nb = DLIST_NEXT(nb, bbelem))
+					;
+				if (nb != tbb)
+					continue;
+				if (cbrneg(p, 0) == 0)
+					comperr("deljumps: unexpected op");
+				cfg_deledge(bb, tbb);
+				cfg_deledge(bb, b);
+				cfg_deledge(b, ubb);
+				tfree(ip->ip_node);
+				DLIST_REMOVE(ip, qelem);
+				DLIST_REMOVE(b, bbelem);
+				setlval(p->n_right, n);
+				p->n_left->n_label = n;
+				cfg_addedge(bb, ubb);
+				cfg_addedge(bb, DLIST_NEXT(bb, bbelem));
+				ch++;
+				continue;
+			}
+
+			if (bb_jumpnext(bb, tbb)) {
+				ch++;
+				continue;
+			}
+
+			/*
+			 * Move the code at the label, up to the next jump,
+			 * instead of the jump if nothing falls through to it.
+			 */
+			for (ubb = tbb; (b = DLIST_PREV(ubb, bbelem),
+			    bb_labonly(b)) && !bb_fixed(p2e, b); )
+				ubb = b;
+			if (b == bb || !isjbr(b->last))
+				continue;
+			for (b = tbb; !isjbr(b->last); b = DLIST_NEXT(b, bbelem))
+				if (b->first->type == IP_EPILOG)
+					break;
+			if (b == bb || b->first->type == IP_EPILOG ||
+			    (DLIST_NEXT(b, bbelem) == bb && bb->first == bb->last))
+				continue;
+			bb_move(bb, ubb, b);
+			bb_jumpnext(bb, tbb);
+			ch++;
+		}
+	} while (ch);
+}
+
+void
+cfg_dfs(struct basicblock *bb, unsigned int parent, struct bblockinfo *bbinfo)
+{
+	struct cfgnode *cn;
+
+	if (bb->dfnum != 0)
+		return;
+
+	bb->dfnum = ++dfsnum;
+	bb->dfparent = parent;
+	bbinfo->arr[bb->dfnum] = bb;
+	SLIST_FOREACH(cn, &bb->child, chld)
+		cfg_dfs(cn->bblock, bb->dfnum, bbinfo);
+	/* Don't bring in unreachable nodes in the future */
+	bbinfo->size = dfsnum + 1;
+}
+
+static bittype *
+setalloc(int nelem)
+{
+	bittype *b;
+	int sz = (nelem+NUMBITS-1)/NUMBITS;
+
+	b = tmpalloc(sz * sizeof(bittype));
+	memset(b, 0, sz * sizeof(bittype));
+	return b;
+}
+
+/*
+ * Algorithm 19.9, pp 414 from Appel.
+ */
+
+void
+dominators(struct p2env *p2e)
+{
+	struct cfgnode *cnode;
+	struct basicblock *bb, *y, *v;
+	struct basicblock *s, *sprime, *p;
+	int h, i;
+
+	/* the blocks may have been changed since last time */
+	p2e->bbinfo.size = p2e->nbblocks + 1;
+	p2e->bbinfo.arr = tmpcalloc(p2e->bbinfo.size *
+	    sizeof(struct basicblock *));
+	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
+		bb->dfnum = bb->dfparent = bb->semi = bb->ancestor =
+		    bb->idom = bb->samedom = 0;
+		bb->bucket = setalloc(p2e->bbinfo.size);
+		bb->df = setalloc(p2e->bbinfo.size);
+		bb->dfchildren = setalloc(p2e->bbinfo.size);
+	}
+
+	dfsnum = 0;
+	cfg_dfs(DLIST_NEXT(&p2e->bblocks, bbelem), 0, &p2e->bbinfo);
+
+	if (b2debug) {
+		struct basicblock *bbb;
+		struct cfgnode *ccnode, *cn;
+
+		DLIST_FOREACH(bbb, &p2e->bblocks, bbelem) {
+			printf("Basic block %d, parents: ", bbb->dfnum);
+			SLIST_FOREACH(ccnode, &bbb->parents, cfgelem) {
+				printf("%d, ", ccnode->bblock->dfnum);
+			}
+			printf("\nChildren: ");
+			SLIST_FOREACH(cn, &bbb->child, chld)
+				printf("%d, ", cn->bblock->dfnum);
+			printf("\n");
+		}
+	}
+
+	for(h = p2e->bbinfo.size - 1; h > 1; h--) {
+		bb = p2e->bbinfo.arr[h];
+		p = s = p2e->bbinfo.arr[bb->dfparent];
+		SLIST_FOREACH(cnode, &bb->parents, cfgelem) {
+			if (cnode->bblock->dfnum ==0)
+				continue; /* Ignore unreachable code */
+
+			if (cnode->bblock->dfnum <= bb->dfnum) 
+				sprime = cnode->bblock;
+			else 
 				sprime = p2e->bbinfo.arr[ancestorwithlowestsemi
 					      (cnode->bblock, &p2e->bbinfo)->semi];
 			if (sprime->dfnum < s->dfnum)
@@ -1352,101 +2330,470 @@ renamevar(struct p2env *p2e,struct basicblock *bb)
 	}
 }
 
-static struct cpinfo {
-	int ipb, asz;
-	CONSZ *conp;
-	char **namep;
-	int *valp;
-} cpi;
+/*
+ * Sparse conditional constant propagation (Wegman & Zadeck) on the
+ * SSA form.  A temporary is either not yet known, a constant or
+ * varying.  A block is only evaluated once an edge into it has been
+ * found executable, and a branch on a constant only makes the edge
+ * it takes executable; iterate until nothing changes.
+ * Afterwards uses of constants are replaced, constant branches are
+ * turned into gotos and the blocks that cannot be reached are deleted.
+ */
+#define	SC_TOP	0
+#define	SC_CON	1
+#define	SC_BOT	2
 
-static void
-getconst(NODE *p)
-{
-	int ix;
+struct scval {
+	int st;
+	CONSZ val;
+};
 
-	if (p->n_op == ASSIGN && p->n_left->n_op == TEMP && 
-	    p->n_right->n_op == ICON) {
-		ix = regno(p->n_left) - cpi.ipb;
-//printf("Found %d val " CONFMT " name \n", regno(p->n_left), getlval(p->n_right));
-		if (cpi.valp[ix])
-			comperr("TEMP %d found", regno(p->n_left));
-		cpi.valp[ix] = 1;
-		cpi.conp[ix] = getlval(p->n_right);
-		cpi.namep[ix] = p->n_right->n_name;
+static struct scval *scvals;
+static int sclow, scsz;
+static bittype *scbad, *scexec;
+
+static int
+scsize(TWORD t)
+{
+	switch (t) {
+	case CHAR: case UCHAR:
+		return SZCHAR;
+	case SHORT: case USHORT:
+		return SZSHORT;
+	case INT: case UNSIGNED:
+		return SZINT;
+	case LONG: case ULONG:
+		return SZLONG;
+	case LONGLONG: case ULONGLONG:
+		return SZLONGLONG;
 	}
-	if (optype(p->n_op) == BITYPE)
-		getconst(p->n_right);
-	if (optype(p->n_op) != LTYPE)
-		getconst(p->n_left);
+	return ISPTR(t) ? SZPOINT(t) : 0;
 }
 
-static int replaced;
+/*
+ * Truncate v to the size of type t and sign or zero extend it.
+ */
+static CONSZ
+sctrunc(CONSZ v, TWORD t)
+{
+	U_CONSZ u = v, m;
+	int sz = scsize(t);
+
+	if (sz >= (int)sizeof(CONSZ) * SZCHAR)
+		return v;
+	m = ((U_CONSZ)1 << sz) - 1;
+	u &= m;
+	if (!ISUNSIGNED(t) && !ISPTR(t) && (u >> (sz - 1)) & 1)
+		u |= ~m;
+	return (CONSZ)u;
+}
 
+/*
+ * Temporaries not set by an assignment statement or a phi are
+ * not tracked.
+ */
 static void
-replconst(NODE *p)
-{  
+scbadtemp(NODE *p, void *arg)
+{
+	int t;
 
-	if (p->n_op == ASSIGN && p->n_left->n_op == TEMP) {
-		replconst(p->n_right);
-	} else if (p->n_op == TEMP) {
-		if (cpi.valp[regno(p) - cpi.ipb]) {
-//printf("replacing %d %p\n", regno(p), p);
-			p->n_op = ICON;
-			setlval(p, cpi.conp[regno(p) - cpi.ipb]);
-			p->n_name = cpi.namep[regno(p) - cpi.ipb];
-			replaced = 1;
-			regno(p) = 0;
+	if (arg != NULL) {
+		if (p->n_op == TEMP) {
+			t = regno(p) - sclow;
+			if (t >= 0 && t < scsz)
+				BITSET(scbad, t);
 		}
-	} else {
-		if (optype(p->n_op) == BITYPE)
-			replconst(p->n_right);
-		if (optype(p->n_op) != LTYPE)
-			replconst(p->n_left);
+	} else if (p->n_op == XASM) {
+		walkf(p, scbadtemp, p);
+	} else if (asgop(p->n_op)) {
+		scbadtemp(p->n_left, p);
 	}
 }
 
+static int
+sctemp(int t, CONSZ *vp)
+{
+	t -= sclow;
+	if (t < 0 || t >= scsz || TESTBIT(scbad, t))
+		return SC_BOT;
+	*vp = scvals[t].val;
+	return scvals[t].st;
+}
+
 /*
- * Simple version of constant propagation.
- * Should be replaced with conditional constant propagation someday.
+ * Lower the value of temporary t.  Returns 1 if it changed.
  */
-void
-simple_cp(struct p2env *p2e)
+static int
+scset(int t, int st, CONSZ v)
 {
-	struct interpass *ip;
+	struct scval *s;
+
+	t -= sclow;
+	if (t < 0 || t >= scsz || TESTBIT(scbad, t))
+		return 0;
+	s = &scvals[t];
+	if (st == SC_TOP || s->st == SC_BOT)
+		return 0;
+	if (s->st == SC_CON) {
+		if (st == SC_CON && s->val == v)
+			return 0;
+		st = SC_BOT;
+	}
+	s->st = st;
+	s->val = v;
+	return 1;
+}
 
-	cpi.ipb = p2e->ipp->ip_tmpnum;
-	cpi.asz = p2e->epp->ip_tmpnum - cpi.ipb;
-	cpi.conp = tmpcalloc(cpi.asz * sizeof(CONSZ));
-	cpi.valp = tmpcalloc(cpi.asz * sizeof(int));
-	cpi.namep = tmpcalloc(cpi.asz * sizeof(char *));
+/*
+ * Evaluate the tree p.  Only integer arithmetic without side
+ * effects can be constant.
+ */
+static int
+sceval(NODE *p, CONSZ *vp)
+{
+	CONSZ l, r;
+	U_CONSZ m;
+	int o = p->n_op, sl, sr, sz;
+
+	if ((sz = scsize(p->n_type)) == 0)
+		return SC_BOT;
+	l = r = 0;
+	switch (o) {
+	case ICON:
+		if (p->n_name[0])
+			return SC_BOT;
+		*vp = sctrunc(getlval(p), p->n_type);
+		return SC_CON;
+
+	case TEMP:
+		return sctemp(regno(p), vp);
+
+	case PLUS: case MINUS: case MUL: case DIV: case MOD:
+	case AND: case OR: case ER: case LS: case RS:
+	case UMINUS: case COMPL: case SCONV: case PCONV:
+	case EQ: case NE: case LE: case LT: case GE: case GT:
+	case ULE: case ULT: case UGE: case UGT:
+	case POPCNT: case CLZ: case CTZ:
+		sl = sceval(p->n_left, &l);
+		sr = optype(o) == BITYPE ? sceval(p->n_right, &r) : SC_CON;
+		if (sl == SC_BOT || sr == SC_BOT)
+			return SC_BOT;
+		if (sl == SC_TOP || sr == SC_TOP)
+			return SC_TOP;
+		break;
 
-	/* First loop over and get all constants */
-	DLIST_FOREACH(ip, &p2e->ipole, qelem) {
-		if (ip->type == IP_NODE)
-			getconst(ip->ip_node);
+	default:
+		return SC_BOT;
 	}
 
-	do {
-		replaced = 0;
-		/* Second loop replaces all uses of the constants */
-		DLIST_FOREACH(ip, &p2e->ipole, qelem) {
-			if (ip->type == IP_NODE)
-				replconst(ip->ip_node);
+	switch (o) {
+	case PLUS: l = (U_CONSZ)l + r; break;
+	case MINUS: l = (U_CONSZ)l - r; break;
+	case MUL: l = (U_CONSZ)l * r; break;
+	case AND: l &= r; break;
+	case OR: l |= r; break;
+	case ER: l ^= r; break;
+	case UMINUS: l = -(U_CONSZ)l; break;
+	case COMPL: l = ~l; break;
+	case SCONV: case PCONV: break;
+
+	case DIV: case MOD:
+		if (r == 0)
+			return SC_BOT;
+		if (ISUNSIGNED(p->n_type) || ISPTR(p->n_type))
+			l = o == DIV ? (U_CONSZ)l / (U_CONSZ)r :
+			    (U_CONSZ)l % (U_CONSZ)r;
+		else if (r == -1)
+			l = o == DIV ? -(U_CONSZ)l : 0;
+		else
+			l = o == DIV ? l / r : l % r;
+		break;
+
+	case LS: case RS:
+		if (r < 0 || r >= sz)
+			return SC_BOT;
+		if (o == LS)
+			l = (U_CONSZ)l << r;
+		else if (ISUNSIGNED(p->n_type) || ISPTR(p->n_type))
+			l = (U_CONSZ)l >> r;
+		else
+			l = l >> r;
+		break;
+
+	case EQ: l = l == r; break;
+	case NE: l = l != r; break;
+	case LE: l = l <= r; break;
+	case LT: l = l < r; break;
+	case GE: l = l >= r; break;
+	case GT: l = l > r; break;
+
+	case POPCNT: case CLZ: case CTZ:
+		m = l;
+		if (sz < (int)sizeof(CONSZ) * SZCHAR)
+			m &= ((U_CONSZ)1 << sz) - 1;
+		if (m == 0 && o != POPCNT)
+			return SC_BOT;
+		if (o == POPCNT)
+			for (l = 0; m; m &= m - 1)
+				l++;
+		else if (o == CTZ)
+			for (l = 0; (m & 1) == 0; m >>= 1)
+				l++;
+		else
+			for (l = sz; m; m >>= 1)
+				l--;
+		break;
+
+	default: /* unsigned compares */
+		if ((sz = scsize(p->n_left->n_type)) <
+		    (int)sizeof(CONSZ) * SZCHAR) {
+			m = ((U_CONSZ)1 << sz) - 1;
+			l &= m, r &= m;
 		}
-	} while (replaced);
+		switch (o) {
+		case ULE: l = (U_CONSZ)l <= (U_CONSZ)r; break;
+		case ULT: l = (U_CONSZ)l < (U_CONSZ)r; break;
+		case UGE: l = (U_CONSZ)l >= (U_CONSZ)r; break;
+		case UGT: l = (U_CONSZ)l > (U_CONSZ)r; break;
+		}
+	}
+	*vp = sctrunc(l, p->n_type);
+	return SC_CON;
 }
 
-enum pred_type {
-    pred_unknown    = 0,
-    pred_goto       = 1,
-    pred_cond       = 2,
+/*
+ * If bb ends with a branch on a constant, return the only block
+ * it can go to.
+ */
+static struct basicblock *
+sctaken(struct p2env *p2e, struct basicblock *bb)
+{
+	struct basicblock *nbb;
+	NODE *p;
+	CONSZ v;
+
+	if (bb->last->type != IP_NODE || bb->last->ip_node->n_op != CBRANCH)
+		return NULL;
+	p = bb->last->ip_node;
+	if (sceval(p->n_left, &v) != SC_CON)
+		return NULL;
+	if (v)
+		return p2e->labinfo.arr[getlval(p->n_right) -
+		    p2e->labinfo.low];
+	nbb = DLIST_NEXT(bb, bbelem);
+	return nbb->first->type == IP_DEFLAB ? nbb : NULL;
+}
+
+static int
+scedge(struct p2env *p2e, struct basicblock *bb, struct basicblock *cbb)
+{
+	struct basicblock *tbb;
+
+	if (!TESTBIT(scexec, bb->bbnum))
+		return 0;
+	tbb = sctaken(p2e, bb);
+	return tbb == NULL || tbb == cbb;
+}
+
+/*
+ * Mark the blocks reachable from bb when constant branches are
+ * followed only the way they go.
+ */
+static void
+scmark(struct p2env *p2e, struct basicblock *bb, bittype *keep)
+{
+	struct basicblock *tbb;
+	struct cfgnode *cn;
+
+	if (bb == NULL || TESTBIT(keep, bb->bbnum))
+		return;
+	BITSET(keep, bb->bbnum);
+	tbb = TESTBIT(scexec, bb->bbnum) ? sctaken(p2e, bb) : NULL;
+	SLIST_FOREACH(cn, &bb->child, chld)
+		if (tbb == NULL || cn->bblock == tbb)
+			scmark(p2e, cn->bblock, keep);
+}
+
+/*
+ * Replace constant expressions in p.  Pointers, compares
+ * and inline asm are left alone.
+ */
+static void
+screpl(NODE *p)
+{
+	NODE *q;
+	CONSZ v;
+	int o = p->n_op;
+
+	if (o == XASM)
+		return;
+	if (o == ASSIGN && p->n_left->n_op == TEMP) {
+		screpl(p->n_right);
+		return;
+	}
+	if (o != ICON && !logop(o) && scsize(p->n_type) >= SZINT &&
+	    !ISPTR(p->n_type) && sceval(p, &v) == SC_CON) {
+		if (optype(o) == BITYPE)
+			tfree(p->n_right);
+		if (optype(o) != LTYPE)
+			tfree(p->n_left);
+		p->n_op = ICON;
+		p->n_name = "";
+		p->n_ap = NULL;
+		setlval(p, v);
+		regno(p) = 0;
+		return;
+	}
+	if (optype(o) == BITYPE)
+		screpl(p->n_right);
+	if (optype(o) != LTYPE)
+		screpl(p->n_left);
+
+	/* x + 0 and x - 0 are left when only one operand is constant */
+	if ((o == PLUS || o == MINUS) && !ISPTR(p->n_type) &&
+	    p->n_right->n_op == ICON && p->n_right->n_name[0] == 0 &&
+	    getlval(p->n_right) == 0 && p->n_left->n_type == p->n_type) {
+		q = p->n_left;
+		nfree(p->n_right);
+		*p = *q;
+		nfree(q);
+	}
+}
+
+static void
+sccp(struct p2env *p2e)
+{
+	struct basicblock *bb, *nbb, *tbb;
+	struct cfgnode *cn;
+	struct phiinfo *phi;
+	struct interpass *ip;
+	bittype *keep;
+	NODE *p;
+	CONSZ v, v2;
+	int ch, st, st2, i, *l;
+
+	sclow = p2e->ipp->ip_tmpnum;
+	scsz = p2e->epp->ip_tmpnum - sclow;
+	scvals = tmpcalloc(scsz * sizeof(struct scval));
+	scbad = tmpcalloc(BIT2BYTE(scsz));
+	DLIST_FOREACH(ip, &p2e->ipole, qelem) {
+		if (ip->type != IP_NODE)
+			continue;
+		p = ip->ip_node;
+		if (p->n_op == ASSIGN && p->n_left->n_op == TEMP)
+			p = p->n_right;
+		walkf(p, scbadtemp, NULL);
+	}
+
+	scexec = setalloc(p2e->nbblocks);
+	BITSET(scexec, DLIST_NEXT(&p2e->bblocks, bbelem)->bbnum);
+	do {
+		ch = 0;
+		DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
+			if (!TESTBIT(scexec, bb->bbnum)) {
+				SLIST_FOREACH(cn, &bb->parents, cfgelem)
+					if (scedge(p2e, cn->bblock, bb))
+						break;
+				if (cn == NULL)
+					continue;
+				BITSET(scexec, bb->bbnum);
+				ch = 1;
+			}
+			SLIST_FOREACH(phi, &bb->phi, phielem) {
+				st = SC_TOP;
+				v = 0;
+				i = 0;
+				SLIST_FOREACH(cn, &bb->parents, cfgelem) {
+					if (phi->intmpregno[i] == 0 ||
+					    !scedge(p2e, cn->bblock, bb))
+						st2 = SC_TOP;
+					else
+						st2 = sctemp(phi->intmpregno[i],
+						    &v2);
+					if (st == SC_TOP)
+						st = st2, v = v2;
+					else if (st2 == SC_BOT ||
+					    (st2 == SC_CON && v != v2))
+						st = SC_BOT;
+					i++;
+				}
+				ch |= scset(phi->newtmpregno, st, v);
+			}
+			for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+				if (ip->type == IP_NODE &&
+				    (p = ip->ip_node)->n_op == ASSIGN &&
+				    p->n_left->n_op == TEMP) {
+					st = sceval(p->n_right, &v);
+					ch |= scset(regno(p->n_left), st, v);
+				}
+				if (ip == bb->last)
+					break;
+			}
+		}
+	} while (ch);
+
+	/* find what is left when constant branches are followed */
+	keep = setalloc(p2e->nbblocks);
+	scmark(p2e, DLIST_NEXT(&p2e->bblocks, bbelem), keep);
+	for (l = p2e->epp->ip_labels; *l; l++)
+		scmark(p2e, p2e->labinfo.arr[*l - p2e->labinfo.low], keep);
+	scmark(p2e, DLIST_PREV(&p2e->bblocks, bbelem), keep);
+
+	ch = 0;
+	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
+		if (!TESTBIT(keep, bb->bbnum) || !TESTBIT(scexec, bb->bbnum))
+			continue;
+		if ((tbb = sctaken(p2e, bb)) != NULL) {
+			BDEBUG(("sccp: bb %d always goes to %d\n",
+			    bb->bbnum, tbb->bbnum));
+			tfree(bb->last->ip_node);
+			bb->last->ip_node = mkunode(GOTO,
+			    mklnode(ICON, tbb->first->ip_lbl, 0, INT), 0, INT);
+			cn = SLIST_FIRST(&bb->child);
+			if (cn->bblock == tbb)
+				cn = cn->chld.q_forw;
+			cfg_deledge(bb, cn->bblock);
+			ch = 1;
+		}
+		for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+			if (ip->type == IP_NODE)
+				screpl(ip->ip_node);
+			if (ip == bb->last)
+				break;
+		}
+	}
+
+	for (bb = DLIST_NEXT(&p2e->bblocks, bbelem); bb != &p2e->bblocks;
+	    bb = nbb) {
+		nbb = DLIST_NEXT(bb, bbelem);
+		if (TESTBIT(keep, bb->bbnum))
+			continue;
+		BDEBUG(("sccp: deleting bb %d\n", bb->bbnum));
+		bb_free(p2e, bb);
+		ch = 1;
+	}
+
+	/* the dominator tree is used by the following passes */
+	if (ch)
+		dominators(p2e);
+}
+
+enum pred_type {
+    pred_unknown    = 0,
+    pred_goto       = 1,
+    pred_cond       = 2,
     pred_falltrough = 3,
 } ;
 
+/*
+ * Replace the phi functions with copies in the parent blocks, or in
+ * new blocks on the edges to them.  The basic blocks and the cfg are
+ * kept up to date.
+ */
 void
 removephi(struct p2env *p2e)
 {
-	struct basicblock *bb,*bbparent;
+	struct basicblock *bb,*bbparent,*nbb;
 	struct cfgnode *cfgn;
 	struct phiinfo *phi;
 	int i;
@@ -1481,16 +2828,14 @@ removephi(struct p2env *p2e)
 					label = (int)getlval(pip->ip_node->n_right);
 
 					/* Check if parent got us here via branch */
-					if (bb == p2e->labinfo.arr[label - p2e->ipp->ip_lblnum])
+					if (bb == bb_bylab(p2e, label))
 						complex = pred_cond ;
 					else
 						complex = pred_falltrough ;
 
-				} else if (DLIST_PREV(bb, bbelem) == bbparent) {
-					complex = pred_falltrough ;
 				} else {
-					    /* PANIC */
-					comperr("Assumption blown in rem-phi") ;
+					/* new blocks may be in between */
+					complex = pred_falltrough ;
 				}
        
 				BDEBUG((" Complex: %d ",complex)) ;
@@ -1507,7 +2852,7 @@ removephi(struct p2env *p2e)
 							     n_type));
 							BDEBUG(("(%p, %d -> %d) ", ip, phi->intmpregno[i], phi->newtmpregno));
 				
-							DLIST_INSERT_BEFORE((bbparent->last), ip, qelem);
+							bb_insert_before(p2e, bbparent, bbparent->last, ip);
 						}
 					}
 					break ;
@@ -1520,6 +2865,9 @@ removephi(struct p2env *p2e)
 					/* Line number?? ip->lineno; */
 					ip->ip_lbl = newlabel;
 					DLIST_INSERT_BEFORE((bb->first), ip, qelem);
+					nbb = bb_alloc(p2e, ip);
+					DLIST_INSERT_BEFORE(bb, nbb, bbelem);
+					bb_setlab(p2e, newlabel, nbb);
 
 					SLIST_FOREACH(phi,&bb->phi,phielem) {
 						if (phi->intmpregno[i]>0) {
@@ -1536,10 +2884,12 @@ removephi(struct p2env *p2e)
 					/* add a jump to us */
 					ip = ipnode(mkunode(GOTO, mklnode(ICON, label, 0, INT), 0, INT));
 					DLIST_INSERT_BEFORE((bb->first), ip, qelem);
+					nbb->last = ip;
 					setlval(pip->ip_node->n_right,newlabel);
 					if (!logop(pip->ip_node->n_left->n_op))
 						comperr("SSA not logop");
 					pip->ip_node->n_left->n_label=newlabel;
+					cfg_split(bbparent, bb, cfgn, nbb);
 					break ;
 				  case pred_falltrough:
 					if (bb->first->type == IP_DEFLAB) { 
@@ -1571,6 +2921,18 @@ removephi(struct p2env *p2e)
 							DLIST_INSERT_AFTER((bbparent->last), ip, qelem);
 						}
 					}
+
+					/* the jump ends the parent, or a new block after a CBRANCH */
+					for (ip = DLIST_NEXT(pip, qelem); !isbranch(ip);
+					    ip = DLIST_NEXT(ip, qelem))
+						;
+					if (isbranch(pip)) {
+						nbb = bb_alloc(p2e, DLIST_NEXT(pip, qelem));
+						nbb->last = ip;
+						DLIST_INSERT_AFTER(bbparent, nbb, bbelem);
+						cfg_split(bbparent, bb, cfgn, nbb);
+					} else
+						bbparent->last = ip;
 					break ;
 				default:
 					comperr("assumption blown, complex is %d\n", complex) ;
@@ -1580,51 +2942,7 @@ removephi(struct p2env *p2e)
 			}
 			break;
 		}
-	}
-}
-
-    
-/*
- * Remove unreachable nodes in the CFG.
- */ 
-
-void
-remunreach(struct p2env *p2e)
-{
-	struct basicblock *bb, *nbb;
-	struct interpass *next, *ctree;
-
-	bb = DLIST_NEXT(&p2e->bblocks, bbelem);
-	while (bb != &p2e->bblocks) {
-		nbb = DLIST_NEXT(bb, bbelem);
-
-		/* Code with dfnum 0 is unreachable */
-		if (bb->dfnum != 0) {
-			bb = nbb;
-			continue;
-		}
-
-		/* Need the epilogue node for other parts of the
-		   compiler, set its label to 0 and backend will
-		   handle it. */ 
-		if (bb->first->type == IP_EPILOG) {
-			bb->first->ip_lbl = 0;
-			bb = nbb;
-			continue;
-		}
-
-		next = bb->first;
-		do {
-			ctree = next;
-			next = DLIST_NEXT(ctree, qelem);
-			
-			if (ctree->type == IP_NODE)
-				tfree(ctree->ip_node);
-			DLIST_REMOVE(ctree, qelem);
-		} while (ctree != bb->last);
-			
-		DLIST_REMOVE(bb, bbelem);
-		bb = nbb;
+		SLIST_INIT(&bb->phi);
 	}
 }
 
@@ -2059,25 +3377,2317 @@ static void add_labels(struct p2env* p2e)
 	}
 }
 
-/* node map */
-#ifdef ENABLE_NEW
-struct node_map {
-	NODE* node ;		/* the node */
-	unsigned int node_num ; /* node is equal to that one */
-	unsigned int var_num ;	/* node computes this variable */
-} ;
+/*
+ * Global value numbering on the SSA form, done by walking the
+ * dominator tree with a scoped hash table of the expressions seen.
+ * SSA temporaries never change value, so an expression made of
+ * temporaries and constants computed in a dominating position can
+ * be reused.  The first occurrence is moved into a new temporary
+ * (unless it is already assigned to one) when a second is found.
+ * Memory references, calls and anything with side effects are left
+ * alone, as are cheap expressions that fold into addressing modes.
+ */
+struct gvnent {
+	struct gvnent *next;	/* hash chain */
+	struct gvnent *snext;	/* scope stack */
+	int op, vl, vr;
+	TWORD type;
+	CONSZ lval;
+	char *name;
+	int vn;			/* value number */
+	NODE *p;		/* first occurrence, if worth reusing */
+	struct interpass *ip;	/* statement of first occurrence */
+	struct basicblock *bb;
+	int temp;		/* temporary holding the value, or 0 */
+};
+
+#define	GVNHSZ	1024
+#define	GVNHASH(op,ty,vl,vr,lv) \
+	(((unsigned)(op) * 31 + (ty) * 7 + (vl) * 131 + (vr) * 1031 + \
+	    (unsigned)(lv)) % GVNHSZ)
+static struct gvnent *gvnhash[GVNHSZ], *gvnstk, *gvnlast;
+static int *gvntemp, gvnlow, gvnsz, nvn;
+static bittype *gvnbad;
+static struct interpass *gvnip;
+static struct basicblock *gvnbb;
+
+/*
+ * Temporaries written to by other means than an SSA assignment.
+ */
+static void
+gvnbadtemp(NODE *p, void *arg)
+{
+	int t;
+
+	if (arg != NULL) {
+		if (p->n_op == TEMP) {
+			t = regno(p) - gvnlow;
+			if (t >= 0 && t < gvnsz)
+				BITSET(gvnbad, t);
+		}
+	} else if (p->n_op == XASM) {
+		walkf(p, gvnbadtemp, p);
+	} else if (asgop(p->n_op) && p->n_op != ASSIGN) {
+		gvnbadtemp(p->n_left, p);
+	}
+}
+
+/*
+ * Move the expression q into a new temporary and make q refer to it.
+ * Returns the statement that assigns the temporary.
+ */
+static struct interpass *
+tempasg(NODE *q)
+{
+	NODE *r = talloc();
+
+	*r = *q;
+	q->n_op = TEMP;
+	q->n_name = "";
+	q->n_ap = NULL;
+	setlval(q, 0);
+	regno(q) = p2env.epp->ip_tmpnum++;
+	return ipnode(mkbinode(ASSIGN, mktemp(regno(q), r->n_type),
+	    r, r->n_type));
+}
 
-static unsigned long nodes_counter ;
-static void node_map_count_walker(NODE* n, void* x)
+static int
+gvnlook(int op, TWORD type, int vl, int vr, CONSZ lval, char *name,
+    NODE *p, int cost)
+{
+	struct gvnent *e;
+	unsigned int h;
+
+	h = GVNHASH(op, type, vl, vr, lval);
+	for (e = gvnhash[h]; e; e = e->next)
+		if (e->op == op && e->type == type && e->vl == vl &&
+		    e->vr == vr && e->lval == lval &&
+		    (name == e->name || strcmp(name, e->name) == 0))
+			break;
+	if (e == NULL) {
+		e = tmpalloc(sizeof(struct gvnent));
+		e->op = op;
+		e->type = type;
+		e->vl = vl;
+		e->vr = vr;
+		e->lval = lval;
+		e->name = name;
+		e->vn = ++nvn;
+		e->p = cost > 1 ? p : NULL;
+		e->ip = gvnip;
+		e->bb = gvnbb;
+		e->temp = 0;
+		e->next = gvnhash[h];
+		gvnhash[h] = e;
+		e->snext = gvnstk;
+		gvnstk = e;
+		gvnlast = e;
+		return e->vn;
+	}
+	gvnlast = e;
+	if (e->p == NULL || p == NULL)
+		return e->vn;
+
+	if (e->temp == 0) {
+		/* move the first occurrence into a new temporary */
+		struct interpass *ip = tempasg(e->p);
+
+		bb_insert_before(&p2env, e->bb, e->ip, ip);
+		e->temp = regno(e->p);
+		e->p = ip->ip_node->n_right;
+		gvntemp[e->temp - gvnlow] = e->vn;
+		BDEBUG(("gvn: new temp %d for vn %d\n", e->temp, e->vn));
+	}
+
+	/* replace this one */
+	if (optype(p->n_op) != LTYPE)
+		tfree(p->n_left);
+	if (optype(p->n_op) == BITYPE)
+		tfree(p->n_right);
+	p->n_op = TEMP;
+	p->n_name = "";
+	p->n_ap = NULL;
+	setlval(p, 0);
+	regno(p) = e->temp;
+	return e->vn;
+}
+
+/*
+ * Return the value number of p, or 0 if it has none.
+ * Cost is a rough estimate of the work to compute p.
+ */
+static int
+gvnnode(NODE *p, int *cost)
+{
+	int o = p->n_op;
+	int vl, vr, cl, cr, t;
+
+	cl = cr = vr = 0;
+	gvnlast = NULL;
+	switch (o) {
+	case TEMP:
+		*cost = 0;
+		t = regno(p) - gvnlow;
+		if (t < 0 || t >= gvnsz || TESTBIT(gvnbad, t))
+			return 0;
+		if (gvntemp[t] == 0)
+			gvntemp[t] = ++nvn;
+		return gvntemp[t];
+
+	case ICON:
+		*cost = 0;
+		return gvnlook(o, p->n_type, 0, 0, getlval(p), p->n_name,
+		    NULL, 0);
+
+	case PLUS: case MINUS: case MUL: case DIV: case MOD:
+	case AND: case OR: case ER: case LS: case RS:
+	case UMINUS: case COMPL: case SCONV: case PCONV:
+	case POPCNT: case CLZ: case CTZ:
+		vl = gvnnode(p->n_left, &cl);
+		if (optype(o) == BITYPE)
+			vr = gvnnode(p->n_right, &cr);
+		*cost = cl + cr + (o == MUL || o == DIV || o == MOD ? 3 :
+		    o == PCONV ? 0 : 1);
+		if (vl == 0 || (optype(o) == BITYPE && vr == 0))
+			return 0;
+		if (!ISPTR(p->n_type) && p->n_type != FLOAT &&
+		    p->n_type != DOUBLE && (p->n_type < INT ||
+		    p->n_type > ULONGLONG))
+			return 0;
+		if ((o == PLUS || o == MUL || o == AND || o == OR ||
+		    o == ER) && vl > vr)
+			t = vl, vl = vr, vr = t;
+		return gvnlook(o, p->n_type, vl, vr, 0, "", p, *cost);
+
+	default:
+		*cost = 0;
+		if (optype(o) != LTYPE)
+			(void)gvnnode(p->n_left, &cl);
+		if (optype(o) == BITYPE)
+			(void)gvnnode(p->n_right, &cr);
+		gvnlast = NULL;
+		return 0;
+	}
+}
+
+/*
+ * Does the tree assign to anything?
+ */
+static int
+gvnasg(NODE *p)
+{
+	if (asgop(p->n_op) || p->n_op == XASM)
+		return 1;
+	if (optype(p->n_op) != LTYPE && gvnasg(p->n_left))
+		return 1;
+	if (optype(p->n_op) == BITYPE && gvnasg(p->n_right))
+		return 1;
+	return 0;
+}
+
+/*
+ * Is there inline asm or an assignment anywhere below the top of p?
+ */
+static int
+nestedasg(NODE *p)
+{
+	if (p->n_op == XASM)
+		return 1;
+	if (optype(p->n_op) != LTYPE && gvnasg(p->n_left))
+		return 1;
+	if (optype(p->n_op) == BITYPE && gvnasg(p->n_right))
+		return 1;
+	return 0;
+}
+
+static void
+gvnblock(struct p2env *p2e, struct basicblock *bb)
+{
+	struct gvnent *mark, *e;
+	struct interpass *ip, *nip;
+	NODE *p;
+	int h, c, v, t;
+
+	mark = gvnstk;
+	gvnbb = bb;
+	for (ip = bb->first; ; ip = nip) {
+		nip = DLIST_NEXT(ip, qelem);
+		if (ip->type == IP_NODE) {
+			p = ip->ip_node;
+			gvnip = ip;
+			if (nestedasg(p)) {
+				;	/* leave alone */
+			} else if (p->n_op == ASSIGN && p->n_left->n_op == TEMP) {
+				v = gvnnode(p->n_right, &c);
+				t = regno(p->n_left) - gvnlow;
+				if (v && t >= 0 && t < gvnsz &&
+				    !TESTBIT(gvnbad, t)) {
+					gvntemp[t] = v;
+					e = gvnlast;
+					if (e && e->p == p->n_right && e->temp == 0 &&
+					    e->type == p->n_left->n_type)
+						e->temp = regno(p->n_left);
+				}
+			} else
+				(void)gvnnode(p, &c);
+		}
+		if (ip == bb->last)
+			break;
+	}
+
+	for (h = 1; h < p2e->bbinfo.size; h++)
+		if (TESTBIT(bb->dfchildren, h))
+			gvnblock(p2e, p2e->bbinfo.arr[h]);
+
+	/* leave the scope of this block */
+	while (gvnstk != mark) {
+		e = gvnstk;
+		gvnstk = e->snext;
+		h = GVNHASH(e->op, e->type, e->vl, e->vr, e->lval);
+		if (gvnhash[h] != e)
+			comperr("gvnblock: bad scope");
+		gvnhash[h] = e->next;
+	}
+}
+
+static void
+gvncount(NODE *p, void *arg)
+{
+	(*(int *)arg)++;
+}
+
+static void
+do_cse(struct p2env *p2e)
+{
+	struct interpass *ip;
+	int n = 0;
+
+	DLIST_FOREACH(ip, &p2e->ipole, qelem)
+		if (ip->type == IP_NODE)
+			walkf(ip->ip_node, gvncount, &n);
+
+	/* room for the new temporaries too */
+	gvnlow = p2e->ipp->ip_tmpnum;
+	gvnsz = p2e->epp->ip_tmpnum - gvnlow + n;
+	gvntemp = tmpcalloc(gvnsz * sizeof(int));
+	gvnbad = tmpcalloc(BIT2BYTE(gvnsz));
+	DLIST_FOREACH(ip, &p2e->ipole, qelem)
+		if (ip->type == IP_NODE)
+			walkf(ip->ip_node, gvnbadtemp, NULL);
+
+	nvn = 0;
+	gvnstk = NULL;
+	memset(gvnhash, 0, sizeof(gvnhash));
+	gvnblock(p2e, DLIST_NEXT(&p2e->bblocks, bbelem));
+}
+
+/*
+ * Natural loops.  An edge n -> h where h dominates n is a back edge,
+ * and its loop is h and all blocks that reach n without passing h.
+ * Loops with the same header are merged.  Needs dominators().
+ */
+static int
+dominates(struct p2env *p2e, struct basicblock *a, struct basicblock *b)
+{
+	while (b != a) {
+		if (b->idom == 0)
+			return 0;
+		b = p2e->bbinfo.arr[b->idom];
+	}
+	return 1;
+}
+
+void
+findloops(struct p2env *p2e)
+{
+	struct basicblock *bb, *h, *pb;
+	struct cfgnode *cn, *pn;
+	struct loop **lps, **ord, *lp, *lq;
+	int *stk, n, nl, i, j, sp;
+
+	SLIST_INIT(&p2e->loops);
+	n = p2e->bbinfo.size;
+	lps = tmpcalloc(n * sizeof(struct loop *));
+	stk = tmpalloc(n * sizeof(int));
+	for (nl = 0, i = 1; i < n; i++) {
+		bb = p2e->bbinfo.arr[i];
+		SLIST_FOREACH(cn, &bb->child, chld) {
+			h = cn->bblock;
+			if (h->dfnum == 0 || !dominates(p2e, h, bb))
+				continue;
+			if ((lp = lps[h->dfnum]) == NULL) {
+				lp = lps[h->dfnum] = tmpcalloc(sizeof(struct loop));
+				lp->header = h;
+				lp->blocks = setalloc(n);
+				BITSET(lp->blocks, h->dfnum);
+				lp->nblocks = 1;
+				nl++;
+			}
+			sp = 0;
+			if (!TESTBIT(lp->blocks, bb->dfnum)) {
+				BITSET(lp->blocks, bb->dfnum);
+				lp->nblocks++;
+				stk[sp++] = bb->dfnum;
+			}
+			while (sp > 0) {
+				pb = p2e->bbinfo.arr[stk[--sp]];
+				SLIST_FOREACH(pn, &pb->parents, cfgelem) {
+					j = pn->bblock->dfnum;
+					if (j == 0 || TESTBIT(lp->blocks, j))
+						continue;
+					BITSET(lp->blocks, j);
+					lp->nblocks++;
+					stk[sp++] = j;
+				}
+			}
+		}
+	}
+	if (nl == 0)
+		return;
+
+	/* sort innermost first; an enclosing loop is always bigger */
+	ord = tmpalloc(nl * sizeof(struct loop *));
+	for (nl = 0, i = 1; i < n; i++) {
+		if ((lp = lps[i]) == NULL)
+			continue;
+		for (j = nl++; j > 0 && ord[j-1]->nblocks > lp->nblocks; j--)
+			ord[j] = ord[j-1];
+		ord[j] = lp;
+	}
+	for (i = 0; i < nl; i++) {
+		lp = ord[i];
+		for (j = i+1; j < nl; j++)
+			if (TESTBIT(ord[j]->blocks, lp->header->dfnum))
+				break;
+		lp->outer = j < nl ? ord[j] : NULL;
+		SLIST_INSERT_LAST(&p2e->loops, lp, loopelem);
+	}
+
+	SLIST_FOREACH(lp, &p2e->loops, loopelem) {
+		for (lq = lp; lq; lq = lq->outer)
+			lp->depth++;
+
+		/* a single block outside that only leads here is a preheader */
+		pb = NULL;
+		j = 0;
+		SLIST_FOREACH(pn, &lp->header->parents, cfgelem) {
+			if (pn->bblock->dfnum == 0 ||
+			    TESTBIT(lp->blocks, pn->bblock->dfnum))
+				continue;
+			pb = pn->bblock;
+			j++;
+		}
+		if (j == 1 && SLIST_FIRST(&pb->child)->chld.q_forw == NULL &&
+		    pb->last->type != IP_PROLOG &&
+		    DLIST_PREV(pb->first, qelem)->type != IP_PROLOG)
+			lp->pre = pb;
+		BDEBUG(("loop header %d depth %d blocks %d pre %d\n",
+		    lp->header->dfnum, lp->depth, lp->nblocks,
+		    lp->pre ? (int)lp->pre->dfnum : 0));
+	}
+}
+
+/*
+ * Add an empty preheader block in front of the loop header.
+ * Jumps into the loop from outside are redirected to it.
+ * Returns 0 if it could not be done.
+ */
+static int
+mkpreheader(struct p2env *p2e, struct loop *lp)
+{
+	struct basicblock *h = lp->header, *pb;
+	struct cfgnode *pn;
+	struct interpass *ip;
+	NODE *p;
+	int lbl, nlbl;
+
+	pb = DLIST_PREV(h, bbelem);
+	if (h->first->type != IP_DEFLAB || pb->last->type == IP_PROLOG)
+		return 0;
+	SLIST_FOREACH(pn, &h->parents, cfgelem) {
+		ip = pn->bblock->last;
+		if (isbranch(ip) && ip->ip_node->n_op == GOTO &&
+		    ip->ip_node->n_left->n_op != ICON)
+			return 0;
+	}
+
+	lbl = h->first->ip_lbl;
+	nlbl = getlab2();
+	BDEBUG(("mkpreheader: label %d for loop at %d\n", nlbl, lbl));
+
+	/* a block in the loop falling into the header must jump instead */
+	if (pb->dfnum && TESTBIT(lp->blocks, pb->dfnum) &&
+	    !(isbranch(pb->last) && pb->last->ip_node->n_op == GOTO)) {
+		ip = ipnode(mkunode(GOTO, mklnode(ICON, lbl, 0, INT), 0, INT));
+		DLIST_INSERT_AFTER(pb->last, ip, qelem);
+	}
+
+	ip = tmpalloc(sizeof(struct interpass));
+	ip->type = IP_DEFLAB;
+	ip->lineno = h->first->lineno;
+	ip->ip_lbl = nlbl;
+	DLIST_INSERT_BEFORE(h->first, ip, qelem);
+
+	SLIST_FOREACH(pn, &h->parents, cfgelem) {
+		if (pn->bblock->dfnum == 0 ||
+		    TESTBIT(lp->blocks, pn->bblock->dfnum) ||
+		    !isbranch(pn->bblock->last))
+			continue;
+		p = pn->bblock->last->ip_node;
+		if (p->n_op == GOTO) {
+			if (getlval(p->n_left) == lbl)
+				setlval(p->n_left, nlbl);
+		} else if (getlval(p->n_right) == lbl) {
+			setlval(p->n_right, nlbl);
+			p->n_left->n_label = nlbl;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Loop invariant code motion.  Runs after the SSA form is gone, so a
+ * temporary is invariant in a loop if it is not assigned anywhere in
+ * it.  Invariant expressions without side effects that cannot trap
+ * are computed into new temporaries in the preheader.  Assignments
+ * of invariant values to temporaries that are assigned only once in
+ * the function are moved there as a whole.  Inner loops are done
+ * first, so that their preheader code can move further out.
+ */
+static int *licmdefs;		/* number of assignments to each temporary */
+static bittype *licmset;	/* temporaries assigned in the loop */
+static int licmlow, licmsz;
+
+static void
+licmtemp(NODE *p, int n, void *arg)
+{
+	int t = regno(p) - licmlow;
+
+	if (t < 0 || t >= licmsz)
+		return;
+	if (arg != NULL)
+		BITSET(licmset, t);
+	else
+		licmdefs[t] += n;
+}
+
+static void
+licmxasm(NODE *p, void *arg)
+{
+	if (p->n_op == TEMP)
+		licmtemp(p, 2, arg);
+}
+
+/*
+ * Note the temporaries assigned in p.  With arg == NULL count them
+ * in licmdefs, else mark them in licmset.  Inline asm counts twice
+ * so that its outputs never look like single assignments.
+ */
+static void
+licmdef(NODE *p, void *arg)
 {
-	nodes_counter ++ ;
+	if (p->n_op == XASM)
+		walkf(p, licmxasm, arg);
+	else if (asgop(p->n_op) && p->n_left->n_op == TEMP)
+		licmtemp(p->n_left, p->n_op == ASSIGN ? 1 : 2, arg);
 }
 
-static void do_cse(struct p2env* p2e)
+/*
+ * Is p loop invariant and safe to compute in the preheader?
+ * Cost is a rough estimate of the work to compute p.
+ */
+static int
+licminv(NODE *p, int *cost)
 {
-	nodes_counter = 0 ;
-	WalkAll(p2e, node_map_count_walker, 0, 0) ;
-	BDEBUG(("Found %ld nodes\n", nodes_counter)) ;
+	int o = p->n_op, cl, cr, t;
+
+	*cost = 0;
+	switch (o) {
+	case TEMP:
+		t = regno(p) - licmlow;
+		return t >= 0 && t < licmsz && !TESTBIT(licmset, t);
+
+	case ICON:
+		return 1;
+
+	case DIV: case MOD:
+		if (p->n_type == FLOAT || p->n_type == DOUBLE)
+			break;
+		/* integer division only by a known safe constant */
+		if (p->n_right->n_op != ICON || p->n_right->n_name[0] ||
+		    getlval(p->n_right) == 0 || getlval(p->n_right) == -1)
+			return 0;
+		break;
+
+	case PLUS: case MINUS: case MUL: case AND: case OR: case ER:
+	case LS: case RS: case UMINUS: case COMPL: case SCONV: case PCONV:
+	case POPCNT: case CLZ: case CTZ:
+		break;
+
+	default:
+		return 0;
+	}
+	if (!ISPTR(p->n_type) && p->n_type != FLOAT &&
+	    p->n_type != DOUBLE && (p->n_type < INT || p->n_type > ULONGLONG))
+		return 0;
+	cr = 0;
+	if (!licminv(p->n_left, &cl))
+		return 0;
+	if (optype(o) == BITYPE && !licminv(p->n_right, &cr))
+		return 0;
+	*cost = cl + cr + (o == MUL || o == DIV || o == MOD ? 3 :
+	    o == PCONV ? 0 : 1);
+	return 1;
+}
+
+/*
+ * Append ip to the preheader of lp.
+ */
+static void
+licmput(struct loop *lp, struct interpass *ip)
+{
+	struct basicblock *pb = lp->pre;
+
+	if (isbranch(pb->last)) {
+		DLIST_INSERT_BEFORE(pb->last, ip, qelem);
+	} else {
+		DLIST_INSERT_AFTER(pb->last, ip, qelem);
+		pb->last = ip;
+	}
+}
+
+/*
+ * Move the biggest invariant subtrees of p out of the loop.
+ */
+static void
+licmexpr(struct loop *lp, NODE *p)
+{
+	struct interpass *ip;
+	int c;
+
+	if (licminv(p, &c)) {
+		if (c > 1) {
+			ip = tempasg(p);
+			licmdefs[regno(p) - licmlow] = 1;
+			licmput(lp, ip);
+			BDEBUG(("licm: new temp %d\n", regno(p)));
+		}
+		return;
+	}
+	if (optype(p->n_op) != LTYPE)
+		licmexpr(lp, p->n_left);
+	if (optype(p->n_op) == BITYPE)
+		licmexpr(lp, p->n_right);
+}
+
+/*
+ * Count the assignments to all temporaries, with room for n more.
+ */
+static void
+licminit(struct p2env *p2e, int n)
+{
+	struct interpass *ip;
+
+	licmlow = p2e->ipp->ip_tmpnum;
+	licmsz = p2e->epp->ip_tmpnum - licmlow + n;
+	licmdefs = tmpcalloc(licmsz * sizeof(int));
+	licmset = tmpalloc(BIT2BYTE(licmsz));
+	DLIST_FOREACH(ip, &p2e->ipole, qelem)
+		if (ip->type == IP_NODE)
+			walkf(ip->ip_node, licmdef, NULL);
+}
+
+/*
+ * Mark the temporaries assigned in lp, phi results included.
+ */
+static void
+licmmark(struct p2env *p2e, struct loop *lp)
+{
+	struct basicblock *bb;
+	struct interpass *ip;
+	struct phiinfo *phi;
+	int i, t;
+
+	memset(licmset, 0, BIT2BYTE(licmsz));
+	for (i = 1; i < p2e->bbinfo.size; i++) {
+		if (!TESTBIT(lp->blocks, i))
+			continue;
+		bb = p2e->bbinfo.arr[i];
+		SLIST_FOREACH(phi, &bb->phi, phielem) {
+			t = phi->newtmpregno - licmlow;
+			if (t >= 0 && t < licmsz)
+				BITSET(licmset, t);
+		}
+		for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+			if (ip->type == IP_NODE)
+				walkf(ip->ip_node, licmdef, licmset);
+			if (ip == bb->last)
+				break;
+		}
+	}
+}
+
+static void
+licm(struct p2env *p2e, struct loop *lp)
+{
+	struct basicblock *bb;
+	struct interpass *ip, *nip, *last;
+	NODE *p;
+	int i, c, t;
+
+	licmmark(p2e, lp);
+
+	/* dominators have lower numbers, so definitions come before uses */
+	for (i = 1; i < p2e->bbinfo.size; i++) {
+		if (!TESTBIT(lp->blocks, i))
+			continue;
+		bb = p2e->bbinfo.arr[i];
+		last = bb->last;
+		for (ip = bb->first; ; ip = nip) {
+			nip = DLIST_NEXT(ip, qelem);
+			if (ip->type != IP_NODE || nestedasg(p = ip->ip_node))
+				;
+			else if (p->n_op == ASSIGN && p->n_left->n_op == TEMP &&
+			    (t = regno(p->n_left) - licmlow) >= 0 &&
+			    t < licmsz && licmdefs[t] == 1 &&
+			    (ip != bb->first || ip != bb->last) &&
+			    licminv(p->n_right, &c) && c > 0) {
+				BDEBUG(("licm: moving temp %d\n", t + licmlow));
+				if (ip == bb->first)
+					bb->first = nip;
+				if (ip == bb->last)
+					bb->last = DLIST_PREV(ip, qelem);
+				DLIST_REMOVE(ip, qelem);
+				licmput(lp, ip);
+				BITCLEAR(licmset, t);
+			} else
+				licmexpr(lp, p);
+			if (ip == last)
+				break;
+		}
+	}
+}
+
+static void
+loopopt(struct p2env *p2e)
+{
+	struct interpass *ip;
+	struct loop *lp;
+	int n;
+
+	/* find the loops and give all of them preheaders */
+	for (;;) {
+		bblocks_build(p2e);
+		cfg_build(p2e);
+		dominators(p2e);
+		findloops(p2e);
+		SLIST_FOREACH(lp, &p2e->loops, loopelem)
+			if (lp->pre == NULL && mkpreheader(p2e, lp))
+				break;
+		if (lp == NULL)
+			break;
+	}
+	if (SLIST_ISEMPTY(&p2e->loops))
+		return;
+
+	/* room for the new temporaries too */
+	n = 0;
+	DLIST_FOREACH(ip, &p2e->ipole, qelem)
+		if (ip->type == IP_NODE)
+			walkf(ip->ip_node, gvncount, &n);
+	licminit(p2e, n);
+
+	SLIST_FOREACH(lp, &p2e->loops, loopelem)
+		if (lp->pre != NULL)
+			licm(p2e, lp);
+}
+
+/*
+ * Induction variable strength reduction, done on the SSA form.  A
+ * basic induction variable is a phi in a loop header that is stepped
+ * by a constant in the loop.  An address base + i*k + c with base
+ * invariant and k known gets a new pointer that starts at base + i*k
+ * in the preheader and is stepped along with i.  If i is then only
+ * used to step itself and in a loop test, the test is changed to
+ * compare the pointer instead and i is deleted.  If i stays alive and
+ * the target can address base + i*k directly (IVSCALE) the pointer is
+ * only an extra add in the loop, so the addresses are put back.
+ */
+struct ivptr {
+	struct ivptr *next;
+	NODE *base;		/* invariant TEMP or named ICON */
+	NODE *t;		/* other invariant term, or NULL */
+	CONSZ k, tk;		/* factors of the variable and of t */
+	TWORD type, otype;	/* type of the pointer and of offsets */
+	int p1, p2;		/* pointer in the loop and after step */
+	struct interpass *ip0, *ip2;	/* start and step assignments */
+	struct phiinfo *phi;
+};
+
+/* an address replaced by a pointer, and what it was */
+struct ivundo {
+	struct ivundo *next;
+	NODE *p;
+	NODE n;
+};
+
+struct ivvar {
+	struct ivvar *next;
+	struct phiinfo *phi;	/* defines the variable in the header */
+	int init;		/* initial value from the preheader */
+	int stept;		/* temporary assigned the stepped value */
+	struct interpass *stepip;	/* and its assignment */
+	struct basicblock *stepbb;
+	CONSZ step;
+	struct ivptr *ptrs;	/* pointers derived from it */
+	struct ivundo *undo;	/* addresses replaced */
+};
+
+/* iv*k + t*tk + c */
+struct ivlin {
+	struct ivvar *iv;
+	NODE *t;
+	CONSZ k, tk, c;
+};
+
+#ifndef IVSCALE
+#define	IVSCALE(k)	0	/* no scaled index address mode */
+#endif
+
+static struct interpass **ivdefs;	/* assignment of each temporary */
+static struct basicblock **ivdefbb;	/* and its block */
+static struct ivvar *ivvars;
+
+static int
+ivtsize(TWORD t)
+{
+	switch (t) {
+	case INT: case UNSIGNED:
+		return SZINT;
+	case LONG: case ULONG:
+		return SZLONG;
+	case LONGLONG: case ULONGLONG:
+		return SZLONGLONG;
+	}
+	return ISPTR(t) ? SZPOINT(t) : 0;
+}
+
+static int
+ivsigned(TWORD t)
+{
+	return t == INT || t == LONG || t == LONGLONG;
+}
+
+static void
+ivdef(int t, struct interpass *ip, struct basicblock *bb)
+{
+	t -= licmlow;
+	if (t < 0 || t >= licmsz)
+		return;
+	ivdefs[t] = ip;
+	ivdefbb[t] = bb;
+}
+
+static struct ivvar *
+ivfind(int t)
+{
+	struct ivvar *iv;
+
+	for (iv = ivvars; iv; iv = iv->next)
+		if (iv->phi->newtmpregno == t)
+			break;
+	return iv;
+}
+
+static int
+ivadd(struct ivlin *l, struct ivlin *r)
+{
+	if (r->iv != NULL) {
+		if (l->iv != NULL && l->iv != r->iv)
+			return 0;
+		l->iv = r->iv;
+		l->k += r->k;
+	}
+	if (r->t != NULL) {
+		if (l->t != NULL)
+			return 0;
+		l->t = r->t;
+		l->tk = r->tk;
+	}
+	l->c += r->c;
+	return 1;
+}
+
+/*
+ * Write the integer expression p as a linear function of one of the
+ * basic induction variables.  Temporaries assigned such a function
+ * in the loop (derived induction variables) are looked through.
+ */
+static int
+ivlinear(NODE *p, struct ivlin *l, int depth)
+{
+	struct interpass *ip;
+	struct ivlin r;
+	CONSZ m;
+	int c, t;
+
+	l->iv = NULL;
+	l->t = NULL;
+	l->k = l->tk = l->c = 0;
+	if (p->n_op == ICON) {
+		if (p->n_name[0])
+			return 0;
+		l->c = getlval(p);
+		return 1;
+	}
+	if (ISPTR(p->n_type) || ivtsize(p->n_type) == 0 || depth > 8)
+		return 0;
+	if (licminv(p, &c)) {
+		l->t = p;
+		l->tk = 1;
+		return 1;
+	}
+	switch (p->n_op) {
+	case TEMP:
+		if ((l->iv = ivfind(regno(p))) != NULL) {
+			l->k = 1;
+			return 1;
+		}
+		t = regno(p) - licmlow;
+		if (t < 0 || t >= licmsz || licmdefs[t] != 1 ||
+		    (ip = ivdefs[t]) == NULL)
+			return 0;
+		return ivlinear(ip->ip_node->n_right, l, depth+1);
+
+	case PLUS:
+	case MINUS:
+		if (!ivlinear(p->n_left, l, depth+1) ||
+		    !ivlinear(p->n_right, &r, depth+1))
+			return 0;
+		if (p->n_op == MINUS) {
+			r.k = -r.k;
+			r.tk = -r.tk;
+			r.c = -r.c;
+		}
+		return ivadd(l, &r);
+
+	case MUL:
+	case LS:
+		if (p->n_right->n_op != ICON || p->n_right->n_name[0])
+			return 0;
+		m = getlval(p->n_right);
+		if (p->n_op == LS) {
+			if (m < 0 || m > 16)
+				return 0;
+			m = (CONSZ)1 << m;
+		}
+		if (m < -65536 || m > 65536 || !ivlinear(p->n_left, l, depth+1))
+			return 0;
+		l->k *= m;
+		l->tk *= m;
+		l->c *= m;
+		return l->k > -(1 << 24) && l->k < (1 << 24);
+
+	case SCONV:
+		/* must not change the value of an index in range */
+		t = ivtsize(p->n_left->n_type);
+		if (t == 0 || ISPTR(p->n_left->n_type) ||
+		    (t != ivtsize(p->n_type) &&
+		    (t > ivtsize(p->n_type) || !ivsigned(p->n_left->n_type))))
+			return 0;
+		return ivlinear(p->n_left, l, depth+1);
+	}
+	return 0;
+}
+
+/*
+ * Split the address p into base + iv*k + t*tk + c.
+ */
+static int
+ivaddr(NODE *p, NODE **base, struct ivlin *l, TWORD *otype)
+{
+	struct ivlin r;
+	int c;
+
+	if ((p->n_op == TEMP && licminv(p, &c)) ||
+	    (p->n_op == ICON && p->n_name[0])) {
+		*base = p;
+		l->iv = NULL;
+		l->t = NULL;
+		l->k = l->tk = 0;
+		l->c = p->n_op == ICON ? getlval(p) : 0;
+		return 1;
+	}
+	if ((p->n_op != PLUS && p->n_op != MINUS) ||
+	    !ISPTR(p->n_left->n_type) || ISPTR(p->n_right->n_type))
+		return 0;
+	if (!ivaddr(p->n_left, base, l, otype) ||
+	    !ivlinear(p->n_right, &r, 0))
+		return 0;
+	if (p->n_op == MINUS) {
+		r.k = -r.k;
+		r.tk = -r.tk;
+		r.c = -r.c;
+	}
+	*otype = p->n_right->n_type;
+	return ivadd(l, &r);
+}
+
+static int
+ivsame(NODE *a, NODE *b)
+{
+	if (a == NULL || b == NULL)
+		return a == b;
+	if (a->n_op != b->n_op || a->n_type != b->n_type)
+		return 0;
+	switch (optype(a->n_op)) {
+	case LTYPE:
+		if (a->n_op == TEMP)
+			return regno(a) == regno(b);
+		return getlval(a) == getlval(b) &&
+		    strcmp(a->n_name, b->n_name) == 0;
+	case UTYPE:
+		return ivsame(a->n_left, b->n_left);
+	}
+	return ivsame(a->n_left, b->n_left) && ivsame(a->n_right, b->n_right);
+}
+
+/*
+ * Make p a reference to temporary t.
+ */
+static void
+ivtemp(NODE *p, int t, TWORD type)
+{
+	p->n_op = TEMP;
+	p->n_type = type;
+	p->n_name = "";
+	p->n_ap = NULL;
+	setlval(p, 0);
+	regno(p) = t;
+}
+
+static NODE *
+ivmul(NODE *p, CONSZ k, TWORD t)
+{
+	int s;
+
+	if (p->n_op == ICON && p->n_name[0] == 0) {
+		setlval(p, getlval(p) * k);
+		p->n_type = t;
+		return p;
+	}
+	if (p->n_type != t)
+		p = mkunode(SCONV, p, 0, t);
+	for (s = 0; s < 16 && ((CONSZ)1 << s) != k; s++)
+		;
+	if (s == 16)
+		p = mkbinode(MUL, p, mklnode(ICON, k, 0, t), t);
+	else if (s > 0)
+		p = mkbinode(LS, p, mklnode(ICON, s, 0, INT), t);
+	return p;
+}
+
+/*
+ * The value of pointer pp when its variable is x.
+ */
+static NODE *
+ivval(struct ivptr *pp, NODE *x)
+{
+	NODE *p, *q;
+
+	p = ivmul(x, pp->k, pp->otype);
+	if (pp->t != NULL)
+		p = mkbinode(PLUS, p, ivmul(tcopy(pp->t), pp->tk, pp->otype),
+		    pp->otype);
+	q = tcopy(pp->base);
+	if (p->n_op == ICON && p->n_name[0] == 0 &&
+	    (q->n_op == ICON || getlval(p) == 0)) {
+		/* constant start, as a plain address */
+		setlval(q, getlval(q) + getlval(p));
+		q->n_type = pp->type;
+		nfree(p);
+		return q;
+	}
+	return mkbinode(PLUS, q, p, pp->type);
+}
+
+/*
+ * The constant assigned to temporary t, or NULL.
+ */
+static NODE *
+ivconst(int t)
+{
+	NODE *p;
+
+	t -= licmlow;
+	if (t < 0 || t >= licmsz || ivdefs[t] == NULL)
+		return NULL;
+	p = ivdefs[t]->ip_node->n_right;
+	return p->n_op == ICON && p->n_name[0] == 0 ? p : NULL;
+}
+
+/*
+ * Pointers to different types can share a temporary if they have
+ * the same representation, which char pointers may not have on word
+ * addressed machines.
+ */
+static int
+ivptrtype(TWORD a, TWORD b)
+{
+	if (a == b)
+		return 1;
+	a = DECREF(a);
+	b = DECREF(b);
+	return a > UCHAR && a != VOID && b > UCHAR && b != VOID &&
+	    SZPOINT(INCREF(a)) == SZPOINT(INCREF(b));
+}
+
+/*
+ * Make a statement assigning p to the new temporary t.
+ */
+static struct interpass *
+ivasg(int t, NODE *p)
+{
+	struct interpass *ip;
+
+	ip = ipnode(mkbinode(ASSIGN, mktemp(t, p->n_type), p, p->n_type));
+	licmdefs[t - licmlow] = 1;
+	return ip;
+}
+
+static struct ivptr *
+ivnewptr(struct loop *lp, struct ivvar *iv, NODE *base, struct ivlin *l,
+    TWORD type, TWORD otype)
+{
+	struct ivptr *pp;
+	struct interpass *ip;
+	struct phiinfo *phi;
+	struct cfgnode *cn;
+	NODE *q;
+	int j, p0;
+
+	pp = tmpcalloc(sizeof(struct ivptr));
+	pp->base = tcopy(base);
+	setlval(pp->base, 0);
+	pp->t = l->t ? tcopy(l->t) : NULL;
+	pp->k = l->k;
+	pp->tk = l->tk;
+	pp->type = type;
+	pp->otype = otype;
+	pp->next = iv->ptrs;
+	iv->ptrs = pp;
+	p0 = p2env.epp->ip_tmpnum++;
+	pp->p1 = p2env.epp->ip_tmpnum++;
+	pp->p2 = p2env.epp->ip_tmpnum++;
+
+	/* starting value in the preheader */
+	if ((q = ivconst(iv->init)) != NULL)
+		q = tcopy(q);
+	else
+		q = mktemp(iv->init, iv->phi->n_type);
+	ip = ivasg(p0, ivval(pp, q));
+	licmput(lp, ip);
+	ivdef(p0, ip, lp->pre);
+	pp->ip0 = ip;
+
+	/* step along with the variable */
+	ip = ivasg(pp->p2, mkbinode(PLUS, mktemp(pp->p1, type),
+	    mklnode(ICON, iv->step * pp->k, 0, otype), type));
+	DLIST_INSERT_AFTER(iv->stepip, ip, qelem);
+	if (iv->stepbb->last == iv->stepip)
+		iv->stepbb->last = ip;
+	ivdef(pp->p2, ip, iv->stepbb);
+	pp->ip2 = ip;
+	ivdef(pp->p1, NULL, lp->header);
+	j = pp->p1 - licmlow;
+	BITSET(licmset, j);
+	j = pp->p2 - licmlow;
+	BITSET(licmset, j);
+
+	phi = tmpcalloc(sizeof(struct phiinfo));
+	phi->tmpregno = phi->newtmpregno = pp->p1;
+	phi->n_type = type;
+	phi->size = iv->phi->size;
+	phi->intmpregno = tmpcalloc(phi->size * sizeof(int));
+	j = 0;
+	SLIST_FOREACH(cn, &lp->header->parents, cfgelem) {
+		if (cn->bblock == lp->pre)
+			phi->intmpregno[j] = p0;
+		else if (iv->phi->intmpregno[j] == iv->stept)
+			phi->intmpregno[j] = pp->p2;
+		j++;
+	}
+	SLIST_INSERT_LAST(&lp->header->phi, phi, phielem);
+	pp->phi = phi;
+	BDEBUG(("ivsr: pointer %d for variable %d\n", pp->p1,
+	    iv->phi->newtmpregno));
+	return pp;
+}
+
+/*
+ * Replace the address p with a pointer.
+ */
+static void
+ivreplace(struct loop *lp, NODE *p, NODE *base, struct ivlin *l,
+    TWORD otype)
+{
+	struct ivptr *pp;
+	struct ivundo *u;
+
+	for (pp = l->iv->ptrs; pp; pp = pp->next)
+		if (pp->k == l->k && pp->tk == l->tk &&
+		    ivptrtype(pp->type, p->n_type) &&
+		    pp->otype == otype && pp->base->n_op == base->n_op &&
+		    (base->n_op == TEMP ? regno(pp->base) == regno(base) :
+		    strcmp(pp->base->n_name, base->n_name) == 0) &&
+		    ivsame(pp->t, l->t))
+			break;
+	if (pp == NULL)
+		pp = ivnewptr(lp, l->iv, base, l, p->n_type, otype);
+	u = tmpalloc(sizeof(struct ivundo));
+	u->p = p;
+	u->n = *p;
+	u->next = l->iv->undo;
+	l->iv->undo = u;
+	if (l->c == 0) {
+		ivtemp(p, pp->p1, p->n_type);
+	} else {
+		p->n_op = PLUS;
+		p->n_left = mktemp(pp->p1, p->n_type);
+		p->n_right = mklnode(ICON, l->c, 0, otype);
+	}
+}
+
+static void
+ivscan(struct loop *lp, NODE *p)
+{
+	struct ivlin l;
+	NODE *base;
+	TWORD otype;
+
+	if (ISPTR(p->n_type) && (p->n_op == PLUS || p->n_op == MINUS) &&
+	    ivaddr(p, &base, &l, &otype) && l.iv != NULL && l.k != 0) {
+		ivreplace(lp, p, base, &l, otype);
+		return;
+	}
+	if (optype(p->n_op) != LTYPE)
+		ivscan(lp, p->n_left);
+	if (optype(p->n_op) == BITYPE)
+		ivscan(lp, p->n_right);
+}
+
+/*
+ * Find the basic induction variables of lp.
+ */
+static void
+ivfindvars(struct loop *lp)
+{
+	struct phiinfo *phi;
+	struct cfgnode *cn;
+	struct ivvar *iv;
+	struct interpass *ip;
+	NODE *p;
+	int init, stept, j, t;
+
+	ivvars = NULL;
+	SLIST_FOREACH(phi, &lp->header->phi, phielem) {
+		if (ISPTR(phi->n_type) || ivtsize(phi->n_type) == 0)
+			continue;
+		init = stept = j = 0;
+		SLIST_FOREACH(cn, &lp->header->parents, cfgelem) {
+			t = phi->intmpregno[j++];
+			if (cn->bblock == lp->pre)
+				init = t;
+			else if (cn->bblock->dfnum == 0)
+				continue;
+			else if (stept == 0)
+				stept = t;
+			else if (stept != t)
+				break;
+		}
+		if (cn != NULL || init <= 0 || stept <= 0)
+			continue;
+		t = stept - licmlow;
+		if (t < 0 || t >= licmsz || licmdefs[t] != 1 ||
+		    (ip = ivdefs[t]) == NULL ||
+		    !TESTBIT(lp->blocks, ivdefbb[t]->dfnum))
+			continue;
+		p = ip->ip_node->n_right;
+		if ((p->n_op != PLUS && p->n_op != MINUS) ||
+		    p->n_type != phi->n_type || p->n_left->n_op != TEMP ||
+		    regno(p->n_left) != phi->newtmpregno ||
+		    p->n_right->n_op != ICON || p->n_right->n_name[0] ||
+		    getlval(p->n_right) == 0)
+			continue;
+		iv = tmpcalloc(sizeof(struct ivvar));
+		iv->phi = phi;
+		iv->init = init;
+		iv->stept = stept;
+		iv->stepip = ip;
+		iv->stepbb = ivdefbb[t];
+		iv->step = getlval(p->n_right);
+		if (p->n_op == MINUS)
+			iv->step = -iv->step;
+		iv->next = ivvars;
+		ivvars = iv;
+		BDEBUG(("ivsr: variable %d step " CONFMT "\n",
+		    phi->newtmpregno, iv->step));
+	}
+}
+
+static int
+ivcount(NODE *p, int t)
+{
+	int n = 0;
+
+	if (p->n_op == ASSIGN && p->n_left->n_op == TEMP)
+		return ivcount(p->n_right, t);
+	if (p->n_op == TEMP)
+		return regno(p) == t;
+	if (optype(p->n_op) != LTYPE)
+		n += ivcount(p->n_left, t);
+	if (optype(p->n_op) == BITYPE)
+		n += ivcount(p->n_right, t);
+	return n;
+}
+
+static void
+ivusecnt(NODE *p, int *nuse, int d)
+{
+	int t;
+
+	if (p->n_op == ASSIGN && p->n_left->n_op == TEMP) {
+		ivusecnt(p->n_right, nuse, d);
+	} else if (p->n_op == TEMP) {
+		t = regno(p) - licmlow;
+		if (t >= 0 && t < licmsz)
+			nuse[t] += d;
+	} else if (optype(p->n_op) != LTYPE) {
+		ivusecnt(p->n_left, nuse, d);
+		if (optype(p->n_op) == BITYPE)
+			ivusecnt(p->n_right, nuse, d);
+	}
+}
+
+/*
+ * Count the uses of each temporary, phi arguments included.
+ */
+static void
+ivusesall(struct p2env *p2e, int *nuse)
+{
+	struct basicblock *bb;
+	struct interpass *ip;
+	struct phiinfo *phi;
+	int i, t;
+
+	memset(nuse, 0, licmsz * sizeof(int));
+	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
+		SLIST_FOREACH(phi, &bb->phi, phielem)
+			for (i = 0; i < phi->size; i++)
+				if ((t = phi->intmpregno[i] - licmlow) >= 0 &&
+				    t < licmsz)
+					nuse[t]++;
+		for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+			if (ip->type == IP_NODE)
+				ivusecnt(ip->ip_node, nuse, 1);
+			if (ip == bb->last)
+				break;
+		}
+	}
+}
+
+/*
+ * Delete copies to unused temporaries, like the old value saved
+ * by a postfix increment.  They would keep variables alive.
+ */
+static void
+ivdelcopies(struct p2env *p2e)
+{
+	struct basicblock *bb;
+	struct interpass *ip, *nip, *last;
+	int *nuse, t;
+	NODE *p;
+
+	nuse = tmpalloc(licmsz * sizeof(int));
+	ivusesall(p2e, nuse);
+	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
+		last = bb->last;
+		for (ip = bb->first; ; ip = nip) {
+			nip = DLIST_NEXT(ip, qelem);
+			p = ip->type == IP_NODE ? ip->ip_node : NULL;
+			if (p && p->n_op == ASSIGN &&
+			    p->n_left->n_op == TEMP && p->n_right->n_op == TEMP &&
+			    (t = regno(p->n_left) - licmlow) >= 0 &&
+			    t < licmsz && nuse[t] == 0 && licmdefs[t] == 1 &&
+			    (ip != bb->first || ip != bb->last)) {
+				if ((t = regno(p->n_right) - licmlow) >= 0 &&
+				    t < licmsz)
+					nuse[t]--;
+				if (ip == bb->first)
+					bb->first = nip;
+				if (ip == bb->last)
+					bb->last = DLIST_PREV(ip, qelem);
+				DLIST_REMOVE(ip, qelem);
+				tfree(p);
+			}
+			if (ip == last)
+				break;
+		}
+	}
+}
+
+/*
+ * Number of uses of temporary t.
+ */
+static int
+ivuses(struct p2env *p2e, int t)
+{
+	struct basicblock *bb;
+	struct interpass *ip;
+	struct phiinfo *phi;
+	int i, n = 0;
+
+	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
+		SLIST_FOREACH(phi, &bb->phi, phielem)
+			for (i = 0; i < phi->size; i++)
+				n += phi->intmpregno[i] == t;
+		for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+			if (ip->type == IP_NODE)
+				n += ivcount(ip->ip_node, t);
+			if (ip == bb->last)
+				break;
+		}
+	}
+	return n;
+}
+
+/*
+ * Delete derived variables in lp that are no longer used.
+ */
+static void
+ivdelderived(struct p2env *p2e, struct loop *lp)
+{
+	struct basicblock *bb;
+	struct interpass *ip, *nip, *last;
+	struct ivlin l;
+	NODE *p;
+	int i, ch;
+
+again:	ch = 0;
+	for (i = 1; i < p2e->bbinfo.size; i++) {
+		if (!TESTBIT(lp->blocks, i))
+			continue;
+		bb = p2e->bbinfo.arr[i];
+		last = bb->last;
+		for (ip = bb->first; ; ip = nip) {
+			nip = DLIST_NEXT(ip, qelem);
+			p = ip->type == IP_NODE ? ip->ip_node : NULL;
+			if (p && p->n_op == ASSIGN && p->n_left->n_op == TEMP &&
+			    (ip != bb->first || ip != bb->last) &&
+			    ivlinear(p->n_right, &l, 0) && l.iv != NULL &&
+			    ivuses(p2e, regno(p->n_left)) == 0) {
+				if (ip == bb->first)
+					bb->first = nip;
+				if (ip == bb->last)
+					bb->last = DLIST_PREV(ip, qelem);
+				DLIST_REMOVE(ip, qelem);
+				tfree(p);
+				ch = 1;
+			}
+			if (ip == last)
+				break;
+		}
+	}
+	if (ch)
+		goto again;
+}
+
+/*
+ * Do what ivdelderived() would do to the use counts in nuse,
+ * without deleting anything.  Deleted temporaries get count -1.
+ */
+static void
+ivsimdel(struct p2env *p2e, struct loop *lp, int *nuse)
+{
+	struct basicblock *bb;
+	struct interpass *ip;
+	struct ivlin l;
+	NODE *p;
+	int i, t, ch;
+
+	ivusesall(p2e, nuse);
+again:	ch = 0;
+	for (i = 1; i < p2e->bbinfo.size; i++) {
+		if (!TESTBIT(lp->blocks, i))
+			continue;
+		bb = p2e->bbinfo.arr[i];
+		for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+			p = ip->type == IP_NODE ? ip->ip_node : NULL;
+			if (p && p->n_op == ASSIGN && p->n_left->n_op == TEMP &&
+			    (ip != bb->first || ip != bb->last) &&
+			    (t = regno(p->n_left) - licmlow) >= 0 &&
+			    t < licmsz && nuse[t] == 0 &&
+			    ivlinear(p->n_right, &l, 0) && l.iv != NULL) {
+				nuse[t] = -1;
+				ivusecnt(p->n_right, nuse, -1);
+				ch = 1;
+			}
+			if (ip == bb->last)
+				break;
+		}
+	}
+	if (ch)
+		goto again;
+}
+
+/*
+ * Unlink ip from bb.
+ */
+static void
+ivunlink(struct basicblock *bb, struct interpass *ip)
+{
+	if (bb->first == ip)
+		bb->first = DLIST_NEXT(ip, qelem);
+	if (bb->last == ip)
+		bb->last = DLIST_PREV(ip, qelem);
+	DLIST_REMOVE(ip, qelem);
+	tfree(ip->ip_node);
+}
+
+static void
+ivunphi(struct basicblock *bb, struct phiinfo *phi)
+{
+	struct phiinfo **pl;
+
+	for (pl = &bb->phi.q_forw; *pl != phi; pl = &(*pl)->phielem.q_forw)
+		;
+	if ((*pl = phi->phielem.q_forw) == NULL)
+		bb->phi.q_last = pl;
+}
+
+/*
+ * Put back the addresses replaced by pointers to iv and delete
+ * the pointers.
+ */
+static void
+ivundo(struct loop *lp, struct ivvar *iv)
+{
+	struct ivundo *u;
+	struct ivptr *pp;
+	NODE *p;
+
+	for (u = iv->undo; u; u = u->next) {
+		p = u->p;
+		if (p->n_op == PLUS) {
+			tfree(p->n_left);
+			tfree(p->n_right);
+		}
+		*p = u->n;
+	}
+	iv->undo = NULL;
+	for (pp = iv->ptrs; pp; pp = pp->next) {
+		ivunlink(lp->pre, pp->ip0);
+		ivunlink(iv->stepbb, pp->ip2);
+		ivunphi(lp->header, pp->phi);
+		tfree(pp->base);
+		if (pp->t != NULL)
+			tfree(pp->t);
+		BDEBUG(("ivsr: pointer %d deleted\n", pp->p1));
+	}
+	iv->ptrs = NULL;
+}
+
+/*
+ * Linear function test replacement.  If the only other use of iv
+ * is a compare with an invariant, compare a pointer instead.
+ * With use counts nuse only check if it can be done.
+ */
+static int
+ivlftr(struct p2env *p2e, struct loop *lp, struct ivvar *iv, int *nuse)
+{
+	struct interpass *ip;
+	struct ivptr *pp;
+	NODE *p, *q, *n, *c0;
+	int i, v, o, c, ni, ns, t;
+
+	for (pp = iv->ptrs; pp; pp = pp->next)
+		if (pp->k > 0)
+			break;
+	if (pp == NULL)
+		return 0;
+
+	v = iv->phi->newtmpregno;
+	p = q = n = NULL;
+	for (i = 1; i < p2e->bbinfo.size; i++) {
+		if (!TESTBIT(lp->blocks, i))
+			continue;
+		ip = p2e->bbinfo.arr[i]->last;
+		if (ip->type != IP_NODE || ip->ip_node->n_op != CBRANCH)
+			continue;
+		p = ip->ip_node->n_left;
+		if (p->n_op < EQ || p->n_op > UGT)
+			continue;
+		q = p->n_left, n = p->n_right;
+		if (n->n_op == TEMP && (regno(n) == v || regno(n) == iv->stept))
+			q = p->n_right, n = p->n_left;
+		if (q->n_op == TEMP &&
+		    (regno(q) == v || regno(q) == iv->stept) &&
+		    (n->n_op != ICON || !n->n_name[0]) && licminv(n, &c))
+			break;
+	}
+	if (i == p2e->bbinfo.size)
+		return 0;
+
+	/* nothing else may use the variable */
+	for (ns = i = 0; i < iv->phi->size; i++)
+		ns += iv->phi->intmpregno[i] == iv->stept;
+	ni = 1;
+	if (regno(q) == v)
+		ni++;
+	else
+		ns++;
+	if (nuse != NULL) {
+		if ((t = v - licmlow) < 0 || t >= licmsz || nuse[t] != ni ||
+		    (t = iv->stept - licmlow) < 0 || t >= licmsz ||
+		    nuse[t] != ns)
+			return 0;
+	} else if (ivuses(p2e, v) != ni || ivuses(p2e, iv->stept) != ns)
+		return 0;
+
+	/*
+	 * The pointers may be compared as signed if they are wide
+	 * enough to hold any value of the variable times k.  Otherwise
+	 * only if the variable starts below the limit and steps by one
+	 * so that the pointers stay in the object.
+	 */
+	o = p->n_op;
+	if (o != EQ && o != NE) {
+		if (!ivsigned(iv->phi->n_type) || o > GT)
+			return 0;
+		if (SZPOINT(pp->type) >= ivtsize(iv->phi->n_type) + 32 &&
+		    pp->k < 65536 && (pp->t == NULL ||
+		    (ivtsize(pp->t->n_type) <= ivtsize(iv->phi->n_type) &&
+		    pp->tk > -65536 && pp->tk < 65536)))
+			;
+		else if (iv->step == 1 && n->n_op == ICON &&
+		    (c0 = ivconst(iv->init)) != NULL && getlval(c0) <= getlval(n))
+			o += ULE - LE;
+		else
+			return 0;
+	}
+	if (nuse != NULL)
+		return 1;
+	BDEBUG(("ivsr: test of %d replaced by %d\n", v, pp->p1));
+
+	t = p2env.epp->ip_tmpnum++;
+	ip = ivasg(t, ivval(pp, tcopy(n)));
+	licmput(lp, ip);
+	ivdef(t, ip, lp->pre);
+	if (p->n_left == n)
+		p->n_left = mktemp(t, pp->type);
+	else
+		p->n_right = mktemp(t, pp->type);
+	tfree(n);
+	ivtemp(q, regno(q) == v ? pp->p1 : pp->p2, pp->type);
+	p->n_op = o;
+
+	/* the variable is dead now */
+	ivunlink(iv->stepbb, iv->stepip);
+	ivunphi(lp->header, iv->phi);
+	return 1;
+}
+
+static void
+ivsr(struct p2env *p2e)
+{
+	struct basicblock *bb;
+	struct interpass *ip;
+	struct phiinfo *phi;
+	struct loop *lp;
+	struct ivvar *iv;
+	struct ivptr *pp;
+	struct ivundo *u;
+	int *nuse, i, n;
+
+	findloops(p2e);
+	if (SLIST_ISEMPTY(&p2e->loops))
+		return;
+
+	/* each address may need three temporaries and each test one */
+	n = 0;
+	DLIST_FOREACH(ip, &p2e->ipole, qelem)
+		if (ip->type == IP_NODE)
+			walkf(ip->ip_node, gvncount, &n);
+	licminit(p2e, 4 * n);
+	ivdelcopies(p2e);
+	ivdefs = tmpcalloc(licmsz * sizeof(struct interpass *));
+	ivdefbb = tmpcalloc(licmsz * sizeof(struct basicblock *));
+	nuse = tmpalloc(licmsz * sizeof(int));
+	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
+		SLIST_FOREACH(phi, &bb->phi, phielem)
+			ivdef(phi->newtmpregno, NULL, bb);
+		for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+			if (ip->type == IP_NODE && ip->ip_node->n_op == ASSIGN &&
+			    ip->ip_node->n_left->n_op == TEMP)
+				ivdef(regno(ip->ip_node->n_left), ip, bb);
+			if (ip == bb->last)
+				break;
+		}
+	}
+
+	SLIST_FOREACH(lp, &p2e->loops, loopelem) {
+		if (lp->pre == NULL)
+			continue;
+		licmmark(p2e, lp);
+		ivfindvars(lp);
+		if (ivvars == NULL)
+			continue;
+		for (i = 1; i < p2e->bbinfo.size; i++) {
+			if (!TESTBIT(lp->blocks, i))
+				continue;
+			bb = p2e->bbinfo.arr[i];
+			for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+				if (ip->type == IP_NODE)
+					ivscan(lp, ip->ip_node);
+				if (ip == bb->last)
+					break;
+			}
+		}
+
+		/*
+		 * Keep the pointers if the variable goes away or some
+		 * address can not be done with a scaled index.
+		 */
+		ivsimdel(p2e, lp, nuse);
+		for (iv = ivvars; iv; iv = iv->next) {
+			for (pp = iv->ptrs; pp; pp = pp->next)
+				if (!IVSCALE(pp->k) || pp->t != NULL)
+					break;
+			if (iv->ptrs != NULL && pp == NULL &&
+			    !ivlftr(p2e, lp, iv, nuse))
+				ivundo(lp, iv);
+			for (u = iv->undo; u; u = u->next) {
+				tfree(u->n.n_left);
+				tfree(u->n.n_right);
+			}
+		}
+		ivdelderived(p2e, lp);
+		for (iv = ivvars; iv; iv = iv->next) {
+			if (iv->ptrs != NULL)
+				ivlftr(p2e, lp, iv, NULL);
+			for (pp = iv->ptrs; pp; pp = pp->next) {
+				tfree(pp->base);
+				if (pp->t != NULL)
+					tfree(pp->t);
+			}
+		}
+	}
+}
+
+#ifdef VECOP
+/*
+ * Loop vectorization, for targets with XTYPE vector registers.  Done
+ * before the SSA passes on innermost loops that look like
+ *
+ *	L1:	if (i >= n) goto L2;	(or i > n)
+ *		body
+ *		i = i + 1;
+ *		goto L1;
+ *
+ * where n is invariant and the body is straight line code of stores
+ * a[i+c] = e, reductions s = s op e and copies of i.  The expressions
+ * e may use loads b[i+c], invariants and the operations VECOP()
+ * allows.  All elements must have the same size.  A vector loop doing
+ * several iterations at a time is put in front of the loop, which is
+ * left to do the rest.  Arrays that may overlap are checked at run
+ * time, and the vector loop is skipped if they are too close.
+ */
+#define	VMAXREF	16		/* memory references and statements */
+#define	VMAXCHK	6		/* run time overlap checks */
+
+struct vref {
+	NODE *base;		/* invariant TEMP or named ICON */
+	CONSZ off;		/* bytes from base when i is 0 */
+	int st;			/* stored to */
+};
+
+struct vstmt {
+	struct interpass *ip;
+	NODE *e;		/* vectorized expression */
+	NODE *acc;		/* accumulator of a reduction */
+	int op;			/* of a reduction, else 0 */
+	int t;			/* reduction or copy temporary */
+};
+
+static struct vref vrefs[VMAXREF];
+static struct vstmt vstmts[VMAXREF];
+static NODE *vnames[VMAXREF];	/* scalar NAMEs read */
+static int nvref, nvstmt, nvname;
+static int vesz, vlen;		/* element size in bytes, and count */
+static int vivar;		/* induction variable */
+static TWORD vetype;		/* element type of the statement */
+static struct interpass *vpos;	/* where the new code goes */
+
+static int vswaprel[] = { EQ, NE, GE, GT, LE, LT, UGE, UGT, ULE, ULT };
+
+static int
+vtsize(TWORD t)
+{
+	switch (t) {
+	case CHAR: case UCHAR:
+		return 1;
+	case SHORT: case USHORT:
+		return SZSHORT/SZCHAR;
+	case INT: case UNSIGNED:
+		return SZINT/SZCHAR;
+	case LONG: case ULONG:
+		return SZLONG/SZCHAR;
+	case LONGLONG: case ULONGLONG:
+		return SZLONGLONG/SZCHAR;
+	case FLOAT:
+		return SZFLOAT/SZCHAR;
+	case DOUBLE:
+		return SZDOUBLE/SZCHAR;
+	}
+	return 0;
+}
+
+static int
+vinv(NODE *p)
+{
+	int t = regno(p) - licmlow;
+
+	return t >= 0 && t < licmsz && !TESTBIT(licmset, t);
+}
+
+/*
+ * Is p the induction variable plus a constant c?
+ */
+static int
+vindex(NODE *p, CONSZ *c)
+{
+	*c = 0;
+	if (p->n_op == SCONV) {
+		p = p->n_left;
+		/* i + c may wrap before it is widened */
+		if (ISUNSIGNED(p->n_type) && p->n_op != TEMP)
+			return 0;
+	}
+	if ((p->n_op == PLUS || p->n_op == MINUS) &&
+	    p->n_right->n_op == ICON && p->n_right->n_name[0] == 0) {
+		*c = getlval(p->n_right);
+		if (p->n_op == MINUS)
+			*c = -*c;
+		p = p->n_left;
+	}
+	return p->n_op == TEMP && regno(p) == vivar;
+}
+
+/*
+ * Is p the address of a[i+c]?  Note the reference.
+ */
+static int
+vaddr(NODE *p, int st)
+{
+	NODE *b, *x;
+	CONSZ c, off;
+
+	if (p->n_op != PLUS || nvref == VMAXREF)
+		return 0;
+	b = p->n_left, x = p->n_right;
+	if (b->n_op != TEMP && b->n_op != ICON)
+		b = p->n_right, x = p->n_left;
+	off = 0;
+	if (b->n_op == ICON) {
+		if (b->n_name[0] == 0)
+			return 0;
+		off = getlval(b);
+	} else if (b->n_op != TEMP || !vinv(b))
+		return 0;
+	if (x->n_op == SCONV && vtsize(x->n_type) != 0 &&
+	    vtsize(x->n_type) == vtsize(x->n_left->n_type))
+		x = x->n_left;	/* sign change only */
+	if (vesz > 1) {
+		if (x->n_op != LS || x->n_right->n_op != ICON ||
+		    getlval(x->n_right) < 1 || getlval(x->n_right) > 3 ||
+		    1 << getlval(x->n_right) != vesz)
+			return 0;
+		x = x->n_left;
+	}
+	if (!vindex(x, &c))
+		return 0;
+	vrefs[nvref].base = b;
+	vrefs[nvref].off = off + c * vesz;
+	vrefs[nvref].st = st;
+	nvref++;
+	return 1;
+}
+
+/*
+ * Can p be computed on vectors of vesz byte elements?  If tr is set
+ * only the low vesz bytes of the value are used, so wider integer
+ * operations that do not depend on the upper bits are fine too.
+ */
+static int
+vexpr(NODE *p, int tr)
+{
+	TWORD t = p->n_type, lt;
+	int o = p->n_op, sz = vtsize(t), fp;
+
+	fp = (t == FLOAT || t == DOUBLE);
+	if (sz == 0 || fp != (vetype == FLOAT || vetype == DOUBLE) ||
+	    (fp && t != vetype) || sz < vesz || (sz > vesz && !tr) ||
+	    ISVOL(p->n_qual << TSHIFT))
+		return 0;
+	lt = sz == vesz ? t : vetype;
+
+	switch (o) {
+	case TEMP:
+		return vinv(p);
+	case ICON:
+		return p->n_name[0] == 0;
+	case FCON:
+		return 1;
+	case NAME:
+		if (!ISCON(p->n_qual << TSHIFT)) {
+			if (nvname == VMAXREF)
+				return 0;
+			vnames[nvname++] = p;
+		}
+		return 1;
+	case UMUL:
+		return sz == vesz && vaddr(p->n_left, 0);
+	case SCONV:
+		t = p->n_left->n_type;
+		if (fp || t == FLOAT || t == DOUBLE)
+			return 0;
+		return vexpr(p->n_left, tr || vtsize(t) > vesz);
+	case DIV:
+	case RS:
+		if (sz != vesz)
+			return 0; /* needs the upper bits */
+		/* FALLTHROUGH */
+	case LS:
+		if (o != DIV) {
+			if (p->n_right->n_op != ICON || p->n_right->n_name[0] ||
+			    getlval(p->n_right) < 0 ||
+			    getlval(p->n_right) >= vesz * SZCHAR)
+				return 0;
+			return VECOP(o, lt) && vexpr(p->n_left, tr);
+		}
+		break;
+	case UMINUS:
+	case COMPL:
+		return VECOP(o, lt) && vexpr(p->n_left, tr);
+	case PLUS:
+	case MINUS:
+	case MUL:
+	case AND:
+	case OR:
+	case ER:
+		break;
+	default:
+		return 0;
+	}
+	return VECOP(o, lt) && vexpr(p->n_left, tr) && vexpr(p->n_right, tr);
+}
+
+static struct attr *
+vattr(TWORD t)
+{
+	struct attr *ap = attr_new(ATTR_VECTOR, 3);
+
+	ap->iarg(0) = SZXTYPE/SZCHAR;
+	ap->iarg(1) = t;
+	return ap;
+}
+
+/*
+ * Put ip before the loop.
+ */
+static void
+vput(struct interpass *ip)
+{
+	DLIST_INSERT_BEFORE(vpos, ip, qelem);
+}
+
+/*
+ * Return a temporary set to p in all elements before the loop.
+ */
+static NODE *
+vsplat(NODE *p, TWORD t)
+{
+	NODE *q = mkunode(SCONV, p, 0, XTYPE);
+
+	q->n_ap = vattr(t);
+	vput(tempasg(q));
+	return q;
+}
+
+/*
+ * Make the vector version of expression p.
+ */
+static NODE *
+vbuild(NODE *p)
+{
+	TWORD t = vtsize(p->n_type) == vesz ? p->n_type : vetype;
+	NODE *q;
+
+	switch (p->n_op) {
+	case TEMP:
+	case ICON:
+	case FCON:
+	case NAME:
+		return vsplat(tcopy(p), t);
+	case SCONV:
+		return vbuild(p->n_left);
+	case UMUL:
+		q = mkunode(UMUL, tcopy(p->n_left), 0, XTYPE);
+		break;
+	case UMINUS:
+	case COMPL:
+		q = mkunode(p->n_op, vbuild(p->n_left), 0, XTYPE);
+		break;
+	case LS:
+	case RS:
+		q = mkbinode(p->n_op, vbuild(p->n_left),
+		    tcopy(p->n_right), XTYPE);
+		break;
+	default:
+		q = mkbinode(p->n_op, vbuild(p->n_left),
+		    vbuild(p->n_right), XTYPE);
+		break;
+	}
+	q->n_ap = vattr(t);
+	return q;
+}
+
+static int
+vsame(NODE *a, NODE *b)
+{
+	if (a->n_op != b->n_op)
+		return 0;
+	if (a->n_op == TEMP)
+		return regno(a) == regno(b);
+	return strcmp(a->n_name, b->n_name) == 0;
+}
+
+/*
+ * Address of array base b, less its offset.
+ */
+static NODE *
+vbase(NODE *b)
+{
+	NODE *p = tcopy(b);
+
+	if (p->n_op == ICON)
+		setlval(p, 0);
+	return p;
+}
+
+/*
+ * Check the statements of the loop body lb, set up the vector
+ * information and the list of references.  Returns the statement
+ * stepping i, or NULL if the loop cannot be vectorized.
+ */
+static struct interpass *
+vscan(struct basicblock *lb)
+{
+	struct interpass *ip, *incr = NULL;
+	struct vstmt *vs;
+	NODE *p, *l, *r;
+	int i, o;
+
+	nvref = nvstmt = nvname = vesz = 0;
+	for (ip = lb->first; ip != lb->last; ip = DLIST_NEXT(ip, qelem)) {
+		if (ip == lb->first && ip->type == IP_DEFLAB)
+			continue;
+		if (ip->type != IP_NODE || incr != NULL || nvstmt == VMAXREF)
+			return NULL;
+		p = ip->ip_node;
+		if (p->n_op != ASSIGN)
+			return NULL;
+		l = p->n_left, r = p->n_right;
+		vs = &vstmts[nvstmt++];
+		vs->ip = ip;
+		vs->e = NULL;
+		vs->op = vs->t = 0;
+		if (l->n_op == TEMP) {
+			if (regno(l) == vivar) {
+				/* i = i + 1, last */
+				if (r->n_op != PLUS || r->n_left->n_op != TEMP ||
+				    regno(r->n_left) != vivar ||
+				    r->n_right->n_op != ICON ||
+				    r->n_right->n_name[0] ||
+				    getlval(r->n_right) != 1)
+					return NULL;
+				incr = ip;
+				nvstmt--;
+				continue;
+			}
+			for (i = 0; i < nvstmt - 1; i++)
+				if (vstmts[i].t == regno(l))
+					return NULL;
+			vs->t = regno(l);
+			if (r->n_op == TEMP && regno(r) == vivar) {
+				/* copy of i, from i++ */
+				if (l->n_type != r->n_type)
+					return NULL;
+				continue;
+			}
+			/* s = s op e; not floating point, it is not exact */
+			o = r->n_op;
+			if (o != PLUS && o != MINUS && o != AND && o != OR &&
+			    o != ER)
+				return NULL;
+			if (r->n_left->n_op == TEMP &&
+			    regno(r->n_left) == regno(l))
+				vs->e = r->n_right;
+			else if (o != MINUS && r->n_right->n_op == TEMP &&
+			    regno(r->n_right) == regno(l))
+				vs->e = r->n_left;
+			else
+				return NULL;
+			if (l->n_type > ULONGLONG || vtsize(l->n_type) == 0 ||
+			    !VECOP(o, l->n_type))
+				return NULL;
+			vs->op = o;
+		} else if (l->n_op == UMUL) {
+			if (ISVOL(l->n_qual << TSHIFT))
+				return NULL;
+			vs->e = r;
+		} else
+			return NULL;
+
+		if (vesz == 0)
+			vesz = vtsize(l->n_type);
+		if (vesz == 0 || vtsize(l->n_type) != vesz)
+			return NULL;
+		vetype = l->n_type;
+		if (l->n_op == UMUL && !vaddr(l->n_left, 1))
+			return NULL;
+		if (!vexpr(vs->e, 0))
+			return NULL;
+	}
+	if (incr == NULL || vesz == 0)
+		return NULL;
+	vlen = (SZXTYPE/SZCHAR) / vesz;
+	return incr;
+}
+
+
+/*
+ * Vectorize loop lp if it is simple enough.
+ */
+static void
+vecloop(struct p2env *p2e, struct loop *lp)
+{
+	struct basicblock *h = lp->header, *lb = NULL;
+	struct interpass *ip, *incr, vbody;
+	struct vstmt *vs;
+	struct vref *ri, *rj;
+	struct { NODE *a, *b; CONSZ d; } chk[VMAXCHK];
+	NODE *p, *q, *n;
+	TWORD it, pt, t;
+	CONSZ d, w;
+	int i, j, k, o, nchk, line, lh, lv, lr, off;
+
+	for (i = 1; i < p2e->bbinfo.size; i++)
+		if (TESTBIT(lp->blocks, i) && p2e->bbinfo.arr[i] != h)
+			lb = p2e->bbinfo.arr[i];
+	if (lp->nblocks != 2 || h->first->type != IP_DEFLAB ||
+	    DLIST_NEXT(h->first, qelem) != h->last || !isbranch(h->last) ||
+	    h->last->ip_node->n_op != CBRANCH ||
+	    DLIST_NEXT(h->last, qelem) != lb->first || !isbranch(lb->last) ||
+	    lb->last->ip_node->n_op != GOTO ||
+	    lb->last->ip_node->n_left->n_op != ICON ||
+	    getlval(lb->last->ip_node->n_left) != h->first->ip_lbl)
+		return;
+	lh = h->first->ip_lbl;
+	line = h->first->lineno;
+	if (lb->first->type == IP_DEFLAB &&
+	    getlval(h->last->ip_node->n_right) == lb->first->ip_lbl)
+		return; /* the test is not an exit */
+
+	/* the exit test must be i >= n or i > n, n invariant */
+	p = h->last->ip_node->n_left;
+	if ((o = p->n_op) < EQ || o > UGT)
+		return;
+	licmmark(p2e, lp);
+	q = p->n_left, n = p->n_right;
+	if (q->n_op != TEMP || vinv(q))
+		q = p->n_right, n = p->n_left, o = vswaprel[o - EQ];
+	if ((o != GE && o != GT && o != UGE && o != UGT) ||
+	    q->n_op != TEMP || (it = q->n_type) < INT || it > ULONGLONG)
+		return;
+	if (n->n_op == ICON ? n->n_name[0] != 0 :
+	    n->n_op != TEMP || n->n_type != it || !vinv(n))
+		return;
+	vivar = regno(q);
+
+	if ((incr = vscan(lb)) == NULL)
+		return;
+
+	/*
+	 * A store and another reference to the same array must be to
+	 * the same element or at least a vector apart.  Different
+	 * pointers are checked for that at run time.
+	 */
+	w = vlen * vesz;
+	nchk = 0;
+	for (i = 0; i < nvref; i++) {
+		ri = &vrefs[i];
+		if (!ri->st)
+			continue;
+		for (j = 0; j < nvref; j++) {
+			rj = &vrefs[j];
+			if (j == i || (rj->st && j < i))
+				continue;
+			d = rj->off - ri->off;
+			if (vsame(ri->base, rj->base)) {
+				if (d != 0 && d > -w && d < w)
+					return;
+				continue;
+			}
+			if (ri->base->n_op == ICON && rj->base->n_op == ICON)
+				continue; /* different objects */
+			for (k = 0; k < nchk; k++)
+				if (vsame(chk[k].a, ri->base) &&
+				    vsame(chk[k].b, rj->base) && chk[k].d == d)
+					break;
+			if (k < nchk)
+				continue;
+			if (nchk == VMAXCHK)
+				return;
+			chk[nchk].a = ri->base;
+			chk[nchk].b = rj->base;
+			chk[nchk++].d = d;
+		}
+	}
+	/* scalars read may not be stored to */
+	for (k = 0; k < nvname; k++)
+		for (i = 0; i < nvref; i++)
+			if (vrefs[i].st && (vrefs[i].base->n_op != ICON ||
+			    strcmp(vrefs[i].base->n_name,
+			    vnames[k]->n_name) == 0))
+				return;
+
+	if (!mkpreheader(p2e, lp))
+		return;
+	BDEBUG(("vect: loop %d, %d elements of %d bytes, %d checks\n",
+	    lh, vlen, vesz, nchk));
+	vpos = h->first;
+	lv = getlab2();
+	lr = lh;
+	for (vs = vstmts; vs < &vstmts[nvstmt]; vs++)
+		if (vs->op)
+			lr = getlab2();
+
+	/* skip the vector loop if |b + d - a| < w */
+	pt = SZPOINT(CHAR) == SZLONG ? LONG : LONGLONG;
+	for (k = 0; k < nchk; k++) {
+		p = mkbinode(MINUS, vbase(chk[k].b), vbase(chk[k].a), pt);
+		p = mkbinode(PLUS, p, mklnode(ICON, chk[k].d + w - 1, 0, pt), pt);
+		p = mkbinode(ULT, p, mklnode(ICON, 2 * w - 1, 0, pt), INT);
+		vput(ipnode(mkbinode(CBRANCH, p,
+		    mklnode(ICON, lh, 0, INT), INT)));
+	}
+
+	/* accumulators start as 0, or all ones for and */
+	for (vs = vstmts; vs < &vstmts[nvstmt]; vs++) {
+		if (vs->op == 0)
+			continue;
+		t = vs->ip->ip_node->n_type;
+		vs->acc = vsplat(mklnode(ICON, vs->op == AND ? -1 : 0, 0, t), t);
+	}
+
+	/* the body; invariants are set up in front of it */
+	DLIST_INIT(&vbody, qelem);
+	for (vs = vstmts; vs < &vstmts[nvstmt]; vs++) {
+		p = vs->ip->ip_node;
+		vetype = t = p->n_left->n_type;
+		if (vs->op) {
+			q = mkbinode(vs->op, tcopy(vs->acc), vbuild(vs->e),
+			    XTYPE);
+			q->n_ap = vattr(t);
+			q = mkbinode(ASSIGN, tcopy(vs->acc), q, XTYPE);
+		} else if (vs->e) {
+			q = mkbinode(ASSIGN, mkunode(UMUL,
+			    tcopy(p->n_left->n_left), 0, XTYPE),
+			    vbuild(vs->e), XTYPE);
+		} else {
+			/* copy of i, as of the last element */
+			q = mkbinode(PLUS, tcopy(p->n_right),
+			    mklnode(ICON, vlen - 1, 0, t), t);
+			q = mkbinode(ASSIGN, tcopy(p->n_left), q, t);
+		}
+		ip = ipnode(q);
+		ip->lineno = vs->ip->lineno;
+		DLIST_INSERT_BEFORE(&vbody, ip, qelem);
+	}
+
+	/*
+	 * The vector loop runs until i reaches i + (count & -vlen),
+	 * computed once; count is n - i, or n - i + 1 for i > n.
+	 * The exit test in front of it keeps count from going negative.
+	 */
+	p = tcopy(h->last->ip_node);
+	setlval(p->n_right, lr);
+	vput(ipnode(p));
+	p = mkbinode(MINUS, tcopy(n), mktemp(vivar, it), it);
+	if (o == GT || o == UGT)
+		p = mkbinode(PLUS, p, mklnode(ICON, 1, 0, it), it);
+	p = mkbinode(AND, p, mklnode(ICON, -vlen, 0, it), it);
+	p = mkbinode(PLUS, p, mktemp(vivar, it), it);
+	vput(tempasg(p));
+	vput(lymklab(lv, line));
+	p = mkbinode(EQ, mktemp(vivar, it), p, INT);
+	vput(ipnode(mkbinode(CBRANCH, p, mklnode(ICON, lr, 0, INT), INT)));
+	while (!DLIST_ISEMPTY(&vbody, qelem)) {
+		ip = DLIST_NEXT(&vbody, qelem);
+		DLIST_REMOVE(ip, qelem);
+		vput(ip);
+	}
+	p = tcopy(incr->ip_node);
+	setlval(p->n_right->n_right, vlen);
+	vput(ipnode(p));
+	vput(lymkgoto(lv, line));
+	if (lr == lh)
+		return;
+
+	/* add up the elements of the accumulators */
+	vput(lymklab(lr, line));
+	off = freetemp(szty(XTYPE));
+	for (vs = vstmts; vs < &vstmts[nvstmt]; vs++) {
+		if (vs->op == 0)
+			continue;
+		t = vs->ip->ip_node->n_type;
+		vput(ipnode(mkbinode(ASSIGN, storenode(XTYPE, off),
+		    vs->acc, XTYPE)));
+		o = vs->op == MINUS ? PLUS : vs->op;
+		for (k = 0; k < vlen; k++) {
+			p = mkbinode(o, mktemp(vs->t, t),
+			    storenode(t, off + k * vesz), t);
+			vput(ipnode(mkbinode(ASSIGN, mktemp(vs->t, t), p, t)));
+		}
+	}
+}
+
+static void
+vectorize(struct p2env *p2e)
+{
+	struct loop *lp;
+
+	bblocks_build(p2e);
+	cfg_build(p2e);
+	dominators(p2e);
+	findloops(p2e);
+	if (SLIST_ISEMPTY(&p2e->loops))
+		return;
+	licminit(p2e, 0);
+	SLIST_FOREACH(lp, &p2e->loops, loopelem)
+		if (lp->nblocks == 2)
+			vecloop(p2e, lp);
 }
 #endif
 
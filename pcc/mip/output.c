@@ -0,0 +1,297 @@
+/*	$Id$	*/
+/*
+ * Copyright (c) 2026 The pcc project.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Assembler output.
+ *
+ * All output goes through stdio to stdout, which is given a large
+ * fully buffered buffer; stdio decides when to write it out.  The
+ * routines here format numbers, constants and labels without going
+ * through printf.  They are used by expand() for all targets, and by
+ * the amd64 and i386 adrput(), conput(), deflab() and friends.  The
+ * other backends still print with printf, which is fine since it
+ * goes to the same stdio buffer and the order is kept.
+ *
+ * On targets that keep a function as a list of lines (MINSN), the
+ * output of a function is instead caught here line by line and given
+ * to miline() until ocatch(0) is called.
+ */
+
+#include "pass2.h"
+#include <string.h>
+#include <stdarg.h>
+
+#define	OBUFSZ	(256*1024)
+
+static char obuf[OBUFSZ];
+
+/* CONFMT and LABFMT split around the conversion */
+static char *conpre, *consuf, *labpre, *labsuf;
+static int conbase, fmtdone;
+
+/*
+ * Split fmt into the text before and after a single %d, %o or %x
+ * conversion (with any l modifiers).  Return the base, or 0 if the
+ * format is something else.
+ */
+static int
+fmtsplit(char *fmt, char **pre, char **suf)
+{
+	char *s, *p;
+	int base;
+
+	if ((s = strchr(fmt, '%')) == NULL)
+		return 0;
+	for (p = s+1; *p == 'l'; p++)
+		;
+	switch (*p) {
+	case 'd': base = 10; break;
+	case 'o': base = 8; break;
+	case 'x': base = 16; break;
+	default: return 0;
+	}
+	if (strchr(p, '%'))
+		return 0;
+	*pre = xstrdup(fmt);
+	(*pre)[s - fmt] = 0;
+	*suf = p+1;
+	return base;
+}
+
+static void
+fmtinit(void)
+{
+	int base;
+
+	conbase = fmtsplit(CONFMT, &conpre, &consuf);
+	base = fmtsplit(LABFMT, &labpre, &labsuf);
+	if (base != 10)
+		labpre = NULL;
+	fmtdone = 1;
+}
+
+/*
+ * Called when stdout is opened for the assembler output.
+ */
+void
+oinit(void)
+{
+	setvbuf(stdout, obuf, _IOFBF, OBUFSZ);
+}
+
+/*
+ * Print v in base 8, 10 or 16.  Only base 10 is signed.
+ */
+static void
+oputnum(FILE *fp, CONSZ v, int base)
+{
+	static char digs[] = "0123456789abcdef";
+	char buf[32], *s;
+	U_CONSZ u;
+
+	s = &buf[sizeof(buf)];
+	u = (base == 10 && v < 0) ? -(U_CONSZ)v : (U_CONSZ)v;
+	do {
+		*--s = digs[u % base];
+		u /= base;
+	} while (u);
+	if (base == 10 && v < 0)
+		*--s = '-';
+	fwrite(s, 1, &buf[sizeof(buf)] - s, fp);
+}
+
+/*
+ * Print a signed decimal number, like "%lld".
+ */
+void
+oputd(FILE *fp, CONSZ v)
+{
+	oputnum(fp, v, 10);
+}
+
+/*
+ * Print a constant as CONFMT does.
+ */
+void
+oputcon(FILE *fp, CONSZ v)
+{
+	if (fmtdone == 0)
+		fmtinit();
+	if (conbase == 0) {
+		fprintf(fp, CONFMT, v);
+		return;
+	}
+	fputs(conpre, fp);
+	oputnum(fp, v, conbase);
+	fputs(consuf, fp);
+}
+
+/*
+ * Print a label as LABFMT does.
+ */
+void
+oputlab(FILE *fp, int lab)
+{
+	if (fmtdone == 0)
+		fmtinit();
+	if (labpre == NULL) {
+		fprintf(fp, LABFMT, lab);
+		return;
+	}
+	fputs(labpre, fp);
+	oputnum(fp, lab, 10);
+	fputs(labsuf, fp);
+}
+
+#ifdef MINSN
+#undef printf
+#undef fprintf
+#undef putc
+#undef fputc
+#undef fputs
+#undef fwrite
+
+static int ocaught;		/* output is caught */
+static char *lbuf, *fbuf;	/* current line, printf result */
+static size_t lbufsz, llen, fbufsz;
+
+/*
+ * Add n chars at s to the caught output.
+ */
+static void
+ostr(const char *s, size_t n)
+{
+	const char *e;
+	size_t l;
+
+	while (n > 0) {
+		e = memchr(s, '\n', n);
+		l = e ? (size_t)(e - s) : n;
+		if (llen + l + 1 > lbufsz)
+			lbuf = xrealloc(lbuf, lbufsz = (llen + l) * 2 + 128);
+		memcpy(lbuf + llen, s, l);
+		llen += l;
+		if (e == NULL)
+			break;
+		lbuf[llen] = 0;
+		miline(lbuf);
+		llen = 0;
+		s += l + 1;
+		n -= l + 1;
+	}
+}
+
+/*
+ * Start or stop catching the output.
+ */
+void
+ocatch(int on)
+{
+	if (!on && llen) {
+		lbuf[llen] = 0;
+		miline(lbuf);
+	}
+	llen = 0;
+	ocaught = on;
+}
+
+int
+oprintf(const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	if (!ocaught) {
+		n = vprintf(fmt, ap);
+		va_end(ap);
+		return n;
+	}
+	n = vsnprintf(fbuf, fbufsz, fmt, ap);
+	va_end(ap);
+	if (n >= (int)fbufsz) {
+		fbuf = xrealloc(fbuf, fbufsz = n + 256);
+		va_start(ap, fmt);
+		vsnprintf(fbuf, fbufsz, fmt, ap);
+		va_end(ap);
+	}
+	ostr(fbuf, n);
+	return n;
+}
+
+int
+ofprintf(FILE *fp, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	if (!ocaught || fp != stdout) {
+		n = vfprintf(fp, fmt, ap);
+		va_end(ap);
+		return n;
+	}
+	n = vsnprintf(fbuf, fbufsz, fmt, ap);
+	va_end(ap);
+	if (n >= (int)fbufsz) {
+		fbuf = xrealloc(fbuf, fbufsz = n + 256);
+		va_start(ap, fmt);
+		vsnprintf(fbuf, fbufsz, fmt, ap);
+		va_end(ap);
+	}
+	ostr(fbuf, n);
+	return n;
+}
+
+int
+oputc(int c, FILE *fp)
+{
+	char ch = c;
+
+	if (!ocaught || fp != stdout)
+		return putc(c, fp);
+	ostr(&ch, 1);
+	return (unsigned char)c;
+}
+
+int
+ofputs(const char *s, FILE *fp)
+{
+	if (!ocaught || fp != stdout)
+		return fputs(s, fp);
+	ostr(s, strlen(s));
+	return 0;
+}
+
+size_t
+ofwrite(const void *p, size_t sz, size_t n, FILE *fp)
+{
+	if (!ocaught || fp != stdout)
+		return fwrite(p, sz, n, fp);
+	ostr(p, sz * n);
+	return n;
+}
+#endif
@@ -153,6 +153,7 @@ extern struct shape shoreg, shname, shicon, shone, shzero;
 #define	TULONGLONG	0100000	/* unsigned long long */
 #define	TLDOUBLE	0200000	/* long double; exceeds 16 bit */
 #define	TFTN		0400000	/* function pointer; exceeds 16 bit */
+#define	TXTYPE		01000000 /* target-specific (vector) type */
 
 /* reclamation cookies */
 #define RNULL		0	/* clobber result */
@@ -281,6 +282,146 @@ void adrcon(CONSZ);
 void zzzcode(NODE *, int);
 void insput(NODE *);
 void upput(NODE *, int);
+void oinit(void);
+void oputd(FILE *, CONSZ);
+void oputcon(FILE *, CONSZ);
+void oputlab(FILE *, int);
+#ifdef ELFOBJ
+/* integrated assembler, elfobj.c */
+struct assym;
+struct asexp {
+	struct assym *sym, *sub;	/* sym - sub + val */
+	CONSZ val;
+	int mod;			/* AM_* */
+};
+#define	AM_PLT		1	/* sym@PLT etc */
+#define	AM_GOTPCREL	2
+#define	AM_GOT		3
+#define	AM_GOTOFF	4
+#define	AM_TPOFF	5	/* TLS from here on */
+#define	AM_GOTTPOFF	6
+#define	AM_TLSGD	7
+#define	AM_TLSLD	8
+#define	AM_DTPOFF	9
+#define	AF_PCREL	001	/* relative to the end of the instruction */
+#define	AF_BRANCH	002	/* branch target */
+#define	AF_SIGNED	004	/* sign-extended by the instruction */
+#define	AF_TARG		010	/* first flag free for the target */
+int elfobj(char *, char *);
+char *asexpr(char *, struct asexp *);
+void asemit(U_CONSZ, int);
+int asfixup(struct asexp *, int, int, int);
+int asjump(int, int, int, struct asexp *);
+int asinsn(char *, char *);
+int asrtype(int, int, int);
+void asnops(char *, int);
+#endif
+#if defined(PEEPHOLE) || defined(SCHEDULE)
+#define	MINSN		/* output is kept as a minsn list, see peep.c */
+#endif
+#ifdef MINSN
+/* machine-level peephole optimizer, peep.c */
+#define	MAXOPD	4	/* max operands of an instruction */
+#define	PEEPMAX	4	/* max lines in a rule */
+struct minsn {
+	DLIST_ENTRY(minsn) link;
+	int type;		/* MI_* */
+	char *text;		/* line as printed */
+	char *form;		/* line as in the patterns */
+	char *op;		/* opcode or label name */
+	int nopd;
+	char *opd[MAXOPD];	/* operands */
+};
+#define	MI_INSN		1
+#define	MI_LABEL	2
+#define	MI_RAW		3	/* directives, inline asm etc */
+struct peeprule {
+	char *pat[PEEPMAX];	/* lines to match */
+	char *rep[PEEPMAX];	/* replacement */
+	int (*chk)(struct minsn *, char **);
+};
+extern struct peeprule peeptab[];
+void peepbegin(void);
+void peepend(void);
+void peepraw(void);
+void miline(char *);
+struct minsn *minext(struct minsn *);
+struct minsn *miprev(struct minsn *);
+
+/*
+ * While a function is kept as a list its output is caught in memory,
+ * see output.c.  Pass2 writes to stdout with stdio everywhere, so
+ * those calls go through here.
+ */
+void ocatch(int);
+int oprintf(const char *, ...);
+int ofprintf(FILE *, const char *, ...);
+int oputc(int, FILE *);
+int ofputs(const char *, FILE *);
+size_t ofwrite(const void *, size_t, size_t, FILE *);
+#if !defined(MKEXT) && !defined(PASS1)
+#undef putchar
+#undef putc
+#undef fputc
+#define	printf		oprintf
+#define	fprintf		ofprintf
+#define	putchar(c)	oputc(c, stdout)
+#define	putc		oputc
+#define	fputc		oputc
+#define	fputs		ofputs
+#define	fwrite		ofwrite
+#endif
+#endif
+#ifdef SCHEDULE
+/* list instruction scheduler, sched.c */
+#ifndef SCHEDREGS
+#define	SCHEDREGS	128	/* registers known to schedinsn() */
+#endif
+#define	SC_ALU		0
+#define	SC_LOAD		1
+#define	SC_STORE	2
+#define	SC_MUL		3
+#define	SC_DIV		4
+#define	SC_FPU		5
+#define	SC_FDIV		6
+#define	SC_BRANCH	7
+#define	NSCLASS		8
+struct schedinfo {
+	int class;		/* SC_* */
+	int flags;		/* SF_* */
+	int lat;		/* latency if not that of the class */
+	int war;		/* cycles before a used reg may be written */
+	int mreg;		/* frame base register of a memory ref, or -1 */
+	CONSZ moff;		/* offset from mreg */
+	int msize;		/* size of the memory ref in bytes */
+	bittype use[BIT2BYTE(SCHEDREGS)];
+	bittype def[BIT2BYTE(SCHEDREGS)];
+};
+#define	SF_BARRIER	001	/* nothing may move across it */
+#define	SF_NOP		002	/* hazard filler, may be removed */
+#define	SF_MEM		004	/* reads or writes memory */
+#define	SF_STORE	010	/* writes memory */
+struct schedmodel {
+	int width;		/* instructions issued per cycle */
+	int lat[NSCLASS];	/* result latency of each class */
+	int units[NSCLASS];	/* issued per cycle of each class */
+	char *nop;		/* must fill stall cycles if not NULL */
+};
+struct schedop {
+	char *name;
+	int class;		/* SC_* */
+	int flags;		/* SF_* and SO_DEF */
+	int size;		/* of a memory ref */
+	int idef, iuse;		/* implied registers, or 0 */
+};
+#define	SO_DEF		0100	/* first operand is written */
+extern struct schedmodel schedmodel;
+int schedinsn(struct minsn *, struct schedinfo *);
+int schedreg(char *);
+void schedopd(struct schedinfo *, char *, int);
+int schedtab(struct minsn *, char *, struct schedop *, struct schedinfo *);
+void schedule(struct minsn *);
+#endif
 int tlen(NODE *p);
 int setbin(NODE *);
 int notoff(TWORD, int, CONSZ, char *);
@@ -290,6 +431,7 @@ int ncnt(char *);
 char *hasneed(char *, int);
 char *hasneed2(char *, int, int);
 void mainp2(void);
+void pass2_sync(void);
 
 extern	char *rnames[];
 
@@ -492,6 +634,19 @@ struct phiinfo {
 	int *intmpregno;
 };
 
+/*
+ * A natural loop.  Loops are kept innermost first.
+ */
+struct loop {
+	SLIST_ENTRY(loop) loopelem;
+	struct loop *outer;		/* enclosing loop, or NULL */
+	struct basicblock *header;
+	struct basicblock *pre;		/* preheader, or NULL if none */
+	bittype *blocks;		/* member blocks, indexed by dfnum */
+	int nblocks;
+	int depth;			/* nesting depth, outermost is 1 */
+};
+
 /*
  * Description of the pass2 environment.
  * There will be only one of these structs.  It is used to keep
@@ -505,12 +660,19 @@ struct p2env {
 	struct labelinfo labinfo;
 	struct basicblock bblocks;
 	int nbblocks;
+	SLIST_HEAD(, loop) loops;		/* set by findloops() */
 #define NIPPREGS        BIT2BYTE(MAXREGS)/sizeof(bittype)
 	bittype p_regs[NIPPREGS];	/* Bitmask of registers to save */
 };
 
 extern struct p2env p2env;
 
+struct basicblock *bb_find(struct p2env *, struct interpass *);
+void bb_insert_before(struct p2env *, struct basicblock *,
+    struct interpass *, struct interpass *);
+void bb_remove(struct p2env *, struct basicblock *, struct interpass *);
+void findloops(struct p2env *);
+
 /*
  * C compiler second pass extra defines.
  */
@@ -525,3 +687,40 @@ enum {
 #endif
 	ATTR_P2_MAX
 };
+
+/*
+ * Records in the intermediate file between the two passes.
+ * Each record starts with a sync char followed by binary data in
+ * host byte order.  Passthrough lines from pass1 are left as text.
+ * Strings are sent once as IR_STR and later referred to by their
+ * index in order of appearance; -1 means the empty string.
+ */
+#define	IR_PASS		'*'	/* passthrough line, text up to newline */
+#define	IR_STR		'='	/* int length (with NUL), string */
+#define	IR_LINE		'#'	/* int line number */
+#define	IR_NODE		'"'	/* tree of struct irnode in prefix order */
+#define	IR_LABEL	'^'	/* int label number */
+#define	IR_ASM		'$'	/* int length (with NUL), asm statement */
+#define	IR_PROLOG	'!'	/* struct irprolog */
+#define	IR_EPILOG	'%'	/* struct irprolog, int labels[nlabels] */
+
+struct irnode {
+	int op;
+	TWORD type;
+	TWORD qual;
+	int rval;
+	int name;		/* string index */
+	int nattr;		/* # of attribute ints following */
+	CONSZ lval;
+};
+
+struct irprolog {
+	int name;		/* string index */
+	int flags;
+	TWORD type;
+	int autos;
+	int lbl;
+	int tmpnum;
+	int lblnum;
+	int nlabels;
+};
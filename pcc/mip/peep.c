@@ -0,0 +1,384 @@
+/*	$Id$	*/
+/*
+ * Copyright (c) 2026 The pcc project.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Machine-level peephole optimizer (-xpeep).
+ *
+ * The assembler output of a function is caught in memory while it
+ * is emitted (see output.c), each line is made an entry in a list of
+ * machine instructions and labels, and the target rules in peeptab[]
+ * are applied to it before it is written to the real output.
+ *
+ * A rule is a short sequence of instruction patterns and what they
+ * are replaced with.  Patterns are written as the instructions are
+ * printed, "op a,b", with @0-@9 as variables.  A variable matches
+ * anything up to the next character of the pattern (outside
+ * parentheses), and must match the same text if used again.
+ * A pattern ending in ':' matches a label.  The replacement lines
+ * are the patterns with the variables filled in.  If the rule has a
+ * check function it must also agree before the rule is applied.
+ *
+ * Lines between two peepraw() calls (inline assembler) and all
+ * directives are left alone, and no pattern matches across them.
+ *
+ * The same list is given to the instruction scheduler (-xsched),
+ * see sched.c.
+ */
+
+#include "pass2.h"
+
+#ifdef MINSN
+#include <string.h>
+
+#ifndef MICOMMENT
+#define	MICOMMENT	"#"	/* chars that start a comment */
+#endif
+
+static struct minsn mhead;
+static int pcatch;	/* catching a function */
+static int praw;	/* in untouched output */
+
+/*
+ * Start catching the output of a function.
+ */
+void
+peepbegin(void)
+{
+	DLIST_INIT(&mhead, link);
+	pcatch = 1;
+	praw = 0;
+	ocatch(1);
+}
+
+/*
+ * Mark the start or end of output that should be passed through
+ * untouched, like inline assembler.
+ */
+void
+peepraw(void)
+{
+	if (pcatch)
+		praw = !praw;
+}
+
+/*
+ * Split an instruction into opcode and operands.  Return 0 if it
+ * is not an instruction.
+ */
+static int
+miparse(struct minsn *mi, char *s)
+{
+	char *e, *d;
+	int par, q;
+
+	while (*s == ' ' || *s == '\t')
+		s++;
+	if (*s == 0 || *s == '.' || *s == '#' || *s == ';' ||
+	    strchr(MICOMMENT, *s))
+		return 0;
+	d = mi->op = tmpalloc(strlen(s) + 1);
+	while (*s && *s != ' ' && *s != '\t')
+		*d++ = *s++;
+	*d++ = 0;
+	mi->nopd = 0;
+	while (*s == ' ' || *s == '\t')
+		s++;
+	while (*s && strchr(MICOMMENT, *s) == NULL) {
+		if (mi->nopd == MAXOPD)
+			return 0;
+		mi->opd[mi->nopd++] = d;
+		par = q = 0;
+		for (e = s; *e; e++) {
+			if (*e == '"')
+				q = !q;
+			else if (q)
+				continue;
+			else if (strchr(MICOMMENT, *e))
+				break;
+			else if (*e == '(' || *e == '[' || *e == '{')
+				par++;
+			else if (*e == ')' || *e == ']' || *e == '}')
+				par--;
+			else if (*e == ',' && par == 0)
+				break;
+		}
+		while (e > s && (e[-1] == ' ' || e[-1] == '\t'))
+			e--;
+		while (s < e)
+			*d++ = *s++;
+		*d++ = 0;
+		while (*s == ' ' || *s == '\t' || *s == ',')
+			s++;
+	}
+	return 1;
+}
+
+/*
+ * Make the form of an instruction used in the patterns, "op a,b".
+ */
+static char *
+miform(struct minsn *mi)
+{
+	char *s, *d;
+	size_t l;
+	int i;
+
+	l = strlen(mi->op) + 1;
+	for (i = 0; i < mi->nopd; i++)
+		l += strlen(mi->opd[i]) + 1;
+	d = s = tmpalloc(l);
+	strcpy(d, mi->op);
+	for (i = 0; i < mi->nopd; i++) {
+		d += strlen(d);
+		*d++ = i ? ',' : ' ';
+		strcpy(d, mi->opd[i]);
+	}
+	return s;
+}
+
+/*
+ * Make a list entry from a printed line.
+ */
+static struct minsn *
+minew(char *s, int raw)
+{
+	struct minsn *mi = tmpcalloc(sizeof(struct minsn));
+	size_t l = strlen(s);
+
+	mi->text = s;
+	if (raw) {
+		mi->type = MI_RAW;
+	} else if (*s != ' ' && *s != '\t' && l > 1 && s[l-1] == ':') {
+		mi->type = MI_LABEL;
+		mi->form = s;
+		mi->op = tmpstrdup(s);
+		mi->op[l-1] = 0;
+	} else if (miparse(mi, s)) {
+		mi->type = MI_INSN;
+		mi->form = miform(mi);
+	} else
+		mi->type = MI_RAW;
+	return mi;
+}
+
+/*
+ * Add a line of caught output to the list.
+ */
+void
+miline(char *s)
+{
+	struct minsn *mi = minew(tmpstrdup(s), praw);
+
+	DLIST_INSERT_BEFORE(&mhead, mi, link);
+}
+
+/*
+ * Return the entry after/before mi, or NULL at the ends.
+ */
+struct minsn *
+minext(struct minsn *mi)
+{
+	mi = DLIST_NEXT(mi, link);
+	return mi == &mhead ? NULL : mi;
+}
+
+struct minsn *
+miprev(struct minsn *mi)
+{
+	mi = DLIST_PREV(mi, link);
+	return mi == &mhead ? NULL : mi;
+}
+
+#ifdef PEEPHOLE
+#define	VBUFSZ	1024	/* room for variable values */
+
+static char vbuf[VBUFSZ];
+static int vlen;
+
+/*
+ * Match pattern p against line s, binding variables in v.
+ */
+static int
+pmatch(char *p, char *s, char **v)
+{
+	char *e;
+	int n, l, par;
+
+	while (*p) {
+		if (*p != '@' || p[1] < '0' || p[1] > '9') {
+			if (*p++ != *s++)
+				return 0;
+			continue;
+		}
+		n = p[1] - '0';
+		p += 2;
+		if (v[n] != NULL) {
+			l = strlen(v[n]);
+			if (strncmp(s, v[n], l))
+				return 0;
+			s += l;
+			continue;
+		}
+		for (e = s, par = 0; *e; e++) {
+			if (par == 0 && *e == *p)
+				break;
+			if (*e == '(' || *e == '[' || *e == '{')
+				par++;
+			else if (*e == ')' || *e == ']' || *e == '}')
+				par--;
+		}
+		if (e == s || *e != *p)
+			return 0;
+		l = e - s;
+		if (vlen + l + 1 > VBUFSZ)
+			return 0;
+		v[n] = memcpy(vbuf + vlen, s, l);
+		v[n][l] = 0;
+		vlen += l + 1;
+		s = e;
+	}
+	return *s == 0;
+}
+
+/*
+ * Fill in the variables of a replacement line, and indent it unless
+ * it is a label.
+ */
+static char *
+psubst(char *p, char **v)
+{
+	char buf[256], *s;
+	size_t l = 1, n;
+
+	for (; *p; p++) {
+		if (*p == '@' && p[1] >= '0' && p[1] <= '9') {
+			s = v[*++p - '0'];
+			n = strlen(s);
+		} else
+			s = p, n = 1;
+		if (l + n >= sizeof(buf))
+			comperr("psubst: line too long");
+		memcpy(buf + l, s, n);
+		l += n;
+	}
+	buf[0] = '\t';
+	buf[l] = 0;
+	return tmpstrdup(buf + (buf[l-1] == ':'));
+}
+
+/*
+ * Try rule r at mi.  On success, replace the matched entries and
+ * return the first new one (or the entry before them if the rule
+ * only deletes).
+ */
+static struct minsn *
+prule(struct peeprule *r, struct minsn *mi)
+{
+	struct minsn *m[PEEPMAX], *n, *prev;
+	char *v[10];
+	int i, np;
+
+	memset(v, 0, sizeof(v));
+	vlen = 0;
+	for (np = 0, n = mi; np < PEEPMAX && r->pat[np]; np++, n = minext(n)) {
+		if (n == NULL || n->type == MI_RAW)
+			return NULL;
+		i = strlen(r->pat[np]);
+		if ((r->pat[np][i-1] == ':') != (n->type == MI_LABEL))
+			return NULL;
+		if (!pmatch(r->pat[np], n->form, v))
+			return NULL;
+		m[np] = n;
+	}
+	if (r->chk && !(*r->chk)(mi, v))
+		return NULL;
+
+	prev = DLIST_PREV(mi, link);
+	for (i = 0; i < np; i++)
+		DLIST_REMOVE(m[i], link);
+	n = prev;
+	for (i = 0; i < PEEPMAX && r->rep[i]; i++) {
+		mi = minew(psubst(r->rep[i], v), 0);
+		DLIST_INSERT_AFTER(n, mi, link);
+		n = mi;
+	}
+	return i ? DLIST_NEXT(prev, link) : prev;
+}
+
+/*
+ * Apply the target rules until nothing more matches.
+ */
+static void
+peepopt(void)
+{
+	struct minsn *mi, *n;
+	struct peeprule *r;
+	int i;
+
+	for (mi = DLIST_NEXT(&mhead, link); mi != &mhead; ) {
+		for (r = peeptab; r->pat[0]; r++)
+			if ((n = prule(r, mi)) != NULL)
+				break;
+		if (r->pat[0] == NULL) {
+			mi = DLIST_NEXT(mi, link);
+			continue;
+		}
+		/* back up so that the new code is matched again */
+		for (mi = n, i = 0; i < PEEPMAX-1 && mi != &mhead; i++)
+			mi = DLIST_PREV(mi, link);
+		if (mi == &mhead)
+			mi = DLIST_NEXT(mi, link);
+	}
+}
+#endif
+
+/*
+ * Stop catching the function, optimize it and write it to the real
+ * output.
+ */
+void
+peepend(void)
+{
+	struct minsn *mi;
+
+	ocatch(0);
+	pcatch = 0;
+
+#ifdef PEEPHOLE
+	if (xpeep)
+		peepopt();
+#endif
+#ifdef SCHEDULE
+	if (xsched)
+		schedule(&mhead);
+#endif
+
+	DLIST_FOREACH(mi, &mhead, link) {
+		fputs(mi->text, stdout);
+		putchar('\n');
+	}
+}
+#endif
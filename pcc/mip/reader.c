@@ -68,6 +68,11 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#if defined(HAVE_UNISTD_H) && defined(HAVE_SYS_WAIT_H)
+#include <unistd.h>
+#include <sys/wait.h>
+#define	P2JOBS
+#endif
 
 /*	some storage declarations */
 int nrecur;
@@ -90,6 +95,7 @@ static void afree(void);
 struct p2env p2env;
 
 int crslab2 = 11; 
+static int p2lablim;	/* label limit with -xp2jobs, 0 if none */
 /*
  * Return a number for internal labels.
  */
@@ -100,11 +106,204 @@ getlab2(void)
 	if (crslab2 < p2env.ipp->ip_lblnum)
 		comperr("getlab2 %d outside boundaries %d-%d",
 		    crslab2, p2env.ipp->ip_lblnum, p2env.epp->ip_lblnum);
+	if (p2lablim && crslab2 >= p2lablim)
+		comperr("getlab2 %d outside reserved labels", crslab2);
 	if (crslab2 >= p2env.epp->ip_lblnum)
 		p2env.epp->ip_lblnum = crslab2+1;
         return crslab2++;
 }
 
+#ifdef P2JOBS
+/*
+ * Parallel code generation (-xp2jobs=N).
+ *
+ * Each complete function is handed to a forked worker that runs
+ * the rest of pass2 on its own copy of the compiler state and writes
+ * its assembler output to a scratch file.  Everything pass1 prints
+ * between functions is saved in scratch files as well, and the
+ * scratch files are copied to the real output in original order as
+ * soon as the ones before them are complete.
+ *
+ * Small functions are not worth a fork and are compiled directly.
+ *
+ * Labels made by a worker cannot be seen by the others, so pass1
+ * leaves room for them in the label range of each function, counted
+ * by p2labels().  A function whose range is too small anyway (after
+ * inlining) is compiled directly.
+ */
+#define	P2WINDOW	8	/* max queued jobs per worker */
+#define	P2MINSTMTS	64	/* min statements to use a worker */
+
+struct p2job {
+	struct p2job *next;
+	pid_t pid;		/* worker, 0 if output from pass1 */
+	int done;
+	FILE *fp;		/* saved output */
+};
+
+static struct p2job *p2jhead, **p2jtail = &p2jhead;
+static int p2outfd = -1, p2running, p2queued, p2worker;
+
+/*
+ * Copy a finished scratch file to the real output.
+ */
+static void
+p2copy(struct p2job *j)
+{
+	char buf[8192];
+	int fd = fileno(j->fp);
+	ssize_t n, w, o;
+
+	if (lseek(fd, 0, SEEK_SET) < 0)
+		comperr("p2copy: lseek");
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		for (o = 0; o < n; o += w)
+			if ((w = write(p2outfd, buf + o, n - o)) < 0)
+				comperr("p2copy: write");
+	}
+	fclose(j->fp);
+}
+
+/*
+ * Reap a worker (any if pid is -1).  Returns 0 if none was reaped.
+ */
+static int
+p2reap(pid_t pid, int block)
+{
+	struct p2job *j;
+	int st;
+
+	if (p2running == 0)
+		return 0;
+	if ((pid = waitpid(pid, &st, block ? 0 : WNOHANG)) <= 0)
+		return 0;
+	for (j = p2jhead; j; j = j->next)
+		if (j->pid == pid)
+			break;
+	if (j == NULL)
+		return 1;	/* not ours */
+	j->done = 1;
+	p2running--;
+	if (!WIFEXITED(st) || WEXITSTATUS(st) != 0)
+		nerrors++;
+	return 1;
+}
+
+/*
+ * Write out all completed scratch files at the head of the queue.
+ * Pass1 output at the head is always complete; if it is the last
+ * one it is the current output, which is then redirected back
+ * to the real output.
+ */
+static void
+p2drain(void)
+{
+	struct p2job *j;
+
+	while (p2reap(-1, 0))
+		;
+	while ((j = p2jhead) != NULL) {
+		if (j->pid && !j->done)
+			break;
+		if (j->next == NULL) {
+			fflush(stdout);
+			dup2(p2outfd, STDOUT_FILENO);
+		}
+		p2copy(j);
+		if ((p2jhead = j->next) == NULL)
+			p2jtail = &p2jhead;
+		p2queued--;
+		free(j);
+	}
+}
+
+static struct p2job *
+p2enqueue(void)
+{
+	struct p2job *j = xcalloc(1, sizeof(struct p2job));
+
+	if ((j->fp = tmpfile()) == NULL)
+		comperr("cannot create scratch file");
+	*p2jtail = j;
+	p2jtail = &j->next;
+	p2queued++;
+	return j;
+}
+
+/*
+ * Hand the function in p2env to a worker.
+ * Returns 1 in the parent if a worker took it, otherwise 0.
+ */
+static int
+p2fork(struct p2env *p2e)
+{
+	struct interpass *ip;
+	struct p2job *j;
+	int n = 0, nl = 0;
+
+	p2lablim = 0;
+	DLIST_FOREACH(ip, &p2e->ipole, qelem) {
+		if (ip->type == IP_NODE)
+			n++;
+		nl += p2labels(ip);
+	}
+	if (n < P2MINSTMTS || crslab2 + 2 * nl > p2e->epp->ip_lblnum)
+		return 0;
+	p2lablim = p2e->epp->ip_lblnum;
+
+	fflush(stdout);
+	if (p2outfd < 0 && (p2outfd = dup(STDOUT_FILENO)) < 0)
+		comperr("p2fork: dup");
+
+	p2drain();
+	while (p2running >= xp2jobs)
+		p2reap(-1, 1);
+	while (p2queued >= xp2jobs * P2WINDOW && p2jhead->pid) {
+		p2reap(p2jhead->pid, 1);
+		p2drain();
+	}
+
+	j = p2enqueue();
+	if ((j->pid = fork()) < 0)
+		comperr("p2fork: fork");
+	if (j->pid == 0) {
+		dup2(fileno(j->fp), STDOUT_FILENO);
+		p2worker = 1;
+		return 0;
+	}
+	p2running++;
+	if (crslab2 < p2e->epp->ip_lblnum)
+		crslab2 = p2e->epp->ip_lblnum;
+
+	j = p2enqueue();
+	dup2(fileno(j->fp), STDOUT_FILENO);
+
+	DLIST_FOREACH(ip, &p2e->ipole, qelem)
+		if (ip->type == IP_NODE)
+			tfree(ip->ip_node);
+	p2drain();
+	return 1;
+}
+#endif
+
+/*
+ * Wait for all pass2 workers and write out what is left.
+ */
+void
+pass2_sync(void)
+{
+#ifdef P2JOBS
+	if (p2outfd < 0)
+		return;
+	fflush(stdout);
+	while (p2reap(-1, 1))
+		;
+	p2drain();
+	close(p2outfd);
+	p2outfd = -1;
+#endif
+}
+
 
 #ifdef PCC_DEBUG
 static int *lbldef, *lbluse;
@@ -277,6 +476,7 @@ isuseless(NODE *n)
 	case USTCALL:
 	case STASG:
 	case STARG:
+	case PREFETCH:
 		return 0;
 	default:
 		return 1;
@@ -341,141 +541,121 @@ latechecks(NODE *p, void *arg)
 
 #ifdef PASS2
 
-#define	SKIPWS(p) while (*p == ' ') p++
-#define	SZIBUF 	256
-static int inpline;
-static char inpbuf[SZIBUF];
-static char *
-rdline(void)
-{
-	int l;
-
-	if (fgets(inpbuf, sizeof(inpbuf), stdin) == NULL)
-		return NULL;
-	inpline++;
-	l = strlen(inpbuf);
-	if (inpbuf[0] < 33 || inpbuf[1] != ' ' || inpbuf[l-1] != '\n')
-		comperr("sync error in-line %d string '%s'", inpline, inpbuf);
-	inpbuf[l-1] = 0;
-	return inpbuf;
-}
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 /*
- * Read an int and traverse over it. count up s.
+ * The intermediate file from pass1 is mapped into memory (or read,
+ * if it is not a regular file) and the records are picked directly
+ * out of it.  Strings stay in the mapped file.
  */
-static int
-rdint(char **s)
+static char *irbuf, *irpos, *irend;
+static char **irstrs;
+static int nirstrs, irstrsz;
+
+static void
+irmap(void)
 {
-	char *p = *s;
-	int rv;
-
-	SKIPWS(p);
-	rv = atoi(p);
-	if (*p == '-' || *p == '+') p++;
-	while (*p >= '0' && *p <= '9') p++;
-	*s = p;
-	return rv;
+	struct stat st;
+	size_t sz, n;
+	char *b;
+	int fd = fileno(stdin);
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		b = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE,
+		    MAP_PRIVATE, fd, 0);
+		if (b != MAP_FAILED) {
+			irbuf = irpos = b;
+			irend = b + st.st_size;
+			return;
+		}
+	}
+	sz = 65536;
+	b = xmalloc(sz);
+	for (n = 0; (n += fread(b + n, 1, sz - n, stdin)) == sz; )
+		b = xrealloc(b, sz *= 2);
+	irbuf = irpos = b;
+	irend = b + n;
+}
+
+static void *
+irget(int sz)
+{
+	char *p = irpos;
+
+	if (sz < 0 || irend - irpos < sz)
+		comperr("intermediate file truncated");
+	irpos += sz;
+	return p;
 }
 
-static struct attr *
-rdattr(char **p)
+#define	IRGET(v)	memcpy(&(v), irget(sizeof(v)), sizeof(v))
+
+static char *
+irstr(int idx)
 {
-	struct attr *ap, *app = NULL;
-	int i, a, sz;
-
-	(*p)++; /* skip + */
-onemore:
-	a = rdint(p);
-	sz = rdint(p);
-	ap = attr_new(a, sz);
-	for (i = 0; i < sz; i++)
-		ap->iarg(i) = rdint(p);
-	ap->next = app;
-	app = ap;
-	SKIPWS((*p));
-	if (**p != 0)
-		goto onemore;
-
-	return app;
+	if (idx == -1)
+		return "";
+	if (idx < 0 || idx >= nirstrs)
+		comperr("bad string index %d", idx);
+	return irstrs[idx];
 }
 
 /*
- * Read in an indentifier and save on tmp heap.  Return saved string.
+ * Get a text line, with the sync char already consumed.
  */
 static char *
-rdstr(char **p)
+rdline(void)
 {
-	char *t, *s = *p;
-	int sz;
-
-	SKIPWS(s);
-	*p = s;
-	for (sz = 0; *s && *s != ' '; s++, sz++)
-		;
-	t = tmpalloc(sz+1);
-	memcpy(t, *p, sz);
-	t[sz] = 0;
-	*p = s;
-	return t;
+	char *s, *e;
+
+	s = irpos;
+	if ((e = memchr(s, '\n', irend - s)) == NULL)
+		comperr("intermediate file truncated");
+	irpos = e + 1;
+	*e = 0;
+	if (*s == ' ')
+		s++;
+	return s;
 }
 
 /*
- * Read and check node structs from pass1.
+ * Read node structs from pass1.
  */
 static NODE *
-rdnode(char *s)
+rdnode(void)
 {
+	struct irnode irn;
+	struct attr *ap, **app;
 	NODE *p = talloc();
-	int ty;
+	int a, i, n, sz;
 
-	if (s[0] != '"')
-		comperr("rdnode sync error");
-	s++; s++;
+	IRGET(irn);
 	p->n_regw = NULL;
 	p->n_ap = NULL;
-	p->n_su = p->n_rval = 0;
-	setlval(p, 0);
-	p->n_op = rdint(&s);
-	p->n_type = rdint(&s);
-	p->n_qual = rdint(&s);
-	p->n_name = "";
-	SKIPWS(s);
-	ty = optype(p->n_op);
-	if (p->n_op == XASM) {
-		int i = strlen(s);
-		p->n_name = tmpalloc(i+1);
-		memcpy(p->n_name, s, i);
-		p->n_name[i] = 0;
-		s += i;
-	}
-	if (ty == UTYPE) {
-		p->n_rval = rdint(&s);
-	} else if (ty == LTYPE) {
-		setlval(p, strtoll(s, &s, 10));
-		if (p->n_op == NAME || p->n_op == ICON) {
-			SKIPWS(s);
-			if (*s && *s != '+')
-				p->n_name = rdstr(&s);
-		} else
-			p->n_rval = rdint(&s);
-	}
-	SKIPWS(s);
-	if (p->n_op == XARG) {
-		int i = strlen(s);
-		p->n_name = tmpalloc(i+1);
-		memcpy(p->n_name, s, i);
-		p->n_name[i] = 0;
-		s += i;
+	p->n_su = 0;
+	p->n_op = irn.op;
+	p->n_type = irn.type;
+	p->n_qual = irn.qual;
+	p->n_rval = irn.rval;
+	p->n_name = irstr(irn.name);
+	setlval(p, irn.lval);
+	app = &p->n_ap;
+	for (n = irn.nattr; n > 0; n -= sz + 2) {
+		IRGET(a);
+		IRGET(sz);
+		*app = ap = attr_new(a, sz);
+		for (i = 0; i < sz; i++)
+			IRGET(ap->iarg(i));
+		app = &ap->next;
 	}
-	if (*s == '+')
-		p->n_ap = rdattr(&s);
-	SKIPWS(s);
-	if (*s)
-		comperr("in-line %d failed read, buf '%s'", inpline, inpbuf);
-	if (ty != LTYPE)
-		p->n_left = rdnode(rdline());
-	if (ty == BITYPE)
-		p->n_right = rdnode(rdline());
+	if (n != 0)
+		comperr("rdnode: bad attributes");
+	if (optype(p->n_op) != LTYPE)
+		p->n_left = rdnode();
+	if (optype(p->n_op) == BITYPE)
+		p->n_right = rdnode();
 	return p;
 }
 
@@ -488,105 +668,92 @@ mainp2()
 	static int foo[] = { 0 };
 	struct interpass_prolog *ipp;
 	struct interpass *ip;
-	char nam[SZIBUF], *p, *b;
-	extern char *ftitle;
-
-	while ((p = rdline()) != NULL) {
-		b = p++;
-		p++;
-
-		switch (*b) {
-		case '*': /* pass thru line */
-			printf("%s\n", p);
+	struct irprolog irp;
+	char *s;
+	int c, i, l;
+
+	irmap();
+	while (irpos < irend) {
+		switch (c = *irpos++) {
+		case IR_PASS: /* pass thru line */
+			printf("%s\n", rdline());
 			break;
-		case '&': /* current filename */
-			free(ftitle);
-			ftitle = xstrdup(p);
+		case IR_STR:
+			IRGET(l);
+			s = irget(l);
+			if (l == 0 || s[l-1] != 0)
+				comperr("bad string in intermediate file");
+			if (nirstrs == irstrsz) {
+				irstrsz = irstrsz ? irstrsz * 2 : 256;
+				irstrs = xrealloc(irstrs,
+				    irstrsz * sizeof(char *));
+			}
+			irstrs[nirstrs++] = s;
 			break;
-		case '#':
-			lineno = atoi(p);
+		case IR_LINE:
+			IRGET(lineno);
 			break;
-		case '"':
-			ip = malloc(sizeof(struct interpass));
+		case IR_NODE:
+			ip = tmpalloc(sizeof(struct interpass));
 			ip->type = IP_NODE;
-			ip->ip_node = rdnode(b);
+			ip->lineno = lineno;
+			ip->ip_node = rdnode();
 			pass2_compile(ip);
 			break;
-		case '^':
-			ip = malloc(sizeof(struct interpass));
+		case IR_LABEL:
+			ip = tmpalloc(sizeof(struct interpass));
 			ip->type = IP_DEFLAB;
-			ip->ip_lbl = atoi(p);
+			ip->lineno = lineno;
+			IRGET(ip->ip_lbl);
+			pass2_compile(ip);
+			break;
+		case IR_ASM:
+			IRGET(l);
+			ip = tmpalloc(sizeof(struct interpass));
+			ip->type = IP_ASM;
+			ip->lineno = lineno;
+			ip->ip_asm = irget(l);
+			if (l == 0 || ip->ip_asm[l-1] != 0)
+				comperr("bad asm in intermediate file");
 			pass2_compile(ip);
 			break;
-		case '!': /* prolog */
-			ipp = malloc(sizeof(struct interpass_prolog));
+		case IR_PROLOG:
+		case IR_EPILOG:
+			IRGET(irp);
+			ipp = tmpalloc(sizeof(struct interpass_prolog));
 			ip = (void *)ipp;
-			ip->type = IP_PROLOG;
-			sscanf(p, "%d %d %d %d %d %s", &ipp->ipp_type,
-			    &ipp->ipp_flags, &ip->ip_lbl, &ipp->ip_tmpnum,
-			    &ipp->ip_lblnum, nam);
-			ipp->ipp_name = xstrdup(nam);
-			ipp->ipp_autos = -1;
+			ip->type = c == IR_PROLOG ? IP_PROLOG : IP_EPILOG;
+			ip->lineno = lineno;
+			ip->ip_lbl = irp.lbl;
+			ipp->ipp_name = irstr(irp.name);
+			ipp->ipp_flags = irp.flags;
+			ipp->ipp_type = irp.type;
+			ipp->ipp_autos = irp.autos;
+			ipp->ip_tmpnum = irp.tmpnum;
+			ipp->ip_lblnum = irp.lblnum;
 			ipp->ip_labels = foo;
+			if (irp.nlabels > 0) {
+				ipp->ip_labels =
+				    tmpalloc(sizeof(int) * (irp.nlabels+1));
+				for (i = 0; i < irp.nlabels; i++)
+					IRGET(ipp->ip_labels[i]);
+				ipp->ip_labels[i] = 0;
+			}
 #ifdef TARGET_IPP_MEMBERS
-			if (*(p = rdline()) != '(')
+			if (*irpos++ != (c == IR_PROLOG ? '(' : ')'))
 				comperr("target member error");
-			p += 2;
-			target_members_read_prolog(ipp);
-			SKIPWS(p);
-			if (*p)
-				comperr("bad prolog '%s' '%s'", p, inpbuf);
-#endif
-			pass2_compile((struct interpass *)ipp);
-			break;
-
-		case '%': /* epilog */
-			ipp = malloc(sizeof(struct interpass_prolog));
-			ip = (void *)ipp;
-			ip->type = IP_EPILOG;
-			ipp->ipp_autos = rdint(&p);
-			ip->ip_lbl = rdint(&p);
-			ipp->ip_tmpnum = rdint(&p);
-			ipp->ip_lblnum = rdint(&p);
-			ipp->ipp_name = rdstr(&p);
-			SKIPWS(p);
-			if (*p == '+') {
-				int num, i;
-				p++;
-				num = rdint(&p) + 1;
-				ipp->ip_labels = tmpalloc(sizeof(int)*num);
-				for (i = 0; i < num; i++)
-					ipp->ip_labels[i] = rdint(&p);
-				ipp->ip_labels[num] = 0;
-			} else
-				ipp->ip_labels = foo;
-			SKIPWS(p);
-			if (*p)
-				comperr("bad epilog '%s' '%s'", p, inpbuf);
-#ifdef TARGET_IPP_MEMBERS
-			if (*(p = rdline()) != ')')
-				comperr("target epi member error");
-			p += 2;
-			target_members_read_epilog(ipp);
-			SKIPWS(p);
-			if (*p)
-				comperr("bad epilog2 '%s' '%s'", p, inpbuf);
+			if (c == IR_PROLOG)
+				target_members_read_prolog(ipp);
+			else
+				target_members_read_epilog(ipp);
 #endif
-			pass2_compile((struct interpass *)ipp);
-			break;
-		case '$': /* assembler */
-			if (*p) {
-				int sz = strlen(p);
-				ip = malloc(sizeof(struct interpass));
-				ip->type = IP_ASM;
-				ip->ip_asm = tmpalloc(sz+1);
-                		memcpy(ip->ip_asm, p, sz);
-				ip->ip_asm[sz] = 0;
-				pass2_compile(ip);
-			}
+			pass2_compile(ip);
+			if (c == IR_EPILOG)
+				tmpfree(); /* release the function */
 			break;
 		default:
-			comperr("bad string %s", b);
+			comperr("intermediate file sync error, char %d at %ld",
+			    c, (long)(irpos - irbuf - 1));
 		}
 	}
 }
@@ -695,6 +862,13 @@ pass2_compile(struct interpass *ip)
 	p2e->epp = (struct interpass_prolog *)DLIST_PREV(&p2e->ipole, qelem);
 	p2maxautooff = p2autooff = p2e->epp->ipp_autos;
 
+#ifdef P2JOBS
+	if (xp2jobs > 1 && p2fork(p2e))
+		return; /* compiled by a worker */
+#endif
+	tmfunc(p2e->ipp->ipp_name);
+	tmenter(TM_PASS2);
+
 #ifdef PCC_DEBUG
 	if (e2debug) {
 		printf("Entering pass2\n");
@@ -765,15 +939,40 @@ pass2_compile(struct interpass *ip)
 	optimize(p2e);
 	ngenregs(p2e);
 
-	if (xtemps && xdeljumps)
+	if (xtemps && xdeljumps) {
+		tmenter(TM_DELJUMPS);
 		deljumps(p2e);
+		tmleave();
+	}
 
 	DLIST_FOREACH(ip, &p2e->ipole, qelem)
 		if (ip->type == IP_NODE)
 			walkf(ip->ip_node, latechecks, &p2env.ipp->ipp_flags);
 
+	tmenter(TM_EMIT);
+#ifdef MINSN
+	if (xpeep || xsched)
+		peepbegin();
+#endif
 	DLIST_FOREACH(ip, &p2e->ipole, qelem)
 		emit(ip);
+	tmleave();
+#ifdef MINSN
+	if (xpeep || xsched) {
+		tmenter(TM_PEEP);
+		peepend();
+		tmleave();
+	}
+#endif
+	tmleave();
+	tmfunc(NULL);
+
+#ifdef P2JOBS
+	if (p2worker) {
+		fflush(stdout);
+		_exit(nerrors ? 1 : 0);
+	}
+#endif
 }
 
 void
@@ -818,7 +1017,13 @@ emit(struct interpass *ip)
 			gencode(p->n_left, INREGS);
 			break;
 		case XASM:
+#ifdef MINSN
+			peepraw();
+#endif
 			genxasm(p);
+#ifdef MINSN
+			peepraw();
+#endif
 			break;
 		default:
 			if (p->n_op != REG || p->n_type != VOID) /* XXX */
@@ -838,7 +1043,13 @@ emit(struct interpass *ip)
 		deflab(ip->ip_lbl);
 		break;
 	case IP_ASM:
+#ifdef MINSN
+		peepraw();
+#endif
 		printf("%s\n", ip->ip_asm);
+#ifdef MINSN
+		peepraw();
+#endif
 		break;
 	default:
 		cerror("emit %d", ip->type);
@@ -929,6 +1140,11 @@ again:	switch (o = p->n_op) {
 	case ULT:
 	case UGE:
 	case UGT:
+		if (p->n_type == XTYPE) {
+			/* vector compares give a value */
+			rv = findops(p, cookie);
+			break;
+		}
 		p1 = p->n_left;
 		p2 = p->n_right;
 		if (p2->n_op == ICON && getlval(p2) == 0 && *p2->n_name == 0 &&
@@ -999,6 +1215,10 @@ again:	switch (o = p->n_op) {
 	case UCALL:
 	case USTCALL:
 	case ADDROF:
+	case POPCNT:
+	case CLZ:
+	case CTZ:
+	case PREFETCH:
 		rv = finduni(p, cookie);
 		break;
 
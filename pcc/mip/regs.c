@@ -41,6 +41,9 @@
 #ifndef MAX
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
 #endif
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
 
 /*
  * New-style register allocator using graph coloring.
@@ -84,28 +87,25 @@
  *
  * The "live" set used during graph building is represented by a bitset.
  *
- * Interference edges are represented by struct AdjSet, hashed and linked
- * from index into the edgehash array.
+ * Each node also gets a dense index r_idx; precolored registers first,
+ * then the long-lived temporaries followed by the nodes allocated
+ * in nsucomp().  Interference edges are represented by a lower-triangular
+ * bit matrix indexed by r_idx, sized per function.  Edges between
+ * nodes the matrix does not cover (more than ADJMAXN nodes) are kept
+ * in struct AdjSet instead, hashed and linked from index into the
+ * edgehash array.
  *
  * A mapping from each node to the moves it is assiciated with is 
  * maintained by an array moveList which for each node number has a linked
  * list of MOVL types, each pointing to a REGM.
  *
- * Adjacency list is maintained by the adjList array, indexed by the
- * node number. Each adjList entry points to an ADJL type, and is a
- * single-linked list for all adjacent nodes.
+ * Adjacency list is maintained as a growing vector of pointers to
+ * the adjacent nodes in each node, r_nadj entries long.  It is walked
+ * from the end so that the latest added edges are seen first.
  *
  * degree, alias and color are integer arrays indexed by node number.
  */
 
-/*
- * linked list of adjacent nodes.
- */
-typedef struct regw3 {
-	struct regw3 *r_next;
-	struct regw *a_temp;
-} ADJL;
-
 /*
  * Structure describing a move.
  */
@@ -125,12 +125,16 @@ typedef struct movlink {
  */
 typedef struct regw {
 	DLIST_ENTRY(regw) link;
-	ADJL *r_adjList;	/* linked list of adjacent nodes */
+	struct regw **r_adjList;	/* vector of adjacent nodes */
+	int r_nadj;		/* number of adjacent nodes */
+	int r_adjsz;		/* allocated size of r_adjList */
+	int r_idx;		/* index in interference matrix */
 	short r_class;		/* this nodes class */
 	short r_nrw;		/* XXX number of regw */
 	int r_nclass[NUMCLASS+1];	/* count of adjacent classes */
 	struct regw *r_alias;		/* aliased temporary */
 	int r_color;		/* final node color */
+	int r_cost;		/* spill cost, uses weighted by loop depth */
 	struct regw *r_onlist;	/* which work list this node belongs to */
 	MOVL *r_moveList;	/* moves associated with this node */
 	int nodnum;		/* Human-readable node number */
@@ -148,7 +152,8 @@ int use_regw;
 #endif
 int nodnum = 100;
 int ntsz, stktemp;
-#define	SETNUM(x)	(x)->nodnum = nodnum++
+static int nregw;	/* number of nodes, next free r_idx */
+#define	SETNUM(x)	(x)->nodnum = nodnum++, (x)->r_idx = nregw++
 #define	ASGNUM(x)	(x)->nodnum
 
 #define	ALLNEEDS (NACOUNT|NBCOUNT|NCCOUNT|NDCOUNT|NECOUNT|NFCOUNT|NGCOUNT)
@@ -372,6 +377,7 @@ nsucomp(NODE *p)
 #define	CLASS(x)	(x)->r_class
 #define	NCLASS(x,c)	(x)->r_nclass[c]
 #define	ADJLIST(x)	(x)->r_adjList
+#define	NADJ(x)		(x)->r_nadj
 #define	ALIAS(x)	(x)->r_alias
 #define	ONLIST(x)	(x)->r_onlist
 #define	MOVELIST(x)	(x)->r_moveList
@@ -576,51 +582,145 @@ worklistmoveadd(REGW *src, REGW *dst)
 	return w;
 }
 
+#define	ADJMAXN	8192	/* max nodes for the interference bit matrix */
 #define	HASHSZ	16384
 struct AdjSet {
 	struct AdjSet *next;
 	REGW *u, *v;
 } *edgehash[HASHSZ];
+static bittype *adjbits;	/* lower-triangular interference matrix */
+static size_t adjbsz;		/* allocated size of adjbits */
+static int adjn;		/* number of nodes covered by adjbits */
+static int adjhash;		/* some edges are in edgehash */
+
+#define	ADJHASH(u,v)	(((u)->r_idx+(v)->r_idx) & (HASHSZ-1))
+
+/*
+ * Setup an empty interference graph for the nregw nodes.
+ * If there are too many nodes all edges go into edgehash.
+ */
+static void
+adjinit(void)
+{
+	size_t sz;
+
+	if (adjhash) {
+		memset(edgehash, 0, sizeof(edgehash));
+		adjhash = 0;
+	}
+	adjn = nregw > ADJMAXN ? 0 : nregw;
+	sz = BIT2BYTE((size_t)adjn*(adjn-1)/2);
+	if (sz > adjbsz)
+		adjbits = tmpalloc(adjbsz = sz);
+	memset(adjbits, 0, sz);
+}
+
+/*
+ * Extend the matrix to cover node index n.  DCE may create new
+ * nodes after the graph is setup; rows are only added at the end
+ * so the existing bits stay in place.  The matrix never grows past
+ * ADJMAXN nodes; edges to nodes above that go into edgehash, so a
+ * pair is always found in the same place.  Return 0 if n is not
+ * covered.
+ */
+static int
+adjgrow(int n)
+{
+	bittype *b;
+	size_t osz, sz;
+
+	if (adjn == 0 || n >= ADJMAXN)
+		return 0;
+	osz = BIT2BYTE((size_t)adjn*(adjn-1)/2);
+	n += adjn/8 + 1;
+	if (n > ADJMAXN)
+		n = ADJMAXN;
+	sz = BIT2BYTE((size_t)n*(n-1)/2);
+	if (sz > adjbsz) {
+		b = tmpalloc(sz);
+		memcpy(b, adjbits, osz);
+		adjbits = b;
+		adjbsz = sz;
+	}
+	memset((char *)adjbits + osz, 0, sz - osz);
+	adjn = n;
+	return 1;
+}
+
+/*
+ * Return the bit number for the edge u-v in adjbits,
+ * or -1 if it is outside the matrix.  adjn <= ADJMAXN
+ * so the bit number fits in an int.
+ */
+static int
+adjbit(REGW *u, REGW *v)
+{
+	int a = u->r_idx, b = v->r_idx;
+
+	if (a < b)
+		a = v->r_idx, b = u->r_idx;
+	if (a >= adjn)
+		return -1;
+	return a*(a-1)/2+b;
+}
+
+/* Check if an edge between two nodes is in adjset */
+static int
+adjtest(REGW *u, REGW *v)
+{
+	struct AdjSet *w;
+	int x;
+
+	if ((x = adjbit(u, v)) >= 0)
+		return TESTBIT(adjbits, x) != 0;
+	if (adjhash == 0)
+		return 0;
+	for (w = edgehash[ADJHASH(u, v)]; w; w = w->next)
+		if ((u == w->u && v == w->v) || (u == w->v && v == w->u))
+			return 1;
+	return 0;
+}
 
 /* Check if a node pair is adjacent */
 static int
 adjSet(REGW *u, REGW *v)
 {
-	struct AdjSet *w;
 	REGW *t;
+	int i;
 
 	if (ONLIST(u) == &precolored) {
-		ADJL *a = ADJLIST(v);
 		/*
 		 * Check if any of the registers that have edges against v
 		 * alias to u.
 		 */
-		for (; a; a = a->r_next) {
-			if (ONLIST(a->a_temp) != &precolored)
+		for (i = NADJ(v)-1; i >= 0; i--) {
+			t = ADJLIST(v)[i];
+			if (ONLIST(t) != &precolored)
 				continue;
-			t = a->a_temp;
 			if (interferes(t - ablock, u - ablock))
 				return 1;
 		}
 	}
-
-	w = edgehash[(u->nodnum+v->nodnum)& (HASHSZ-1)];
-
-	for (; w; w = w->next) {
-		if ((u == w->u && v == w->v) || (u == w->v && v == w->u))
-			return 1;
-	}
-	return 0;
+	return adjtest(u, v);
 }
 
-/* Add a pair to adjset.  No check for dups */
+/* Add a pair to adjset.  Return 1 if already there */
 static int
 adjSetadd(REGW *u, REGW *v)
 {
 	struct AdjSet *w;
 	int x;
 
-	x = (u->nodnum+v->nodnum)& (HASHSZ-1);
+	if ((x = adjbit(u, v)) < 0 && adjgrow(MAX(u->r_idx, v->r_idx)))
+		x = adjbit(u, v);
+	if (x >= 0) {
+		if (TESTBIT(adjbits, x))
+			return 1;
+		BITSET(adjbits, x);
+		return 0;
+	}
+
+	x = ADJHASH(u, v);
 	for (w = edgehash[x]; w; w = w->next)
 		if ((u == w->u && v == w->v) || (u == w->v && v == w->u))
 			return 1;
@@ -629,16 +729,35 @@ adjSetadd(REGW *u, REGW *v)
 	w->u = u, w->v = v;
 	w->next = edgehash[x];
 	edgehash[x] = w;
+	adjhash = 1;
 	return 0;
 }
 
+/*
+ * Append v to the adjacency vector of u.
+ */
+static void
+adjadd(REGW *u, REGW *v)
+{
+	REGW **a;
+
+	if (NADJ(u) == u->r_adjsz) {
+		u->r_adjsz = u->r_adjsz ? u->r_adjsz * 2 : 8;
+		a = tmpalloc(u->r_adjsz * sizeof(REGW *));
+		if (NADJ(u))
+			memcpy(a, ADJLIST(u), NADJ(u) * sizeof(REGW *));
+		ADJLIST(u) = a;
+	}
+	ADJLIST(u)[NADJ(u)++] = v;
+	NCLASS(u, CLASS(v))++;
+}
+
 /*
  * Add an interference edge between two nodes.
  */
 static void
 AddEdge(REGW *u, REGW *v)
 {
-	ADJL *x;
 
 #ifdef PCC_DEBUG
 	RRDEBUG(("AddEdge: u %d v %d\n", ASGNUM(u), ASGNUM(v)));
@@ -662,21 +781,10 @@ AddEdge(REGW *u, REGW *v)
 		comperr("precolored node in AddEdge");
 #endif
 
-	if (ONLIST(u) != &precolored) {
-		x = tmpalloc(sizeof(ADJL));
-		x->a_temp = v;
-		x->r_next = u->r_adjList;
-		u->r_adjList = x;
-		NCLASS(u, CLASS(v))++;
-	}
-
-	if (ONLIST(v) != &precolored) {
-		x = tmpalloc(sizeof(ADJL));
-		x->a_temp = u;
-		x->r_next = v->r_adjList;
-		v->r_adjList = x;
-		NCLASS(v, CLASS(u))++;
-	}
+	if (ONLIST(u) != &precolored)
+		adjadd(u, v);
+	if (ONLIST(v) != &precolored)
+		adjadd(v, u);
 
 #if 0
 	RDEBUG(("AddEdge: u %d(d %d) v %d(d %d)\n", u, DEGREE(u), v, DEGREE(v)));
@@ -1149,11 +1257,18 @@ insnwalk(NODE *p)
 			moveadd(rv, lr), lrv = rv;
 		if (rv && rp)
 			addedge_r(rp, rv);
+		/* dest is set before right is moved to its special reg */
+		if (rv && (w = hasneed(q->needs, cNR)) &&
+		    hasneed(q->needs, cNL) == NULL)
+			AddEdge(rv, &ablock[(int)w[1]]);
 	} else if (q->rewrite & RRIGHT) {
 		if (rr && rv)
 			moveadd(rv, rr), rrv = rv;
 		if (rv && lp)
 			addedge_r(lp, rv);
+		if (rv && (w = hasneed(q->needs, cNL)) &&
+		    hasneed(q->needs, cNR) == NULL)
+			AddEdge(rv, &ablock[(int)w[1]]);
 	}
 
 	switch (optype(o)) {
@@ -1417,25 +1532,19 @@ dce(struct p2env *p2e)
 					struct interpass *previp;
 					struct basicblock *prevbb;
 
+					prevbb = DLIST_PREV(bb, bbelem);
 					if (ip == bb->first && ip == bb->last) {
 						/* Remove basic block */
-						previp = DLIST_PREV(ip, qelem);
-						DLIST_REMOVE(ip, qelem);
-						prevbb = DLIST_PREV(bb, bbelem);
-						DLIST_REMOVE(bb, bbelem);
+						bb_remove(p2e, bb, ip);
 						bb = prevbb;
 					} else if (ip == bb->first) {
-						bb->first =
-						    DLIST_NEXT(ip, qelem);
-						DLIST_REMOVE(ip, qelem);
+						bb_remove(p2e, bb, ip);
 					} else if (ip == bb->last) {
-						previp = DLIST_PREV(ip, qelem);
-						DLIST_REMOVE(ip, qelem);
-						bb->last = previp;
-						bb = DLIST_PREV(bb, bbelem);
+						bb_remove(p2e, bb, ip);
+						bb = prevbb;
 					} else {
 						previp = DLIST_NEXT(ip, qelem);
-						DLIST_REMOVE(ip, qelem);
+						bb_remove(p2e, bb, ip);
 						ip = previp;
 						fix++;
 						continue;
@@ -1450,9 +1559,7 @@ dce(struct p2env *p2e)
 					BDEBUG(("bb %d: DCE doing ip prepend\n", bbnum));
 					tipp = DLIST_NEXT(&prepole, qelem);
 					DLIST_REMOVE(tipp, qelem);
-					DLIST_INSERT_BEFORE(ip, tipp, qelem);
-					if (ip == bb->first)
-						bb->first = tipp;
+					bb_insert_before(p2e, bb, ip, tipp);
 					fix++;
 					BDEBUG(("DCE ip prepended\n"));
 				}
@@ -1521,6 +1628,21 @@ unionize(NODE *p, int bb)
 		unionize(p->n_right, bb);
 }
 
+/*
+ * Remove v from the adjacency vector of u, keeping the order.
+ */
+static void
+adjdel(REGW *u, REGW *v)
+{
+	REGW **a = ADJLIST(u);
+	int i, j;
+
+	for (i = j = 0; i < NADJ(u); i++)
+		if (a[i] != v)
+			a[j++] = a[i];
+	NADJ(u) = j;
+}
+
 /*
  * delete an interference edge between two nodes.
  */
@@ -1528,43 +1650,35 @@ static void
 deledge(REGW *u, REGW *v)
 {
 	struct AdjSet *w, **ww;
-	ADJL *x, **xx;
+	int x;
 
 	if (ONLIST(v) == &precolored || ONLIST(u) == &precolored)
 		return; /* registers can be assigned */
 
-	ww = &edgehash[(u->nodnum+v->nodnum)& (HASHSZ-1)];
-
-	if (*ww == NULL)
-		return; /* no edges */
-
 	/*
 	 * Remove from the adjacent set.
 	 */
-	for (w = *ww; w; ww = &w->next, w = w->next) {
-		if ((u == w->u && v == w->v) || (u == w->v && v == w->u)) {
-			*ww = w->next;
-			RDEBUG(("deledge: %d <> %d\n", u->nodnum, v->nodnum));
+	if ((x = adjbit(u, v)) >= 0) {
+		if (TESTBIT(adjbits, x) == 0)
+			return; /* no edge */
+		BITCLEAR(adjbits, x);
+	} else {
+		ww = &edgehash[ADJHASH(u, v)];
+		if (*ww == NULL)
+			return; /* no edges */
+		for (w = *ww; w; ww = &w->next, w = w->next) {
+			if ((u == w->u && v == w->v) ||
+			    (u == w->v && v == w->u))
+				*ww = w->next;
 		}
 	}
+	RDEBUG(("deledge: %d <> %d\n", u->nodnum, v->nodnum));
 
 	/*
 	 * remove from adjacent lists.
 	 */
-	if (ONLIST(u) != &precolored) {
-		xx = &ADJLIST(u);
-		for (x = *xx; x; xx = &x->r_next, x = x->r_next) {
-			if (x->a_temp == v)
-				*xx = x->r_next;
-		}
-	}
-	if (ONLIST(v) != &precolored) {
-		xx = &ADJLIST(v);
-		for (x = *xx; x; xx = &x->r_next, x = x->r_next) {
-			if (x->a_temp == u)
-				*xx = x->r_next;
-		}
-	}
+	adjdel(u, v);
+	adjdel(v, u);
 }
 
 /*
@@ -1667,7 +1781,8 @@ livagain:
 	for (i = 0; i < NPERMREG-1; i++) {
 		if (nsavregs[i])
 			continue;
-		BITSET(out[p2e->nbblocks-1], (i+MAXREGS));
+		BITSET(out[DLIST_PREV(&p2e->bblocks, bbelem)->bbnum],
+		    (i+MAXREGS));
 		for (j = i+1; j < NPERMREG-1; j++) {
 			if (nsavregs[j])
 				continue;
@@ -1773,32 +1888,32 @@ livagain:
 
 #ifdef PCC_DEBUG
 	if (r2debug) {
-		struct AdjSet *w;
-		ADJL *x;
-		REGW *y;
+		REGW *x, *y;
 		MOVL *m;
 
 		printf("Interference edges\n");
-		for (i = 0; i < HASHSZ; i++) {
-			if ((w = edgehash[i]) == NULL)
-				continue;
-			for (; w; w = w->next)
-				printf("%d <-> %d\n", ASGNUM(w->u), ASGNUM(w->v));
+		DLIST_FOREACH(y, &initial, link) {
+			for (i = NADJ(y)-1; i >= 0; i--) {
+				x = ADJLIST(y)[i];
+				if (ONLIST(x) == &precolored ||
+				    x->r_idx > y->r_idx)
+					printf("%d <-> %d\n",
+					    ASGNUM(y), ASGNUM(x));
+			}
 		}
 		printf("Degrees\n");
 		DLIST_FOREACH(y, &initial, link) {
 			printf("%d (%c): trivial [%d] ", ASGNUM(y),
 			    CLASS(y)+'@', trivially_colorable(y));
-			i = 0;
-			for (x = ADJLIST(y); x; x = x->r_next) {
-				if (ONLIST(x->a_temp) != &selectStack &&
-				    ONLIST(x->a_temp) != &coalescedNodes)
-					printf("%d ", ASGNUM(x->a_temp));
+			for (i = NADJ(y)-1; i >= 0; i--) {
+				x = ADJLIST(y)[i];
+				if (ONLIST(x) != &selectStack &&
+				    ONLIST(x) != &coalescedNodes)
+					printf("%d ", ASGNUM(x));
 				else
-					printf("(%d) ", ASGNUM(x->a_temp));
-				i++;
+					printf("(%d) ", ASGNUM(x));
 			}
-			printf(": n=%d\n", i);
+			printf(": n=%d\n", NADJ(y));
 		}
 		printf("Move nodes\n");
 		DLIST_FOREACH(y, &initial, link) {
@@ -1835,15 +1950,15 @@ EnableMoves(REGW *n)
 static void
 EnableAdjMoves(REGW *nodes)
 {
-	ADJL *w;
 	REGW *n;
+	int i;
 
 	EnableMoves(nodes);
-	for (w = ADJLIST(nodes); w; w = w->r_next) {
-		n = w->a_temp;
+	for (i = NADJ(nodes)-1; i >= 0; i--) {
+		n = ADJLIST(nodes)[i];
 		if (ONLIST(n) == &selectStack || ONLIST(n) == &coalescedNodes)
 			continue;
-		EnableMoves(w->a_temp);
+		EnableMoves(n);
 	}
 }
 
@@ -1878,8 +1993,8 @@ DecrementDegree(REGW *w, int c)
 static void
 Simplify(void)
 {
-	REGW *w;
-	ADJL *l;
+	REGW *w, *t;
+	int i;
 
 	w = POPWLIST(simplifyWorklist);
 	PUSHWLIST(w, selectStack);
@@ -1887,12 +2002,11 @@ Simplify(void)
 	RDEBUG(("Simplify: node %d class %d\n", ASGNUM(w), w->r_class));
 #endif
 
-	l = w->r_adjList;
-	for (; l; l = l->r_next) {
-		if (ONLIST(l->a_temp) == &selectStack ||
-		    ONLIST(l->a_temp) == &coalescedNodes)
+	for (i = NADJ(w)-1; i >= 0; i--) {
+		t = ADJLIST(w)[i];
+		if (ONLIST(t) == &selectStack || ONLIST(t) == &coalescedNodes)
 			continue;
-		DecrementDegree(l->a_temp, w->r_class);
+		DecrementDegree(t, w->r_class);
 	}
 }
 
@@ -1912,16 +2026,16 @@ OK(REGW *t, REGW *r)
 	    ASGNUM(t), CLASS(t), ASGNUM(t), ASGNUM(r), adjSet(t, r)));
 
 	if (r2debug > 1) {
-		ADJL *w;
-		int ndeg = 0;
+		REGW *w;
+		int i, ndeg = 0;
 		printf("OK degree: ");
-		for (w = ADJLIST(t); w; w = w->r_next) {
-			if (ONLIST(w->a_temp) != &selectStack &&
-			    ONLIST(w->a_temp) != &coalescedNodes)
-				printf("%c%d ", CLASS(w->a_temp)+'@',
-				    ASGNUM(w->a_temp)), ndeg++;
+		for (i = NADJ(t)-1; i >= 0; i--) {
+			w = ADJLIST(t)[i];
+			if (ONLIST(w) != &selectStack &&
+			    ONLIST(w) != &coalescedNodes)
+				printf("%c%d ", CLASS(w)+'@', ASGNUM(w)), ndeg++;
 			else
-				printf("(%d) ", ASGNUM(w->a_temp));
+				printf("(%d) ", ASGNUM(w));
 		}
 		printf("\n");
 #if 0
@@ -1940,12 +2054,12 @@ OK(REGW *t, REGW *r)
 static int
 adjok(REGW *v, REGW *u)
 {
-	ADJL *w;
 	REGW *t;
+	int i;
 
 	RDEBUG(("adjok\n"));
-	for (w = ADJLIST(v); w; w = w->r_next) {
-		t = w->a_temp;
+	for (i = NADJ(v)-1; i >= 0; i--) {
+		t = ADJLIST(v)[i];
 		if (ONLIST(t) == &selectStack || ONLIST(t) == &coalescedNodes)
 			continue;
 		if (OK(t, u) == 0)
@@ -1963,9 +2077,8 @@ adjok(REGW *v, REGW *u)
 static int
 Conservative(REGW *u, REGW *v)
 {
-	ADJL *w, *ww;
 	REGW *n;
-	int xncl[NUMCLASS+1], mcl = 0, j;
+	int xncl[NUMCLASS+1], mcl = 0, i, j;
 
 	for (j = 0; j < NUMCLASS+1; j++)
 		xncl[j] = 0;
@@ -1973,8 +2086,8 @@ Conservative(REGW *u, REGW *v)
 	 * Increment xncl[class] up to K for each class.
 	 * If all classes has reached K then check colorability and return.
 	 */
-	for (w = ADJLIST(u); w; w = w->r_next) {
-		n = w->a_temp;
+	for (i = NADJ(u)-1; i >= 0; i--) {
+		n = ADJLIST(u)[i];
 		if (ONLIST(n) == &selectStack || ONLIST(n) == &coalescedNodes)
 			continue;
 		if (xncl[CLASS(n)] == regK[CLASS(n)])
@@ -1986,17 +2099,14 @@ Conservative(REGW *u, REGW *v)
 		if (++mcl == NUMCLASS)
 			goto out; /* cannot get more out of it */
 	}
-	for (w = ADJLIST(v); w; w = w->r_next) {
-		n = w->a_temp;
+	for (i = NADJ(v)-1; i >= 0; i--) {
+		n = ADJLIST(v)[i];
 		if (ONLIST(n) == &selectStack || ONLIST(n) == &coalescedNodes)
 			continue;
 		if (xncl[CLASS(n)] == regK[CLASS(n)])
 			continue;
-		/* ugly: have we been here already? */
-		for (ww = ADJLIST(u); ww; ww = ww->r_next)
-			if (ww->a_temp == n)
-				break;
-		if (ww)
+		/* have we been here already? */
+		if (adjtest(u, n))
 			continue;
 		if (!trivially_colorable(n) || ONLIST(n) == &precolored)
 			xncl[CLASS(n)]++;
@@ -2024,8 +2134,8 @@ static void
 Combine(REGW *u, REGW *v)
 {
 	MOVL *m;
-	ADJL *l;
 	REGW *t;
+	int i;
 
 #ifdef PCC_DEBUG
 	RDEBUG(("Combine (%d,%d)\n", ASGNUM(u), ASGNUM(v)));
@@ -2038,11 +2148,12 @@ Combine(REGW *u, REGW *v)
 	}
 	PUSHWLIST(v, coalescedNodes);
 	ALIAS(v) = u;
+	u->r_cost += v->r_cost;
 #ifdef PCC_DEBUG
 	if (r2debug) { 
 		printf("adjlist(%d): ", ASGNUM(v));
-		for (l = ADJLIST(v); l; l = l->r_next)
-			printf("%d ", l->a_temp->nodnum);
+		for (i = NADJ(v)-1; i >= 0; i--)
+			printf("%d ", ADJLIST(v)[i]->nodnum);
 		printf("\n");
 	}
 #endif
@@ -2069,8 +2180,8 @@ Combine(REGW *u, REGW *v)
 		MOVELIST(u) = MOVELIST(v);
 #endif
 	EnableMoves(v);
-	for (l = ADJLIST(v); l; l = l->r_next) {
-		t = l->a_temp;
+	for (i = NADJ(v)-1; i >= 0; i--) {
+		t = ADJLIST(v)[i];
 		if (ONLIST(t) == &selectStack || ONLIST(t) == &coalescedNodes)
 			continue;
 		/* Do not add edge if u cannot affect the colorability of t */
@@ -2085,14 +2196,14 @@ Combine(REGW *u, REGW *v)
 	}
 #ifdef PCC_DEBUG
 	if (r2debug) {
-		ADJL *w;
 		printf("Combine %d class (%d): ", ASGNUM(u), CLASS(u));
-		for (w = ADJLIST(u); w; w = w->r_next) {
-			if (ONLIST(w->a_temp) != &selectStack &&
-			    ONLIST(w->a_temp) != &coalescedNodes)
-				printf("%d ", ASGNUM(w->a_temp));
+		for (i = NADJ(u)-1; i >= 0; i--) {
+			t = ADJLIST(u)[i];
+			if (ONLIST(t) != &selectStack &&
+			    ONLIST(t) != &coalescedNodes)
+				printf("%d ", ASGNUM(t));
 			else
-				printf("(%d) ", ASGNUM(w->a_temp));
+				printf("(%d) ", ASGNUM(t));
 		}
 		printf("\n");
 	}
@@ -2256,6 +2367,19 @@ Freeze(void)
 	FreezeMoves(u);
 }
 
+/*
+ * Number of neighbours still in the graph.
+ */
+static int
+spilldeg(REGW *w)
+{
+	int c, n;
+
+	for (n = 0, c = 1; c < NUMCLASS+1; c++)
+		n += NCLASS(w, c);
+	return n;
+}
+
 static void
 SelectSpill(void)
 {
@@ -2265,7 +2389,8 @@ SelectSpill(void)
 #ifdef PCC_DEBUG
 	if (r2debug)
 		DLIST_FOREACH(w, &spillWorklist, link)
-			printf("SelectSpill: %d\n", ASGNUM(w));
+			printf("SelectSpill: %d cost %d\n",
+			    ASGNUM(w), w->r_cost);
 #endif
 
 	/* First check if we can spill register variables */
@@ -2276,13 +2401,21 @@ SelectSpill(void)
 
 	RRDEBUG(("SelectSpill: trying longrange\n"));
 	if (w == &spillWorklist) {
-		/* try to find another long-range variable */
+		/* find the cheapest long-range variable by cost/degree */
+		REGW *best = &spillWorklist;
+		int deg, bdeg = 0;
+
 		DLIST_FOREACH(w, &spillWorklist, link) {
+			if (w < &nblock[basetemp] || w >= &nblock[tempmax])
+				continue;
 			if (innotspill(w - nblock))
 				continue;
-			if (w >= &nblock[tempmin] && w < &nblock[tempmax])
-				break;
+			deg = spilldeg(w);
+			if (best == &spillWorklist || (long long)w->r_cost * bdeg <
+			    (long long)best->r_cost * deg)
+				best = w, bdeg = deg;
 		}
+		w = best;
 	}
 
 	if (w == &spillWorklist) {
@@ -2409,13 +2542,186 @@ colfind(int okColors, REGW *r)
 	return color2reg(ffs(okColors)-1, CLASS(r));
 }
 
+/*
+ * Linear scan allocation, used instead of simplify/coalesce if
+ * xlinearscan is set.  The live interval of a node is the range of
+ * tree positions from its first to its last use, stretched to the
+ * block bounds where it is live in or out.  Nodes are colored in
+ * order of interval start; if a node cannot be colored, the
+ * interfering long-lived temporaries that end last are spilled
+ * instead where possible.  Interferences are still those found
+ * by Build(), so all register constraints are honored; the graph
+ * is built as usual, so only the coloring time is saved.
+ */
+static int *ivstart, *ivend, lspos;
+
+#define	LONGLIVED(w)	((w) >= &nblock[tempmin] && (w) < &nblock[tempmax])
+
+static void
+lsuse(int idx)
+{
+	if (ivstart[idx] < 0)
+		ivstart[idx] = lspos;
+	ivend[idx] = lspos;
+}
+
+static void
+lsnode(NODE *p, void *arg)
+{
+	REGW *w;
+	int i;
+
+	if ((w = p->n_regw) != NULL)
+		for (i = 0; i < w->r_nrw; i++)
+			lsuse(w[i].r_idx);
+	if (p->n_op == TEMP)
+		lsuse(nblock[regno(p)].r_idx);
+	lspos++;
+}
+
+static void
+lsrange(struct interpass *ip, struct interpass *last, int bbnum)
+{
+	int i;
+
+	for (i = MAXREGS; i < xbits; i++)
+		if (TESTBIT(in[bbnum], i))
+			lsuse(i);
+	for (;;) {
+		if (ip->type == IP_NODE)
+			walkf(ip->ip_node, lsnode, 0);
+		if (ip == last)
+			break;
+		ip = DLIST_NEXT(ip, qelem);
+	}
+	lspos++;
+	for (i = MAXREGS; i < xbits; i++)
+		if (TESTBIT(out[bbnum], i))
+			lsuse(i);
+}
+
+static int
+lscmp(const void *a, const void *b)
+{
+	REGW *u = *(REGW * const *)a, *v = *(REGW * const *)b;
+
+	if (ivstart[u->r_idx] != ivstart[v->r_idx])
+		return ivstart[u->r_idx] - ivstart[v->r_idx];
+	return u->r_idx - v->r_idx;
+}
+
+static void
+LinearScan(struct p2env *p2e)
+{
+	struct interpass *ipole = &p2e->ipole;
+	struct basicblock *bb;
+	REGW **wv, *w;
+	int i, n;
+
+	ivstart = tmpalloc(nregw * sizeof(int));
+	ivend = tmpalloc(nregw * sizeof(int));
+	for (i = 0; i < nregw; i++)
+		ivstart[i] = ivend[i] = -1;
+	lspos = 0;
+	if (xtemps == 0) {
+		/* Build() used a single fake basic block */
+		lsrange(DLIST_NEXT(ipole, qelem), DLIST_PREV(ipole, qelem), 0);
+	} else {
+		DLIST_FOREACH(bb, &p2e->bblocks, bbelem)
+			lsrange(bb->first, bb->last, bb->bbnum);
+	}
+
+	n = 0;
+	DLIST_FOREACH(w, &simplifyWorklist, link)
+		n++;
+	DLIST_FOREACH(w, &freezeWorklist, link)
+		n++;
+	DLIST_FOREACH(w, &spillWorklist, link)
+		n++;
+	wv = tmpalloc((n+1) * sizeof(REGW *));
+	n = 0;
+	while (!WLISTEMPTY(simplifyWorklist))
+		wv[n++] = POPWLIST(simplifyWorklist);
+	while (!WLISTEMPTY(freezeWorklist))
+		wv[n++] = POPWLIST(freezeWorklist);
+	while (!WLISTEMPTY(spillWorklist))
+		wv[n++] = POPWLIST(spillWorklist);
+	qsort(wv, n, sizeof(REGW *), lscmp);
+
+	/* AssignColors pops from the top */
+	for (i = n-1; i >= 0; i--) {
+		w = wv[i];
+		PUSHWLIST(w, selectStack);
+#ifdef PCC_DEBUG
+		RDEBUG(("LinearScan: %d interval %d-%d\n",
+		    ASGNUM(w), ivstart[w->r_idx], ivend[w->r_idx]));
+#endif
+	}
+}
+
+/*
+ * Colors free for w if the colored long-lived neighbours whose
+ * intervals end after lim are ignored.
+ */
+static int
+lsfree(REGW *w, int lim)
+{
+	REGW *v;
+	int i, ok;
+
+	ok = classmask(CLASS(w));
+	for (i = NADJ(w)-1; i >= 0; i--) {
+		v = GetAlias(ADJLIST(w)[i]);
+		if (ONLIST(v) == &coloredNodes) {
+			if (LONGLIVED(v) && ivend[v->r_idx] > lim)
+				continue;
+		} else if (ONLIST(v) != &precolored)
+			continue;
+		ok &= ~aliasmap(CLASS(w), COLOR(v));
+	}
+	return ok;
+}
+
+/*
+ * No color left for w; spill the colored long-lived neighbours that
+ * live longer than w, longest first, until a color gets free.
+ * Return the free colors, or 0 if w itself should be spilled.
+ */
+static int
+lsevict(REGW *w)
+{
+	REGW *o, *best;
+	int i, ok, lim;
+
+	lim = LONGLIVED(w) ? ivend[w->r_idx] : -1;
+	if (lsfree(w, lim) == 0)
+		return 0;
+	while ((ok = lsfree(w, lspos)) == 0) {
+		best = NULL;
+		for (i = NADJ(w)-1; i >= 0; i--) {
+			o = GetAlias(ADJLIST(w)[i]);
+			if (ONLIST(o) != &coloredNodes || !LONGLIVED(o) ||
+			    ivend[o->r_idx] <= lim)
+				continue;
+			if (best == NULL || ivend[o->r_idx] > ivend[best->r_idx])
+				best = o;
+		}
+#ifdef PCC_DEBUG
+		RDEBUG(("lsevict: spilling %d for %d\n",
+		    ASGNUM(best), ASGNUM(w)));
+#endif
+		DELWLIST(best);
+		PUSHWLIST(best, spilledNodes);
+	}
+	return ok;
+}
+
 static void
 AssignColors(struct interpass *ip)
 {
 	struct interpass *ip2;
-	int okColors, c;
-	REGW *o, *w;
-	ADJL *x;
+	int okColors, c, i;
+	REGW *o, *w, *x;
 
 	RDEBUG(("AssignColors\n"));
 	while (!WLISTEMPTY(selectStack)) {
@@ -2426,11 +2732,12 @@ AssignColors(struct interpass *ip)
 		    w->nodnum, CLASS(w), okColors));
 #endif
 
-		for (x = ADJLIST(w); x; x = x->r_next) {
-			o = GetAlias(x->a_temp);
+		for (i = NADJ(w)-1; i >= 0; i--) {
+			x = ADJLIST(w)[i];
+			o = GetAlias(x);
 #ifdef PCC_DEBUG
 			RRDEBUG(("Adj(%d): %d (%d)\n",
-			    ASGNUM(w), ASGNUM(o), ASGNUM(x->a_temp)));
+			    ASGNUM(w), ASGNUM(o), ASGNUM(x)));
 #endif
 
 			if (ONLIST(o) == &coloredNodes ||
@@ -2443,6 +2750,8 @@ AssignColors(struct interpass *ip)
 				okColors &= ~c;
 			}
 		}
+		if (okColors == 0 && xlinearscan)
+			okColors = lsevict(w);
 		if (okColors == 0) {
 			PUSHWLIST(w, spilledNodes);
 #ifdef PCC_DEBUG
@@ -2553,7 +2862,7 @@ shstore(NODE *p, struct interpass *ipp, REGW *w)
 	l = storenode(p->n_type, off);
 
 	ip = ipnode(mkbinode(ASSIGN, storenode(p->n_type, off), p, p->n_type));
-	DLIST_INSERT_BEFORE(ipp, ip, qelem);
+	bb_insert_before(&p2env, NULL, ipp, ip);
 	DLIST_REMOVE(w, link);
 	return l;
 }
@@ -2576,7 +2885,7 @@ static int
 shorttemp(NODE *p, NODE *parent, REGW *w)
 {
 	struct interpass *nip;
-	ADJL *ll;
+	REGW *t;
 	NODE *l, *r;
 	int off, i, nc;
 
@@ -2624,11 +2933,10 @@ down:		switch (optype(p->n_op)) {
 	}
 
 	/* Store long-term temps that interferes */
-	ll = w->r_adjList;
-	for (; ll; ll = ll->r_next) {
-		if (ll->a_temp < &nblock[tempmax] &&
-		    ll->a_temp >= &nblock[tempmin]) {
-			longsp = ll->a_temp;
+	for (i = NADJ(w)-1; i >= 0; i--) {
+		t = ADJLIST(w)[i];
+		if (t < &nblock[tempmax] && t >= &nblock[tempmin]) {
+			longsp = t;
 			RDEBUG(("Stored long %d\n", ASGNUM(longsp)));
 			return 1; /* try again */
 		}
@@ -2648,7 +2956,7 @@ dospill:
 	*r = *p;
 	nip = ipnode(mkbinode(ASSIGN, l, r, p->n_type));
 	storemod(p, off, FPREG); /* XXX */
-	DLIST_INSERT_BEFORE(cip, nip, qelem);
+	bb_insert_before(&p2env, NULL, cip, nip);
 	DLIST_REMOVE(w, link);
 	RDEBUG(("Stored parent node %d (%p)\n", ASGNUM(w), p));
 	return 1;
@@ -2714,6 +3022,7 @@ treerewrite(struct interpass *ipole, REGW *rpole)
 	REGW *w, longregs;
 
 	spole = rpole;
+	longsp = NULL;
 
 	DLIST_FOREACH(ip, ipole, qelem) {
 		if (ip->type != IP_NODE)
@@ -2802,6 +3111,115 @@ temparg(struct interpass *ipole, REGW *w)
 	return 0;
 }
 
+/*
+ * Rematerialization.  A spilled long-lived temporary that is assigned
+ * only once, from a constant or a frame address, need not live on
+ * stack; the value is recomputed at each use instead.
+ */
+static NODE **rmval, rmnone, rmbad;
+
+static int
+canremat(NODE *p)
+{
+	if (p->n_op == ICON)
+		return 1;
+	if ((p->n_op == PLUS || p->n_op == MINUS) &&
+	    p->n_left->n_op == REG && regno(p->n_left) == FPREG &&
+	    p->n_right->n_op == ICON && p->n_right->n_name[0] == 0)
+		return 1;
+	return 0;
+}
+
+static void
+rmscan(NODE *p, void *arg)
+{
+	struct interpass *ip = arg;
+	int t;
+
+	if (p->n_op == XARG && p->n_left->n_op == TEMP) {
+		/* may be an output operand */
+		if (rmval[regno(p->n_left)])
+			rmval[regno(p->n_left)] = &rmbad;
+		return;
+	}
+	if (p->n_op != ASSIGN || p->n_left->n_op != TEMP)
+		return;
+	t = regno(p->n_left);
+	if (rmval[t] == NULL)
+		return;	/* not spilled */
+	if (rmval[t] == &rmnone && p == ip->ip_node && canremat(p->n_right))
+		rmval[t] = p;
+	else
+		rmval[t] = &rmbad;
+}
+
+static void
+rmuse(NODE *p, void *arg)
+{
+	NODE *q;
+
+	if (p->n_op != TEMP || rmval[regno(p)] == NULL)
+		return;
+	q = tcopy(rmval[regno(p)]->n_right);
+	*p = *q;
+	nfree(q);
+}
+
+/*
+ * Remove the rematerializable temps from rpole and substitute their
+ * definitions into the uses.  Return the number of temps removed.
+ */
+static int
+remat(struct interpass *ipole, REGW *rpole)
+{
+	struct interpass *ip;
+	REGW *w, *ww, rmpole;
+	NODE *p;
+	int n;
+
+	rmval = tmpcalloc((tempmax-tempmin) * sizeof(NODE *));
+	rmval -= tempmin;
+	DLIST_FOREACH(w, rpole, link)
+		rmval[w - nblock] = &rmnone;
+	DLIST_FOREACH(ip, ipole, qelem)
+		if (ip->type == IP_NODE)
+			walkf(ip->ip_node, rmscan, ip);
+
+	n = 0;
+	DLIST_INIT(&rmpole, link);
+	for (w = DLIST_NEXT(rpole, link); w != rpole; w = ww) {
+		ww = DLIST_NEXT(w, link);
+		if (rmval[w - nblock] == &rmnone ||
+		    rmval[w - nblock] == &rmbad) {
+			rmval[w - nblock] = NULL;
+			continue;
+		}
+		RDEBUG(("remat %d\n", ASGNUM(w)));
+		DLIST_REMOVE(w, link);
+		DLIST_INSERT_AFTER(&rmpole, w, link);
+		n++;
+	}
+	if (n == 0)
+		return 0;
+
+	DLIST_FOREACH(ip, ipole, qelem) {
+		if (ip->type != IP_NODE)
+			continue;
+		p = ip->ip_node;
+		if (p->n_op == ASSIGN && p->n_left->n_op == TEMP &&
+		    rmval[regno(p->n_left)] == p) {
+			/* Keep basic blocks, see temparg() */
+			ip->type = IP_ASM;
+			ip->ip_asm = "";
+			continue;
+		}
+		walkf(p, rmuse, 0);
+	}
+	DLIST_FOREACH(w, &rmpole, link)
+		tfree(rmval[w - nblock]);
+	return n;
+}
+
 #define	ONLYPERM 1
 #define	LEAVES	 2
 #define	SMALL	 3
@@ -2860,6 +3278,8 @@ RewriteProgram(struct interpass *ip)
 			nsavregs[num] = 1;
 		}
 	}
+	if (!DLIST_ISEMPTY(&longregs, link) && remat(ip, &longregs))
+		rwtyp = ONLYPERM;
 	if (!DLIST_ISEMPTY(&longregs, link)) {
 		rwtyp = LEAVES;
 		DLIST_FOREACH(w, &longregs, link) {
@@ -2935,6 +3355,36 @@ insgen()
 }
 #endif
 
+static void
+tempcost(NODE *p, void *arg)
+{
+	if (p->n_op == TEMP)
+		nblock[regno(p)].r_cost += *(int *)arg;
+}
+
+/*
+ * Set the spill cost of the long-lived temporaries.  Each use or
+ * def counts as 8^depth where depth is the loop nesting of its block.
+ */
+static void
+spillcosts(struct p2env *p2e, int *lpdepth)
+{
+	struct basicblock *bb;
+	struct interpass *ip;
+	int d, c;
+
+	DLIST_FOREACH(bb, &p2e->bblocks, bbelem) {
+		d = lpdepth && bb->dfnum ? lpdepth[bb->dfnum] : 0;
+		c = 1 << (3 * MIN(d, 5));
+		for (ip = bb->first; ; ip = DLIST_NEXT(ip, qelem)) {
+			if (ip->type == IP_NODE)
+				walkf(ip->ip_node, tempcost, &c);
+			if (ip == bb->last)
+				break;
+		}
+	}
+}
+
 /*
  * Do register allocation for trees by graph-coloring.
  */
@@ -2948,6 +3398,8 @@ ngenregs(struct p2env *p2e)
 	int uu[NPERMREG] = { -1 };
 	int xnsavregs[NPERMREG];
 	int beenhere = 0;
+	int *lpdepth = NULL;
+	struct loop *lp;
 	TWORD type;
 
 	DLIST_INIT(&lunused, link);
@@ -2983,12 +3435,13 @@ ngenregs(struct p2env *p2e)
 		ablock[i].r_onlist = &precolored;
 		ablock[i].r_class = GCLASS(i); /* XXX */
 		ablock[i].r_color = i;
+		ablock[i].r_idx = i;
 #ifdef PCC_DEBUG
 		ablock[i].nodnum = i;
 #endif
 	}
+	adjbsz = 0;
 
-ssagain:
 	tempmax = p2e->epp->ip_tmpnum;
 #ifdef PCC_DEBUG
 	nodnum = tempmax;
@@ -3006,6 +3459,16 @@ ssagain:
 	}
 	live = tmpalloc(BIT2BYTE(xbits));
 
+	/* loop nesting depth of each block, for spill costs */
+	if (xtemps && !SLIST_ISEMPTY(&p2e->loops)) {
+		lpdepth = tmpcalloc(p2e->bbinfo.size * sizeof(int));
+		SLIST_FOREACH(lp, &p2e->loops, loopelem)
+			for (i = 1; i < p2e->bbinfo.size; i++)
+				if (TESTBIT(lp->blocks, i) &&
+				    lp->depth > lpdepth[i])
+					lpdepth[i] = lp->depth;
+	}
+
 #ifdef notyet
 	TMPMARK();
 #endif
@@ -3013,8 +3476,6 @@ ssagain:
 
 recalc:
 onlyperm: /* XXX - should not have to redo all */
-	memset(edgehash, 0, sizeof(edgehash));
-
 	/* clear adjacent node list */
 	for (i = 0; i < MAXREGS; i++)
 		for (j = 0; j < NUMCLASS+1; j++)
@@ -3022,15 +3483,19 @@ onlyperm: /* XXX - should not have to redo all */
 
 	if (tbits) {
 		memset(nblock+tempmin, 0, tbits * sizeof(REGW));
+		for (i = tempmin; i < tempmax; i++) {
+			nblock[i].r_idx = i - tempmin + MAXREGS;
 #ifdef PCC_DEBUG
-		for (i = tempmin; i < tempmax; i++)
 			nblock[i].nodnum = i;
 #endif
+		}
 	}
+	nregw = xbits;
 	memset(live, 0, BIT2BYTE(xbits));
 	RPRINTIP(ipole);
 	DLIST_INIT(&initial, link);
 	ntsz = 0;
+	tmenter(TM_GENINSN);
 	DLIST_FOREACH(ip, ipole, qelem) {
 		extern int thisline;
 		if (ip->type != IP_NODE)
@@ -3045,8 +3510,13 @@ onlyperm: /* XXX - should not have to redo all */
 		walkf(ip->ip_node, traclass, 0);
 	}
 	nodepole = NIL;
+	tmleave();
+	tmenter(TM_RABUILD);
+	if (xtemps)
+		spillcosts(p2e, lpdepth);
 	RDEBUG(("nsucomp allocated %d temps (%d,%d)\n", 
 	    tempmax-tempmin, tempmin, tempmax));
+	adjinit();
 
 #ifdef PCC_DEBUG
 	use_regw = 1;
@@ -3074,10 +3544,14 @@ onlyperm: /* XXX - should not have to redo all */
 
 	Build(p2e);
 	RDEBUG(("Build done\n"));
+	tmleave();
+	tmenter(TM_RACOLOR);
 	MkWorklist();
 	RDEBUG(("MkWorklist done\n"));
 	Coalassign(p2e);
-	do {
+	if (xlinearscan)
+		LinearScan(p2e);
+	else do {
 		if (!WLISTEMPTY(simplifyWorklist))
 			Simplify();
 		else if (!WLISTEMPTY(worklistMoves))
@@ -3089,20 +3563,22 @@ onlyperm: /* XXX - should not have to redo all */
 	} while (!WLISTEMPTY(simplifyWorklist) || !WLISTEMPTY(worklistMoves) ||
 	    !WLISTEMPTY(freezeWorklist) || !WLISTEMPTY(spillWorklist));
 	AssignColors(ipole);
+	tmleave();
 
 	RDEBUG(("After AssignColors\n"));
 	RPRINTIP(ipole);
 
 	if (!WLISTEMPTY(spilledNodes)) {
-		switch (RewriteProgram(ipole)) {
+		tmenter(TM_RASPILL);
+		i = RewriteProgram(ipole);
+		tmleave();
+		switch (i) {
 		case ONLYPERM:
 			goto onlyperm;
 		case SMALL:
-			optimize(p2e);
+			/* basic blocks are kept up to date by treerewrite */
 			if (beenhere++ == MAXLOOP)
 				comperr("cannot color graph - COLORMAP() bug?");
-			if (xssa)
-				goto ssagain;
 			goto recalc;
 		}
 	}
@@ -0,0 +1,369 @@
+/*	$Id$	*/
+/*
+ * Copyright (c) 2026 The pcc project.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * List instruction scheduler (-xsched).
+ *
+ * Works on the instruction list of a function built by peep.c, after
+ * the peephole rules.  The target describes each instruction through
+ * schedinsn(): its class, the registers it reads and writes and the
+ * memory it touches.  Runs of such instructions between labels,
+ * branches and anything schedinsn() does not know are scheduled as a
+ * block: a dependency graph is built and the instructions are issued
+ * cycle by cycle, longest path to the end of the block first, using
+ * the latencies and issue limits in schedmodel.
+ *
+ * If the model has a nop the target has no interlocks; stall cycles
+ * are filled with it, and the nops already in the code are removed
+ * since they are put back where still needed.  At the end of a block
+ * all results are waited for.
+ *
+ * Memory references are kept in order unless both are off the same
+ * frame register and do not overlap; anything else may be volatile.
+ */
+
+#include "pass2.h"
+
+#ifdef SCHEDULE
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define	SCHEDMAX	128	/* max instructions in a block */
+
+static struct snode {
+	struct minsn *mi;
+	struct schedinfo si;
+	int lat;		/* result latency */
+	int hgt;		/* longest path to the end of the block */
+	int npred;		/* predecessors not yet issued */
+	int early;		/* earliest cycle to issue in */
+	int cycle;		/* issued in, or -1 */
+	int bver;		/* writes of mreg before it in the block */
+} sn[SCHEDMAX];
+static int nsn;
+static signed char edge[SCHEDMAX][SCHEDMAX];	/* latency i->j, or -1 */
+
+/*
+ * Add the registers in operand s to the used or, if def, the written
+ * set of si.  Registers inside parentheses or brackets are addresses
+ * and always used.  A single register there is taken as the base of
+ * a memory reference, with the number in front of it (or after '#'
+ * inside brackets) as offset.
+ */
+void
+schedopd(struct schedinfo *si, char *s, int def)
+{
+	char buf[32], *e, *s0 = s;
+	int r, par, nr, base;
+	CONSZ off;
+
+	par = nr = 0;
+	base = -1;
+	while (*s) {
+		if (*s == '(' || *s == '[')
+			par++;
+		else if (*s == ')' || *s == ']')
+			par--;
+		if (!isalnum((unsigned char)*s) && *s != '$' && *s != '%' &&
+		    *s != '_') {
+			s++;
+			continue;
+		}
+		for (e = s; isalnum((unsigned char)*e) || *e == '$' ||
+		    *e == '%' || *e == '_' || *e == '.'; e++)
+			;
+		if (e - s < (int)sizeof(buf)) {
+			memcpy(buf, s, e - s);
+			buf[e - s] = 0;
+			if ((r = schedreg(buf)) >= 0 && r < SCHEDREGS) {
+				if (par) {
+					BITSET(si->use, r);
+					base = r;
+					nr++;
+				} else if (def)
+					BITSET(si->def, r);
+				else
+					BITSET(si->use, r);
+			}
+		}
+		s = e;
+	}
+	if ((si->flags & SF_MEM) == 0 || nr != 1)
+		return;
+	if (*s0 == '[') {
+		e = strchr(s0, '#');
+		off = e ? strtoll(e+1, NULL, 0) : 0;
+	} else {
+		off = strtoll(s0, &e, 0);
+		if (*e != '(')
+			return;
+	}
+	si->mreg = base;
+	si->moff = off;
+}
+
+/*
+ * Describe instruction mi as entry op of the target table tab says.
+ * The first operand is written if SO_DEF is set, the others are read.
+ * Return 0 if op is not in the table.
+ */
+int
+schedtab(struct minsn *mi, char *op, struct schedop *tab, struct schedinfo *si)
+{
+	int i;
+
+	for (; tab->name; tab++)
+		if (strcmp(tab->name, op) == 0)
+			break;
+	if (tab->name == NULL)
+		return 0;
+	si->class = tab->class;
+	si->flags = tab->flags & ~SO_DEF;
+	si->msize = tab->size;
+	for (i = 0; i < mi->nopd; i++)
+		schedopd(si, mi->opd[i], i == 0 && (tab->flags & SO_DEF));
+	if (tab->idef)
+		BITSET(si->def, tab->idef);
+	if (tab->iuse)
+		BITSET(si->use, tab->iuse);
+	return 1;
+}
+
+/*
+ * Ask the target about mi.  Return 0 if it is unknown.
+ */
+static int
+sinfo(struct minsn *mi, struct schedinfo *si)
+{
+	memset(si, 0, sizeof(struct schedinfo));
+	si->mreg = -1;
+	if (mi->type != MI_INSN || schedinsn(mi, si) == 0)
+		return 0;
+	if (si->msize == 0)
+		si->msize = 8;
+	return 1;
+}
+
+static int
+overlap(bittype *a, bittype *b)
+{
+	int i;
+
+	for (i = 0; i < BIT2BYTE(SCHEDREGS); i++)
+		if (a[i] & b[i])
+			return 1;
+	return 0;
+}
+
+/*
+ * Can memory references a and b (a first) be reordered?
+ */
+static int
+memfree(struct snode *a, struct snode *b)
+{
+	if ((a->si.flags & SF_MEM) == 0 || (b->si.flags & SF_MEM) == 0)
+		return 1;
+	if (a->si.mreg < 0 || a->si.mreg != b->si.mreg || a->bver != b->bver)
+		return 0;
+	if (((a->si.flags | b->si.flags) & SF_STORE) == 0)
+		return 1;
+	return a->si.moff + a->si.msize <= b->si.moff ||
+	    b->si.moff + b->si.msize <= a->si.moff;
+}
+
+/*
+ * Build the dependency graph of the block.
+ */
+static void
+mkdag(void)
+{
+	struct snode *a, *b;
+	int i, j, k, e;
+
+	for (i = 0; i < nsn; i++) {
+		a = &sn[i];
+		a->lat = a->si.lat ? a->si.lat : schedmodel.lat[a->si.class];
+		if (a->lat < 1)
+			a->lat = 1;
+		a->npred = a->early = a->bver = 0;
+		a->cycle = -1;
+		if (a->si.mreg >= 0)
+			for (k = 0; k < i; k++)
+				if (TESTBIT(sn[k].si.def, a->si.mreg))
+					a->bver++;
+	}
+	for (i = 0; i < nsn; i++) {
+		a = &sn[i];
+		for (j = i+1; j < nsn; j++) {
+			b = &sn[j];
+			e = -1;
+			if (overlap(a->si.def, b->si.use) ||
+			    overlap(a->si.def, b->si.def))
+				e = a->lat;
+			if (overlap(a->si.use, b->si.def) && e < a->si.war)
+				e = a->si.war;
+			if (!memfree(a, b) && e < 1)
+				e = (a->si.flags & SF_STORE) ? 1 : 0;
+			if (e > 127)
+				e = 127;
+			edge[i][j] = e;
+			if (e >= 0)
+				b->npred++;
+		}
+	}
+	for (i = nsn-1; i >= 0; i--) {
+		a = &sn[i];
+		a->hgt = a->lat;
+		for (j = i+1; j < nsn; j++)
+			if (edge[i][j] >= 0 && edge[i][j] + sn[j].hgt > a->hgt)
+				a->hgt = edge[i][j] + sn[j].hgt;
+	}
+}
+
+/*
+ * Make a new nop after pos.
+ */
+static struct minsn *
+addnop(struct minsn *pos)
+{
+	struct minsn *mi = tmpcalloc(sizeof(struct minsn));
+
+	mi->type = MI_INSN;
+	mi->op = schedmodel.nop;
+	mi->form = mi->op;
+	mi->text = tmpalloc(strlen(mi->op) + 2);
+	mi->text[0] = '\t';
+	strcpy(mi->text + 1, mi->op);
+	DLIST_INSERT_AFTER(pos, mi, link);
+	return mi;
+}
+
+/*
+ * Schedule the block collected in sn[] and put it back into the list.
+ */
+static void
+sblock(void)
+{
+	struct minsn *pos;
+	struct snode *a;
+	int used[NSCLASS];
+	int i, j, best, cycle, left, issued, end;
+
+	if (nsn == 0)
+		return;
+	pos = DLIST_PREV(sn[0].mi, link);
+	for (i = 0; i < nsn; i++)
+		DLIST_REMOVE(sn[i].mi, link);
+	mkdag();
+
+	end = 0;
+	for (cycle = 0, left = nsn; left; cycle++) {
+		memset(used, 0, sizeof(used));
+		for (issued = 0; issued < schedmodel.width; issued++) {
+			best = -1;
+			for (i = 0; i < nsn; i++) {
+				a = &sn[i];
+				if (a->cycle >= 0 || a->npred || a->early > cycle)
+					continue;
+				if (schedmodel.units[a->si.class] &&
+				    used[a->si.class] ==
+				    schedmodel.units[a->si.class])
+					continue;
+				if (best < 0 || a->hgt > sn[best].hgt)
+					best = i;
+			}
+			if (best < 0)
+				break;
+			a = &sn[best];
+			a->cycle = cycle;
+			used[a->si.class]++;
+			DLIST_INSERT_AFTER(pos, a->mi, link);
+			pos = a->mi;
+			left--;
+			for (j = best+1; j < nsn; j++) {
+				if (edge[best][j] < 0)
+					continue;
+				sn[j].npred--;
+				if (sn[j].early < cycle + edge[best][j])
+					sn[j].early = cycle + edge[best][j];
+			}
+			i = a->lat > a->si.war ? a->lat : a->si.war;
+			if (end < cycle + i)
+				end = cycle + i;
+		}
+		if (issued == 0 && schedmodel.nop)
+			pos = addnop(pos);
+	}
+	/* wait for the results before leaving the block */
+	if (schedmodel.nop)
+		for (; cycle < end; cycle++)
+			pos = addnop(pos);
+	nsn = 0;
+}
+
+/*
+ * Schedule the instruction list of a function, with head as its
+ * list head.
+ */
+void
+schedule(struct minsn *head)
+{
+	struct minsn *mi, *next;
+	struct schedinfo si;
+	int unk;
+
+	nsn = 0;
+	unk = 0;
+	for (mi = DLIST_NEXT(head, link); mi != head; mi = next) {
+		next = DLIST_NEXT(mi, link);
+		if (sinfo(mi, &si) == 0) {
+			/* label, directive or something unknown */
+			sblock();
+			unk = mi->type != MI_LABEL;
+			continue;
+		}
+		if (si.flags & SF_NOP) {
+			if (schedmodel.nop && !unk) {
+				DLIST_REMOVE(mi, link);
+			} else
+				sblock();
+			continue;
+		}
+		unk = 0;
+		if (si.flags & SF_BARRIER) {
+			sblock();
+			continue;
+		}
+		if (nsn == SCHEDMAX)
+			sblock();
+		sn[nsn].mi = mi;
+		sn[nsn].si = si;
+		nsn++;
+	}
+	sblock();
+}
+#endif
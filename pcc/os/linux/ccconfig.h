@@ -52,6 +52,7 @@
 #include "../inc/amd64.h"
 #define	DYNLINKLIB	"/lib64/ld-linux-x86-64.so.2"
 #define MUSL_DYLIB	"/lib/ld-musl-x86_64.so.1"
+#define	USE_ELFOBJ	/* ccom can write object files */
 #ifndef MULTIARCH_PATH
 #define	DEFLIBDIRS	{ "/usr/lib64/", 0 }
 #else